@@ -0,0 +1,60 @@
+/*
+各个 C 基准共用的部分：计时、把生成的源码写进临时文件、用真正的 parser 解析、取 reps 次里最快的一次。
+包含前先定义 BENCH_NAME (比如 "lex_bench")，报错时的文件名用它。
+*/
+#ifndef VIX_BENCH_UTIL_H
+#define VIX_BENCH_UTIL_H
+
+#include <stdio.h>
+#include <time.h>
+#include "../include/ast.h"
+
+#ifndef BENCH_NAME
+#error "define BENCH_NAME before including bench_util.h"
+#endif
+
+extern FILE* yyin;
+extern ASTNode* root;
+extern int yyparse();
+extern void yyrestart(FILE* f);
+const char* current_input_filename = BENCH_NAME ".vix";
+
+static inline double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* gen 把 n 对应规模的源码写进临时文件，返回已经 rewind 的文件，失败返回 NULL */
+static inline FILE* bench_source(void (*gen)(FILE* fp, long long n), long long n) {
+    FILE* f = tmpfile();
+    if (!f) {
+        perror("tmpfile");
+        return NULL;
+    }
+    gen(f, n);
+    fflush(f);
+    rewind(f);
+    return f;
+}
+
+/* 从头解析 f，成功返回 root，解析耗时写进 *parse_ms；失败报错返回 NULL */
+static inline ASTNode* bench_parse(FILE* f, double* parse_ms) {
+    yyin = f;
+    yyrestart(f);
+    root = NULL;
+    double t0 = now_ms();
+    if (yyparse() != 0 || !root) {
+        fprintf(stderr, "Er: generated program failed to parse\n");
+        return NULL;
+    }
+    if (parse_ms) *parse_ms = now_ms() - t0;
+    return root;
+}
+
+/* 第 r 次 (从 0 数) 量到 ms 之后的最好成绩 */
+static inline double bench_best(double best, int r, double ms) {
+    return r == 0 || ms < best ? ms : best;
+}
+
+#endif
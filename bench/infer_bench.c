@@ -0,0 +1,65 @@
+/*
+类型推导基准：生成一个有 n 个变量的程序 (一半是全局 let，一半是函数里的局部变量，每个函数 100 个，
+各函数的局部变量同名)，用真正的 parser 解析，再计时 infer_type 走完整棵树。
+
+    cd src && make bench-infer                       # 默认 50000 个变量
+    make bench-infer INFER_ARGS="200000 5"           # 变量数、重复次数
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/type_inference.h"
+#include "../include/compiler.h"
+#define BENCH_NAME "infer_bench"
+#include "bench_util.h"
+
+#define LOCALS_PER_FUNCTION 100
+
+static void gen_program(FILE* fp, long long n) {
+    int nvars = (int)n;
+    int nlocals = nvars / 2;
+    int nfuncs = (nlocals + LOCALS_PER_FUNCTION - 1) / LOCALS_PER_FUNCTION;
+    for (int f = 0; f < nfuncs; f++) {
+        //不能叫 f<k>：f32 / f64 是类型关键字
+        fprintf(fp, "fn work%d(p: i32) -> i32 {\n    let v0 = %d\n", f, f);
+        for (int i = 1; i < LOCALS_PER_FUNCTION; i++) {
+            fprintf(fp, "    let v%d = v%d + %d\n", i, i - 1, f);
+        }
+        fprintf(fp, "    return v%d\n}\n", LOCALS_PER_FUNCTION - 1);
+    }
+    fprintf(fp, "let g0 = 0\n");
+    for (int i = 1; i < nvars - nlocals; i++) {
+        fprintf(fp, "let g%d = g%d + 1\n", i, i - 1);
+    }
+}
+
+int main(int argc, char** argv) {
+    int nvars = argc > 1 ? atoi(argv[1]) : 50000;
+    int reps = argc > 2 ? atoi(argv[2]) : 3;
+    if (nvars < 2 || reps < 1) {
+        fprintf(stderr, "usage: %s [variables] [repetitions]\n", argv[0]);
+        return 2;
+    }
+
+    FILE* f = bench_source(gen_program, nvars);
+    if (!f) return 1;
+    double parse_ms = 0;
+    if (!bench_parse(f, &parse_ms)) return 1;
+    fclose(f);
+
+    double best = 0;
+    int ok = 1;
+    for (int r = 0; r < reps; r++) {
+        TypeInferenceContext* ctx = create_type_inference_context();
+        double t0 = now_ms();
+        infer_type(ctx, root);
+        best = bench_best(best, r, now_ms() - t0);
+        char last[32];
+        snprintf(last, sizeof(last), "g%d", nvars - nvars / 2 - 1);
+        //全局都推成整数，函数的局部变量在函数结束时已经出了作用域
+        ok = ok && get_variable_type(ctx, last) == TYPE_INT && !has_variable(ctx, "v0") && !has_variable(ctx, "p");
+        free_type_inference_context(ctx);
+    }
+    printf("variables %d  parse %.1f ms  infer_type best of %d: %.1f ms  %s\n", nvars, parse_ms, reps, best,
+           ok && get_error_count() == 0 ? "ok" : "WRONG");
+    return ok && get_error_count() == 0 ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+/*
+词法基准：生成一个 n MB 的源文件 (关键字、有限个反复出现的标识符、数字、字符串、注释)，把 yylex 跑到底，
+先按 stdio (yyrestart) 再按 mmap (lexer_begin，编译器实际用的路径) 各量一遍，报吞吐和到那时为止的峰值 RSS。
+关键字不分配、标识符和字符串驻留，扫过的映射页会还掉，峰值内存只跟不同名字的个数有关，跟文件大小无关。
+
+    cd src && make bench-lex                    # 默认 500 MB
+    make bench-lex LEX_ARGS="64 5"              # MB 数、重复次数
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#define BENCH_NAME "lex_bench"
+#include "bench_util.h"
+
+extern int yylineno;
+extern int yylex(void);
+extern void lexer_begin(FILE* f);
+extern void lexer_end(void);
+
+#define DISTINCT_NAMES 4096
+
+static void gen_source(FILE* fp, long long bytes) {
+    long long i = 0;
+    while (ftell(fp) < bytes) {
+        int a = (int)(i % DISTINCT_NAMES);
+        int b = (int)((i * 7 + 3) % DISTINCT_NAMES);
+        fprintf(fp, "fn work_%d(p: i32, q: f64) -> i32 {\n", a);
+        fprintf(fp, "    let mut value_%d = p + %lld // 累加\n", b, i);
+        fprintf(fp, "    while value_%d < 0x%llx and q >= 1.5 {\n", b, i & 0xffff);
+        fprintf(fp, "        value_%d += work_%d(value_%d, q) * 3\n", b, b, a);
+        fprintf(fp, "    }\n    if value_%d == 0 { print(\"zero\\n\") } else { return value_%d }\n}\n", b, b);
+        i++;
+    }
+    //文件长度卡在页尾时 lexer_begin 放不下 flex 要的两个 '\0'，会退回 stdio；补几个换行错开
+    long page = sysconf(_SC_PAGESIZE);
+    while (page > 2 && (ftell(fp) % page == 0 || ftell(fp) % page > page - 2)) fputc('\n', fp);
+}
+
+static long long count_tokens(void) {
+    long long n = 0;
+    yylineno = 1;
+    while (yylex() != 0) n++;
+    return n;
+}
+
+int main(int argc, char** argv) {
+    long long mb = argc > 1 ? atoll(argv[1]) : 500;
+    int reps = argc > 2 ? atoi(argv[2]) : 3;
+    if (mb < 1 || reps < 1) {
+        fprintf(stderr, "usage: %s [megabytes] [repetitions]\n", argv[0]);
+        return 2;
+    }
+
+    FILE* f = bench_source(gen_source, mb * 1024 * 1024);
+    if (!f) return 1;
+    fseek(f, 0, SEEK_END);
+    double size_mb = ftell(f) / (1024.0 * 1024.0);
+
+    long long tokens[2] = {0, 0};
+    for (int mapped = 0; mapped < 2; mapped++) {
+        double best = 0;
+        for (int r = 0; r < reps; r++) {
+            rewind(f);
+            double t0 = now_ms();
+            if (mapped) {
+                lexer_begin(f);
+                tokens[mapped] = count_tokens();
+                lexer_end();
+            } else {
+                yyrestart(f);
+                tokens[mapped] = count_tokens();
+            }
+            best = bench_best(best, r, now_ms() - t0);
+        }
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        printf("%-5s %.0f MB  %lld tokens  yylex best of %d: %.1f ms (%.0f MB/s)  peak RSS %ld MB\n", mapped ? "mmap" : "stdio",
+               size_mb, tokens[mapped], reps, best, size_mb / (best / 1e3), ru.ru_maxrss / 1024);
+    }
+    fclose(f);
+    free_ast_arena();
+    if (tokens[0] != tokens[1]) {
+        fprintf(stderr, "Er: stdio and mmap scans disagree (%lld vs %lld tokens)\n", tokens[0], tokens[1]);
+        return 1;
+    }
+    return tokens[0] > 0 ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""--backend=qbe 对照检查：用真正的 qbe 编译 examples，输出要和 LLVM 后端一致
+
+    python3 bench/qbe_check.py                    # 需要 PATH 里有 qbe
+    python3 bench/qbe_check.py --only fib,lambda
+
+每个程序先用 LLVM -O0 编译作参照 (LLVM 也编不过的跳过)，再用 --backend=qbe --experimental-qbe 编译；
+两个可执行文件同名、在同样的工作目录下以相同参数运行，stdin 接 /dev/null，比较 stdout。
+qbe 编不过、输出不同或被信号杀掉 (LLVM 版没有) 就算失败，退出码为 1。退出码本身不比：
+没写 return 的 main 两边返回的都是寄存器里剩下的值。QBE_SKIP 里是已知不支持或本来就不该一致的程序。
+"""
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# 名字 -> 原因
+QBE_SKIP = {
+    "simd_bench": "SIMD vector types are not supported by --backend=qbe",
+    "toint": "toint(string) is parsed with atoi under qbe",
+    "rand": "does arithmetic on a function value (global seed = time)",
+}
+
+RUN_ARGS = ["a", "b"]
+
+
+def compile_one(vixc, src, out, backend):
+    cmd = [vixc, src, "-o", out, "--no-cache", "--backend=" + backend]
+    if backend == "llvm":
+        cmd.append("-O0")
+    else:
+        cmd.append("--experimental-qbe")
+    proc = subprocess.run(cmd, cwd=os.path.join(ROOT, "src"), stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                          universal_newlines=True)
+    return proc.returncode == 0, proc.stdout
+
+
+def run_one(exe, timeout):
+    proc = subprocess.run(["./" + os.path.basename(exe)] + RUN_ARGS, cwd=os.path.dirname(exe),
+                          stdin=subprocess.DEVNULL, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, timeout=timeout)
+    return proc.returncode, proc.stdout
+
+
+def main():
+    ap = argparse.ArgumentParser(description="compare --backend=qbe against the LLVM backend on examples/")
+    ap.add_argument("--vixc", default=os.path.join(ROOT, "src", "vixc"), help="compiler to check (default: src/vixc)")
+    ap.add_argument("--only", help="comma separated program names to check")
+    ap.add_argument("--timeout", type=float, default=60, help="per-run timeout in seconds")
+    args = ap.parse_args()
+
+    vixc = os.path.abspath(args.vixc)
+    if not os.access(vixc, os.X_OK):
+        sys.exit("error: %s is not an executable (build it with make in src/ or pass --vixc)" % vixc)
+    if not shutil.which("qbe"):
+        sys.exit("error: qbe not found in PATH (https://c9x.me/compile/)")
+
+    programs = []
+    for sub in ("examples", os.path.join("examples", "test")):
+        for f in sorted(os.listdir(os.path.join(ROOT, sub))):
+            if f.endswith(".vix"):
+                programs.append((f[:-4], os.path.join(ROOT, sub, f)))
+    if args.only:
+        wanted = set(args.only.split(","))
+        programs = [p for p in programs if p[0] in wanted]
+
+    work = tempfile.mkdtemp(prefix="vix-qbe-")
+    passed, failed, skipped = 0, [], 0
+    try:
+        for name, src in programs:
+            if name in QBE_SKIP:
+                print("%-22s skip: %s" % (name, QBE_SKIP[name]))
+                skipped += 1
+                continue
+            exes = {}
+            for backend in ("llvm", "qbe"):
+                os.makedirs(os.path.join(work, backend), exist_ok=True)
+                exes[backend] = os.path.join(work, backend, name)
+            ok, _ = compile_one(vixc, src, exes["llvm"], "llvm")
+            if not ok:
+                skipped += 1  # 库模块、故意报错的例子、缺外部依赖的例子
+                continue
+            ok, log = compile_one(vixc, src, exes["qbe"], "qbe")
+            if not ok:
+                print("%-22s FAILED: qbe compile\n%s" % (name, log))
+                failed.append(name)
+                continue
+            try:
+                ref = run_one(exes["llvm"], args.timeout)
+                got = run_one(exes["qbe"], args.timeout)
+            except subprocess.TimeoutExpired:
+                print("%-22s FAILED: timeout" % name)
+                failed.append(name)
+                continue
+            if got[1] != ref[1] or (got[0] < 0 and ref[0] >= 0):
+                print("%-22s FAILED: exit %d vs %d, stdout %s" % (name, got[0], ref[0],
+                                                                  "same" if got[1] == ref[1] else "differs"))
+                failed.append(name)
+                continue
+            print("%-22s ok" % name, flush=True)
+            passed += 1
+    finally:
+        shutil.rmtree(work, ignore_errors=True)
+
+    print("\npassed %d, failed %d, skipped %d" % (passed, len(failed), skipped))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
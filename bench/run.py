@@ -0,0 +1,326 @@
+#!/usr/bin/env python3
+"""Vix 编译器 / 生成代码基准
+
+    python3 bench/run.py                          # 全部基准，结果写到 bench/results.json
+    python3 bench/run.py --baseline bench/baseline.json   # 和基线比较，有回退时退出码为 1
+    python3 bench/run.py --save bench/baseline.json       # 记录新的基线
+    python3 bench/run.py --backend qbe                    # 用 --backend=qbe 编译
+    python3 bench/run.py --compare-backends --runs 0      # 同一语料比较 llvm -O0 / llvm -O2 / qbe 的编译时间
+    python3 bench/run.py --vec-check                      # 用 --vec-report 检查向量化核心的循环确实被向量化
+
+每个程序用 --no-cache --time-phases=json 编译若干次，各阶段取中位数；
+生成的可执行文件先预热一次，再运行若干次统计 min / median / mean / stdev。
+合成程序 synth_<n> 有 n 个小函数，用来看编译时间随规模的变化。
+"""
+
+import argparse
+import datetime
+import json
+import os
+import platform
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# (名字, 源文件)；运行时 stdin/stdout 都接 /dev/null
+CORPUS = [
+    ("fib40", "examples/test/fib40.vix"),
+    ("sort", "examples/test/sort.vix"),
+    ("quicksort", "examples/quicksort.vix"),
+    ("print", "examples/print_bench.vix"),
+    ("push", "examples/push_bench.vix"),
+    ("str_scan", "examples/str_scan_bench.vix"),
+    ("vectorize", "examples/vectorize_bench.vix"),
+    ("simd", "examples/simd_bench.vix"),
+    ("string_builder", "examples/string_builder_bench.vix"),
+]
+
+# --vec-check：源文件 -> 必须报 vectorized 的函数
+VEC_EXPECT = [
+    ("examples/vectorize_bench.vix", ["dot", "dotf", "saxpy"]),
+]
+
+SYNTH_SIZES = [1000, 10000, 100000]
+PHASES = ["parse", "imports", "semantic", "fold", "emit", "opt", "codegen", "link"]
+
+
+def gen_synthetic(path, nfuncs, group=100):
+    """n 个互不相同的小函数 work<i>，按 group 个一组由 group<j> 调用，main 调用所有 group<j>
+    (不能叫 f<i>：f32 / f64 是类型关键字)"""
+    with open(path, "w") as f:
+        f.write("// 合成基准: %d 个函数，由 bench/run.py 生成\n" % nfuncs)
+        for i in range(nfuncs):
+            f.write(
+                "fn work%d(x: i32) -> i32 {\n"
+                "    let a = x * %d + %d\n"
+                "    let s = 0\n"
+                "    for (k in 0 .. 4) {\n"
+                "        if (a %% 2 == 0) {\n"
+                "            s = s + a / 2\n"
+                "        } else {\n"
+                "            s = s + a * 3 + 1\n"
+                "        }\n"
+                "        a = s %% 1000\n"
+                "    }\n"
+                "    return s\n"
+                "}\n" % (i, i % 7 + 1, i % 101))
+        ngroups = (nfuncs + group - 1) // group
+        for j in range(ngroups):
+            f.write("fn group%d(x: i32) -> i32 {\n    let v = x\n" % j)
+            for i in range(j * group, min(nfuncs, (j + 1) * group)):
+                f.write("    v = work%d(v) %% 100000\n" % i)
+            f.write("    return v\n}\n")
+        f.write("fn main() -> i32 {\n    let v = 1\n")
+        for j in range(ngroups):
+            f.write("    v = group%d(v)\n" % j)
+        f.write("    print(v)\n    return 0\n}\n")
+
+
+def stats(samples):
+    return {
+        "samples": [round(s, 6) for s in samples],
+        "min": min(samples),
+        "median": statistics.median(samples),
+        "mean": statistics.mean(samples),
+        "stdev": statistics.stdev(samples) if len(samples) > 1 else 0.0,
+    }
+
+
+def compile_once(vixc, src, out, opt, backend="llvm"):
+    cmd = [vixc, src, "-o", out, "-O%d" % opt, "--no-cache", "--time-phases=json", "--backend=" + backend]
+    if backend == "qbe":
+        cmd.append("--experimental-qbe")
+    proc = subprocess.run(cmd, cwd=ROOT, stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+    if proc.returncode != 0:
+        raise RuntimeError("compile failed: %s\n%s" % (" ".join(cmd), proc.stderr))
+    for line in reversed(proc.stderr.splitlines()):
+        if line.startswith("{\"phases_ms\""):
+            return json.loads(line)
+    raise RuntimeError("no --time-phases output from %s (vixc too old?)" % vixc)
+
+
+def bench_compile(vixc, src, out, opt, reps, backend="llvm"):
+    runs = [compile_once(vixc, src, out, opt, backend) for _ in range(reps)]
+    return {
+        "phases_ms": {p: statistics.median(r["phases_ms"].get(p, 0.0) for r in runs) for p in PHASES},
+        "total_ms": stats([r["total_ms"] for r in runs]),
+    }
+
+
+def bench_run(exe, reps, timeout):
+    def once():
+        start = time.perf_counter()
+        proc = subprocess.run([exe], cwd=ROOT, stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL,
+                              stderr=subprocess.PIPE, timeout=timeout)
+        elapsed = time.perf_counter() - start
+        if proc.returncode != 0:
+            raise RuntimeError("%s exited with %d: %s" % (exe, proc.returncode, proc.stderr.decode(errors="replace")))
+        return elapsed
+    once()  # 预热：页缓存、动态链接
+    return stats([once() for _ in range(reps)])
+
+
+def git_commit():
+    try:
+        return subprocess.check_output(["git", "rev-parse", "--short", "HEAD"], cwd=ROOT,
+                                       stderr=subprocess.DEVNULL, universal_newlines=True).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return ""
+
+
+def compare(results, baseline, tolerance, min_compile_ms, min_run_s):
+    """比较各程序的编译总时间、每个阶段和运行时间的中位数，返回回退列表"""
+    regressions = []
+    base = baseline.get("benchmarks", {})
+    print("\n%-22s %-16s %12s %12s %8s" % ("benchmark", "metric", "baseline", "current", "change"))
+    for name, cur in results["benchmarks"].items():
+        old = base.get(name)
+        if not old:
+            print("%-22s (no baseline)" % name)
+            continue
+        metrics = [("compile_ms", old["compile"]["total_ms"]["median"], cur["compile"]["total_ms"]["median"], min_compile_ms)]
+        for p in PHASES:
+            metrics.append(("  " + p + "_ms", old["compile"]["phases_ms"].get(p, 0.0), cur["compile"]["phases_ms"].get(p, 0.0),
+                            min_compile_ms))
+        if "run_s" in old and "run_s" in cur:
+            metrics.append(("run_s", old["run_s"]["median"], cur["run_s"]["median"], min_run_s))
+        for metric, a, b, floor in metrics:
+            change = (b - a) / a if a > 0 else 0.0
+            bad = b > a * (1 + tolerance) and b - a > floor
+            if bad:
+                regressions.append((name, metric.strip(), a, b))
+            if bad or not metric.startswith("  "):
+                print("%-22s %-16s %12.3f %12.3f %+7.1f%%%s" % (name, metric, a, b, change * 100, "  REGRESSION" if bad else ""))
+    return regressions
+
+
+# --compare-backends 的三种配置：(列名, 后端, -O)
+BACKEND_CONFIGS = [("llvm-O0", "llvm", 0), ("llvm-O2", "llvm", 2), ("qbe", "qbe", 0)]
+
+
+def compare_backends(vixc, programs, work, reps):
+    """每个程序按 BACKEND_CONFIGS 各编译 reps 次，打印总编译时间中位数和 qbe 相对 llvm -O0 的倍数"""
+    print("%-22s %12s %12s %12s %10s" % (("benchmark",) + tuple(c[0] + " ms" for c in BACKEND_CONFIGS) + ("O0/qbe",)))
+    table = {}
+    failed = False
+    for name, src in programs:
+        row = {}
+        for label, backend, opt in BACKEND_CONFIGS:
+            try:
+                row[label] = bench_compile(vixc, src, os.path.join(work, name + "-" + label), opt, reps, backend)
+            except RuntimeError as e:
+                print("%-22s %s FAILED: %s" % (name, label, e), file=sys.stderr)
+                failed = True
+        table[name] = row
+        cols = ["%12.1f" % row[c[0]]["total_ms"]["median"] if c[0] in row else "%12s" % "-" for c in BACKEND_CONFIGS]
+        ratio = "-"
+        if "llvm-O0" in row and "qbe" in row and row["qbe"]["total_ms"]["median"] > 0:
+            ratio = "%.2fx" % (row["llvm-O0"]["total_ms"]["median"] / row["qbe"]["total_ms"]["median"])
+        print("%-22s %s %10s" % (name, " ".join(cols), ratio), flush=True)
+    return table, failed
+
+
+def vec_check(vixc, opt, work):
+    """按 VEC_EXPECT 编译成目标文件 (不链接) 并打开 --vec-report，返回没被向量化的 (源文件, 函数) 列表"""
+    missing = []
+    for src, funcs in VEC_EXPECT:
+        obj = os.path.join(work, os.path.basename(src) + ".o")
+        cmd = [vixc, os.path.join(ROOT, src), "-obj", obj, "-O%d" % max(opt, 1), "--no-cache", "--vec-report"]
+        proc = subprocess.run(cmd, cwd=ROOT, stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+        if proc.returncode != 0:
+            raise RuntimeError("compile failed: %s\n%s" % (" ".join(cmd), proc.stderr))
+        vectorized = set()
+        for line in proc.stderr.splitlines():
+            parts = line.split(": ", 3)
+            if len(parts) >= 3 and parts[0] == "vec" and parts[2] == "vectorized":
+                vectorized.add(parts[1])
+        for fn in funcs:
+            ok = fn in vectorized
+            print("%-32s %-10s %s" % (src, fn, "vectorized" if ok else "NOT VECTORIZED"), flush=True)
+            if not ok:
+                missing.append((src, fn))
+    return missing
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Vix compiler and generated-code benchmarks")
+    ap.add_argument("--vixc", default=os.path.join(ROOT, "src", "vixc"), help="compiler to benchmark (default: src/vixc)")
+    ap.add_argument("-O", dest="opt", type=int, default=2, help="optimization level passed to vixc (default 2)")
+    ap.add_argument("--backend", choices=["llvm", "qbe"], default="llvm", help="code generator passed to vixc (default llvm)")
+    ap.add_argument("--compare-backends", action="store_true",
+                    help="only compare compile times of llvm -O0, llvm -O2 and qbe; results go to --save")
+    ap.add_argument("--vec-check", action="store_true",
+                    help="only check that the loops listed in VEC_EXPECT are vectorized; exit 1 otherwise")
+    ap.add_argument("--compile-reps", type=int, default=3, help="compilations per program (default 3)")
+    ap.add_argument("--runs", type=int, default=5, help="timed runs per binary after one warm-up (default 5)")
+    ap.add_argument("--sizes", default=",".join(str(n) for n in SYNTH_SIZES),
+                    help="synthetic program sizes in functions, comma separated, empty to skip")
+    ap.add_argument("--only", help="comma separated benchmark names to run")
+    ap.add_argument("--timeout", type=float, default=300, help="per-run timeout in seconds")
+    ap.add_argument("--save", default=os.path.join(ROOT, "bench", "results.json"), help="where to write the results JSON")
+    ap.add_argument("--baseline", help="baseline JSON to compare against; exit 1 on regressions")
+    ap.add_argument("--tolerance", type=float, default=0.10, help="allowed slowdown before flagging (default 0.10)")
+    ap.add_argument("--min-compile-ms", type=float, default=5.0, help="ignore compile-time changes smaller than this")
+    ap.add_argument("--min-run-s", type=float, default=0.01, help="ignore runtime changes smaller than this")
+    args = ap.parse_args()
+
+    vixc = os.path.abspath(args.vixc)
+    if not os.access(vixc, os.X_OK):
+        sys.exit("error: %s is not an executable (build it with make in src/ or pass --vixc)" % vixc)
+
+    work = tempfile.mkdtemp(prefix="vix-bench-")
+    if args.vec_check:
+        try:
+            missing = vec_check(vixc, args.opt, work)
+        except RuntimeError as e:
+            print("vec-check FAILED: %s" % e, file=sys.stderr)
+            return 1
+        finally:
+            shutil.rmtree(work, ignore_errors=True)
+        if missing:
+            print("\n%d loop(s) expected to vectorize did not" % len(missing))
+            return 1
+        print("\nall expected loops vectorized")
+        return 0
+    programs = [(name, os.path.join(ROOT, src)) for name, src in CORPUS]
+    for n in [int(s) for s in args.sizes.split(",") if s.strip()]:
+        path = os.path.join(work, "synth_%d.vix" % n)
+        gen_synthetic(path, n)
+        programs.append(("synth_%d" % n, path))
+    if args.only:
+        wanted = set(args.only.split(","))
+        programs = [p for p in programs if p[0] in wanted]
+
+    results = {
+        "meta": {
+            "date": datetime.datetime.now().isoformat(timespec="seconds"),
+            "commit": git_commit(),
+            "host": platform.node(),
+            "machine": platform.machine(),
+            "vixc": vixc,
+            "opt": args.opt,
+            "backend": args.backend,
+            "compile_reps": args.compile_reps,
+            "runs": args.runs,
+        },
+        "benchmarks": {},
+    }
+    if args.compare_backends:
+        try:
+            results["backends"], failed = compare_backends(vixc, programs, work, args.compile_reps)
+        finally:
+            shutil.rmtree(work, ignore_errors=True)
+        with open(args.save, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print("results written to %s" % args.save)
+        return 1 if failed else 0
+
+    failed = False
+    try:
+        for name, src in programs:
+            exe = os.path.join(work, name)
+            try:
+                entry = {"source": os.path.relpath(src, ROOT) if src.startswith(ROOT) else os.path.basename(src)}
+                entry["compile"] = bench_compile(vixc, src, exe, args.opt, args.compile_reps, args.backend)
+                entry["binary_bytes"] = os.path.getsize(exe)
+                if args.runs > 0:
+                    entry["run_s"] = bench_run(exe, args.runs, args.timeout)
+            except (RuntimeError, subprocess.TimeoutExpired) as e:
+                print("%-22s FAILED: %s" % (name, e), file=sys.stderr)
+                failed = True
+                continue
+            results["benchmarks"][name] = entry
+            ph = entry["compile"]["phases_ms"]
+            line = "%-22s compile %9.1f ms (parse %.1f, sema %.1f, emit %.1f, opt %.1f, codegen %.1f, link %.1f)" % (
+                name, entry["compile"]["total_ms"]["median"], ph["parse"], ph["semantic"], ph["emit"], ph["opt"],
+                ph["codegen"], ph["link"])
+            if "run_s" in entry:
+                line += "  run %.4f s ± %.4f" % (entry["run_s"]["median"], entry["run_s"]["stdev"])
+            print(line, flush=True)
+    finally:
+        shutil.rmtree(work, ignore_errors=True)
+
+    with open(args.save, "w") as f:
+        json.dump(results, f, indent=2, sort_keys=True)
+        f.write("\n")
+    print("results written to %s" % args.save)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        regressions = compare(results, baseline, args.tolerance, args.min_compile_ms, args.min_run_s)
+        if regressions:
+            print("\n%d regression(s) against %s" % (len(regressions), args.baseline))
+            return 1
+        print("\nno regressions against %s" % args.baseline)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,91 @@
+/*
+语义检查基准：生成只有一个函数、函数体有 n 条语句的程序 (默认 100000)，用真正的 parser 解析，
+计时 check_undefined_symbols + check_unused_variables。同样的程序再按 n/8、n/4、n/2 各跑一遍，
+在双对数坐标上对 (语句数, 耗时) 做最小二乘，斜率超过 SLOPE_LIMIT 就判失败。平方级的遍历斜率在 2 附近；
+线性的本该是 1，但符号表、驻留表大到出了缓存以后每次查找变慢，实测在 1.2 到 1.45 之间。
+单个规模上的抖动只会让斜率偏一点，不会把两者搞混。
+
+    cd src && make bench-semantic                    # 默认 100000 条语句
+    make bench-semantic SEMANTIC_ARGS="400000 5"     # 语句数、重复次数
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "../include/semantic.h"
+#include "../include/compiler.h"
+#define BENCH_NAME "semantic_bench"
+#include "bench_util.h"
+
+#define SIZES 4
+#define SLOPE_LIMIT 1.7
+
+static void gen_program(FILE* fp, long long nstmts) {
+    //每 10 条里一条是 acc += 上一个变量，其余是依次引用上一个变量的 let，保证每个变量都被用到
+    fprintf(fp, "fn big(p: i32) -> i32 {\n    let mut acc = p\n    let v0 = p + 1\n");
+    int last = 0;
+    for (int i = 1; i < nstmts - 3; i++) {
+        if (i % 10 == 0) {
+            fprintf(fp, "    acc += v%d\n", last);
+        } else {
+            fprintf(fp, "    let v%d = v%d + %d\n", i, last, i % 7);
+            last = i;
+        }
+    }
+    fprintf(fp, "    return acc + v%d\n}\nfn main() -> i32 {\n    return big(1)\n}\n", last);
+}
+
+/* 返回 reps 次里最快的语义检查耗时，解析失败或报了错返回 -1 */
+static double run_size(int nstmts, int reps, double* parse_ms) {
+    FILE* f = bench_source(gen_program, nstmts);
+    if (!f) return -1;
+    ASTNode* prog = bench_parse(f, parse_ms);
+    fclose(f);
+    if (!prog) return -1;
+
+    double best = 0;
+    for (int r = 0; r < reps; r++) {
+        double t0 = now_ms();
+        int errs = check_undefined_symbols(prog);
+        SymbolTable* g_tbl = create_symbol_table(NULL);
+        int unused = check_unused_variables(prog, g_tbl);
+        destroy_symbol_table(g_tbl);
+        double ms = now_ms() - t0;
+        if (errs || unused || get_error_count()) {
+            fprintf(stderr, "Er: generated program has %d error(s), %d unused variable(s)\n", errs, unused);
+            return -1;
+        }
+        best = bench_best(best, r, ms);
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 100000;
+    int reps = argc > 2 ? atoi(argv[2]) : 3;
+    if (n < 800 || reps < 1) {
+        fprintf(stderr, "usage: %s [statements >= 800] [repetitions]\n", argv[0]);
+        return 2;
+    }
+
+    //ms = c * n^k 两边取对数是直线，斜率 k 就是增长的阶
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (int i = 0; i < SIZES; i++) {
+        int size = n >> (SIZES - 1 - i);
+        double parse_ms = 0;
+        double ms = run_size(size, reps, &parse_ms);
+        if (ms < 0) return 1;
+        printf("statements %7d  parse %8.1f ms  semantic best of %d: %8.1f ms  (%.2f us/stmt)\n", size, parse_ms, reps,
+               ms, ms * 1e3 / size);
+        double x = log(size), y = log(ms > 1e-3 ? ms : 1e-3);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    double slope = (SIZES * sxy - sx * sy) / (SIZES * sxx - sx * sx);
+    int ok = slope <= SLOPE_LIMIT;
+    printf("semantic time grows as n^%.2f from %d to %d statements: %s\n", slope, n >> (SIZES - 1), n,
+           ok ? "linear" : "SUPERLINEAR");
+    free_ast_arena();
+    return ok ? 0 : 1;
+}
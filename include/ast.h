@@ -61,7 +61,8 @@ typedef enum {
     AST_CALL,
     AST_STRUCT_DEF,
     AST_STRUCT_LITERAL,
-    AST_NIL
+    AST_NIL,
+    AST_MATCH
 } NodeType;
 
 typedef enum {
@@ -99,6 +100,7 @@ typedef struct ASTNode {
     Location location;// 位置信息
     const char* source_file;
     MutabilityType mutability; // 可变性标记
+    unsigned int visit_epoch;  // 语义遍历的访问戳，由 arena 清零
     union {
         struct {
             struct ASTNode** statements;
@@ -176,11 +178,18 @@ typedef struct ASTNode {
             struct ASTNode* condition;
             struct ASTNode* body;
         } while_stmt;
+        struct {
+            struct ASTNode* scrutinee;
+            struct ASTNode* arms;//AST_EXPRESSION_LIST，每个分支是 AST_ASSIGN(pattern, body)
+            struct ASTNode* lowered;//lower_match_to_if 的结果，按需生成
+        } match_stmt;
         struct {
             struct ASTNode* var;
             struct ASTNode* start;
             struct ASTNode* end;
             struct ASTNode* body;
+            int vectorize;//@vectorize
+            int unroll;//@unroll(n)，0 表示没写
         } for_stmt;
         struct {
             char* name;
@@ -285,6 +294,9 @@ ASTNode* create_if_node(ASTNode* condition, ASTNode* then_body, ASTNode* else_bo
 ASTNode* create_while_node_with_location(ASTNode* condition, ASTNode* body, Location location);
 ASTNode* create_while_node_with_yyltype(ASTNode* condition, ASTNode* body, void* yylloc);
 ASTNode* create_while_node(ASTNode* condition, ASTNode* body);
+ASTNode* create_match_node_with_location(ASTNode* scrutinee, ASTNode* arms, Location location);
+ASTNode* create_match_node_with_yyltype(ASTNode* scrutinee, ASTNode* arms, void* yylloc);
+ASTNode* lower_match_to_if(ASTNode* match);//没有 switch 的后端和语义检查用的 if-else 形式
 ASTNode* create_for_node(ASTNode* var, ASTNode* start, ASTNode* end, ASTNode* body);
 ASTNode* create_for_node_with_location(ASTNode* var, ASTNode* start, ASTNode* end, ASTNode* body, Location location);
 ASTNode* create_for_node_with_yyltype(ASTNode* var, ASTNode* start, ASTNode* end, ASTNode* body, void* yylloc);
@@ -324,10 +336,30 @@ ASTNode* create_global_node_with_yyltype(ASTNode* identifier, ASTNode* type, AST
 ASTNode* create_import_node(const char* module_path);
 ASTNode* create_import_node_with_location(const char* module_path, Location location);
 ASTNode* create_import_node_with_yyltype(const char* module_path, void* yylloc);
-void free_ast(ASTNode* node);
+// 节点和字符串都在解析会话的 arena 里，不单独释放；free_ast_arena 一次性归还
+void* ast_alloc(size_t size);
+char* ast_strdup(const char* s);
+char* ast_intern(const char* s);
+char* ast_intern_len(const char* s, size_t len);
+char* ast_intern_find(const char* s);
+void free_ast_arena(void);
 void print_ast(ASTNode* node, int indent);
 int get_array_length(ASTNode* node);
+// v4f32、v8i32 这类 SIMD 向量类型名：取元素类型和通道数，不是向量类型返回 0
+int vector_type_info(const char* name, NodeType* elem, int* lanes);
+// 常量折叠和常量传播，剪掉条件是常量的 if 分支；语义检查之后、各后端之前调用
+void fold_constants(ASTNode* root);
 // Inline imports: parse modules and inline their `pub` functions into the AST
 void inline_imports(ASTNode* node);
+// Separate compilation: replace imports with the modules' `pub` interface (signatures, struct layouts);
+// each module's own AST is kept for compiling to its own object. Returns the module count.
+int import_module_interfaces(ASTNode* node);
+ASTNode* imported_module_root(int index, const char** path);
+// 把第 index 个模块的接口 (导出的签名、泛型函数、结构体布局、常量) 写成文本，分离编译时和模块的 .o 一起缓存
+int write_module_interface(int index, FILE* f);
+// 设置后 import_module_interfaces 先用它按模块路径打开缓存里的接口文件，读到了就不解析这个模块，
+// imported_module_root 对它返回 NULL (path 照常给出)，它的 .o 从缓存里取
+void set_module_interface_cache(FILE* (*open_cached)(const char* module_path));
+void clear_imported_modules(void);
 
 #endif/*AST_H*/
\ No newline at end of file
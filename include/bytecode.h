@@ -6,6 +6,7 @@ typedef enum {
     BC_LOAD_CONST_INT,
     BC_LOAD_CONST_FLOAT,
     BC_LOAD_CONST_STRING,
+    BC_LOAD_CONST_CHAR,
     BC_LOAD_NAME,
     BC_STORE_NAME,
     BC_PRINT,
@@ -45,7 +46,22 @@ typedef enum {
     BC_STRUCT_DEF,
     BC_STRUCT_CREATE,
     BC_STRUCT_GET_FIELD,
-    BC_STRUCT_SET_FIELD
+    BC_STRUCT_SET_FIELD,
+    BC_MOVE,
+    BC_LOAD_NIL,
+    BC_LIST_NEW,
+    BC_LIST_PUSH,
+    BC_INDEX_SET,
+    BC_LENGTH,
+    BC_LOAD_CONST_I64,  // 放不进 32 位的整数常量，标记在编译期定好
+    BC_ADD_I32,         // 两边在编译期已知是 32 位整数，结果按 32 位回绕
+    BC_ADD_I64,         // 两边都是整数且至少一边是 64 位，不用截断
+    BC_SUB_I32,
+    BC_SUB_I64,
+    BC_MUL_I32,
+    BC_MUL_I64,
+    BC_HALT,
+    BC_OP_COUNT
 } ByteCodeInstruction;
 
 typedef struct {
@@ -64,15 +80,26 @@ typedef struct {
 typedef struct {
     char* name;
     int* param_indices;
+    int* param_bits;  // 参数声明的整数位宽 8/32/64，0 表示没写或不是整数
     int param_count;
     int entry_point;
+    int frame_size;   // 寄存器个数（变量 + 临时）
 } FunctionDefArgs;
 typedef struct {
     char* name;
     int* arg_indices;
     int arg_count;
     int result_index;
+    int func_index;   // 生成结束后解析成 BC_FUNCTION_DEF 的位置，运行时不再查名字
+    int* arg_bits;    // 实参在编译期已知的整数位宽，0 表示不知道
+    int wrap_args;    // 有实参的位宽和形参声明的不一样，调用时要截断
 } CallArgs;
+typedef struct {
+    int var_index;
+    int end_index;
+    int step_index;
+    int address;
+} ForArgs;
 typedef struct {
     int target_index;
     int index_index;
@@ -107,6 +134,8 @@ typedef struct {
 
 typedef struct {
     ByteCodeInstruction op;
+    int reg;          // 单寄存器指令的目标/条件寄存器
+    int line;         // 源码行号，运行时报错用
     union {
         long long int_value;
         double float_value;
@@ -114,6 +143,7 @@ typedef struct {
         int var_index;
         PrintArgs print_args;
         JumpArgs jump_args;
+        ForArgs for_args;
         TriAddrOperands triaddr;
         FunctionDefArgs func_def_args;
         CallArgs call_args;
@@ -129,6 +159,8 @@ typedef struct {
     ByteCode* codes;
     int count;
     int capacity;
+    int entry_frame_size; // 顶层帧（全局变量 + 顶层临时）大小
+    const char* source_file;
 } ByteCodeList;
 
 typedef struct {
@@ -137,6 +169,23 @@ typedef struct {
     int var_count;
     int var_capacity;
     int tmp_counter;  
+    char** globals;       // 顶层变量，函数里通过 LOAD_NAME/STORE_NAME 访问
+    int global_count;
+    int in_function;
+    int ret_bits;         // 当前函数返回值声明的整数位宽，写进 RETURN 的操作数
+    int* var_bits;        // 和 variables 对应：没被重新赋值的整数参数的位宽，其余为 0
+    ASTNode* program;     // 顶层 AST，查被调函数声明的返回位宽
+    int max_regs;
+    int* break_patches;
+    int break_count;
+    int break_capacity;
+    int* continue_patches;
+    int continue_count;
+    int continue_capacity;
+    int loop_break_base;
+    int loop_continue_base;
+    int error_count;
+    int cur_line;
 } ByteCodeGen;
 
 ByteCodeList* create_bytecode_list();
@@ -149,5 +198,6 @@ void generate_bytecode_print(ByteCodeGen* gen, ASTNode* node);
 int get_variable_index(ByteCodeGen* gen, const char* name);
 void print_bytecode(ByteCodeList* list);
 void print_bytecode_to_file(ByteCodeList* list, FILE* output);
+int finalize_bytecode(ByteCodeGen* gen);
 
 #endif /*BYTECODE_H*/
\ No newline at end of file
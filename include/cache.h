@@ -0,0 +1,17 @@
+#ifndef CACHE_H
+#define CACHE_H
+#include <stdio.h>
+/*
+编译缓存：~/.cache/vix/<key>.o，分离编译的模块还有接口摘要 <key>.vi (见 ast.h 的 write_module_interface)
+key = 编译器版本 + 编译器二进制的内容 + 选项 (本机编译含 host CPU 名和特性) + 源文件及其递归 import 的内容
+*/
+#define VIX_CACHE_KEY_LEN 17
+#define VIX_VERSION "0.1.0_rc1_2 (Beta_26.01.01)"
+
+int vix_cache_key(const char* in_f, const char* flags, char key[VIX_CACHE_KEY_LEN]);
+int vix_cache_has(const char* key);
+int vix_cache_fetch(const char* key, const char* obj_path);
+void vix_cache_store(const char* key, const char* obj_path);
+FILE* vix_cache_open_interface(const char* key);
+void vix_cache_store_interface(const char* key, const char* vi_path);
+#endif /*CACHE_H*/
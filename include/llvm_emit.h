@@ -9,6 +9,23 @@ extern "C" {
 typedef struct ASTNode ASTNode;
 void llvm_emit_from_ast(ASTNode* ast_root, FILE* llvm_fp);
 void llvm_set_target_triple(const char* triple);
+void llvm_set_opt_level(int level);
+void llvm_set_jobs(int jobs);
+// print 输出方式：0 线程局部缓冲，1 每次 print 后刷新（--unbuffered），2 直接 printf（裸机）
+void llvm_set_print_mode(int mode);
+// 数组/列表下标越界检查（--bounds-check）
+void llvm_set_bounds_check(int enabled);
+// 循环向量化报告（--vec-report），只在 -O1 以上有输出
+void llvm_set_vec_report(int enabled);
+// --time-phases：累计的 AST->IR、优化 pass、出目标文件耗时 (ms)，-j 时取最慢的分区
+void llvm_get_phase_times(double* emit_ms, double* opt_ms, double* codegen_ms);
+// 本机编译用的 CPU 名和特性串 ("skylake +avx2,+fma,...")，缓存 key 用它区分机器
+void llvm_host_cpu_desc(char* buf, size_t size);
+// 非空时下一次 llvm_emit_object_from_ast 把出 .o 的 module 同时写成 .ll (-kt)，只生成一遍
+void llvm_set_ir_output(FILE* llvm_fp);
+int llvm_emit_object_from_ast(ASTNode* ast_root, const char* obj_path, int pic);
+// 分离编译的 import 模块：不生成默认 main，非 pub 符号为 internal
+int llvm_emit_module_object_from_ast(ASTNode* ast_root, const char* obj_path, int pic);
 
 #ifdef __cplusplus
 }//c api
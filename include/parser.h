@@ -3,6 +3,9 @@
 #include "ast.h"
 int yylex(void);
 int yyparse(void);
+//f 交给词法分析器：普通文件 mmap 进来直接扫，别的照旧读 yyin；和 lexer_end 成对，可以嵌套
+void lexer_begin(FILE* f);
+void lexer_end(void);
 void yyerror(const char *s);
 extern ASTNode* root;
 #endif//PARSER_H
@@ -46,9 +46,45 @@ typedef struct QbeGenState {
 	char **pending_struct_defs;
 	int pending_struct_defs_count;
 	int pending_struct_defs_capacity;
+	/* ir_gen：AST 直接生成 QBE IL（--backend=qbe） */
+	FILE* data_out;             // 字符串常量和全局变量，最后接在函数后面
+	char* data_buf;
+	size_t data_len;
+	FILE* fn_body;              // 当前函数的指令，函数生成完再和 fn_alloc 一起写进 output
+	char* fn_body_buf;
+	size_t fn_body_len;
+	FILE* fn_alloc;             // 当前函数入口块里的 alloc8，变量都放在栈槽里
+	char* fn_alloc_buf;
+	size_t fn_alloc_len;
+	int terminated;             // 上一条是 ret/jmp/jnz/hlt，后面的指令要另开一个块
+	int break_label;
+	int continue_label;
+	int scratch_slot;           // StringBuilder 格式化数字用的栈缓冲
+	int string_counter;
+	int in_top;                 // 正在生成顶层语句：变量都是全局变量
+	struct ASTNode** func_nodes;        // 与 func_names 一一对应
+	char ***func_bindings;      // 泛型实例：类型参数名和实参类型交替存放，普通函数为 NULL
+	int *func_binding_counts;
+	char **func_symbols;        // 生成的符号名（泛型实例、重名的 lambda 不同于源码里的名字）
+	int *func_emitted;
+	int *func_index;            // func_names 上的开放寻址哈希，名字都 intern 过，按指针比较
+	int func_index_capacity;
+	int *global_index;
+	int global_index_capacity;
+	char **type_bindings;       // 正在生成的泛型实例
+	int type_binding_count;
+	unsigned int used_helpers;  // 用到的运行时辅助函数，最后按需输出
+	struct ASTNode** append_nodes;      // 循环里改写成往 StringBuilder 追加的 s = s + ... 赋值
+	int *append_slots;          // 对应 builder 的栈槽
+	int append_count;
+	int append_capacity;
 } QbeGenState;
 
 void ir_gen(ASTNode* ast, FILE* fp);
+void qbe_set_print_mode(int unbuffered);
+void qbe_set_bounds_check(int enabled);
+// 类型结点对应的类型名：i32、string、[i32]、结构体名 ...，泛型参数按当前实例绑定
+const char* qbe_type_name(QbeGenState* state, ASTNode* type);
 
 #ifdef __cplusplus
 }
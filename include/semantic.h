@@ -10,15 +10,16 @@ typedef enum {
 } SymbolType;
 
 typedef struct Symbol {
-    char* name;
+    char* name;              // ast_intern 过的名字，同名即同指针
     SymbolType type;
     InferredType inferred_type;
     int is_mutable_pointer;  // 是否是可变指针
-    struct Symbol* next;
 } Symbol;
 
 typedef struct SymbolTable {
-    Symbol* head;
+    Symbol** slots;          // 开放寻址哈希表，按名字指针散列
+    int capacity;
+    int count;
     struct SymbolTable* parent;
 } SymbolTable;
 
@@ -32,18 +32,28 @@ typedef struct StructTypeInfo {
 } StructTypeInfo;
 
 typedef struct {
-    char* name;
+    char* name;//ast_intern 过的名字，同名即同指针；NULL 表示空槽
     InferredType type;
     InferredType element_type;
     InferredType pointer_target_type;
-    StructTypeInfo* struct_type;
+    StructTypeInfo* struct_type;//指向 ctx->structs 里的定义，不归变量所有
     int array_length;
 } VariableInfo;
 
-typedef struct {
-    VariableInfo* variables;
-    int count;
+/* 一层作用域 (全局、函数体或块)：开放寻址哈希表，按名字指针散列 */
+typedef struct TypeScope {
+    VariableInfo* slots;
     int capacity;
+    int count;
+    struct TypeScope* parent;
+} TypeScope;
+
+typedef struct {
+    TypeScope* scope;//当前 (最内层) 作用域
+    TypeScope* global;
+    StructTypeInfo** structs;//结构体定义，同样按名字指针散列，重新定义时原地替换字段
+    int struct_capacity;
+    int struct_count;
 } TypeInferenceContext;
 
 TypeInferenceContext* create_type_inference_context();
@@ -62,4 +72,11 @@ InferredType get_struct_field_type(TypeInferenceContext* ctx, const char* struct
 void process_struct_definition(TypeInferenceContext* ctx, ASTNode* struct_def_node);//处理结构体定义
 const char* type_to_cpp_string(InferredType type);
 int has_variable(TypeInferenceContext* ctx, const char* var_name);
+/*
+infer_type 遇到函数体和 if / while / for 的块会自己进出作用域；let / mut 声明在当前作用域新建变量，
+遮住外层同名的，普通赋值和上面的 set_variable_* 改最近的那个，找不到才在当前作用域新建
+*/
+void push_type_scope(TypeInferenceContext* ctx);
+void pop_type_scope(TypeInferenceContext* ctx);
+void declare_variable_type(TypeInferenceContext* ctx, const char* var_name, InferredType type);
 #endif/*TYPE_INFERENCE_H*/
\ No newline at end of file
@@ -0,0 +1,11 @@
+#ifndef VM_H
+#define VM_H
+#include "ast.h"
+#include "bytecode.h"
+
+// 执行已经 finalize 的字节码，返回进程退出码（main 的返回值）
+int vm_run(ByteCodeList* code);
+// 生成字节码并执行，dump 非 0 时先打印字节码
+int vm_run_ast(ASTNode* root, int dump);
+
+#endif /*VM_H*/
@@ -1,4 +1,5 @@
 #include "../include/ast.h"
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -9,10 +10,11 @@ extern char* realpath(const char* path, char* resolved_path);
 #ifdef HAVE_PARSER_TAB_H//tips : 别删，用来取消警告
 #include "../parser/parser.tab.h"//tips : 这个头文件按编译顺序编译
 #endif
-extern FILE* yyin;
 extern ASTNode* root; //tips : 根节点
 extern const char* current_input_filename;
 extern int yyparse(void);
+extern void lexer_begin(FILE* f);
+extern void lexer_end(void);
 extern int yylineno;
 
 typedef struct ImportedModuleNode {
@@ -98,27 +100,192 @@ static void clear_import_cache(void) {
     g_imported_module_cache = NULL;
 }
 
+/*
+AST arena：解析会话里所有节点、节点数组和字符串都从这里按块 bump 分配，
+标识符额外走一张 intern 表，同名标识符共用一份字符串。
+节点不再单独释放，编译结束时 free_ast_arena 一次性归还整块内存。
+*/
+#define AST_CHUNK_SIZE (64 * 1024)
+#define AST_ALIGN 8 //ASTNode 里最宽的是 long long/double/指针
+
+typedef struct AstChunk {
+    struct AstChunk* next;
+    size_t used;
+    size_t cap;
+    _Alignas(AST_ALIGN) char data[];
+} AstChunk;
+
+typedef struct {
+    char* str;
+    unsigned int hash;
+} AstInternSlot;
+
+static AstChunk* g_ast_chunks = NULL;
+static AstInternSlot* g_intern_slots = NULL;
+static size_t g_intern_cap = 0;
+static size_t g_intern_count = 0;
+
+void* ast_alloc(size_t size) {
+    size = (size + AST_ALIGN - 1) & ~(size_t)(AST_ALIGN - 1);
+    AstChunk* chunk = g_ast_chunks;
+    if (!chunk || chunk->cap - chunk->used < size) {
+        size_t cap = size > AST_CHUNK_SIZE / 4 ? size : AST_CHUNK_SIZE;
+        chunk = malloc(sizeof(AstChunk) + cap);
+        if (!chunk) {
+            fprintf(stderr, "Error: out of memory while building AST\n");
+            exit(1);
+        }
+        chunk->used = 0;
+        chunk->cap = cap;
+        if (g_ast_chunks && cap != AST_CHUNK_SIZE) {
+            //大块单独挂在后面，当前块还能继续用
+            chunk->next = g_ast_chunks->next;
+            g_ast_chunks->next = chunk;
+        } else {
+            chunk->next = g_ast_chunks;
+            g_ast_chunks = chunk;
+        }
+    }
+    void* p = (char*)chunk->data + chunk->used;
+    chunk->used += size;
+    memset(p, 0, size);
+    return p;
+}
+
+static ASTNode* ast_new_node(void) {
+    return ast_alloc(sizeof(ASTNode));
+}
+
+char* ast_strdup(const char* s) {
+    if (!s) return NULL;
+    size_t len = strlen(s);
+    char* copy = ast_alloc(len + 1);
+    memcpy(copy, s, len + 1);
+    return copy;
+}
+
+static unsigned int ast_hash_string(const char* s, size_t len) {
+    unsigned int h = 2166136261u;//FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void ast_intern_grow(void) {
+    size_t cap = g_intern_cap ? g_intern_cap * 2 : 1024;
+    AstInternSlot* slots = calloc(cap, sizeof(AstInternSlot));
+    if (!slots) {
+        fprintf(stderr, "Error: out of memory while building AST\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < g_intern_cap; i++) {
+        if (!g_intern_slots[i].str) continue;
+        size_t j = g_intern_slots[i].hash & (cap - 1);
+        while (slots[j].str) j = (j + 1) & (cap - 1);
+        slots[j] = g_intern_slots[i];
+    }
+    free(g_intern_slots);
+    g_intern_slots = slots;
+    g_intern_cap = cap;
+}
+
+//s[0..len) 不要求以 \0 结尾：lexer 直接拿 yytext/yyleng 来查，命中时不分配
+char* ast_intern_len(const char* s, size_t len) {
+    if (!s) return NULL;
+    if ((g_intern_count + 1) * 4 > g_intern_cap * 3) {
+        ast_intern_grow();
+    }
+    unsigned int h = ast_hash_string(s, len);
+    size_t j = h & (g_intern_cap - 1);
+    while (g_intern_slots[j].str) {
+        const char* str = g_intern_slots[j].str;
+        if (g_intern_slots[j].hash == h && strncmp(str, s, len) == 0 && str[len] == '\0') {
+            return g_intern_slots[j].str;
+        }
+        j = (j + 1) & (g_intern_cap - 1);
+    }
+    char* copy = ast_alloc(len + 1);
+    memcpy(copy, s, len);
+    g_intern_slots[j].str = copy;
+    g_intern_slots[j].hash = h;
+    g_intern_count++;
+    return copy;
+}
+
+char* ast_intern(const char* s) {
+    return s ? ast_intern_len(s, strlen(s)) : NULL;
+}
+
+//只查不插：没驻留过的名字返回 NULL，查符号表这种只读的路径用它，不会把拼错的名字塞进驻留表
+char* ast_intern_find(const char* s) {
+    if (!s || !g_intern_cap) return NULL;
+    size_t len = strlen(s);
+    unsigned int h = ast_hash_string(s, len);
+    size_t j = h & (g_intern_cap - 1);
+    while (g_intern_slots[j].str) {
+        if (g_intern_slots[j].hash == h && strcmp(g_intern_slots[j].str, s) == 0) {
+            return g_intern_slots[j].str;
+        }
+        j = (j + 1) & (g_intern_cap - 1);
+    }
+    return NULL;
+}
+
+/* 节点数组的容量隐含为 max(4, 不小于 count 的 2 的幂)，满了就在 arena 里翻倍搬家 */
+static size_t ast_node_array_cap(int count) {
+    size_t cap = 4;
+    while (cap < (size_t)count) cap *= 2;
+    return cap;
+}
+
+static ASTNode** ast_node_array(int count) {
+    return ast_alloc(sizeof(ASTNode*) * ast_node_array_cap(count));
+}
+
+static ASTNode** ast_node_array_append(ASTNode** items, int count, ASTNode* item) {
+    if (!items || (size_t)count == ast_node_array_cap(count)) {
+        size_t old_bytes = sizeof(ASTNode*) * (size_t)count;
+        AstChunk* chunk = g_ast_chunks;
+        if (items && chunk && (char*)items + old_bytes == (char*)chunk->data + chunk->used &&
+            chunk->cap - chunk->used >= old_bytes) {
+            //数组正好在当前块的末尾，原地延长，不用搬家
+            memset((char*)chunk->data + chunk->used, 0, old_bytes);
+            chunk->used += old_bytes;
+            items[count] = item;
+            return items;
+        }
+        ASTNode** grown = ast_node_array(count + 1);
+        if (count > 0) memcpy(grown, items, sizeof(ASTNode*) * count);
+        items = grown;
+    }
+    items[count] = item;
+    return items;
+}
+
+void free_ast_arena(void) {
+    AstChunk* chunk = g_ast_chunks;
+    while (chunk) {
+        AstChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    g_ast_chunks = NULL;
+    free(g_intern_slots);
+    g_intern_slots = NULL;
+    g_intern_cap = 0;
+    g_intern_count = 0;
+}
+
 static void remove_program_statement_at(ASTNode* program, int idx) {
     if (!program || program->type != AST_PROGRAM) return;
     if (idx < 0 || idx >= program->data.program.statement_count) return;
 
-    free_ast(program->data.program.statements[idx]);
-
     for (int k = idx + 1; k < program->data.program.statement_count; k++) {
         program->data.program.statements[k - 1] = program->data.program.statements[k];
     }
-
     program->data.program.statement_count--;
-    if (program->data.program.statement_count == 0) {
-        free(program->data.program.statements);
-        program->data.program.statements = NULL;
-    } else {
-        ASTNode** resized = realloc(program->data.program.statements,
-                                    sizeof(ASTNode*) * program->data.program.statement_count);
-        if (resized) {
-            program->data.program.statements = resized;
-        }
-    }
 }
 
 static void set_source_file_recursive(ASTNode* node, const char* source_file) {
@@ -175,6 +342,11 @@ static void set_source_file_recursive(ASTNode* node, const char* source_file) {
             set_source_file_recursive(node->data.while_stmt.condition, source_file);
             set_source_file_recursive(node->data.while_stmt.body, source_file);
             break;
+        case AST_MATCH:
+            set_source_file_recursive(node->data.match_stmt.scrutinee, source_file);
+            set_source_file_recursive(node->data.match_stmt.arms, source_file);
+            set_source_file_recursive(node->data.match_stmt.lowered, source_file);
+            break;
         case AST_FOR:
             set_source_file_recursive(node->data.for_stmt.var, source_file);
             set_source_file_recursive(node->data.for_stmt.start, source_file);
@@ -221,7 +393,7 @@ static void set_source_file_recursive(ASTNode* node, const char* source_file) {
 }
 
 ASTNode* create_program_node_with_location(Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_PROGRAM;
     node->location = location;
     node->data.program.statements = NULL;
@@ -237,16 +409,16 @@ ASTNode* create_program_node() {
 void add_statement_to_program(ASTNode* program, ASTNode* statement) {
     if (program->type != AST_PROGRAM) return;
     
-    program->data.program.statement_count++;
-    program->data.program.statements = realloc(
+    program->data.program.statements = ast_node_array_append(
         program->data.program.statements,
-        sizeof(ASTNode*) * program->data.program.statement_count
+        program->data.program.statement_count,
+        statement
     );
-    program->data.program.statements[program->data.program.statement_count - 1] = statement;
+    program->data.program.statement_count++;
 }
 
 ASTNode* create_print_node_with_location(ASTNode* expr, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_PRINT;
     node->location = location;
     node->data.print.expr = expr;
@@ -258,7 +430,7 @@ ASTNode* create_print_node(ASTNode* expr) {
 }
 
 ASTNode* create_input_node_with_location(ASTNode* prompt, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_INPUT;
     node->location = location;
     node->data.input.prompt = prompt;
@@ -281,7 +453,7 @@ ASTNode* create_input_node_with_yyltype(ASTNode* prompt, void* yylloc) {
 }
 
 ASTNode* create_toint_node_with_location(ASTNode* expr, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_TOINT;
     node->location = location;
     node->data.toint.expr = expr;
@@ -293,7 +465,7 @@ ASTNode* create_toint_node(ASTNode* expr) {
 }
 
 ASTNode* create_tofloat_node_with_location(ASTNode* expr, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_TOFLOAT;
     node->location = location;
     node->data.tofloat.expr = expr;
@@ -305,7 +477,7 @@ ASTNode* create_tofloat_node(ASTNode* expr) {
 }
 
 ASTNode* create_nil_node_with_location(Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_NIL;
     node->location = location;
     return node;
@@ -328,7 +500,7 @@ ASTNode* create_nil_node_with_yyltype(void* yylloc) {
 }
 
 ASTNode* create_expression_list_node_with_location(Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_EXPRESSION_LIST;
     node->location = location;
     node->data.expression_list.expressions = NULL;
@@ -345,16 +517,16 @@ ASTNode* create_expression_list_node() {
 void add_expression_to_list(ASTNode* list, ASTNode* expr) {
     if (!list || list->type != AST_EXPRESSION_LIST || !expr) return;
     
-    list->data.expression_list.expression_count++;
-    list->data.expression_list.expressions = realloc(
+    list->data.expression_list.expressions = ast_node_array_append(
         list->data.expression_list.expressions,
-        sizeof(ASTNode*) * list->data.expression_list.expression_count
+        list->data.expression_list.expression_count,
+        expr
     );
-    list->data.expression_list.expressions[list->data.expression_list.expression_count - 1] = expr;
+    list->data.expression_list.expression_count++;
 }
 
 ASTNode* create_assign_node_with_location(ASTNode* left, ASTNode* right, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_ASSIGN;
     node->location = location;
     node->data.assign.left = left;
@@ -365,7 +537,7 @@ ASTNode* create_assign_node_with_location(ASTNode* left, ASTNode* right, Locatio
 }
 
 ASTNode* create_const_node_with_location(ASTNode* left, ASTNode* right, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_CONST;
     node->location = location;
     node->data.assign.left = left;
@@ -396,7 +568,7 @@ ASTNode* create_assign_node(ASTNode* left, ASTNode* right) {
 }
 
 ASTNode* create_assign_node_with_yyltype(ASTNode* left, ASTNode* right, void* yylloc) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     if (!node) return NULL;
     
     YYLTYPE* loc = (YYLTYPE*)yylloc;
@@ -415,7 +587,7 @@ ASTNode* create_assign_node_with_yyltype(ASTNode* left, ASTNode* right, void* yy
 }
 
 ASTNode* create_assign_node_with_mutability(ASTNode* left, ASTNode* right, MutabilityType mutability) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     if (!node) return NULL;
     
     node->type = AST_ASSIGN;
@@ -436,10 +608,8 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
             char* result = malloc(len1 + len2 + 1);
             strcpy(result, left->data.string.value);
             strcat(result, right->data.string.value);
-            ASTNode* new_node = create_string_node_with_location(result, location);// 创建新的字符串节点并释放临时节点
+            ASTNode* new_node = create_string_node_with_location(result, location);
             free(result);
-            free_ast(left);
-            free_ast(right);
             return new_node;
         }
         else if (op == OP_MUL || op == OP_REPEAT) {
@@ -467,11 +637,8 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                 strcat(result, str_val);
             }
             
-            // 创建新的字符串节点并释放临时节点
             ASTNode* new_node = create_string_node_with_location(result, location);
             free(result);
-            free_ast(left);
-            free_ast(right);
             return new_node;
         }
     }
@@ -482,8 +649,6 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                     left->data.num_int.value + right->data.num_int.value, 
                     location
                 );
-                free_ast(left);
-                free_ast(right);
                 return new_node;
             }
             case OP_SUB: {
@@ -491,8 +656,6 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                     left->data.num_int.value - right->data.num_int.value, 
                     location
                 );
-                free_ast(left);
-                free_ast(right);
                 return new_node;
             }
             case OP_MUL: {
@@ -500,8 +663,6 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                     left->data.num_int.value * right->data.num_int.value, 
                     location
                 );
-                free_ast(left);
-                free_ast(right);
                 return new_node;
             }
             case OP_DIV: {
@@ -510,8 +671,6 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                         left->data.num_int.value / right->data.num_int.value, 
                         location
                     );
-                    free_ast(left);
-                    free_ast(right);
                     return new_node;
                 }
                 break;
@@ -522,8 +681,6 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                         left->data.num_int.value % right->data.num_int.value, 
                         location
                     );
-                    free_ast(left);
-                    free_ast(right);
                     return new_node;
                 }
                 break;
@@ -539,8 +696,6 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                     left->data.num_float.value + right->data.num_float.value, 
                     location
                 );
-                free_ast(left);
-                free_ast(right);
                 return new_node;
             }
             case OP_SUB: {
@@ -548,8 +703,6 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                     left->data.num_float.value - right->data.num_float.value, 
                     location
                 );
-                free_ast(left);
-                free_ast(right);
                 return new_node;
             }
             case OP_MUL: {
@@ -557,8 +710,6 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                     left->data.num_float.value * right->data.num_float.value, 
                     location
                 );
-                free_ast(left);
-                free_ast(right);
                 return new_node;
             }
             case OP_DIV: {
@@ -567,8 +718,6 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                         left->data.num_float.value / right->data.num_float.value, 
                         location
                     );
-                    free_ast(left);
-                    free_ast(right);
                     return new_node;
                 }
                 break;
@@ -585,8 +734,6 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                     left->data.num_int.value + right->data.num_float.value, 
                     location
                 );
-                free_ast(left);
-                free_ast(right);
                 return new_node;
             }
             case OP_SUB: {
@@ -594,8 +741,6 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                     left->data.num_int.value - right->data.num_float.value, 
                     location
                 );
-                free_ast(left);
-                free_ast(right);
                 return new_node;
             }
             case OP_MUL: {
@@ -603,8 +748,6 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                     left->data.num_int.value * right->data.num_float.value, 
                     location
                 );
-                free_ast(left);
-                free_ast(right);
                 return new_node;
             }
             case OP_DIV: {
@@ -613,8 +756,6 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                         left->data.num_int.value / right->data.num_float.value, 
                         location
                     );
-                    free_ast(left);
-                    free_ast(right);
                     return new_node;
                 }
                 break;
@@ -630,8 +771,6 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                     left->data.num_float.value + right->data.num_int.value, 
                     location
                 );
-                free_ast(left);
-                free_ast(right);
                 return new_node;
             }
             case OP_SUB: {
@@ -639,8 +778,6 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                     left->data.num_float.value - right->data.num_int.value, 
                     location
                 );
-                free_ast(left);
-                free_ast(right);
                 return new_node;
             }
             case OP_MUL: {
@@ -648,8 +785,6 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                     left->data.num_float.value * right->data.num_int.value, 
                     location
                 );
-                free_ast(left);
-                free_ast(right);
                 return new_node;
             }
             case OP_DIV: {
@@ -658,8 +793,6 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                         left->data.num_float.value / right->data.num_int.value, 
                         location
                     );
-                    free_ast(left);
-                    free_ast(right);
                     return new_node;
                 }
                 break;
@@ -668,7 +801,7 @@ ASTNode* create_binop_node_with_location(BinOpType op, ASTNode* left, ASTNode* r
                 break;
         }
     }
-    ASTNode* node = malloc(sizeof(ASTNode));// 如果不能折叠，则创建正常的二元操作节点
+    ASTNode* node = ast_new_node();// 如果不能折叠，则创建正常的二元操作节点
     node->type = AST_BINOP;
     node->location = location;
     node->data.binop.op = op;
@@ -688,7 +821,7 @@ ASTNode* create_binop_node(BinOpType op, ASTNode* left, ASTNode* right) {
 }
 
 ASTNode* create_unaryop_node_with_location(UnaryOpType op, ASTNode* expr, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_UNARYOP;
     node->location = location;
     node->data.unaryop.op = op;
@@ -718,7 +851,7 @@ ASTNode* create_unaryop_node(UnaryOpType op, ASTNode* expr) {
 }
 
 ASTNode* create_num_int_node_with_location(long long value, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_NUM_INT;
     node->location = location;
     node->data.num_int.value = value;
@@ -731,7 +864,7 @@ ASTNode* create_num_int_node(long long value) {
 }
 
 ASTNode* create_num_float_node_with_location(double value, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_NUM_FLOAT;
     node->location = location;
     node->data.num_float.value = value;
@@ -744,11 +877,10 @@ ASTNode* create_num_float_node(double value) {
 }
 
 ASTNode* create_string_node_with_location(const char* value, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_STRING;
     node->location = location;
-    node->data.string.value = malloc(strlen(value) + 1);
-    strcpy(node->data.string.value, value);
+    node->data.string.value = ast_intern(value);//字面量驻留：同样内容同一指针，各后端按指针去重
     return node;
 }
 
@@ -758,11 +890,10 @@ ASTNode* create_string_node(const char* value) {
 }
 
 ASTNode* create_identifier_node_with_location(const char* name, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_IDENTIFIER;
     node->location = location;
-    node->data.identifier.name = malloc(strlen(name) + 1);
-    strcpy(node->data.identifier.name, name);
+    node->data.identifier.name = ast_intern(name);
     return node;
 }
 
@@ -772,14 +903,14 @@ ASTNode* create_identifier_node(const char* name) {
 }
 
 ASTNode* create_type_node_with_location(NodeType type, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = type;
     node->location = location;
     return node;
 }
 
 ASTNode* create_type_node(NodeType type) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     if (!node) return NULL;
     Location loc = {0};
     node->type = type;
@@ -787,7 +918,7 @@ ASTNode* create_type_node(NodeType type) {
     return node;
 }
 ASTNode* create_list_type_node_with_location(ASTNode* element_type, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     if (!node) return NULL;
     node->type = AST_TYPE_LIST;
     node->location = location;
@@ -800,7 +931,7 @@ ASTNode* create_list_type_node(ASTNode* element_type) {
     return create_list_type_node_with_location(element_type, loc);
 }
 ASTNode* create_fixed_size_list_type_node_with_location(ASTNode* element_type, long long size, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     if (!node) return NULL;
     node->type = AST_TYPE_FIXED_SIZE_LIST;
     node->location = location;
@@ -815,7 +946,7 @@ ASTNode* create_fixed_size_list_type_node(ASTNode* element_type, long long size)
 }
 
 ASTNode* create_if_node_with_location(ASTNode* condition, ASTNode* then_body, ASTNode* else_body, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_IF;
     node->location = location;
     node->data.if_stmt.condition = condition;
@@ -835,7 +966,7 @@ ASTNode* create_if_node(ASTNode* condition, ASTNode* then_body, ASTNode* else_bo
 }
 
 ASTNode* create_while_node_with_location(ASTNode* condition, ASTNode* body, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_WHILE;
     node->location = location;
     node->data.while_stmt.condition = condition;
@@ -853,8 +984,146 @@ ASTNode* create_while_node(ASTNode* condition, ASTNode* body) {
     return create_while_node_with_location(condition, body, loc);
 }
 
+ASTNode* create_match_node_with_location(ASTNode* scrutinee, ASTNode* arms, Location location) {
+    ASTNode* node = ast_new_node();
+    node->type = AST_MATCH;
+    node->location = location;
+    node->data.match_stmt.scrutinee = scrutinee;
+    node->data.match_stmt.arms = arms;
+    node->data.match_stmt.lowered = NULL;
+    return node;
+}
+
+static int is_match_wildcard(ASTNode* pattern) {
+    return pattern && pattern->type == AST_IDENTIFIER && pattern->data.identifier.name &&
+           strcmp(pattern->data.identifier.name, "_") == 0;
+}
+
+//只有标识符/字面量可以直接复制，其它 scrutinee 先存进临时变量，保证只求值一次
+static ASTNode* clone_match_operand(ASTNode* node) {
+    if (!node) return NULL;
+    switch (node->type) {
+        case AST_IDENTIFIER:
+            return node->data.identifier.name ? create_identifier_node_with_location(node->data.identifier.name, node->location) : NULL;
+        case AST_NUM_INT:
+            return create_num_int_node(node->data.num_int.value);
+        case AST_NUM_FLOAT:
+            return create_num_float_node(node->data.num_float.value);
+        case AST_CHAR:
+            return create_char_node(node->data.character.value);
+        case AST_STRING:
+            return node->data.string.value ? create_string_node(node->data.string.value) : NULL;
+        case AST_NIL:
+            return create_nil_node();
+        default:
+            return NULL;
+    }
+}
+
+static ASTNode* match_none_or_clone(ASTNode* pattern) {
+    if (pattern->type == AST_IDENTIFIER && pattern->data.identifier.name &&
+        strcmp(pattern->data.identifier.name, "None") == 0) {
+        return create_num_int_node(0);
+    }
+    return clone_match_operand(pattern);
+}
+
+static ASTNode* prepend_match_binding(ASTNode* body, const char* bind_name, ASTNode* subject) {
+    ASTNode* bind_decl = create_assign_node(create_identifier_node(bind_name), clone_match_operand(subject));
+    bind_decl->data.assign.is_declaration = 1;
+
+    ASTNode* wrapped = create_program_node();
+    add_statement_to_program(wrapped, bind_decl);
+    if (body && body->type == AST_PROGRAM) {
+        for (int i = 0; i < body->data.program.statement_count; i++) {
+            add_statement_to_program(wrapped, body->data.program.statements[i]);
+        }
+    } else if (body) {
+        add_statement_to_program(wrapped, body);
+    }
+    return wrapped;
+}
+
+/*
+match -> if-else 链，给 VM、vic-ir 和语义检查用；LLVM 后端直接处理 AST_MATCH 生成 switch
+Ctor(x) 分支按 scrutinee != 0 判断并把 x 绑定到 scrutinee，None 按 0 比较
+*/
+ASTNode* lower_match_to_if(ASTNode* match) {
+    if (!match || match->type != AST_MATCH) return match;
+    if (match->data.match_stmt.lowered) return match->data.match_stmt.lowered;
+
+    ASTNode* scrutinee = match->data.match_stmt.scrutinee;
+    ASTNode* arms = match->data.match_stmt.arms;
+    if (!scrutinee || !arms || arms->type != AST_EXPRESSION_LIST) return NULL;
+
+    int count = arms->data.expression_list.expression_count;
+    int needs_compare = 0;
+    for (int i = 0; i < count; i++) {
+        ASTNode* arm = arms->data.expression_list.expressions[i];
+        if (arm && arm->type == AST_ASSIGN && !is_match_wildcard(arm->data.assign.left)) {
+            needs_compare = 1;
+            break;
+        }
+    }
+
+    ASTNode* result = create_program_node_with_location(match->location);
+    ASTNode* subject = scrutinee;
+    if (!clone_match_operand(scrutinee)) {
+        if (needs_compare) {
+            static unsigned int match_temp_seq = 0;
+            char temp_name[32];
+            snprintf(temp_name, sizeof(temp_name), "__match%u", match_temp_seq++);
+            subject = create_identifier_node_with_location(temp_name, scrutinee->location);
+            ASTNode* temp_decl = create_assign_node(create_identifier_node_with_location(temp_name, scrutinee->location), scrutinee);
+            temp_decl->data.assign.is_declaration = 1;
+            add_statement_to_program(result, temp_decl);
+        } else {
+            add_statement_to_program(result, scrutinee);//只有 _ 分支：副作用照样要执行
+        }
+    }
+
+    ASTNode* chain = NULL;
+    for (int i = count - 1; i >= 0; i--) {
+        ASTNode* arm = arms->data.expression_list.expressions[i];
+        if (!arm || arm->type != AST_ASSIGN || !arm->data.assign.left || !arm->data.assign.right) continue;
+
+        ASTNode* pattern = arm->data.assign.left;
+        ASTNode* body = arm->data.assign.right;
+        if (is_match_wildcard(pattern)) {
+            chain = body;
+            continue;
+        }
+
+        ASTNode* cond = NULL;
+        if (pattern->type == AST_CALL && pattern->data.call.func &&
+            pattern->data.call.func->type == AST_IDENTIFIER && pattern->data.call.func->data.identifier.name) {
+            ASTNode* args = pattern->data.call.args;
+            if (args && args->type == AST_EXPRESSION_LIST && args->data.expression_list.expression_count == 1) {
+                ASTNode* bind_arg = args->data.expression_list.expressions[0];
+                if (bind_arg && bind_arg->type == AST_IDENTIFIER && bind_arg->data.identifier.name) {
+                    body = prepend_match_binding(body, bind_arg->data.identifier.name, subject);
+                }
+                cond = create_binop_node(OP_NE, clone_match_operand(subject), create_num_int_node(0));
+            } else {
+                ASTNode* right = match_none_or_clone(pattern->data.call.func);
+                if (right) cond = create_binop_node(OP_EQ, clone_match_operand(subject), right);
+            }
+        } else {
+            ASTNode* right = match_none_or_clone(pattern);
+            if (right) cond = create_binop_node(OP_EQ, clone_match_operand(subject), right);
+        }
+
+        if (!cond) continue;
+        chain = create_if_node(cond, body, chain);
+    }
+    if (chain) add_statement_to_program(result, chain);
+
+    match->data.match_stmt.lowered = result;
+    return result;
+}
+
 ASTNode* create_for_node_with_location(ASTNode* var, ASTNode* start, ASTNode* end, ASTNode* body, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_FOR;
     node->location = location;
     node->data.for_stmt.var = var;
@@ -875,11 +1144,10 @@ ASTNode* create_for_node(ASTNode* var, ASTNode* start, ASTNode* end, ASTNode* bo
 }
 
 ASTNode* create_function_node_with_location(const char* name, ASTNode* params, ASTNode* return_type, ASTNode* body, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_FUNCTION;
     node->location = location;
-    node->data.function.name = malloc(strlen(name) + 1);
-    strcpy(node->data.function.name, name);
+    node->data.function.name = ast_intern(name);
     node->data.function.params = params;
     node->data.function.generic_params = NULL;
     node->data.function.return_type = return_type;
@@ -922,19 +1190,17 @@ ASTNode* create_public_function_node_with_location(const char* name, ASTNode* pa
 }
 
 ASTNode* create_extern_function_node_with_location(const char* name, ASTNode* params, ASTNode* return_type, const char* linkage, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_FUNCTION;
     node->location = location;
-    node->data.function.name = malloc(strlen(name) + 1);
-    strcpy(node->data.function.name, name);
+    node->data.function.name = ast_intern(name);
     node->data.function.params = params;
     node->data.function.generic_params = NULL;
     node->data.function.return_type = return_type;
     node->data.function.body = NULL;
     node->data.function.is_extern = 1;
     if (linkage) {
-        node->data.function.linkage = malloc(strlen(linkage) + 1);
-        strcpy(node->data.function.linkage, linkage);
+        node->data.function.linkage = ast_strdup(linkage);
     } else {
         node->data.function.linkage = NULL;
     }
@@ -948,7 +1214,7 @@ ASTNode* create_extern_function_node(const char* name, ASTNode* params, ASTNode*
 }
 
 ASTNode* create_break_node_with_location(Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_BREAK;
     node->location = location;
     return node;
@@ -960,7 +1226,7 @@ ASTNode* create_break_node() {
 }
 
 ASTNode* create_continue_node_with_location(Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_CONTINUE;
     node->location = location;
     return node;
@@ -972,7 +1238,7 @@ ASTNode* create_continue_node() {
 }
 
 ASTNode* create_return_node_with_location(ASTNode* expr, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_RETURN;
     node->location = location;
     node->data.return_stmt.expr = expr;
@@ -989,7 +1255,7 @@ ASTNode* create_return_node(ASTNode* expr) {
 }
 
 ASTNode* create_call_node(ASTNode* func, ASTNode* args) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_CALL;
     node->location = func->location;// 使用函数的位置
     node->data.call.func = func;
@@ -998,7 +1264,7 @@ ASTNode* create_call_node(ASTNode* func, ASTNode* args) {
     return node;
 }
 ASTNode* create_call_node_with_location(ASTNode* func, ASTNode* args, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_CALL;
     node->location = location;
     node->data.call.func = func;
@@ -1007,7 +1273,7 @@ ASTNode* create_call_node_with_location(ASTNode* func, ASTNode* args, Location l
     return node;
 }
 ASTNode* create_call_node_with_yyltype(ASTNode* func, ASTNode* args, void* yylloc) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_CALL;
     YYLTYPE* loc = (YYLTYPE*)yylloc;
     node->location.first_line = loc->first_line;
@@ -1021,11 +1287,10 @@ ASTNode* create_call_node_with_yyltype(ASTNode* func, ASTNode* args, void* yyllo
 }
 
 ASTNode* create_struct_def_node_with_location(const char* name, ASTNode* fields, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_STRUCT_DEF;
     node->location = location;
-    node->data.struct_def.name = malloc(strlen(name) + 1);
-    strcpy(node->data.struct_def.name, name);
+    node->data.struct_def.name = ast_intern(name);
     node->data.struct_def.fields = fields;
     node->data.struct_def.is_public = 0;
     return node;
@@ -1043,7 +1308,7 @@ ASTNode* create_struct_def_node_with_yyltype(const char* name, ASTNode* fields,
 }
 
 ASTNode* create_struct_literal_node_with_location(ASTNode* type_name, ASTNode* fields, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_STRUCT_LITERAL;
     node->location = location;
     node->data.struct_literal.type_name = type_name;
@@ -1062,7 +1327,7 @@ ASTNode* create_struct_literal_node_with_yyltype(ASTNode* type_name, ASTNode* fi
     return create_struct_literal_node_with_location(type_name, fields, location);
 }
 ASTNode* create_index_node_with_location(ASTNode* target, ASTNode* index, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_INDEX;
     node->location = location;
     node->data.index.target = target;
@@ -1102,7 +1367,7 @@ ASTNode* create_member_access_node(ASTNode* object, ASTNode* field) {
 }
 
 ASTNode* create_member_access_node_with_location(ASTNode* object, ASTNode* field, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_MEMBER_ACCESS;
     node->location = location;
     node->data.member_access.object = object;
@@ -1242,6 +1507,17 @@ ASTNode* create_while_node_with_yyltype(ASTNode* condition, ASTNode* body, void*
     return create_while_node_with_location(condition, body, location);
 }
 
+ASTNode* create_match_node_with_yyltype(ASTNode* scrutinee, ASTNode* arms, void* yylloc) {
+    YYLTYPE* loc = (YYLTYPE*)yylloc;
+    Location location = {
+        loc->first_line,
+        loc->first_column,
+        loc->last_line,
+        loc->last_column
+    };
+    return create_match_node_with_location(scrutinee, arms, location);
+}
+
 ASTNode* create_for_node_with_yyltype(ASTNode* var, ASTNode* start, ASTNode* end, ASTNode* body, void* yylloc) {
     YYLTYPE* loc = (YYLTYPE*)yylloc;
     Location location = {
@@ -1309,7 +1585,7 @@ ASTNode* create_identifier_node_with_yyltype(const char* name, void* yylloc) {
 }
 
 ASTNode* create_global_node_with_location(ASTNode* identifier, ASTNode* type, ASTNode* initializer, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     node->type = AST_GLOBAL;
     node->location = location;
     node->mutability = MUTABILITY_IMMUTABLE;//global cannt bian
@@ -1344,7 +1620,7 @@ ASTNode* create_import_node(const char* module_path) {
 }
 
 ASTNode* create_import_node_with_location(const char* module_path, Location location) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     if (!node) {
         fprintf(stderr, "Failed to allocate memory for ASTNode\n");
         exit(1);
@@ -1352,7 +1628,7 @@ ASTNode* create_import_node_with_location(const char* module_path, Location loca
     node->type = AST_IMPORT;
     node->location = location;
     node->mutability = MUTABILITY_IMMUTABLE;
-    node->data.import.module_path = strdup(module_path);
+    node->data.import.module_path = ast_strdup(module_path);
     return node;
 }
 
@@ -1368,7 +1644,7 @@ ASTNode* create_import_node_with_yyltype(const char* module_path, void* yylloc)
 }
 
 ASTNode* create_char_node(char value) {
-    ASTNode* node = malloc(sizeof(ASTNode));
+    ASTNode* node = ast_new_node();
     if (!node) {
         fprintf(stderr, "Failed to allocate memory for ASTNode\n");
         exit(1);
@@ -1394,186 +1670,6 @@ ASTNode* create_char_node_with_yyltype(char value, void* yylloc) {
     return create_char_node_with_location(value, loc);
 }
 
-void free_ast(ASTNode* node) {
-    if (!node) return;
-    
-    switch (node->type) {
-        case AST_PROGRAM:
-            for (int i = 0; i < node->data.program.statement_count; i++) {
-                free_ast(node->data.program.statements[i]);
-            }
-            free(node->data.program.statements);
-            break;
-            
-        case AST_PRINT:
-            free_ast(node->data.print.expr);
-            break;
-            
-        case AST_INPUT:
-            free_ast(node->data.input.prompt);
-            break;
-            
-        case AST_TOINT:
-            free_ast(node->data.toint.expr);
-            break;
-            
-        case AST_TOFLOAT:
-            free_ast(node->data.tofloat.expr);
-            break;
-            
-        case AST_EXPRESSION_LIST:
-            for (int i = 0; i < node->data.expression_list.expression_count; i++) {
-                free_ast(node->data.expression_list.expressions[i]);
-            }
-            free(node->data.expression_list.expressions);
-            break;
-            
-        case AST_ASSIGN:
-            free_ast(node->data.assign.left);
-            free_ast(node->data.assign.right);
-            break;
-        case AST_CONST:
-            free_ast(node->data.assign.left);
-            free_ast(node->data.assign.right);
-            break;
-            
-        case AST_BINOP:
-            free_ast(node->data.binop.left);
-            free_ast(node->data.binop.right);
-            break;
-            
-        case AST_UNARYOP:
-            free_ast(node->data.unaryop.expr);
-            break;
-            
-        case AST_STRING:
-            free(node->data.string.value);
-            break;
-            
-        case AST_CHAR:
-            break;
-            
-        case AST_IDENTIFIER:
-            free(node->data.identifier.name);
-            break;
-            
-        case AST_TYPE_INT32:
-        case AST_TYPE_INT64:
-        case AST_TYPE_INT8:
-        case AST_TYPE_FLOAT32:
-        case AST_TYPE_FLOAT64:
-        case AST_TYPE_STRING:
-        case AST_TYPE_VOID:
-        case AST_TYPE_POINTER:
-            break;
-            
-        case AST_TYPE_LIST:
-            if (node->data.list_type.element_type) {
-                free_ast(node->data.list_type.element_type);
-            }
-            break;
-            
-        case AST_TYPE_FIXED_SIZE_LIST:
-            if (node->data.fixed_size_list_type.element_type) {
-                free_ast(node->data.fixed_size_list_type.element_type);
-            }
-            break;
-            
-        case AST_IF:
-            free_ast(node->data.if_stmt.condition);
-            free_ast(node->data.if_stmt.then_body);
-            if (node->data.if_stmt.else_body) {
-                free_ast(node->data.if_stmt.else_body);
-            }
-            break;
-        case AST_IMPORT:
-            free(node->data.import.module_path);
-            break;
-        case AST_WHILE:
-            free_ast(node->data.while_stmt.condition);
-            free_ast(node->data.while_stmt.body);
-            break;
-            
-        case AST_FOR:
-            free_ast(node->data.for_stmt.var);
-            free_ast(node->data.for_stmt.start);
-            free_ast(node->data.for_stmt.end);
-            free_ast(node->data.for_stmt.body);
-            break;
-        case AST_INDEX:
-            free_ast(node->data.index.target);
-            free_ast(node->data.index.index);
-            break;
-        case AST_MEMBER_ACCESS:
-            free_ast(node->data.member_access.object);
-            free_ast(node->data.member_access.field);
-            break;
-            
-        case AST_FUNCTION:
-            free(node->data.function.name);
-            if (node->data.function.params) {
-                free_ast(node->data.function.params);
-            }
-            if (node->data.function.generic_params) {
-                free_ast(node->data.function.generic_params);
-            }
-            if (node->data.function.return_type) {
-                free_ast(node->data.function.return_type);
-            }
-            if (node->data.function.body) {
-                free_ast(node->data.function.body);
-            }
-            if (node->data.function.linkage) {
-                free(node->data.function.linkage);
-            }
-            break;
-            
-        case AST_CALL:
-            free_ast(node->data.call.func);
-            if (node->data.call.args) {
-                free_ast(node->data.call.args);
-            }
-            if (node->data.call.type_args) {
-                free_ast(node->data.call.type_args);
-            }
-            break;
-        case AST_STRUCT_DEF:
-            free(node->data.struct_def.name);
-            if (node->data.struct_def.fields) free_ast(node->data.struct_def.fields);
-            break;
-        case AST_STRUCT_LITERAL:
-            if (node->data.struct_literal.type_name) free_ast(node->data.struct_literal.type_name);
-            if (node->data.struct_literal.fields) free_ast(node->data.struct_literal.fields);
-            break;
-            
-        case AST_RETURN:
-            if (node->data.return_stmt.expr) {
-                free_ast(node->data.return_stmt.expr);
-            }
-            break;
-        case AST_GLOBAL:
-            if (node->data.global_decl.identifier) {
-                free_ast(node->data.global_decl.identifier);
-            }
-            if (node->data.global_decl.type) {
-                free_ast(node->data.global_decl.type);
-            }
-            if (node->data.global_decl.initializer) {
-                free_ast(node->data.global_decl.initializer);
-            }
-            break;
-            
-        case AST_NUM_INT:
-        case AST_NUM_FLOAT:
-        case AST_NIL:
-        case AST_BREAK:
-        case AST_CONTINUE:
-            break;
-    }
-    
-    free(node);
-}
-
 void print_ast(ASTNode* node, int indent) {
     if (!node) return;
     
@@ -1618,6 +1714,11 @@ void print_ast(ASTNode* node, int indent) {
             print_ast(node->data.while_stmt.condition, indent + 1);
             print_ast(node->data.while_stmt.body, indent + 1);
             break;
+        case AST_MATCH:
+            printf("Match:\n");
+            print_ast(node->data.match_stmt.scrutinee, indent + 1);
+            print_ast(node->data.match_stmt.arms, indent + 1);
+            break;
         case AST_FOR:
             printf("For:\n");
             print_ast(node->data.for_stmt.var, indent + 1);
@@ -1927,25 +2028,24 @@ static void inline_imports_in_node(ASTNode* node) {
 
                 import_cache_add(full_module_path);
 
-                FILE* old_yyin = yyin;
                 ASTNode* old_root = root;
                 const char* old_current = current_input_filename;
                 int old_yylineno = yylineno;
 
-                yyin = f;
                 current_input_filename = full_module_path;
                 root = NULL;
                 yylineno = 1;
+                lexer_begin(f);
                 yyparse();
+                lexer_end();//yyin 一并还原
                 fclose(f);
 
                 ASTNode* module_root = root;
-                yyin = old_yyin;//存储旧值
                 root = old_root;
                 current_input_filename = old_current;
                 yylineno = old_yylineno;
 
-                char* module_source_file = strdup(full_module_path);
+                char* module_source_file = ast_strdup(full_module_path);
                 if (module_source_file && module_root) {
                     set_source_file_recursive(module_root, module_source_file);
                 }
@@ -1958,7 +2058,6 @@ static void inline_imports_in_node(ASTNode* node) {
                 }
 
                 if (!module_root || module_root->type != AST_PROGRAM) {
-                    if (module_root) free_ast(module_root);
                     i++;
                     continue;
                 }
@@ -2028,14 +2127,13 @@ static void inline_imports_in_node(ASTNode* node) {
                 }
 
                 if (add_count == 0) {
-                    free_ast(module_root);
                     i++;
                     continue;
                 }
 
                 int old_count = node->data.program.statement_count;
                 int new_count = old_count - 1 + add_count;
-                ASTNode** new_statements = malloc(sizeof(ASTNode*) * new_count);
+                ASTNode** new_statements = ast_node_array(new_count);
                 int idx = 0;
                 for (int k = 0; k < i; k++) new_statements[idx++] = node->data.program.statements[k];//复制
                 for (int j = 0; j < module_root->data.program.statement_count; j++) {
@@ -2114,24 +2212,8 @@ static void inline_imports_in_node(ASTNode* node) {
                     }
                 }
                 for (int k = i + 1; k < old_count; k++) new_statements[idx++] = node->data.program.statements[k];//复制语句
-                free(node->data.program.statements);
                 node->data.program.statements = new_statements;
                 node->data.program.statement_count = new_count;
-                free_ast(stmt);
-                int remaining = 0;
-                for (int j = 0; j < module_root->data.program.statement_count; j++) if (module_root->data.program.statements[j]) remaining++;
-                ASTNode** rem = NULL;
-                if (remaining > 0) {
-                    rem = malloc(sizeof(ASTNode*) * remaining);
-                    int r = 0;
-                    for (int j = 0; j < module_root->data.program.statement_count; j++) {
-                        if (module_root->data.program.statements[j]) rem[r++] = module_root->data.program.statements[j];
-                    }
-                }
-                free(module_root->data.program.statements);
-                module_root->data.program.statements = rem;
-                module_root->data.program.statement_count = remaining;
-                free_ast(module_root);
                 i += add_count; //next
             } else {
                 inline_imports_in_node(stmt);
@@ -2162,6 +2244,697 @@ void inline_imports(ASTNode* node) {
     clear_import_cache();
 }
 
+/*
+分离编译：import 不再把 pub 函数体拼进导入方，只拼接口
+  pub fn      -> extern 声明（泛型函数需要在导入方实例化，保留原节点）
+  pub struct  -> 原节点（只有布局，没有符号）
+  pub const   -> is_public = 2，导入方按 available_externally 处理
+  pub global  -> is_public = 2，导入方只声明不定义
+模块自己的 AST 留着，由 main.c 各自编成一个 .o
+*/
+typedef struct ImportedModule {
+    char* path;
+    ASTNode* root;
+    ASTNode** iface;
+    int iface_count;
+    int* deps;//直接 import 的模块下标，写接口文件用
+    int dep_count;
+    int done;
+} ImportedModule;
+
+static ImportedModule* g_modules = NULL;
+static int g_module_count = 0;
+static int g_module_capacity = 0;
+static int g_loading = -1;//正在处理哪个模块里的 import
+static FILE* (*g_open_cached_interface)(const char* module_path) = NULL;
+
+static void import_interfaces_in_node(ASTNode* node, const char* current_file);
+static int load_cached_interface(int index);
+
+static ASTNode* interface_decl_of(ASTNode* s) {
+    ASTNode* d;
+    switch (s->type) {
+        case AST_FUNCTION: {
+            ASTNode* gparams = s->data.function.generic_params;
+            int is_generic = gparams && gparams->type == AST_EXPRESSION_LIST && gparams->data.expression_list.expression_count > 0;
+            if (s->data.function.is_extern && !s->data.function.body) return s;
+            if (!s->data.function.is_public) return NULL;
+            if (is_generic) return s;
+            d = ast_alloc(sizeof(ASTNode));
+            *d = *s;
+            d->visit_epoch = 0;
+            d->data.function.body = NULL;
+            d->data.function.is_extern = 1;
+            return d;
+        }
+        case AST_STRUCT_DEF:
+            return s->data.struct_def.is_public ? s : NULL;
+        case AST_CONST:
+            if (!s->data.assign.is_public) return NULL;
+            if (s->data.assign.is_public == 2) return s;//已经是接口节点（从更深的 import 传上来的）
+            d = ast_alloc(sizeof(ASTNode));
+            *d = *s;
+            d->visit_epoch = 0;
+            d->data.assign.is_public = 2;
+            return d;
+        case AST_GLOBAL:
+            if (!s->data.global_decl.is_public) return NULL;
+            if (s->data.global_decl.is_public == 2) return s;
+            d = ast_alloc(sizeof(ASTNode));
+            *d = *s;
+            d->visit_epoch = 0;
+            d->data.global_decl.is_public = 2;
+            return d;
+        default:
+            return NULL;
+    }
+}
+
+static void add_interface_decl(ImportedModule* m, ASTNode* s) {
+    ASTNode* d = s ? interface_decl_of(s) : NULL;
+    if (!d) return;
+    m->iface = ast_node_array_append(m->iface, m->iface_count, d);
+    m->iface_count++;
+}
+
+//模块只保留声明类语句；顶层的可执行语句和以前内联时一样被丢弃
+static int is_module_decl(ASTNode* s) {
+    return s->type == AST_FUNCTION || s->type == AST_STRUCT_DEF || s->type == AST_CONST ||
+           s->type == AST_GLOBAL || s->type == AST_PROGRAM;
+}
+
+static ImportedModule* load_imported_module(const char* full_module_path) {
+    for (int i = 0; i < g_module_count; i++) {
+        if (strcmp(g_modules[i].path, full_module_path) == 0) {
+            return g_modules[i].done ? &g_modules[i] : NULL;//循环 import：与内联模式一样跳过
+        }
+    }
+
+    FILE* f = fopen(full_module_path, "r");
+    if (!f) return NULL;
+    if (g_module_count == g_module_capacity) {
+        int cap = g_module_capacity ? g_module_capacity * 2 : 8;
+        ImportedModule* grown = realloc(g_modules, sizeof(ImportedModule) * cap);
+        if (!grown) {
+            fclose(f);
+            return NULL;
+        }
+        g_modules = grown;
+        g_module_capacity = cap;
+    }
+    int index = g_module_count++;
+    memset(&g_modules[index], 0, sizeof(ImportedModule));
+    g_modules[index].path = ast_strdup(full_module_path);
+    if (load_cached_interface(index)) {
+        fclose(f);
+        g_modules[index].done = 1;
+        return &g_modules[index];
+    }
+
+    ASTNode* old_root = root;
+    const char* old_current = current_input_filename;
+    int old_yylineno = yylineno;
+
+    current_input_filename = g_modules[index].path;
+    root = NULL;
+    yylineno = 1;
+    lexer_begin(f);
+    yyparse();
+    lexer_end();
+    fclose(f);
+
+    ASTNode* module_root = root;
+    root = old_root;
+    yylineno = old_yylineno;
+
+    if (module_root && module_root->type == AST_PROGRAM) {
+        set_source_file_recursive(module_root, g_modules[index].path);
+        int old_loading = g_loading;
+        g_loading = index;
+        import_interfaces_in_node(module_root, g_modules[index].path);
+        g_loading = old_loading;
+        int keep = 0;
+        for (int j = 0; j < module_root->data.program.statement_count; j++) {
+            ASTNode* s = module_root->data.program.statements[j];
+            if (s && is_module_decl(s)) module_root->data.program.statements[keep++] = s;
+        }
+        module_root->data.program.statement_count = keep;
+    } else {
+        module_root = NULL;
+    }
+    current_input_filename = old_current;
+
+    //import_interfaces_in_node 可能让 g_modules 扩容，重新取地址
+    ImportedModule* m = &g_modules[index];
+    m->root = module_root;
+    if (module_root) {
+        for (int j = 0; j < module_root->data.program.statement_count; j++) {
+            ASTNode* s = module_root->data.program.statements[j];
+            if (s->type == AST_PROGRAM) {
+                for (int jj = 0; jj < s->data.program.statement_count; jj++) {
+                    add_interface_decl(m, s->data.program.statements[jj]);
+                }
+            } else {
+                add_interface_decl(m, s);
+            }
+        }
+    }
+    m->done = 1;
+    return m;
+}
+
+static void module_add_dep(int index) {
+    if (g_loading < 0) return;
+    ImportedModule* m = &g_modules[g_loading];
+    for (int i = 0; i < m->dep_count; i++) {
+        if (m->deps[i] == index) return;
+    }
+    int* grown = realloc(m->deps, sizeof(int) * (m->dep_count + 1));
+    if (!grown) return;
+    m->deps = grown;
+    m->deps[m->dep_count++] = index;
+}
+
+static int program_contains(ASTNode* program, ASTNode* s) {
+    for (int i = 0; i < program->data.program.statement_count; i++) {
+        if (program->data.program.statements[i] == s) return 1;
+    }
+    return 0;
+}
+
+static void import_interfaces_in_node(ASTNode* node, const char* current_file) {
+    if (!node) return;
+
+    if (node->type == AST_FUNCTION) {
+        if (node->data.function.body) import_interfaces_in_node(node->data.function.body, current_file);
+        return;
+    }
+    if (node->type != AST_PROGRAM) return;
+
+    int i = 0;
+    while (i < node->data.program.statement_count) {
+        ASTNode* stmt = node->data.program.statements[i];
+        if (!stmt || stmt->type != AST_IMPORT) {
+            import_interfaces_in_node(stmt, current_file);
+            i++;
+            continue;
+        }
+
+        char full_module_path[1024];
+        ImportedModule* m = NULL;
+        if (resolve_import_path(current_file, stmt->data.import.module_path, full_module_path, sizeof(full_module_path))) {
+            m = load_imported_module(full_module_path);
+        }
+        if (!m) {
+            remove_program_statement_at(node, i);
+            continue;
+        }
+        module_add_dep((int)(m - g_modules));
+
+        //菱形 import 时同一个接口节点只拼一次
+        int add_count = 0;
+        for (int j = 0; j < m->iface_count; j++) {
+            if (!program_contains(node, m->iface[j])) add_count++;
+        }
+        int old_count = node->data.program.statement_count;
+        ASTNode** new_statements = ast_node_array(old_count - 1 + add_count);
+        int idx = 0;
+        for (int k = 0; k < i; k++) new_statements[idx++] = node->data.program.statements[k];
+        for (int j = 0; j < m->iface_count; j++) {
+            if (!program_contains(node, m->iface[j])) new_statements[idx++] = m->iface[j];
+        }
+        for (int k = i + 1; k < old_count; k++) new_statements[idx++] = node->data.program.statements[k];
+        node->data.program.statements = new_statements;
+        node->data.program.statement_count = idx;
+        i += add_count;
+    }
+}
+
+int import_module_interfaces(ASTNode* node) {
+    clear_imported_modules();
+    const char* root_file = current_input_filename ? current_input_filename : ".";
+    char root_path[1024];
+    if (canonicalize_existing_path(root_file, root_path, sizeof(root_path))) {
+        //主文件占一个永远“解析中”的槽，被反向 import 时按循环处理，不会再编一遍
+        g_modules = calloc(1, sizeof(ImportedModule));
+        if (g_modules) {
+            g_modules[0].path = ast_strdup(root_path);
+            g_module_count = g_module_capacity = 1;
+        }
+    }
+    import_interfaces_in_node(node, root_file);
+    return g_module_count;
+}
+
+ASTNode* imported_module_root(int index, const char** path) {
+    if (path) *path = NULL;
+    if (index < 0 || index >= g_module_count || !g_modules[index].done) return NULL;
+    if (path) *path = g_modules[index].path;
+    return g_modules[index].root;
+}
+
+void clear_imported_modules(void) {
+    for (int i = 0; i < g_module_count; i++) {
+        free(g_modules[i].deps);
+    }
+    free(g_modules);//path/root/iface 都在 arena 里
+    g_modules = NULL;
+    g_module_count = 0;
+    g_module_capacity = 0;
+}
+
+/*
+模块接口文件 <key>.vi：模块 m->iface 的文本形式，导入方读回来就不用再解析模块源码
+  vix-iface 1
+  deps <n> <路径>...                 直接 import 的模块，读回时先加载它们
+  decls <n>，每项一行：
+    0 <节点>                         模块自己的声明
+    1 <第几个 dep> <它的第几个接口>    从更深的 import 传上来的，读回后和 dep 的接口是同一个节点 (菱形 import 按指针去重)
+节点按前序写：类型 位置 可变性 各字段，空节点写 -；字符串写 长度:内容，空指针写 ~；浮点数用 %a，读回来一位不差
+*/
+static void iface_write_node(FILE* f, ASTNode* n);
+
+static void iface_write_str(FILE* f, const char* s) {
+    if (s) fprintf(f, " %zu:%s", strlen(s), s);
+    else fputs(" ~", f);
+}
+
+static void iface_write_list(FILE* f, ASTNode** items, int count) {
+    fprintf(f, " %d", count);
+    for (int i = 0; i < count; i++) iface_write_node(f, items[i]);
+}
+
+static void iface_write_node(FILE* f, ASTNode* n) {
+    if (!n) {
+        fputs(" -", f);
+        return;
+    }
+    fprintf(f, " %d %d %d %d %d %d", (int)n->type, n->location.first_line, n->location.first_column,
+            n->location.last_line, n->location.last_column, (int)n->mutability);
+    switch (n->type) {
+        case AST_PROGRAM:
+            iface_write_list(f, n->data.program.statements, n->data.program.statement_count);
+            break;
+        case AST_EXPRESSION_LIST:
+            iface_write_list(f, n->data.expression_list.expressions, n->data.expression_list.expression_count);
+            fprintf(f, " %d", n->data.expression_list.precomputed_length);
+            break;
+        case AST_PRINT: iface_write_node(f, n->data.print.expr); break;
+        case AST_INPUT: iface_write_node(f, n->data.input.prompt); break;
+        case AST_TOINT: iface_write_node(f, n->data.toint.expr); break;
+        case AST_TOFLOAT: iface_write_node(f, n->data.tofloat.expr); break;
+        case AST_RETURN: iface_write_node(f, n->data.return_stmt.expr); break;
+        case AST_INDEX:
+            iface_write_node(f, n->data.index.target);
+            iface_write_node(f, n->data.index.index);
+            break;
+        case AST_MEMBER_ACCESS:
+            iface_write_node(f, n->data.member_access.object);
+            iface_write_node(f, n->data.member_access.field);
+            break;
+        case AST_ASSIGN:
+        case AST_CONST:
+            iface_write_node(f, n->data.assign.left);
+            iface_write_node(f, n->data.assign.right);
+            fprintf(f, " %d %d %d", (int)n->data.assign.mutability, n->data.assign.is_declaration, n->data.assign.is_public);
+            break;
+        case AST_BINOP:
+            fprintf(f, " %d", (int)n->data.binop.op);
+            iface_write_node(f, n->data.binop.left);
+            iface_write_node(f, n->data.binop.right);
+            break;
+        case AST_UNARYOP:
+            fprintf(f, " %d", (int)n->data.unaryop.op);
+            iface_write_node(f, n->data.unaryop.expr);
+            break;
+        case AST_NUM_INT: fprintf(f, " %lld", n->data.num_int.value); break;
+        case AST_NUM_FLOAT: fprintf(f, " %a", n->data.num_float.value); break;
+        case AST_CHAR: fprintf(f, " %d", (int)n->data.character.value); break;
+        case AST_STRING: iface_write_str(f, n->data.string.value); break;
+        case AST_IDENTIFIER: iface_write_str(f, n->data.identifier.name); break;
+        case AST_TYPE_LIST: iface_write_node(f, n->data.list_type.element_type); break;
+        case AST_TYPE_FIXED_SIZE_LIST:
+            iface_write_node(f, n->data.fixed_size_list_type.element_type);
+            fprintf(f, " %lld", n->data.fixed_size_list_type.size);
+            break;
+        case AST_IF:
+            iface_write_node(f, n->data.if_stmt.condition);
+            iface_write_node(f, n->data.if_stmt.then_body);
+            iface_write_node(f, n->data.if_stmt.else_body);
+            break;
+        case AST_WHILE:
+            iface_write_node(f, n->data.while_stmt.condition);
+            iface_write_node(f, n->data.while_stmt.body);
+            break;
+        case AST_MATCH://lowered 用到时重新生成
+            iface_write_node(f, n->data.match_stmt.scrutinee);
+            iface_write_node(f, n->data.match_stmt.arms);
+            break;
+        case AST_FOR:
+            iface_write_node(f, n->data.for_stmt.var);
+            iface_write_node(f, n->data.for_stmt.start);
+            iface_write_node(f, n->data.for_stmt.end);
+            iface_write_node(f, n->data.for_stmt.body);
+            fprintf(f, " %d %d", n->data.for_stmt.vectorize, n->data.for_stmt.unroll);
+            break;
+        case AST_FUNCTION:
+            iface_write_str(f, n->data.function.name);
+            iface_write_node(f, n->data.function.params);
+            iface_write_node(f, n->data.function.generic_params);
+            iface_write_node(f, n->data.function.return_type);
+            iface_write_node(f, n->data.function.body);
+            iface_write_str(f, n->data.function.linkage);
+            fprintf(f, " %d %d %d", n->data.function.is_extern, n->data.function.vararg, n->data.function.is_public);
+            break;
+        case AST_CALL:
+            iface_write_node(f, n->data.call.func);
+            iface_write_node(f, n->data.call.args);
+            iface_write_node(f, n->data.call.type_args);
+            break;
+        case AST_STRUCT_DEF:
+            iface_write_str(f, n->data.struct_def.name);
+            iface_write_node(f, n->data.struct_def.fields);
+            fprintf(f, " %d", n->data.struct_def.is_public);
+            break;
+        case AST_STRUCT_LITERAL:
+            iface_write_node(f, n->data.struct_literal.type_name);
+            iface_write_node(f, n->data.struct_literal.fields);
+            break;
+        case AST_GLOBAL:
+            iface_write_node(f, n->data.global_decl.identifier);
+            iface_write_node(f, n->data.global_decl.type);
+            iface_write_node(f, n->data.global_decl.initializer);
+            fprintf(f, " %d", n->data.global_decl.is_public);
+            break;
+        case AST_IMPORT: iface_write_str(f, n->data.import.module_path); break;
+        default://类型节点、nil、break、continue 没有字段
+            break;
+    }
+}
+
+int write_module_interface(int index, FILE* f) {
+    if (index < 0 || index >= g_module_count || !g_modules[index].done || !f) return 0;
+    ImportedModule* m = &g_modules[index];
+    fprintf(f, "vix-iface 1\ndeps %d", m->dep_count);
+    for (int d = 0; d < m->dep_count; d++) iface_write_str(f, g_modules[m->deps[d]].path);
+    fprintf(f, "\ndecls %d\n", m->iface_count);
+    for (int j = 0; j < m->iface_count; j++) {
+        int ref_dep = -1, ref_at = -1;
+        for (int d = 0; d < m->dep_count && ref_dep < 0; d++) {
+            ImportedModule* dep = &g_modules[m->deps[d]];
+            for (int k = 0; k < dep->iface_count; k++) {
+                if (dep->iface[k] == m->iface[j]) {
+                    ref_dep = d;
+                    ref_at = k;
+                    break;
+                }
+            }
+        }
+        if (ref_dep >= 0) {
+            fprintf(f, "1 %d %d\n", ref_dep, ref_at);
+        } else {
+            fputc('0', f);
+            iface_write_node(f, m->iface[j]);
+            fputc('\n', f);
+        }
+    }
+    return !ferror(f);
+}
+
+typedef struct {
+    const char* p;
+    const char* file;//读出来的节点都算这个模块里的
+    int bad;
+} IfaceReader;
+
+static void iface_skip_space(IfaceReader* r) {
+    while (*r->p == ' ' || *r->p == '\n') r->p++;
+}
+
+static long long iface_read_int(IfaceReader* r) {
+    iface_skip_space(r);
+    char* end;
+    long long v = strtoll(r->p, &end, 10);
+    if (end == r->p) r->bad = 1;
+    r->p = end;
+    return v;
+}
+
+static void iface_expect(IfaceReader* r, const char* word) {
+    iface_skip_space(r);
+    size_t len = strlen(word);
+    if (strncmp(r->p, word, len) != 0) {
+        r->bad = 1;
+        return;
+    }
+    r->p += len;
+}
+
+static char* iface_read_str(IfaceReader* r) {
+    iface_skip_space(r);
+    if (*r->p == '~') {
+        r->p++;
+        return NULL;
+    }
+    long long len = iface_read_int(r);
+    if (r->bad || len < 0 || *r->p != ':' || (long long)strnlen(r->p + 1, (size_t)len) < len) {
+        r->bad = 1;
+        return NULL;
+    }
+    char* s = ast_intern_len(r->p + 1, (size_t)len);
+    r->p += 1 + len;
+    return s;
+}
+
+static ASTNode* iface_read_node(IfaceReader* r);
+
+static ASTNode** iface_read_list(IfaceReader* r, int* count) {
+    long long n = iface_read_int(r);
+    if (r->bad || n < 0 || n > INT_MAX) {
+        r->bad = 1;
+        *count = 0;
+        return NULL;
+    }
+    ASTNode** items = ast_node_array((int)n);
+    for (int i = 0; i < n && !r->bad; i++) items[i] = iface_read_node(r);
+    *count = (int)n;
+    return items;
+}
+
+static ASTNode* iface_read_node(IfaceReader* r) {
+    iface_skip_space(r);
+    if (r->bad) return NULL;
+    if (*r->p == '-') {
+        r->p++;
+        return NULL;
+    }
+    long long type = iface_read_int(r);
+    if (r->bad || type < AST_PROGRAM || type > AST_MATCH) {
+        r->bad = 1;
+        return NULL;
+    }
+    ASTNode* n = ast_new_node();
+    n->type = (NodeType)type;
+    n->source_file = r->file;
+    n->location.first_line = (int)iface_read_int(r);
+    n->location.first_column = (int)iface_read_int(r);
+    n->location.last_line = (int)iface_read_int(r);
+    n->location.last_column = (int)iface_read_int(r);
+    n->mutability = (MutabilityType)iface_read_int(r);
+    switch (n->type) {
+        case AST_PROGRAM:
+            n->data.program.statements = iface_read_list(r, &n->data.program.statement_count);
+            break;
+        case AST_EXPRESSION_LIST:
+            n->data.expression_list.expressions = iface_read_list(r, &n->data.expression_list.expression_count);
+            n->data.expression_list.precomputed_length = (int)iface_read_int(r);
+            break;
+        case AST_PRINT: n->data.print.expr = iface_read_node(r); break;
+        case AST_INPUT: n->data.input.prompt = iface_read_node(r); break;
+        case AST_TOINT: n->data.toint.expr = iface_read_node(r); break;
+        case AST_TOFLOAT: n->data.tofloat.expr = iface_read_node(r); break;
+        case AST_RETURN: n->data.return_stmt.expr = iface_read_node(r); break;
+        case AST_INDEX:
+            n->data.index.target = iface_read_node(r);
+            n->data.index.index = iface_read_node(r);
+            break;
+        case AST_MEMBER_ACCESS:
+            n->data.member_access.object = iface_read_node(r);
+            n->data.member_access.field = iface_read_node(r);
+            break;
+        case AST_ASSIGN:
+        case AST_CONST:
+            n->data.assign.left = iface_read_node(r);
+            n->data.assign.right = iface_read_node(r);
+            n->data.assign.mutability = (MutabilityType)iface_read_int(r);
+            n->data.assign.is_declaration = (int)iface_read_int(r);
+            n->data.assign.is_public = (int)iface_read_int(r);
+            break;
+        case AST_BINOP:
+            n->data.binop.op = (BinOpType)iface_read_int(r);
+            n->data.binop.left = iface_read_node(r);
+            n->data.binop.right = iface_read_node(r);
+            break;
+        case AST_UNARYOP:
+            n->data.unaryop.op = (UnaryOpType)iface_read_int(r);
+            n->data.unaryop.expr = iface_read_node(r);
+            break;
+        case AST_NUM_INT: n->data.num_int.value = iface_read_int(r); break;
+        case AST_NUM_FLOAT: {
+            iface_skip_space(r);
+            char* end;
+            n->data.num_float.value = strtod(r->p, &end);
+            if (end == r->p) r->bad = 1;
+            r->p = end;
+            break;
+        }
+        case AST_CHAR: n->data.character.value = (char)iface_read_int(r); break;
+        case AST_STRING: n->data.string.value = iface_read_str(r); break;
+        case AST_IDENTIFIER: n->data.identifier.name = iface_read_str(r); break;
+        case AST_TYPE_LIST: n->data.list_type.element_type = iface_read_node(r); break;
+        case AST_TYPE_FIXED_SIZE_LIST:
+            n->data.fixed_size_list_type.element_type = iface_read_node(r);
+            n->data.fixed_size_list_type.size = iface_read_int(r);
+            break;
+        case AST_IF:
+            n->data.if_stmt.condition = iface_read_node(r);
+            n->data.if_stmt.then_body = iface_read_node(r);
+            n->data.if_stmt.else_body = iface_read_node(r);
+            break;
+        case AST_WHILE:
+            n->data.while_stmt.condition = iface_read_node(r);
+            n->data.while_stmt.body = iface_read_node(r);
+            break;
+        case AST_MATCH:
+            n->data.match_stmt.scrutinee = iface_read_node(r);
+            n->data.match_stmt.arms = iface_read_node(r);
+            break;
+        case AST_FOR:
+            n->data.for_stmt.var = iface_read_node(r);
+            n->data.for_stmt.start = iface_read_node(r);
+            n->data.for_stmt.end = iface_read_node(r);
+            n->data.for_stmt.body = iface_read_node(r);
+            n->data.for_stmt.vectorize = (int)iface_read_int(r);
+            n->data.for_stmt.unroll = (int)iface_read_int(r);
+            break;
+        case AST_FUNCTION:
+            n->data.function.name = iface_read_str(r);
+            n->data.function.params = iface_read_node(r);
+            n->data.function.generic_params = iface_read_node(r);
+            n->data.function.return_type = iface_read_node(r);
+            n->data.function.body = iface_read_node(r);
+            n->data.function.linkage = iface_read_str(r);
+            n->data.function.is_extern = (int)iface_read_int(r);
+            n->data.function.vararg = (int)iface_read_int(r);
+            n->data.function.is_public = (int)iface_read_int(r);
+            break;
+        case AST_CALL:
+            n->data.call.func = iface_read_node(r);
+            n->data.call.args = iface_read_node(r);
+            n->data.call.type_args = iface_read_node(r);
+            break;
+        case AST_STRUCT_DEF:
+            n->data.struct_def.name = iface_read_str(r);
+            n->data.struct_def.fields = iface_read_node(r);
+            n->data.struct_def.is_public = (int)iface_read_int(r);
+            break;
+        case AST_STRUCT_LITERAL:
+            n->data.struct_literal.type_name = iface_read_node(r);
+            n->data.struct_literal.fields = iface_read_node(r);
+            break;
+        case AST_GLOBAL:
+            n->data.global_decl.identifier = iface_read_node(r);
+            n->data.global_decl.type = iface_read_node(r);
+            n->data.global_decl.initializer = iface_read_node(r);
+            n->data.global_decl.is_public = (int)iface_read_int(r);
+            break;
+        case AST_IMPORT: n->data.import.module_path = iface_read_str(r); break;
+        default:
+            break;
+    }
+    return r->bad ? NULL : n;
+}
+
+static char* iface_slurp(FILE* f) {
+    size_t cap = 4096, len = 0, n;
+    char* buf = malloc(cap + 1);
+    while (buf && (n = fread(buf + len, 1, cap - len, f)) > 0) {
+        len += n;
+        if (len < cap) continue;
+        char* grown = realloc(buf, cap * 2 + 1);
+        if (!grown) {
+            free(buf);
+            return NULL;
+        }
+        buf = grown;
+        cap *= 2;
+    }
+    if (buf) buf[len] = '\0';
+    return buf;
+}
+
+//读缓存里第 index 个模块的接口文件：先加载它直接 import 的模块，再拼出 m->iface。读不了返回 0，调用方照常解析源码
+static int load_cached_interface(int index) {
+    FILE* f = g_open_cached_interface ? g_open_cached_interface(g_modules[index].path) : NULL;
+    if (!f) return 0;
+    char* buf = iface_slurp(f);
+    fclose(f);
+    if (!buf) return 0;
+
+    IfaceReader r = { buf, g_modules[index].path, 0 };
+    iface_expect(&r, "vix-iface");
+    if (iface_read_int(&r) != 1) r.bad = 1;
+    iface_expect(&r, "deps");
+    long long dep_count = iface_read_int(&r);
+    if (dep_count < 0 || dep_count > g_module_count + 4096) r.bad = 1;
+    int* deps = r.bad || dep_count == 0 ? NULL : malloc(sizeof(int) * (size_t)dep_count);
+    if (dep_count > 0 && !deps) r.bad = 1;
+    for (int d = 0; d < dep_count && !r.bad; d++) {
+        char* path = iface_read_str(&r);
+        ImportedModule* dm = path ? load_imported_module(path) : NULL;//可能让 g_modules 扩容
+        if (!dm) r.bad = 1;
+        else deps[d] = (int)(dm - g_modules);
+    }
+    iface_expect(&r, "decls");
+    long long decl_count = iface_read_int(&r);
+    if (decl_count < 0) r.bad = 1;
+    ASTNode** iface = NULL;
+    int count = 0;
+    for (long long j = 0; j < decl_count && !r.bad; j++) {
+        ASTNode* d = NULL;
+        if (iface_read_int(&r) == 1) {
+            long long dep = iface_read_int(&r), at = iface_read_int(&r);
+            if (!r.bad && dep >= 0 && dep < dep_count && at >= 0 && at < g_modules[deps[dep]].iface_count) {
+                d = g_modules[deps[dep]].iface[at];
+            }
+        } else {
+            d = iface_read_node(&r);
+        }
+        if (!d) {
+            r.bad = 1;
+            break;
+        }
+        iface = ast_node_array_append(iface, count, d);
+        count++;
+    }
+    free(buf);
+    if (r.bad) {
+        free(deps);
+        return 0;
+    }
+    ImportedModule* m = &g_modules[index];
+    m->root = NULL;//不解析源码，它的 .o 从缓存里取
+    m->iface = iface;
+    m->iface_count = count;
+    m->deps = deps;
+    m->dep_count = (int)dep_count;
+    return 1;
+}
+
+void set_module_interface_cache(FILE* (*open_cached)(const char* module_path)) {
+    g_open_cached_interface = open_cached;
+}
+
 int get_array_length(ASTNode* node) {
     if (!node || node->type != AST_EXPRESSION_LIST) {
         return -1;
@@ -2172,3 +2945,21 @@ int get_array_length(ASTNode* node) {
     node->data.expression_list.precomputed_length = node->data.expression_list.expression_count;
     return node->data.expression_list.precomputed_length;
 }
+
+int vector_type_info(const char* name, NodeType* elem, int* lanes) {
+    if (!name || name[0] != 'v' || name[1] < '1' || name[1] > '9') return 0;
+    char* end = NULL;
+    long n = strtol(name + 1, &end, 10);
+    NodeType t;
+    int bits;
+    if (strcmp(end, "i8") == 0) { t = AST_TYPE_INT8; bits = 8; }
+    else if (strcmp(end, "i32") == 0) { t = AST_TYPE_INT32; bits = 32; }
+    else if (strcmp(end, "i64") == 0) { t = AST_TYPE_INT64; bits = 64; }
+    else if (strcmp(end, "f32") == 0) { t = AST_TYPE_FLOAT32; bits = 32; }
+    else if (strcmp(end, "f64") == 0) { t = AST_TYPE_FLOAT64; bits = 64; }
+    else return 0;
+    if (n < 2 || (n & (n - 1)) != 0 || n * bits > 512) return 0;//最宽到 AVX-512 的 512 位
+    if (elem) *elem = t;
+    if (lanes) *lanes = (int)n;
+    return 1;
+}
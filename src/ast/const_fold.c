@@ -0,0 +1,1056 @@
+#include "../include/ast.h"
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+
+//AST 层的常量折叠和常量传播：语义检查之后、VM / vic / LLVM 之前跑一遍，三个后端拿到同一棵树
+//整数宽度照 LLVM 后端：两边都放得下 i32 就按 i32 回绕，否则按 i64；char 和 char 按 i8
+//比较和 and/or 只在 if/while 条件里折叠，条件外它们是 bool 值，换成整数会改变 print 的输出
+//字符串比较是比指针，不折叠；字符串只传播 const，let 出来的字符串可能被原地改写，不能换成字面量
+//名字都是 intern 过的指针，表里只比指针；if/match 的分支在同一个环境里折，靠 undo 日志回滚
+
+typedef enum { CK_NONE, CK_CHAR, CK_I32, CK_I64, CK_F64, CK_STR } ConstKind;
+
+typedef struct {
+    ConstKind kind;
+    long long i;
+    double f;
+    const char* s;
+} ConstVal;
+
+typedef struct {
+    const char* name;//NULL 是空槽
+    ConstKind vkind;//变量的类型，CK_NONE 表示不知道
+    int known;//val 是不是当前值
+    ConstVal val;
+    int live;//0：回滚掉的插入留下的槽，当作不在
+    unsigned stamp;//最后一次记进 undo 日志时的 mark 编号；汇合表里记最后改它的分支
+} FoldVar;
+
+typedef struct {
+    const char* name;
+    FoldVar old;
+} FoldUndo;
+
+typedef struct {
+    FoldVar* slots;//开放寻址
+    int count;//用过的槽，包括 live == 0 的
+    int cap;
+    FoldUndo* log;//mark 之后每个名字第一次被改前的值
+    int log_count;
+    int log_cap;
+    unsigned serial;//当前 mark 的编号，0 表示没有 mark，不记日志
+    unsigned next_serial;
+} FoldEnv;
+
+typedef struct {
+    int log;
+    unsigned serial;
+} FoldMark;
+
+typedef struct {
+    const char** names;//按加入的顺序
+    int count;
+    int cap;
+    const char** slots;//开放寻址
+    int slot_cap;
+} NameSet;
+
+static NameSet g_addr;//取过地址的变量，永远不跟踪
+static NameSet g_fn_assigned;//函数里不带 let 赋值过的名字，顶层不跟踪
+static NameSet g_top;//顶层绑定过的名字，函数里没 let 过就不跟踪
+static NameSet g_top_dup;//顶层绑定了不止一次
+static FoldEnv g_consts;//顶层 const，每个函数从这里开始
+static int g_in_fn = 0;
+
+static unsigned int name_hash(const char* name) {
+    uintptr_t p = (uintptr_t)name;
+    p ^= p >> 17;
+    p *= (uintptr_t)0x9E3779B97F4A7C15ull;
+    return (unsigned int)(p >> 16);
+}
+
+static const char** name_set_slot(NameSet* set, const char* name) {
+    int mask = set->slot_cap - 1;
+    int i = (int)(name_hash(name) & (unsigned int)mask);
+    while (set->slots[i] && set->slots[i] != name) i = (i + 1) & mask;
+    return &set->slots[i];
+}
+
+static int name_set_has(NameSet* set, const char* name) {
+    return set->slot_cap && *name_set_slot(set, name) != NULL;
+}
+
+static void name_set_add(NameSet* set, const char* name) {
+    if (!name || name_set_has(set, name)) return;
+    if ((set->count + 1) * 4 > set->slot_cap * 3) {
+        free(set->slots);
+        set->slot_cap = set->slot_cap ? set->slot_cap * 2 : 16;
+        set->slots = calloc(set->slot_cap, sizeof(const char*));
+        for (int i = 0; i < set->count; i++) *name_set_slot(set, set->names[i]) = set->names[i];
+    }
+    if (set->count == set->cap) {
+        set->cap = set->cap ? set->cap * 2 : 16;
+        set->names = realloc(set->names, sizeof(const char*) * set->cap);
+    }
+    set->names[set->count++] = name;
+    *name_set_slot(set, name) = name;
+}
+
+static void name_set_free(NameSet* set) {
+    free(set->names);
+    free(set->slots);
+    memset(set, 0, sizeof(*set));
+}
+
+static FoldVar* env_slot(FoldEnv* env, const char* name) {
+    int mask = env->cap - 1;
+    int i = (int)(name_hash(name) & (unsigned int)mask);
+    while (env->slots[i].name && env->slots[i].name != name) i = (i + 1) & mask;
+    return &env->slots[i];
+}
+
+static FoldVar* env_find(FoldEnv* env, const char* name) {
+    if (!env->cap) return NULL;
+    FoldVar* v = env_slot(env, name);
+    return v->name && v->live ? v : NULL;
+}
+
+//要改 name 了：当前 mark 里第一次改它就把旧值记进日志。返回的指针下次 env_touch 之前有效
+static FoldVar* env_touch(FoldEnv* env, const char* name) {
+    if ((env->count + 1) * 4 > env->cap * 3) {
+        FoldVar* old = env->slots;
+        int old_cap = env->cap;
+        env->cap = old_cap ? old_cap * 2 : 16;
+        env->slots = calloc(env->cap, sizeof(FoldVar));
+        for (int i = 0; i < old_cap; i++) {
+            if (old[i].name) *env_slot(env, old[i].name) = old[i];
+        }
+        free(old);
+    }
+    FoldVar* v = env_slot(env, name);
+    if (!v->name) {
+        v->name = name;
+        env->count++;
+    }
+    if (env->serial && v->stamp != env->serial) {
+        if (env->log_count == env->log_cap) {
+            env->log_cap = env->log_cap ? env->log_cap * 2 : 16;
+            env->log = realloc(env->log, sizeof(FoldUndo) * env->log_cap);
+        }
+        env->log[env->log_count].name = name;
+        env->log[env->log_count].old = *v;
+        env->log_count++;
+        v->stamp = env->serial;
+    }
+    return v;
+}
+
+static void env_put(FoldEnv* env, const char* name, ConstKind vkind, int known, const ConstVal* val) {
+    FoldVar* v = env_touch(env, name);
+    v->live = 1;
+    v->vkind = vkind;
+    v->known = known && val;
+    if (v->known) v->val = *val;
+}
+
+//整个换成 v，stamp 留着
+static FoldVar* env_set(FoldEnv* env, const FoldVar* v) {
+    FoldVar* t = env_touch(env, v->name);
+    unsigned stamp = t->stamp;
+    *t = *v;
+    t->stamp = stamp;
+    return t;
+}
+
+//值不再已知，类型留着：同类型的字面量再赋进来还能接着跟踪
+static void env_forget(FoldEnv* env, const char* name) {
+    FoldVar* v = env_find(env, name);
+    if (v && !v->known) return;
+    if (v) env_touch(env, name)->known = 0;
+    else env_put(env, name, CK_NONE, 0, NULL);
+}
+
+static FoldMark env_mark(FoldEnv* env) {
+    FoldMark m = { env->log_count, env->serial };
+    env->serial = ++env->next_serial;
+    return m;
+}
+
+static void env_rollback(FoldEnv* env, FoldMark m) {
+    while (env->log_count > m.log) {
+        FoldUndo* u = &env->log[--env->log_count];
+        *env_slot(env, u->name) = u->old;
+    }
+    env->serial = m.serial;
+}
+
+static void env_copy(FoldEnv* dst, const FoldEnv* src) {
+    memset(dst, 0, sizeof(*dst));
+    dst->cap = src->cap;
+    dst->count = src->count;
+    dst->next_serial = src->next_serial;
+    if (!src->cap) return;
+    dst->slots = malloc(sizeof(FoldVar) * src->cap);
+    memcpy(dst->slots, src->slots, sizeof(FoldVar) * src->cap);
+}
+
+static void env_free(FoldEnv* env) {
+    free(env->slots);
+    free(env->log);
+    memset(env, 0, sizeof(*env));
+}
+
+static int const_equal(const ConstVal* a, const ConstVal* b) {
+    if (a->kind != b->kind) return 0;
+    switch (a->kind) {
+        case CK_F64: return memcmp(&a->f, &b->f, sizeof(double)) == 0;
+        case CK_STR: return strcmp(a->s, b->s) == 0;
+        default: return a->i == b->i;
+    }
+}
+
+//两条路径汇合：留下两边都一样的值，只有一边有的名字值不知道
+static FoldVar join_var(FoldVar a, const FoldVar* b) {
+    if (!a.live) {
+        a = *b;
+        a.known = 0;
+    } else if (!b->live) {
+        a.known = 0;
+    } else if (a.vkind != b->vkind) {
+        a.vkind = CK_NONE;
+        a.known = 0;
+    } else if (a.known && (!b->known || !const_equal(&a.val, &b->val))) {
+        a.known = 0;
+    }
+    return a;
+}
+
+//if/match 的汇合：每条分支从同一个 mark 开始折，折完把改过的名字并进 acc 再回滚
+typedef struct {
+    FoldEnv acc;//分支改过的名字汇合后的值，stamp 是最后改它的分支
+    FoldMark mark;
+    int arms;
+    int fall;//还有一条哪个分支都不进的路径
+} FoldJoin;
+
+static void join_branch(FoldJoin* j, FoldEnv* env) {
+    j->mark = env_mark(env);
+}
+
+static void join_merge(FoldJoin* j, FoldEnv* env) {
+    j->arms++;
+    for (int i = j->mark.log; i < env->log_count; i++) {
+        FoldUndo* u = &env->log[i];
+        FoldVar* a = env_find(&j->acc, u->name);
+        FoldVar v;
+        if (a) v = join_var(*a, env_slot(env, u->name));
+        else if (j->arms == 1 && !j->fall) v = *env_slot(env, u->name);
+        else v = join_var(u->old, env_slot(env, u->name));//之前的路径没改过它
+        env_set(&j->acc, &v)->stamp = (unsigned)j->arms;
+    }
+    env_rollback(env, j->mark);
+    if (j->arms == 1) return;
+    FoldVar none = {0};
+    for (int i = 0; i < j->acc.cap; i++) {
+        FoldVar* a = &j->acc.slots[i];
+        if (!a->name || a->stamp == (unsigned)j->arms) continue;
+        FoldVar* base = env_find(env, a->name);//这条分支没改过它
+        unsigned stamp = a->stamp;
+        *a = join_var(*a, base ? base : &none);
+        a->stamp = stamp;
+    }
+}
+
+static void join_finish(FoldJoin* j, FoldEnv* env) {
+    for (int i = 0; i < j->acc.cap; i++) {
+        if (j->acc.slots[i].name) env_set(env, &j->acc.slots[i]);
+    }
+    env_free(&j->acc);
+}
+
+static int lit_val(ASTNode* node, ConstVal* v) {
+    if (!node) return 0;
+    memset(v, 0, sizeof(*v));
+    switch (node->type) {
+        case AST_NUM_INT:
+            v->i = node->data.num_int.value;
+            v->kind = (v->i >= INT32_MIN && v->i <= INT32_MAX) ? CK_I32 : CK_I64;
+            return 1;
+        case AST_NUM_FLOAT:
+            v->kind = CK_F64;
+            v->f = node->data.num_float.value;
+            return 1;
+        case AST_CHAR:
+            v->kind = CK_CHAR;
+            v->i = node->data.character.value;
+            return 1;
+        case AST_STRING:
+            if (!node->data.string.value) return 0;
+            v->kind = CK_STR;
+            v->s = node->data.string.value;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static ASTNode* make_lit(const ConstVal* v, ASTNode* orig) {
+    ASTNode* n;
+    if (v->kind == CK_I64 && v->i >= INT32_MIN && v->i <= INT32_MAX) return orig;//写成字面量会变成 i32
+    switch (v->kind) {
+        case CK_CHAR: n = create_char_node_with_location((char)v->i, orig->location); break;
+        case CK_I32:
+        case CK_I64: n = create_num_int_node_with_location(v->i, orig->location); break;
+        case CK_F64: n = create_num_float_node_with_location(v->f, orig->location); break;
+        case CK_STR: n = create_string_node_with_location(v->s, orig->location); break;
+        default: return orig;
+    }
+    n->source_file = orig->source_file;
+    return n;
+}
+
+static long long wrap_int(ConstKind k, unsigned long long x) {
+    switch (k) {
+        case CK_CHAR: return (long long)(int8_t)(uint8_t)x;
+        case CK_I32: return (long long)(int32_t)(uint32_t)x;
+        default: return (long long)x;
+    }
+}
+
+static int is_num(ConstKind k) {
+    return k == CK_CHAR || k == CK_I32 || k == CK_I64 || k == CK_F64;
+}
+
+static double as_f64(const ConstVal* v) {
+    return v->kind == CK_F64 ? v->f : (double)v->i;
+}
+
+//-1 表示不是能当条件用的常量
+static int truth(const ConstVal* v) {
+    if (v->kind == CK_F64) return v->f != 0.0;
+    if (is_num(v->kind)) return v->i != 0;
+    return -1;
+}
+
+static int is_compare(BinOpType op) {
+    return op == OP_EQ || op == OP_NE || op == OP_LT || op == OP_LE || op == OP_GT || op == OP_GE;
+}
+
+static int fold_string_op(BinOpType op, const ConstVal* a, const ConstVal* b, ConstVal* r) {
+    if ((op == OP_ADD || op == OP_CONCAT) && a->kind == CK_STR && b->kind == CK_STR) {
+        size_t la = strlen(a->s), lb = strlen(b->s);
+        char* s = ast_alloc(la + lb + 1);
+        memcpy(s, a->s, la);
+        memcpy(s + la, b->s, lb + 1);
+        r->kind = CK_STR;
+        r->s = s;
+        return 1;
+    }
+    if ((op == OP_MUL || op == OP_REPEAT) && a->kind == CK_STR && (b->kind == CK_I32 || b->kind == CK_I64)) {
+        size_t la = strlen(a->s);
+        long long n = b->i < 0 ? 0 : b->i;
+        if (la > 0 && (unsigned long long)n > 65536 / la) return 0;//太长的字面量不如运行时拼
+        char* s = ast_alloc(la * (size_t)n + 1);
+        for (long long i = 0; i < n; i++) memcpy(s + la * (size_t)i, a->s, la);
+        s[la * (size_t)n] = '\0';
+        r->kind = CK_STR;
+        r->s = s;
+        return 1;
+    }
+    return 0;
+}
+
+static int fold_binop_val(BinOpType op, const ConstVal* a, const ConstVal* b, ConstVal* r) {
+    memset(r, 0, sizeof(*r));
+    if (a->kind == CK_STR || b->kind == CK_STR) return fold_string_op(op, a, b, r);
+    if (!is_num(a->kind) || !is_num(b->kind) || op == OP_AND || op == OP_OR) return 0;
+
+    if (is_compare(op)) {
+        int c;
+        if (a->kind == CK_F64 || b->kind == CK_F64) {
+            double x = as_f64(a), y = as_f64(b);
+            if (isnan(x) || isnan(y)) return 0;
+            c = op == OP_EQ ? x == y : op == OP_NE ? x != y : op == OP_LT ? x < y :
+                op == OP_LE ? x <= y : op == OP_GT ? x > y : x >= y;
+        } else {
+            long long x = a->i, y = b->i;
+            c = op == OP_EQ ? x == y : op == OP_NE ? x != y : op == OP_LT ? x < y :
+                op == OP_LE ? x <= y : op == OP_GT ? x > y : x >= y;
+        }
+        r->kind = CK_I32;
+        r->i = c;
+        return 1;
+    }
+
+    if (a->kind == CK_F64 || b->kind == CK_F64 || (op == OP_POW && b->i < 0)) {
+        double x = as_f64(a), y = as_f64(b), z;
+        switch (op) {
+            case OP_ADD: z = x + y; break;
+            case OP_SUB: z = x - y; break;
+            case OP_MUL: z = x * y; break;
+            case OP_DIV: z = x / y; break;
+            case OP_MOD: z = fmod(x, y); break;
+            case OP_POW: z = pow(x, y); break;
+            default: return 0;
+        }
+        if (!isfinite(z)) return 0;
+        r->kind = CK_F64;
+        r->f = z;
+        return 1;
+    }
+
+    //char 和 int 一起算提升到 int，i32 和 i64 一起算提升到 i64
+    ConstKind k = a->kind > b->kind ? a->kind : b->kind;
+    unsigned long long x = (unsigned long long)a->i, y = (unsigned long long)b->i;
+    long long kmin = k == CK_CHAR ? INT8_MIN : k == CK_I32 ? INT32_MIN : LLONG_MIN;
+    switch (op) {
+        case OP_ADD: r->i = wrap_int(k, x + y); break;
+        case OP_SUB: r->i = wrap_int(k, x - y); break;
+        case OP_MUL: r->i = wrap_int(k, x * y); break;
+        case OP_DIV:
+        case OP_MOD:
+            if (b->i == 0 || (a->i == kmin && b->i == -1)) return 0;//运行时照原样出错
+            r->i = op == OP_DIV ? a->i / b->i : a->i % b->i;
+            break;
+        case OP_POW: {
+            unsigned long long acc = 1, base = x;
+            for (long long e = b->i; e > 0; e >>= 1) {
+                if (e & 1) acc *= base;
+                base *= base;
+            }
+            r->i = wrap_int(k, acc);
+            break;
+        }
+        default:
+            return 0;
+    }
+    r->kind = k;
+    return 1;
+}
+
+//没有副作用、不会出运行时错误，被 and/or 定下来的时候可以整个丢掉
+static int is_pure(ASTNode* node) {
+    if (!node) return 1;
+    switch (node->type) {
+        case AST_NUM_INT:
+        case AST_NUM_FLOAT:
+        case AST_CHAR:
+        case AST_STRING:
+        case AST_NIL:
+        case AST_IDENTIFIER:
+            return 1;
+        case AST_BINOP:
+            if (node->data.binop.op == OP_DIV || node->data.binop.op == OP_MOD || node->data.binop.op == OP_POW) return 0;
+            return is_pure(node->data.binop.left) && is_pure(node->data.binop.right);
+        case AST_UNARYOP:
+            return (node->data.unaryop.op == OP_MINUS || node->data.unaryop.op == OP_PLUS) && is_pure(node->data.unaryop.expr);
+        case AST_MEMBER_ACCESS:
+            return node->data.member_access.object && node->data.member_access.object->type == AST_IDENTIFIER;
+        default:
+            return 0;
+    }
+}
+
+static ASTNode* fold_expr(ASTNode* node, FoldEnv* env, int cond);
+
+static ASTNode* fold_logic(ASTNode* node, FoldEnv* env, int cond) {
+    ASTNode* l0 = node->data.binop.left;
+    ASTNode* r0 = node->data.binop.right;
+    ASTNode* l = fold_expr(l0, env, cond);
+    ASTNode* r = fold_expr(r0, env, cond);
+    ConstVal lv, rv;
+    int lt = (cond && lit_val(l, &lv)) ? truth(&lv) : -1;
+    int rt = (cond && lit_val(r, &rv)) ? truth(&rv) : -1;
+    int is_and = node->data.binop.op == OP_AND;
+    ConstVal res = { CK_I32, 0, 0.0, NULL };
+
+    if (lt >= 0 && rt >= 0) {
+        res.i = is_and ? (lt && rt) : (lt || rt);
+        return make_lit(&res, node);
+    }
+    //一边定下了结果：另一边没有副作用才能丢；一边是单位元：留下另一边
+    if (lt >= 0) {
+        if (lt == !is_and) {
+            if (is_pure(r)) { res.i = lt; return make_lit(&res, node); }
+        } else {
+            return r;
+        }
+    }
+    if (rt >= 0) {
+        if (rt == !is_and) {
+            if (is_pure(l)) { res.i = rt; return make_lit(&res, node); }
+        } else {
+            return l;
+        }
+    }
+    //留着没折完的 and/or 时，操作数保持原来的比较，不混进整数
+    node->data.binop.left = lt >= 0 ? l0 : l;
+    node->data.binop.right = rt >= 0 ? r0 : r;
+    return node;
+}
+
+static void fold_list(ASTNode* list, FoldEnv* env) {
+    if (!list || list->type != AST_EXPRESSION_LIST) return;
+    for (int i = 0; i < list->data.expression_list.expression_count; i++) {
+        list->data.expression_list.expressions[i] = fold_expr(list->data.expression_list.expressions[i], env, 0);
+    }
+}
+
+static ASTNode* fold_expr(ASTNode* node, FoldEnv* env, int cond) {
+    if (!node) return NULL;
+    ConstVal a, b, r;
+    switch (node->type) {
+        case AST_IDENTIFIER: {
+            FoldVar* v = env_find(env, node->data.identifier.name);
+            if (v && v->known) return make_lit(&v->val, node);
+            return node;
+        }
+        case AST_BINOP: {
+            BinOpType op = node->data.binop.op;
+            if (op == OP_AND || op == OP_OR) return fold_logic(node, env, cond);
+            node->data.binop.left = fold_expr(node->data.binop.left, env, 0);
+            node->data.binop.right = fold_expr(node->data.binop.right, env, 0);
+            if (is_compare(op) && !cond) return node;
+            if (lit_val(node->data.binop.left, &a) && lit_val(node->data.binop.right, &b) &&
+                fold_binop_val(op, &a, &b, &r)) {
+                return make_lit(&r, node);
+            }
+            return node;
+        }
+        case AST_UNARYOP: {
+            UnaryOpType op = node->data.unaryop.op;
+            if (op != OP_MINUS && op != OP_PLUS) return node;//& 和 @ 的操作数是左值
+            ASTNode* e = fold_expr(node->data.unaryop.expr, env, 0);
+            node->data.unaryop.expr = e;
+            if (!lit_val(e, &a) || !is_num(a.kind)) return node;
+            if (op == OP_PLUS) return e;
+            if (a.kind == CK_F64) a.f = -a.f;
+            else a.i = wrap_int(a.kind, 0ULL - (unsigned long long)a.i);
+            return make_lit(&a, node);
+        }
+        case AST_TOINT: {
+            ASTNode* e = fold_expr(node->data.toint.expr, env, 0);
+            node->data.toint.expr = e;
+            if (!lit_val(e, &a) || !is_num(a.kind)) return node;
+            if (a.kind == CK_F64) {
+                if (!(a.f > -2147483649.0 && a.f < 2147483648.0)) return node;
+                a.i = (long long)a.f;
+            } else if (a.kind == CK_CHAR && a.i < 0) {
+                return node;
+            }
+            a.kind = CK_I32;
+            a.i = wrap_int(CK_I32, (unsigned long long)a.i);
+            return make_lit(&a, node);
+        }
+        case AST_TOFLOAT: {
+            ASTNode* e = fold_expr(node->data.tofloat.expr, env, 0);
+            node->data.tofloat.expr = e;
+            if (!lit_val(e, &a) || !is_num(a.kind) || (a.kind == CK_CHAR && a.i < 0)) return node;
+            a.f = as_f64(&a);
+            a.kind = CK_F64;
+            return make_lit(&a, node);
+        }
+        case AST_CALL: {
+            ASTNode* f = node->data.call.func;
+            if (f && f->type == AST_MEMBER_ACCESS) fold_expr(f, env, 0);
+            fold_list(node->data.call.args, env);
+            return node;
+        }
+        case AST_INDEX:
+            if (node->data.index.target && node->data.index.target->type != AST_IDENTIFIER) {
+                node->data.index.target = fold_expr(node->data.index.target, env, 0);
+            }
+            node->data.index.index = fold_expr(node->data.index.index, env, 0);
+            return node;
+        case AST_MEMBER_ACCESS:
+            if (node->data.member_access.object && node->data.member_access.object->type != AST_IDENTIFIER) {
+                node->data.member_access.object = fold_expr(node->data.member_access.object, env, 0);
+            }
+            return node;
+        case AST_EXPRESSION_LIST:
+            fold_list(node, env);
+            return node;
+        case AST_STRUCT_LITERAL: {
+            ASTNode* fields = node->data.struct_literal.fields;
+            if (!fields || fields->type != AST_EXPRESSION_LIST) return node;
+            for (int i = 0; i < fields->data.expression_list.expression_count; i++) {
+                ASTNode* fd = fields->data.expression_list.expressions[i];
+                if (fd && fd->type == AST_ASSIGN) fd->data.assign.right = fold_expr(fd->data.assign.right, env, 0);
+            }
+            return node;
+        }
+        case AST_INPUT:
+            node->data.input.prompt = fold_expr(node->data.input.prompt, env, 0);
+            return node;
+        default:
+            return node;
+    }
+}
+
+//左值里只有下标是读
+static void fold_lvalue(ASTNode* node, FoldEnv* env) {
+    if (!node) return;
+    switch (node->type) {
+        case AST_INDEX:
+            fold_lvalue(node->data.index.target, env);
+            node->data.index.index = fold_expr(node->data.index.index, env, 0);
+            break;
+        case AST_MEMBER_ACCESS:
+            fold_lvalue(node->data.member_access.object, env);
+            break;
+        case AST_UNARYOP:
+            fold_lvalue(node->data.unaryop.expr, env);
+            break;
+        default:
+            break;
+    }
+}
+
+static void bind(FoldEnv* env, const char* name, ASTNode* value, int is_decl, int is_const) {
+    if (!name) return;
+    if (name_set_has(&g_addr, name)) {
+        env_put(env, name, CK_NONE, 0, NULL);
+        return;
+    }
+    ConstVal v;
+    int c = lit_val(value, &v);
+    if (c && v.kind == CK_STR && !is_const) {
+        env_put(env, name, CK_STR, 0, NULL);
+        return;
+    }
+    FoldVar* e = env_find(env, name);
+    if (!g_in_fn && name_set_has(&g_fn_assigned, name)) {
+        env_put(env, name, CK_NONE, 0, NULL);//函数里会改它
+    } else if (is_decl || is_const) {
+        env_put(env, name, c ? v.kind : CK_NONE, c, &v);
+    } else if (e) {
+        if (c && e->vkind == v.kind) env_put(env, name, e->vkind, 1, &v);
+        else env_forget(env, name);
+    } else if (g_in_fn ? name_set_has(&g_top, name) : name_set_has(&g_fn_assigned, name)) {
+        env_put(env, name, CK_NONE, 0, NULL);//别处也会写它
+    } else {
+        env_put(env, name, c ? v.kind : CK_NONE, c, &v);//隐式声明
+    }
+}
+
+//语句里所有被赋值的名字（不进嵌套函数），循环前后要作废
+static void collect_assigned(ASTNode* node, NameSet* out) {
+    if (!node) return;
+    switch (node->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < node->data.program.statement_count; i++) collect_assigned(node->data.program.statements[i], out);
+            break;
+        case AST_ASSIGN:
+        case AST_CONST:
+            if (node->data.assign.left && node->data.assign.left->type == AST_IDENTIFIER) {
+                name_set_add(out, node->data.assign.left->data.identifier.name);
+            }
+            break;
+        case AST_IF:
+            collect_assigned(node->data.if_stmt.then_body, out);
+            collect_assigned(node->data.if_stmt.else_body, out);
+            break;
+        case AST_WHILE:
+            collect_assigned(node->data.while_stmt.body, out);
+            break;
+        case AST_FOR:
+            if (node->data.for_stmt.var && node->data.for_stmt.var->type == AST_IDENTIFIER) {
+                name_set_add(out, node->data.for_stmt.var->data.identifier.name);
+            }
+            collect_assigned(node->data.for_stmt.body, out);
+            break;
+        case AST_MATCH: {
+            ASTNode* arms = node->data.match_stmt.arms;
+            if (!arms || arms->type != AST_EXPRESSION_LIST) break;
+            for (int i = 0; i < arms->data.expression_list.expression_count; i++) {
+                ASTNode* arm = arms->data.expression_list.expressions[i];
+                if (arm && arm->type == AST_ASSIGN) collect_assigned(arm->data.assign.right, out);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void forget_all(FoldEnv* env, NameSet* names) {
+    for (int i = 0; i < names->count; i++) env_forget(env, names->names[i]);
+}
+
+//模式里出现的名字在分支里是新绑定
+static void forget_pattern(ASTNode* node, FoldEnv* env) {
+    if (!node) return;
+    switch (node->type) {
+        case AST_IDENTIFIER:
+            env_put(env, node->data.identifier.name, CK_NONE, 0, NULL);
+            break;
+        case AST_CALL:
+            forget_pattern(node->data.call.args, env);
+            break;
+        case AST_EXPRESSION_LIST:
+            for (int i = 0; i < node->data.expression_list.expression_count; i++) {
+                forget_pattern(node->data.expression_list.expressions[i], env);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void fold_block(ASTNode* prog, FoldEnv* env);
+static ASTNode* fold_stmt(ASTNode* s, FoldEnv* env, int* splice);
+
+static void fold_body(ASTNode** slot, FoldEnv* env) {
+    if (!*slot) return;
+    if ((*slot)->type == AST_PROGRAM) {
+        fold_block(*slot, env);
+        return;
+    }
+    int splice = 0;
+    ASTNode* r = fold_stmt(*slot, env, &splice);
+    *slot = r ? r : create_program_node_with_location((*slot)->location);
+}
+
+//块里没有新声明时才能摊平到外层，免得改变作用域
+static int can_splice(ASTNode* block, FoldEnv* env) {
+    if (!block || block->type != AST_PROGRAM) return 0;
+    for (int i = 0; i < block->data.program.statement_count; i++) {
+        ASTNode* s = block->data.program.statements[i];
+        if (!s) continue;
+        switch (s->type) {
+            case AST_ASSIGN:
+                if (s->data.assign.is_declaration) return 0;
+                if (s->data.assign.left && s->data.assign.left->type == AST_IDENTIFIER &&
+                    !env_find(env, s->data.assign.left->data.identifier.name)) return 0;
+                break;
+            case AST_CONST:
+            case AST_GLOBAL:
+            case AST_FUNCTION:
+            case AST_STRUCT_DEF:
+            case AST_IMPORT:
+            case AST_PROGRAM:
+                return 0;
+            default:
+                break;
+        }
+    }
+    return 1;
+}
+
+static ASTNode* fold_if(ASTNode* s, FoldEnv* env, int* splice) {
+    ASTNode* cond = fold_expr(s->data.if_stmt.condition, env, 1);
+    ConstVal cv;
+    int t = lit_val(cond, &cv) ? truth(&cv) : -1;
+    if (t >= 0) {
+        ASTNode* body = t ? s->data.if_stmt.then_body : s->data.if_stmt.else_body;
+        if (!body) return NULL;
+        if (body->type == AST_IF) return fold_if(body, env, splice);//elif
+        if (body->type != AST_PROGRAM) return fold_stmt(body, env, splice);
+        int sp = can_splice(body, env);
+        fold_block(body, env);
+        if (sp) {
+            *splice = 1;
+            return body;
+        }
+        ConstVal one = { CK_I32, 1, 0.0, NULL };
+        s->data.if_stmt.condition = make_lit(&one, cond);
+        s->data.if_stmt.then_body = body;
+        s->data.if_stmt.else_body = NULL;
+        return s;
+    }
+
+    s->data.if_stmt.condition = cond;
+    FoldJoin j = {0};
+    j.fall = s->data.if_stmt.else_body == NULL;
+    join_branch(&j, env);
+    fold_body(&s->data.if_stmt.then_body, env);
+    join_merge(&j, env);
+    if (s->data.if_stmt.else_body) {
+        join_branch(&j, env);
+        if (s->data.if_stmt.else_body->type == AST_IF) {
+            int sp = 0;
+            s->data.if_stmt.else_body = fold_if(s->data.if_stmt.else_body, env, &sp);
+        } else {
+            fold_body(&s->data.if_stmt.else_body, env);
+        }
+        join_merge(&j, env);
+    }
+    join_finish(&j, env);
+    return s;
+}
+
+static void fold_function(ASTNode* fn) {
+    if (!fn->data.function.body) return;
+    int saved = g_in_fn;
+    FoldEnv fe;
+    env_copy(&fe, &g_consts);
+    g_in_fn = 1;
+    ASTNode* params = fn->data.function.params;
+    if (params && params->type == AST_EXPRESSION_LIST) {
+        for (int i = 0; i < params->data.expression_list.expression_count; i++) {
+            ASTNode* p = params->data.expression_list.expressions[i];
+            if (p && p->type == AST_ASSIGN) p = p->data.assign.left;
+            if (p && p->type == AST_IDENTIFIER) env_put(&fe, p->data.identifier.name, CK_NONE, 0, NULL);
+        }
+    }
+    fold_body(&fn->data.function.body, &fe);
+    env_free(&fe);
+    g_in_fn = saved;
+}
+
+static ASTNode* fold_stmt(ASTNode* s, FoldEnv* env, int* splice) {
+    *splice = 0;
+    if (!s) return NULL;
+    switch (s->type) {
+        case AST_PROGRAM:
+            fold_block(s, env);
+            return s;
+        case AST_ASSIGN:
+        case AST_CONST: {
+            ASTNode* left = s->data.assign.left;
+            s->data.assign.right = fold_expr(s->data.assign.right, env, 0);
+            if (left && left->type == AST_IDENTIFIER) {
+                bind(env, left->data.identifier.name, s->data.assign.right, s->data.assign.is_declaration, s->type == AST_CONST);
+            } else {
+                fold_lvalue(left, env);
+            }
+            return s;
+        }
+        case AST_GLOBAL:
+            s->data.global_decl.initializer = fold_expr(s->data.global_decl.initializer, env, 0);
+            if (s->data.global_decl.identifier && s->data.global_decl.identifier->type == AST_IDENTIFIER) {
+                env_put(env, s->data.global_decl.identifier->data.identifier.name, CK_NONE, 0, NULL);
+            }
+            return s;
+        case AST_PRINT:
+            s->data.print.expr = fold_expr(s->data.print.expr, env, 0);
+            return s;
+        case AST_RETURN:
+            s->data.return_stmt.expr = fold_expr(s->data.return_stmt.expr, env, 0);
+            return s;
+        case AST_IF:
+            return fold_if(s, env, splice);
+        case AST_WHILE: {
+            NameSet names = {0};
+            collect_assigned(s->data.while_stmt.body, &names);
+            forget_all(env, &names);
+            s->data.while_stmt.condition = fold_expr(s->data.while_stmt.condition, env, 1);
+            ConstVal cv;
+            if (lit_val(s->data.while_stmt.condition, &cv) && truth(&cv) == 0) {
+                name_set_free(&names);
+                return NULL;
+            }
+            fold_body(&s->data.while_stmt.body, env);
+            forget_all(env, &names);
+            name_set_free(&names);
+            return s;
+        }
+        case AST_FOR: {
+            NameSet names = {0};
+            s->data.for_stmt.start = fold_expr(s->data.for_stmt.start, env, 0);
+            s->data.for_stmt.end = fold_expr(s->data.for_stmt.end, env, 0);
+            collect_assigned(s, &names);
+            forget_all(env, &names);
+            fold_body(&s->data.for_stmt.body, env);
+            forget_all(env, &names);
+            name_set_free(&names);
+            return s;
+        }
+        case AST_MATCH: {
+            ASTNode* arms = s->data.match_stmt.arms;
+            s->data.match_stmt.scrutinee = fold_expr(s->data.match_stmt.scrutinee, env, 0);
+            if (arms && arms->type == AST_EXPRESSION_LIST) {
+                FoldJoin j = {0};
+                j.fall = 1;//没有分支匹配上的路径
+                for (int i = 0; i < arms->data.expression_list.expression_count; i++) {
+                    ASTNode* arm = arms->data.expression_list.expressions[i];
+                    if (!arm || arm->type != AST_ASSIGN) continue;
+                    join_branch(&j, env);
+                    forget_pattern(arm->data.assign.left, env);
+                    fold_body(&arm->data.assign.right, env);
+                    join_merge(&j, env);
+                }
+                join_finish(&j, env);
+            }
+            s->data.match_stmt.lowered = NULL;//语义检查时按旧分支生成过，用到时重新生成
+            return s;
+        }
+        case AST_FUNCTION:
+            fold_function(s);
+            return s;
+        case AST_STRUCT_DEF:
+        case AST_IMPORT:
+        case AST_BREAK:
+        case AST_CONTINUE:
+            return s;
+        default:
+            return fold_expr(s, env, 0);
+    }
+}
+
+static void fold_block(ASTNode* prog, FoldEnv* env) {
+    ASTNode* out = create_program_node_with_location(prog->location);
+    int changed = 0;
+    for (int i = 0; i < prog->data.program.statement_count; i++) {
+        ASTNode* s = prog->data.program.statements[i];
+        int splice = 0;
+        ASTNode* r = fold_stmt(s, env, &splice);
+        if (r != s) changed = 1;
+        if (!r) continue;
+        if (splice) {
+            for (int j = 0; j < r->data.program.statement_count; j++) add_statement_to_program(out, r->data.program.statements[j]);
+        } else {
+            add_statement_to_program(out, r);
+        }
+    }
+    if (changed) {
+        prog->data.program.statements = out->data.program.statements;
+        prog->data.program.statement_count = out->data.program.statement_count;
+    }
+}
+
+//先扫一遍整棵树：取地址的名字、函数里直接赋值的名字
+static void scan_tree(ASTNode* node, int in_fn) {
+    if (!node) return;
+    switch (node->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < node->data.program.statement_count; i++) scan_tree(node->data.program.statements[i], in_fn);
+            break;
+        case AST_EXPRESSION_LIST:
+            for (int i = 0; i < node->data.expression_list.expression_count; i++) scan_tree(node->data.expression_list.expressions[i], in_fn);
+            break;
+        case AST_ASSIGN:
+        case AST_CONST:
+            if (in_fn && node->type == AST_ASSIGN && !node->data.assign.is_declaration &&
+                node->data.assign.left && node->data.assign.left->type == AST_IDENTIFIER) {
+                name_set_add(&g_fn_assigned, node->data.assign.left->data.identifier.name);
+            }
+            scan_tree(node->data.assign.left, in_fn);
+            scan_tree(node->data.assign.right, in_fn);
+            break;
+        case AST_UNARYOP:
+            if (node->data.unaryop.op == OP_ADDRESS) {
+                ASTNode* base = node->data.unaryop.expr;
+                while (base && (base->type == AST_INDEX || base->type == AST_MEMBER_ACCESS)) {
+                    base = base->type == AST_INDEX ? base->data.index.target : base->data.member_access.object;
+                }
+                if (base && base->type == AST_IDENTIFIER) name_set_add(&g_addr, base->data.identifier.name);
+            }
+            scan_tree(node->data.unaryop.expr, in_fn);
+            break;
+        case AST_BINOP:
+            scan_tree(node->data.binop.left, in_fn);
+            scan_tree(node->data.binop.right, in_fn);
+            break;
+        case AST_PRINT: scan_tree(node->data.print.expr, in_fn); break;
+        case AST_RETURN: scan_tree(node->data.return_stmt.expr, in_fn); break;
+        case AST_TOINT: scan_tree(node->data.toint.expr, in_fn); break;
+        case AST_TOFLOAT: scan_tree(node->data.tofloat.expr, in_fn); break;
+        case AST_INPUT: scan_tree(node->data.input.prompt, in_fn); break;
+        case AST_GLOBAL: scan_tree(node->data.global_decl.initializer, in_fn); break;
+        case AST_INDEX:
+            scan_tree(node->data.index.target, in_fn);
+            scan_tree(node->data.index.index, in_fn);
+            break;
+        case AST_MEMBER_ACCESS: scan_tree(node->data.member_access.object, in_fn); break;
+        case AST_CALL:
+            scan_tree(node->data.call.func, in_fn);
+            scan_tree(node->data.call.args, in_fn);
+            break;
+        case AST_STRUCT_LITERAL: scan_tree(node->data.struct_literal.fields, in_fn); break;
+        case AST_IF:
+            scan_tree(node->data.if_stmt.condition, in_fn);
+            scan_tree(node->data.if_stmt.then_body, in_fn);
+            scan_tree(node->data.if_stmt.else_body, in_fn);
+            break;
+        case AST_WHILE:
+            scan_tree(node->data.while_stmt.condition, in_fn);
+            scan_tree(node->data.while_stmt.body, in_fn);
+            break;
+        case AST_FOR:
+            scan_tree(node->data.for_stmt.start, in_fn);
+            scan_tree(node->data.for_stmt.end, in_fn);
+            scan_tree(node->data.for_stmt.body, in_fn);
+            break;
+        case AST_MATCH:
+            scan_tree(node->data.match_stmt.scrutinee, in_fn);
+            scan_tree(node->data.match_stmt.arms, in_fn);
+            break;
+        case AST_FUNCTION:
+            scan_tree(node->data.function.body, 1);
+            break;
+        default:
+            break;
+    }
+}
+
+//顶层（不进函数）绑定过的名字
+static void scan_top(ASTNode* node) {
+    if (!node) return;
+    NameSet names = {0};
+    if (node->type == AST_PROGRAM) {
+        for (int i = 0; i < node->data.program.statement_count; i++) {
+            ASTNode* s = node->data.program.statements[i];
+            if (!s) continue;
+            if (s->type == AST_PROGRAM) {
+                scan_top(s);
+                continue;
+            }
+            if (s->type == AST_GLOBAL && s->data.global_decl.identifier && s->data.global_decl.identifier->type == AST_IDENTIFIER) {
+                name_set_add(&names, s->data.global_decl.identifier->data.identifier.name);
+            }
+            NameSet one = {0};
+            collect_assigned(s, &one);
+            for (int j = 0; j < one.count; j++) {
+                if (name_set_has(&g_top, one.names[j])) name_set_add(&g_top_dup, one.names[j]);
+                name_set_add(&g_top, one.names[j]);
+            }
+            name_set_free(&one);
+        }
+    }
+    for (int j = 0; j < names.count; j++) {
+        if (name_set_has(&g_top, names.names[j])) name_set_add(&g_top_dup, names.names[j]);
+        name_set_add(&g_top, names.names[j]);
+    }
+    name_set_free(&names);
+}
+
+//顶层 const 按出现顺序求值，只绑定一次、函数里也没写过的才进 g_consts
+static void collect_consts(ASTNode* node) {
+    if (!node || node->type != AST_PROGRAM) return;
+    for (int i = 0; i < node->data.program.statement_count; i++) {
+        ASTNode* s = node->data.program.statements[i];
+        if (!s) continue;
+        if (s->type == AST_PROGRAM) {
+            collect_consts(s);
+            continue;
+        }
+        if (s->type != AST_CONST || !s->data.assign.left || s->data.assign.left->type != AST_IDENTIFIER) continue;
+        const char* name = s->data.assign.left->data.identifier.name;
+        s->data.assign.right = fold_expr(s->data.assign.right, &g_consts, 0);
+        ConstVal v;
+        if (!lit_val(s->data.assign.right, &v) || name_set_has(&g_top_dup, name) ||
+            name_set_has(&g_fn_assigned, name) || name_set_has(&g_addr, name)) continue;
+        env_put(&g_consts, name, v.kind, 1, &v);
+    }
+}
+
+void fold_constants(ASTNode* root) {
+    if (!root || root->type != AST_PROGRAM) return;
+    scan_tree(root, 0);
+    scan_top(root);
+    collect_consts(root);
+
+    FoldEnv env;
+    env_copy(&env, &g_consts);
+    g_in_fn = 0;
+    fold_block(root, &env);
+    env_free(&env);
+
+    env_free(&g_consts);
+    name_set_free(&g_addr);
+    name_set_free(&g_fn_assigned);
+    name_set_free(&g_top);
+    name_set_free(&g_top_dup);
+}
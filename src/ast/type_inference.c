@@ -5,8 +5,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
 extern const char* current_input_filename;
 static InferredType infer_index_type(TypeInferenceContext* ctx, ASTNode* node);
+static VariableInfo* lookup_variable(TypeInferenceContext* ctx, const char* var_name);
+static InferredType struct_field_type(StructTypeInfo* struct_type, const char* field_name);
 static InferredType get_nested_field_type(TypeInferenceContext* ctx, ASTNode* node) {
     if (!node) return TYPE_UNKNOWN;
     if (node->type == AST_INDEX && 
@@ -14,21 +17,9 @@ static InferredType get_nested_field_type(TypeInferenceContext* ctx, ASTNode* no
         node->data.index.index->type == AST_IDENTIFIER) {
         const char* obj_name = node->data.index.target->data.identifier.name;
         const char* field_name = node->data.index.index->data.identifier.name;
-        InferredType obj_type = get_variable_type(ctx, obj_name);
-        if (obj_type != TYPE_STRUCT) return TYPE_UNKNOWN;
-        for (int i = 0; i < ctx->count; i++) {
-            if (strcmp(ctx->variables[i].name, obj_name) == 0 && 
-                ctx->variables[i].type == TYPE_STRUCT && 
-                ctx->variables[i].struct_type) {
-                for (int j = 0; j < ctx->variables[i].struct_type->field_count; j++) {
-                    if (strcmp(ctx->variables[i].struct_type->fields[j].name, field_name) == 0) {
-                        return ctx->variables[i].struct_type->fields[j].type;
-                    }
-                }
-                break;
-            }
-        }
-        return TYPE_UNKNOWN;
+        VariableInfo* var = lookup_variable(ctx, obj_name);
+        if (!var || var->type != TYPE_STRUCT || !var->struct_type) return TYPE_UNKNOWN;
+        return struct_field_type(var->struct_type, field_name);
     }
     else if (node->type == AST_INDEX && 
              node->data.index.target->type == AST_INDEX && 
@@ -36,12 +27,11 @@ static InferredType get_nested_field_type(TypeInferenceContext* ctx, ASTNode* no
         InferredType nested_type = get_nested_field_type(ctx, node->data.index.target);
         if (nested_type != TYPE_STRUCT) return nested_type;
         const char* field_name = node->data.index.index->data.identifier.name;
-        for (int i = 0; i < ctx->count; i++) {
-            if (ctx->variables[i].type == TYPE_STRUCT && ctx->variables[i].struct_type) {
-                for (int j = 0; j < ctx->variables[i].struct_type->field_count; j++) {
-                    if (strcmp(ctx->variables[i].struct_type->fields[j].name, field_name) == 0) {
-                        return ctx->variables[i].struct_type->fields[j].type;
-                    }
+        for (int i = 0; i < ctx->struct_capacity; i++) {//不知道是哪个结构体，取第一个有这个字段的
+            if (!ctx->structs[i]) continue;
+            for (int j = 0; j < ctx->structs[i]->field_count; j++) {
+                if (strcmp(ctx->structs[i]->fields[j].name, field_name) == 0) {
+                    return ctx->structs[i]->fields[j].type;
                 }
             }
         }
@@ -53,27 +43,174 @@ static InferredType get_nested_field_type(TypeInferenceContext* ctx, ASTNode* no
 }
 
 
+static unsigned int name_slot_hash(const char* name) {
+    uintptr_t p = (uintptr_t)name;
+    p ^= p >> 17;
+    p *= (uintptr_t)0x9E3779B97F4A7C15ull;
+    return (unsigned int)(p >> 16);
+}
+
+static TypeScope* create_type_scope(TypeScope* parent) {
+    TypeScope* scope = malloc(sizeof(TypeScope));
+    scope->slots = NULL;
+    scope->capacity = 0;
+    scope->count = 0;
+    scope->parent = parent;
+    return scope;
+}
+
+static void free_type_scope(TypeScope* scope) {
+    free(scope->slots);
+    free(scope);
+}
+
+/* key 是 intern 过的指针，只比较指针；返回 key 所在的槽或第一个空槽 */
+static VariableInfo* scope_slot(TypeScope* scope, const char* key) {
+    int mask = scope->capacity - 1;
+    int i = (int)(name_slot_hash(key) & (unsigned int)mask);
+    while (scope->slots[i].name && scope->slots[i].name != key) {
+        i = (i + 1) & mask;
+    }
+    return &scope->slots[i];
+}
+
+static void grow_type_scope(TypeScope* scope) {
+    VariableInfo* old_slots = scope->slots;
+    int old_capacity = scope->capacity;
+    scope->capacity = old_capacity ? old_capacity * 2 : 8;
+    scope->slots = calloc(scope->capacity, sizeof(VariableInfo));
+    for (int i = 0; i < old_capacity; i++) {
+        if (old_slots[i].name) {
+            *scope_slot(scope, old_slots[i].name) = old_slots[i];
+        }
+    }
+    free(old_slots);
+}
+
+//在 scope 里找或新建 key；新建的变量类型未知
+static VariableInfo* scope_define(TypeScope* scope, const char* key) {
+    if ((scope->count + 1) * 4 > scope->capacity * 3) {
+        grow_type_scope(scope);
+    }
+    VariableInfo* var = scope_slot(scope, key);
+    if (!var->name) {
+        var->name = (char*)key;
+        var->type = TYPE_UNKNOWN;
+        var->element_type = TYPE_UNKNOWN;
+        var->pointer_target_type = TYPE_UNKNOWN;
+        var->struct_type = NULL;
+        var->array_length = -1;
+        scope->count++;
+    }
+    return var;
+}
+
+//从当前作用域往外找，返回的指针在同一作用域下一次新建变量之前有效
+static VariableInfo* lookup_variable(TypeInferenceContext* ctx, const char* var_name) {
+    if (!ctx || !var_name) return NULL;
+    const char* key = ast_intern(var_name);
+    for (TypeScope* scope = ctx->scope; scope; scope = scope->parent) {
+        if (scope->count == 0) continue;
+        VariableInfo* var = scope_slot(scope, key);
+        if (var->name) return var;
+    }
+    return NULL;
+}
+
+//赋值的目标：最近的同名变量，没有就在当前作用域新建
+static VariableInfo* assign_target(TypeInferenceContext* ctx, const char* var_name) {
+    VariableInfo* var = lookup_variable(ctx, var_name);
+    return var ? var : scope_define(ctx->scope, ast_intern(var_name));
+}
+
+static void set_variable_info(VariableInfo* var, InferredType type, InferredType element_type,
+                              InferredType pointer_target_type, StructTypeInfo* struct_type) {
+    var->type = type;
+    var->element_type = element_type;
+    var->pointer_target_type = pointer_target_type;
+    var->struct_type = struct_type;
+    var->array_length = -1;
+}
+
+static InferredType struct_field_type(StructTypeInfo* struct_type, const char* field_name) {
+    for (int i = 0; i < struct_type->field_count; i++) {
+        if (strcmp(struct_type->fields[i].name, field_name) == 0) {
+            return struct_type->fields[i].type;
+        }
+    }
+    return TYPE_UNKNOWN;
+}
+
+static StructTypeInfo** struct_slot(TypeInferenceContext* ctx, const char* key) {
+    int mask = ctx->struct_capacity - 1;
+    int i = (int)(name_slot_hash(key) & (unsigned int)mask);
+    while (ctx->structs[i] && ctx->structs[i]->name != key) {
+        i = (i + 1) & mask;
+    }
+    return &ctx->structs[i];
+}
+
 TypeInferenceContext* create_type_inference_context() {
     TypeInferenceContext* ctx = malloc(sizeof(TypeInferenceContext));
-    ctx->variables = NULL;
-    ctx->count = 0;
-    ctx->capacity = 0;
+    ctx->global = create_type_scope(NULL);
+    ctx->scope = ctx->global;
+    ctx->structs = NULL;
+    ctx->struct_capacity = 0;
+    ctx->struct_count = 0;
     return ctx;
 }
 
 void free_type_inference_context(TypeInferenceContext* ctx) {
     if (!ctx) return;
     
-    for (int i = 0; i < ctx->count; i++) {
-        free(ctx->variables[i].name);
-        if (ctx->variables[i].struct_type) {
-            free_struct_type(ctx->variables[i].struct_type);
+    while (ctx->scope) {
+        TypeScope* parent = ctx->scope->parent;
+        free_type_scope(ctx->scope);
+        ctx->scope = parent;
+    }
+    for (int i = 0; i < ctx->struct_capacity; i++) {
+        if (ctx->structs[i]) {
+            free_struct_type(ctx->structs[i]);
         }
     }
-    free(ctx->variables);
+    free(ctx->structs);
     free(ctx);
 }
 
+void push_type_scope(TypeInferenceContext* ctx) {
+    if (!ctx) return;
+    ctx->scope = create_type_scope(ctx->scope);
+}
+
+void pop_type_scope(TypeInferenceContext* ctx) {
+    if (!ctx || ctx->scope == ctx->global) return;
+    TypeScope* parent = ctx->scope->parent;
+    free_type_scope(ctx->scope);
+    ctx->scope = parent;
+}
+
+void declare_variable_type(TypeInferenceContext* ctx, const char* var_name, InferredType type) {
+    if (!ctx || !var_name) return;
+    set_variable_info(scope_define(ctx->scope, ast_intern(var_name)), type, TYPE_UNKNOWN, TYPE_UNKNOWN, NULL);
+}
+
+//块体单独一层作用域
+static void infer_block(TypeInferenceContext* ctx, ASTNode* body) {
+    if (!body) return;
+    push_type_scope(ctx);
+    infer_type(ctx, body);
+    pop_type_scope(ctx);
+}
+
+static const char* param_name(ASTNode* param) {
+    if (!param) return NULL;
+    if (param->type == AST_IDENTIFIER) return param->data.identifier.name;
+    if (param->type == AST_ASSIGN && param->data.assign.left && param->data.assign.left->type == AST_IDENTIFIER) {
+        return param->data.assign.left->data.identifier.name;
+    }
+    return NULL;
+}
+
 InferredType infer_type(TypeInferenceContext* ctx, ASTNode* node) {
     if (!node) return TYPE_UNKNOWN;
     
@@ -91,16 +228,10 @@ InferredType infer_type(TypeInferenceContext* ctx, ASTNode* node) {
             return TYPE_STRING;
             
         case AST_IDENTIFIER: {
-            InferredType type = get_variable_type(ctx, node->data.identifier.name);
-            if (type != TYPE_UNKNOWN) {
-                return type;
+            VariableInfo* var = lookup_variable(ctx, node->data.identifier.name);
+            if (var) {
+                return var->type;//参数和类型还没推出来的变量是 TYPE_UNKNOWN，但不是未定义
             } else {
-                for (int i = 0; i < ctx->count; i++) {
-                    if (strcmp(ctx->variables[i].name, node->data.identifier.name) == 0 && 
-                        ctx->variables[i].type == TYPE_STRUCT) {
-                        return TYPE_STRUCT;
-                    }
-                }
                 report_undefined_variable_with_location(
                     node->data.identifier.name,
                     current_input_filename ? current_input_filename : "unknown",
@@ -179,6 +310,11 @@ InferredType infer_type(TypeInferenceContext* ctx, ASTNode* node) {
             return infer_index_type(ctx, node);
         }
         case AST_CALL: {
+            if (node->data.call.func && node->data.call.func->type == AST_IDENTIFIER &&
+                (strcmp(node->data.call.func->data.identifier.name, "read_line") == 0 ||
+                 strcmp(node->data.call.func->data.identifier.name, "read_all") == 0)) {
+                return TYPE_STRING;
+            }
             if (node->data.call.func && node->data.call.func->type == AST_INDEX) {
                 ASTNode* target = node->data.call.func->data.index.target;
                 ASTNode* method = node->data.call.func->data.index.index;
@@ -188,13 +324,8 @@ InferredType infer_type(TypeInferenceContext* ctx, ASTNode* node) {
                     InferredType targ_type = infer_type(ctx, target);
                     if (targ_type == TYPE_LIST) {
                         if (target->type == AST_IDENTIFIER) {
-                            const char* name = target->data.identifier.name;
-                            for (int i = 0; i < ctx->count; i++) {
-                                if (strcmp(ctx->variables[i].name, name) == 0) {
-                                    elem_type = ctx->variables[i].element_type;
-                                    break;
-                                }
-                            }
+                            VariableInfo* var = lookup_variable(ctx, target->data.identifier.name);
+                            if (var) elem_type = var->element_type;
                         } else if (target->type == AST_EXPRESSION_LIST) {
                             if (target->data.expression_list.expression_count > 0) {
                                 elem_type = infer_type(ctx, target->data.expression_list.expressions[0]);
@@ -207,7 +338,8 @@ InferredType infer_type(TypeInferenceContext* ctx, ASTNode* node) {
                         return elem_type != TYPE_UNKNOWN ? elem_type : TYPE_STRING;// 确保pop/remove返回元素类型而不是列表类型
                     }
                     if (strcmp(mname, "add!") == 0 || strcmp(mname, "push!") == 0 || strcmp(mname, "replace!") == 0 || 
-                        strcmp(mname, "push") == 0 || strcmp(mname, "remove!") == 0 || strcmp(mname, "pop!") == 0) {
+                        strcmp(mname, "push") == 0 || strcmp(mname, "remove!") == 0 || strcmp(mname, "pop!") == 0 ||
+                        strcmp(mname, "reserve") == 0 || strcmp(mname, "shrink_to_fit") == 0) {
                         return TYPE_UNKNOWN;// 表示这是一个原地修改操作
                     }
                 }
@@ -242,40 +374,38 @@ InferredType infer_type(TypeInferenceContext* ctx, ASTNode* node) {
         case AST_ASSIGN: {
             InferredType right_type = infer_type(ctx, node->data.assign.right);
             if (node->data.assign.left->type == AST_IDENTIFIER) {
-                if (right_type == TYPE_LIST && node->data.assign.right && node->data.assign.right->type == AST_EXPRESSION_LIST) {
-                    InferredType elem_type = TYPE_UNKNOWN;
-                    if (node->data.assign.right->data.expression_list.expression_count > 0) {
-                        elem_type = infer_type(ctx, node->data.assign.right->data.expression_list.expressions[0]);
-                    }
-                    set_variable_list_type(ctx, node->data.assign.left->data.identifier.name, TYPE_LIST, elem_type);
-                    for (int i = 0; i < ctx->count; i++) {
-                        if (strcmp(ctx->variables[i].name, node->data.assign.left->data.identifier.name) == 0) {
-                            ctx->variables[i].array_length = node->data.assign.right->data.expression_list.expression_count;
-                            break;
-                        }
+                const char* name = node->data.assign.left->data.identifier.name;
+                ASTNode* right = node->data.assign.right;
+                InferredType elem_type = TYPE_UNKNOWN;
+                InferredType target = TYPE_UNKNOWN;
+                StructTypeInfo* struct_type = NULL;
+                //先把右边要用到的类型都推完，再取变量槽 (新建变量可能让槽搬家)
+                if (right_type == TYPE_LIST && right && right->type == AST_EXPRESSION_LIST) {
+                    if (right->data.expression_list.expression_count > 0) {
+                        elem_type = infer_type(ctx, right->data.expression_list.expressions[0]);
                     }
                 } else if (right_type == TYPE_POINTER) {
-                    if (node->data.assign.right && node->data.assign.right->type == AST_UNARYOP && node->data.assign.right->data.unaryop.op == OP_ADDRESS) {
-                        ASTNode* inner = node->data.assign.right->data.unaryop.expr;
-                        InferredType target = infer_type(ctx, inner);
-                        set_variable_pointer_type(ctx, node->data.assign.left->data.identifier.name, target);
-                    } else {
-                        set_variable_pointer_type(ctx, node->data.assign.left->data.identifier.name, TYPE_UNKNOWN);
+                    if (right && right->type == AST_UNARYOP && right->data.unaryop.op == OP_ADDRESS) {
+                        target = infer_type(ctx, right->data.unaryop.expr);
                     }
                 } else if (right_type == TYPE_STRUCT) {
-                    if (node->data.assign.right->type == AST_STRUCT_LITERAL) {
-                        if (node->data.assign.right->data.struct_literal.type_name && 
-                            node->data.assign.right->data.struct_literal.type_name->type == AST_IDENTIFIER) {
-                            
-                            const char* struct_name = node->data.assign.right->data.struct_literal.type_name->data.identifier.name;
-                            StructTypeInfo* struct_type = get_struct_type(ctx, struct_name);
-                            if (struct_type) {
-                                set_variable_struct_type(ctx, node->data.assign.left->data.identifier.name, struct_type);
-                            }
-                        }
+                    if (right->type == AST_STRUCT_LITERAL && right->data.struct_literal.type_name &&
+                        right->data.struct_literal.type_name->type == AST_IDENTIFIER) {
+                        struct_type = get_struct_type(ctx, right->data.struct_literal.type_name->data.identifier.name);
                     }
+                    if (!struct_type) return right_type;//以前的变量保持原样
+                }
+                VariableInfo* var = node->data.assign.is_declaration ? scope_define(ctx->scope, ast_intern(name))
+                                                                     : assign_target(ctx, name);
+                if (right_type == TYPE_LIST && right && right->type == AST_EXPRESSION_LIST) {
+                    set_variable_info(var, TYPE_LIST, elem_type, TYPE_UNKNOWN, NULL);
+                    var->array_length = right->data.expression_list.expression_count;
+                } else if (right_type == TYPE_POINTER) {
+                    set_variable_info(var, TYPE_POINTER, TYPE_UNKNOWN, target, NULL);
+                } else if (right_type == TYPE_STRUCT) {
+                    set_variable_info(var, TYPE_STRUCT, TYPE_UNKNOWN, TYPE_UNKNOWN, struct_type);
                 } else {
-                    set_variable_type(ctx, node->data.assign.left->data.identifier.name, right_type);
+                    set_variable_info(var, right_type, TYPE_UNKNOWN, TYPE_UNKNOWN, NULL);
                 }
             }
             return right_type;
@@ -283,10 +413,68 @@ InferredType infer_type(TypeInferenceContext* ctx, ASTNode* node) {
         case AST_CONST: {
             InferredType right_type = infer_type(ctx, node->data.assign.right);
             if (node->data.assign.left->type == AST_IDENTIFIER) {
-                set_variable_type(ctx, node->data.assign.left->data.identifier.name, right_type);
+                declare_variable_type(ctx, node->data.assign.left->data.identifier.name, right_type);
             }
             return right_type;
         }
+
+        case AST_PROGRAM:
+            for (int i = 0; i < node->data.program.statement_count; i++) {
+                infer_type(ctx, node->data.program.statements[i]);
+            }
+            return TYPE_UNKNOWN;
+
+        case AST_FUNCTION: {
+            if (node->data.function.name) {
+                assign_target(ctx, node->data.function.name);
+            }
+            push_type_scope(ctx);//每个函数一层：不同函数里的同名局部变量互不影响
+            ASTNode* params = node->data.function.params;
+            if (params && params->type == AST_EXPRESSION_LIST) {
+                for (int i = 0; i < params->data.expression_list.expression_count; i++) {
+                    const char* name = param_name(params->data.expression_list.expressions[i]);
+                    if (name) declare_variable_type(ctx, name, TYPE_UNKNOWN);
+                }
+            }
+            infer_type(ctx, node->data.function.body);
+            pop_type_scope(ctx);
+            return TYPE_UNKNOWN;
+        }
+
+        case AST_IF:
+            infer_type(ctx, node->data.if_stmt.condition);
+            infer_block(ctx, node->data.if_stmt.then_body);
+            infer_block(ctx, node->data.if_stmt.else_body);
+            return TYPE_UNKNOWN;
+
+        case AST_WHILE:
+            infer_type(ctx, node->data.while_stmt.condition);
+            infer_block(ctx, node->data.while_stmt.body);
+            return TYPE_UNKNOWN;
+
+        case AST_FOR: {
+            InferredType start_type = infer_type(ctx, node->data.for_stmt.start);
+            InferredType var_type = TYPE_INT;
+            if (node->data.for_stmt.end) {
+                infer_type(ctx, node->data.for_stmt.end);
+            } else if (start_type == TYPE_LIST) {//for (x in list)
+                var_type = TYPE_UNKNOWN;
+                if (node->data.for_stmt.start->type == AST_IDENTIFIER) {
+                    VariableInfo* list = lookup_variable(ctx, node->data.for_stmt.start->data.identifier.name);
+                    if (list) var_type = list->element_type;
+                }
+            }
+            push_type_scope(ctx);
+            if (node->data.for_stmt.var && node->data.for_stmt.var->type == AST_IDENTIFIER) {
+                declare_variable_type(ctx, node->data.for_stmt.var->data.identifier.name, var_type);
+            }
+            infer_type(ctx, node->data.for_stmt.body);
+            pop_type_scope(ctx);
+            return TYPE_UNKNOWN;
+        }
+
+        case AST_RETURN:
+            return infer_type(ctx, node->data.return_stmt.expr);
             
         default:
             return TYPE_UNKNOWN;
@@ -295,139 +483,37 @@ InferredType infer_type(TypeInferenceContext* ctx, ASTNode* node) {
 
 void set_variable_list_type(TypeInferenceContext* ctx, const char* var_name, InferredType list_type, InferredType element_type) {
     if (!ctx || !var_name) return;
-    for (int i = 0; i < ctx->count; i++) {
-        if (strcmp(ctx->variables[i].name, var_name) == 0) {
-            ctx->variables[i].type = list_type;
-            ctx->variables[i].element_type = element_type;
-            ctx->variables[i].array_length = -1;
-            return;
-        }
-    }
-    if (ctx->count >= ctx->capacity) {
-        ctx->capacity = ctx->capacity == 0 ? 10 : ctx->capacity * 2;
-        ctx->variables = realloc(ctx->variables, sizeof(VariableInfo) * ctx->capacity);
-    }
-    ctx->variables[ctx->count].name = malloc(strlen(var_name) + 1);
-    strcpy(ctx->variables[ctx->count].name, var_name);
-    ctx->variables[ctx->count].type = list_type;
-    ctx->variables[ctx->count].element_type = element_type;
-    ctx->variables[ctx->count].pointer_target_type = TYPE_UNKNOWN;
-    ctx->variables[ctx->count].struct_type = NULL;
-    ctx->variables[ctx->count].array_length = -1;
-    ctx->count++;
+    set_variable_info(assign_target(ctx, var_name), list_type, element_type, TYPE_UNKNOWN, NULL);
 }
 
 InferredType get_variable_type(TypeInferenceContext* ctx, const char* var_name) {
-    if (!ctx || !var_name) return TYPE_UNKNOWN;
-    
-    for (int i = 0; i < ctx->count; i++) {
-        if (strcmp(ctx->variables[i].name, var_name) == 0) {
-            return ctx->variables[i].type;
-        }
-    }
-    
-    return TYPE_UNKNOWN;
+    VariableInfo* var = lookup_variable(ctx, var_name);
+    return var ? var->type : TYPE_UNKNOWN;
 }
 
 void set_variable_type(TypeInferenceContext* ctx, const char* var_name, InferredType type) {
     if (!ctx || !var_name) return;
-    for (int i = 0; i < ctx->count; i++) {
-        if (strcmp(ctx->variables[i].name, var_name) == 0) {
-            ctx->variables[i].type = type;
-            ctx->variables[i].element_type = TYPE_UNKNOWN;
-            ctx->variables[i].pointer_target_type = TYPE_UNKNOWN;//重置指针类型
-            ctx->variables[i].struct_type = NULL;
-            ctx->variables[i].array_length = -1;
-            return;
-        }
-    }
-    if (ctx->count >= ctx->capacity) {
-        ctx->capacity = ctx->capacity == 0 ? 10 : ctx->capacity * 2;
-        ctx->variables = realloc(ctx->variables, sizeof(VariableInfo) * ctx->capacity);
-    }
-    
-    ctx->variables[ctx->count].name = malloc(strlen(var_name) + 1);
-    strcpy(ctx->variables[ctx->count].name, var_name);
-    ctx->variables[ctx->count].type = type;
-    ctx->variables[ctx->count].element_type = TYPE_UNKNOWN;
-    ctx->variables[ctx->count].pointer_target_type = TYPE_UNKNOWN;
-    ctx->variables[ctx->count].struct_type = NULL;
-    ctx->variables[ctx->count].array_length = -1;
-    ctx->count++;
+    set_variable_info(assign_target(ctx, var_name), type, TYPE_UNKNOWN, TYPE_UNKNOWN, NULL);
 }
 
 void set_variable_pointer_type(TypeInferenceContext* ctx, const char* var_name, InferredType target_type) {
     if (!ctx || !var_name) return;
-    for (int i = 0; i < ctx->count; i++) {
-        if (strcmp(ctx->variables[i].name, var_name) == 0) {
-            ctx->variables[i].type = TYPE_POINTER;
-            ctx->variables[i].pointer_target_type = target_type;
-            ctx->variables[i].element_type = TYPE_UNKNOWN;
-            ctx->variables[i].struct_type = NULL;
-            ctx->variables[i].array_length = -1;
-            return;
-        }
-    }
-    if (ctx->count >= ctx->capacity) {
-        ctx->capacity = ctx->capacity == 0 ? 10 : ctx->capacity * 2;
-        ctx->variables = realloc(ctx->variables, sizeof(VariableInfo) * ctx->capacity);
-    }
-    
-    ctx->variables[ctx->count].name = malloc(strlen(var_name) + 1);
-    strcpy(ctx->variables[ctx->count].name, var_name);
-    ctx->variables[ctx->count].type = TYPE_POINTER;
-    ctx->variables[ctx->count].element_type = TYPE_UNKNOWN;
-    ctx->variables[ctx->count].pointer_target_type = target_type;
-    ctx->variables[ctx->count].struct_type = NULL;
-    ctx->variables[ctx->count].array_length = -1;
-    ctx->count++;
+    set_variable_info(assign_target(ctx, var_name), TYPE_POINTER, TYPE_UNKNOWN, target_type, NULL);
 }
 
 InferredType get_variable_pointer_target_type(TypeInferenceContext* ctx, const char* var_name) {
-    if (!ctx || !var_name) return TYPE_UNKNOWN;
-    
-    for (int i = 0; i < ctx->count; i++) {
-        if (strcmp(ctx->variables[i].name, var_name) == 0) {
-            return ctx->variables[i].pointer_target_type;
-        }
-    }
-    
-    return TYPE_UNKNOWN;
+    VariableInfo* var = lookup_variable(ctx, var_name);
+    return var ? var->pointer_target_type : TYPE_UNKNOWN;
 }
 void set_variable_struct_type(TypeInferenceContext* ctx, const char* var_name, StructTypeInfo* struct_type) {
     if (!ctx || !var_name || !struct_type) return;
-    
-    for (int i = 0; i < ctx->count; i++) {
-        if (strcmp(ctx->variables[i].name, var_name) == 0) {
-            ctx->variables[i].type = TYPE_STRUCT;
-            ctx->variables[i].struct_type = struct_type;
-            ctx->variables[i].element_type = TYPE_UNKNOWN;
-            ctx->variables[i].pointer_target_type = TYPE_UNKNOWN;
-            ctx->variables[i].array_length = -1;
-            return;
-        }
-    }
-    
-    if (ctx->count >= ctx->capacity) {
-        ctx->capacity = ctx->capacity == 0 ? 10 : ctx->capacity * 2;
-        ctx->variables = realloc(ctx->variables, sizeof(VariableInfo) * ctx->capacity);
-    }
-    
-    ctx->variables[ctx->count].name = malloc(strlen(var_name) + 1);
-    strcpy(ctx->variables[ctx->count].name, var_name);
-    ctx->variables[ctx->count].type = TYPE_STRUCT;
-    ctx->variables[ctx->count].struct_type = struct_type;
-    ctx->variables[ctx->count].element_type = TYPE_UNKNOWN;
-    ctx->variables[ctx->count].pointer_target_type = TYPE_UNKNOWN;
-    ctx->variables[ctx->count].array_length = -1;
-    ctx->count++;
+    set_variable_info(assign_target(ctx, var_name), TYPE_STRUCT, TYPE_UNKNOWN, TYPE_UNKNOWN, struct_type);
 }
 StructTypeInfo* create_struct_type(const char* name) {
     if (!name) return NULL;
     
     StructTypeInfo* struct_type = malloc(sizeof(StructTypeInfo));
-    struct_type->name = malloc(strlen(name) + 1);
-    strcpy(struct_type->name, name);
+    struct_type->name = ast_intern(name);
     struct_type->fields = NULL;
     struct_type->field_count = 0;
     struct_type->total_size = 0;
@@ -437,8 +523,6 @@ StructTypeInfo* create_struct_type(const char* name) {
 void free_struct_type(StructTypeInfo* struct_type) {
     if (!struct_type) return;
     
-    free(struct_type->name);
-    
     for (int i = 0; i < struct_type->field_count; i++) {
         free(struct_type->fields[i].name);
     }
@@ -446,30 +530,14 @@ void free_struct_type(StructTypeInfo* struct_type) {
     free(struct_type);
 }
 StructTypeInfo* get_struct_type(TypeInferenceContext* ctx, const char* struct_name) {
-    if (!ctx || !struct_name) return NULL;
-    
-    for (int i = 0; i < ctx->count; i++) {
-        if (ctx->variables[i].type == TYPE_STRUCT && 
-            ctx->variables[i].struct_type && 
-            strcmp(ctx->variables[i].struct_type->name, struct_name) == 0) {
-            return ctx->variables[i].struct_type;
-        }
-    }
-    
-    return NULL;
+    if (!ctx || !struct_name || ctx->struct_count == 0) return NULL;
+    return *struct_slot(ctx, ast_intern(struct_name));
 }
 
 InferredType get_struct_field_type(TypeInferenceContext* ctx, const char* struct_name, const char* field_name) {
     StructTypeInfo* struct_type = get_struct_type(ctx, struct_name);
-    if (!struct_type) return TYPE_UNKNOWN;
-    
-    for (int i = 0; i < struct_type->field_count; i++) {
-        if (strcmp(struct_type->fields[i].name, field_name) == 0) {
-            return struct_type->fields[i].type;
-        }
-    }
-    
-    return TYPE_UNKNOWN;
+    if (!struct_type || !field_name) return TYPE_UNKNOWN;
+    return struct_field_type(struct_type, field_name);
 }
 
 const char* type_to_cpp_string(InferredType type) {
@@ -499,21 +567,11 @@ static InferredType infer_index_type(TypeInferenceContext* ctx, ASTNode* node) {
     if (target->type == AST_IDENTIFIER && node->data.index.index->type == AST_IDENTIFIER) {
         const char* obj_name = target->data.identifier.name;
         const char* field_name = node->data.index.index->data.identifier.name;
-        InferredType obj_type = get_variable_type(ctx, obj_name);
-        if (obj_type == TYPE_STRUCT) {
-            for (int i = 0; i < ctx->count; i++) {
-                if (strcmp(ctx->variables[i].name, obj_name) == 0 && 
-                    ctx->variables[i].type == TYPE_STRUCT && 
-                    ctx->variables[i].struct_type) {
-                    for (int j = 0; j < ctx->variables[i].struct_type->field_count; j++) {
-                        if (strcmp(ctx->variables[i].struct_type->fields[j].name, field_name) == 0) {
-                            if (ctx->variables[i].struct_type->fields[j].type == TYPE_STRUCT) {
-                                return TYPE_STRUCT;
-                            }
-                            return ctx->variables[i].struct_type->fields[j].type;
-                        }
-                    }
-                    break;
+        VariableInfo* var = lookup_variable(ctx, obj_name);
+        if (var && var->type == TYPE_STRUCT && var->struct_type) {
+            for (int j = 0; j < var->struct_type->field_count; j++) {
+                if (strcmp(var->struct_type->fields[j].name, field_name) == 0) {
+                    return var->struct_type->fields[j].type;
                 }
             }
         }
@@ -527,12 +585,9 @@ static InferredType infer_index_type(TypeInferenceContext* ctx, ASTNode* node) {
         return infer_type(ctx, target->data.expression_list.expressions[0]);
     }
     if (target->type == AST_IDENTIFIER) {
-        const char* name = target->data.identifier.name;
-        for (int i = 0; i < ctx->count; i++) {
-            if (strcmp(ctx->variables[i].name, name) == 0) {
-                if (ctx->variables[i].type == TYPE_LIST) return ctx->variables[i].element_type;
-                return TYPE_UNKNOWN;
-            }
+        VariableInfo* var = lookup_variable(ctx, target->data.identifier.name);
+        if (var) {
+            return var->type == TYPE_LIST ? var->element_type : TYPE_UNKNOWN;
         }
     }
     InferredType t = infer_type(ctx, target);
@@ -576,12 +631,35 @@ InferredType infer_type_from_value(const char* value) {
 }
 
 int has_variable(TypeInferenceContext* ctx, const char* var_name) {
-    if (!ctx || !var_name) return 0;
-    for (int i = 0; i < ctx->count; i++) {
-        if (strcmp(ctx->variables[i].name, var_name) == 0) return 1;
+    return lookup_variable(ctx, var_name) != NULL;
+}
+//字段声明里的类型结点 (i32、[T]、结构体名 ...)；类型名不是变量，不走 infer_type，免得当成未定义变量报错
+static InferredType declared_type(TypeInferenceContext* ctx, ASTNode* type_node, StructTypeInfo** struct_type) {
+    if (!type_node) return TYPE_UNKNOWN;
+    switch (type_node->type) {
+        case AST_TYPE_INT32:
+        case AST_TYPE_INT64:
+            return TYPE_INT;
+        case AST_TYPE_INT8:
+            return TYPE_INT8;
+        case AST_TYPE_FLOAT32:
+        case AST_TYPE_FLOAT64:
+            return TYPE_FLOAT;
+        case AST_TYPE_STRING:
+            return TYPE_STRING;
+        case AST_TYPE_POINTER:
+            return TYPE_POINTER;
+        case AST_TYPE_LIST:
+        case AST_TYPE_FIXED_SIZE_LIST:
+            return TYPE_LIST;
+        case AST_IDENTIFIER:
+            *struct_type = get_struct_type(ctx, type_node->data.identifier.name);
+            return *struct_type ? TYPE_STRUCT : TYPE_UNKNOWN;
+        default:
+            return TYPE_UNKNOWN;
     }
-    return 0;
 }
+
 void process_struct_definition(TypeInferenceContext* ctx, ASTNode* struct_def_node) {
     if (!struct_def_node || struct_def_node->type != AST_STRUCT_DEF) return;
     
@@ -594,42 +672,47 @@ void process_struct_definition(TypeInferenceContext* ctx, ASTNode* struct_def_no
             if (field && field->type == AST_ASSIGN && 
                 field->data.assign.left && field->data.assign.left->type == AST_IDENTIFIER) {
                 const char* field_name = field->data.assign.left->data.identifier.name;
-                InferredType field_type = TYPE_UNKNOWN;
-                if (field->data.assign.right) {
-                    field_type = infer_type(ctx, field->data.assign.right);
-                }
+                StructTypeInfo* field_struct = NULL;
+                InferredType field_type = declared_type(ctx, field->data.assign.right, &field_struct);
                 struct_type->fields = realloc(struct_type->fields, 
                     sizeof(StructField) * (struct_type->field_count + 1));
                 struct_type->fields[struct_type->field_count].name = malloc(strlen(field_name) + 1);
                 strcpy(struct_type->fields[struct_type->field_count].name, field_name);
                 struct_type->fields[struct_type->field_count].type = field_type;
                 struct_type->fields[struct_type->field_count].offset = -1; // 表示尚未计算
-                struct_type->fields[struct_type->field_count].struct_type = NULL;
+                struct_type->fields[struct_type->field_count].struct_type = field_struct;
                 
                 struct_type->field_count++;
             }
         }
     }
-    for (int i = 0; i < ctx->count; i++) {
-        if (strcmp(ctx->variables[i].name, struct_name) == 0) {
-            if (ctx->variables[i].struct_type) {
-                free_struct_type(ctx->variables[i].struct_type);
-            }
-            ctx->variables[i].struct_type = struct_type;
-            ctx->variables[i].type = TYPE_STRUCT; // 标记这是一个结构体类型定义
-            return;
+    if ((ctx->struct_count + 1) * 4 > ctx->struct_capacity * 3) {
+        StructTypeInfo** old_structs = ctx->structs;
+        int old_capacity = ctx->struct_capacity;
+        ctx->struct_capacity = old_capacity ? old_capacity * 2 : 8;
+        ctx->structs = calloc(ctx->struct_capacity, sizeof(StructTypeInfo*));
+        for (int i = 0; i < old_capacity; i++) {
+            if (old_structs[i]) *struct_slot(ctx, old_structs[i]->name) = old_structs[i];
         }
+        free(old_structs);
     }
-    if (ctx->count >= ctx->capacity) {
-        ctx->capacity = ctx->capacity == 0 ? 10 : ctx->capacity * 2;
-        ctx->variables = realloc(ctx->variables, sizeof(VariableInfo) * ctx->capacity);
+    StructTypeInfo** slot = struct_slot(ctx, struct_type->name);
+    if (*slot) {//重新定义：换掉字段，已经指向它的变量跟着更新
+        StructTypeInfo* old = *slot;
+        for (int i = 0; i < old->field_count; i++) {
+            free(old->fields[i].name);
+        }
+        free(old->fields);
+        old->fields = struct_type->fields;
+        old->field_count = struct_type->field_count;
+        old->total_size = struct_type->total_size;
+        free(struct_type);
+        struct_type = old;
+    } else {
+        *slot = struct_type;
+        ctx->struct_count++;
     }
-    
-    ctx->variables[ctx->count].name = malloc(strlen(struct_name) + 1);
-    strcpy(ctx->variables[ctx->count].name, struct_name);
-    ctx->variables[ctx->count].type = TYPE_STRUCT;
-    ctx->variables[ctx->count].struct_type = struct_type;
-    ctx->variables[ctx->count].element_type = TYPE_UNKNOWN;
-    ctx->variables[ctx->count].pointer_target_type = TYPE_UNKNOWN;
-    ctx->count++;
+    //结构体名本身也登记成全局的 TYPE_STRUCT，get_variable_type / has_variable 认得出
+    VariableInfo* var = scope_define(ctx->global, struct_type->name);
+    set_variable_info(var, TYPE_STRUCT, TYPE_UNKNOWN, TYPE_UNKNOWN, struct_type);
 }
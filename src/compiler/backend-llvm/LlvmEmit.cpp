@@ -2,7 +2,9 @@
 vix0.0.1 released!
 */
 #include "../../../include/llvm_emit.h"
+extern "C" {//ast.c 是 C 编译的
 #include "../../../include/ast.h"
+}
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/LLVMContext.h>
@@ -17,14 +19,38 @@ vix0.0.1 released!
 #include <llvm/MC/TargetRegistry.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/Target/TargetOptions.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Analysis/LoopAnalysisManager.h>
+#include <llvm/Analysis/CGSCCPassManager.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/IR/DiagnosticInfo.h>
+#include <llvm/IR/DiagnosticHandler.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/IR/GlobalIFunc.h>
 #include <stdio.h>
 #include <map>
+#include <unordered_map>
+#include <set>
 #include <string>
+#include <algorithm>
 #include <iostream>
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <functional>
+#include <optional>
+#include <thread>
+#include <vector>
 
 using namespace llvm;
 
@@ -36,6 +62,17 @@ static bool isBuiltinUnionCtorName(const std::string& name) {
 }
 
 static std::string g_vix_target_triple;
+static int g_vix_opt_level = 0;
+static int g_vix_jobs = 1;
+static int g_vix_print_mode = 0;
+static int g_vix_bounds_check = 0;
+static int g_vix_vec_report = 0;
+static FILE* g_vix_ir_out = nullptr;//-kt：出 .o 的同一个 module 顺带写 .ll，不再单独生成一遍
+static double g_vix_phase_ms[3] = {0, 0, 0};//--time-phases：emit / opt / codegen，所有模块累计
+
+static double vixNowMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
 struct SymbolAttr {
     bool exported = false;
@@ -137,7 +174,8 @@ enum class ValueType {
     BOOL,
     POINTER,
     STRING,
-    ARRAY
+    ARRAY,
+    VECTOR//v4f32 等 SIMD 向量
 };
 
 // ==================== INIT!!! ====================
@@ -192,6 +230,7 @@ private:
     std::map<std::string, std::pair<Type*, int>> arrayTypes;
     std::map<std::string, int> variableArraySizes;
     std::map<std::string, bool> stringVariables;//标记字符串变量
+    std::map<std::string, bool> stringBuilders;//StringBuilder 变量，值是指向 {buf, len, cap} 的指针
     std::map<std::string, Type*> genericTypeBindings;
     
 public:
@@ -208,6 +247,12 @@ public:
     bool isStringVariable(const std::string& name) {
         return stringVariables.find(name) != stringVariables.end();
     }
+    void registerStringBuilder(const std::string& name) {
+        stringBuilders[name] = true;
+    }
+    bool isStringBuilder(const std::string& name) {
+        return stringBuilders.find(name) != stringBuilders.end();
+    }
     
     void registerArrayType(const std::string& name, Type* elementType, int elementCount) {
         arrayTypes[name] = {elementType, elementCount};
@@ -342,6 +387,7 @@ public:
         if (type->isFloatTy())     return ValueType::FLOAT32;
         if (type->isDoubleTy())    return ValueType::FLOAT64;
         if (type->isArrayTy())     return ValueType::ARRAY;
+        if (type->isVectorTy())    return ValueType::VECTOR;
         
         if (type->isPointerTy()) {
             if (type == getLLVMType(ValueType::STRING)) {
@@ -357,6 +403,21 @@ public:
         return ValueType::VOID;
     }
     
+    FixedVectorType* getVectorType(const std::string& name) {
+        NodeType elem;
+        int lanes = 0;
+        if (!vector_type_info(name.c_str(), &elem, &lanes)) return nullptr;
+        Type* elemType = Type::getInt32Ty(context);
+        switch (elem) {
+            case AST_TYPE_INT8:    elemType = Type::getInt8Ty(context); break;
+            case AST_TYPE_INT64:   elemType = Type::getInt64Ty(context); break;
+            case AST_TYPE_FLOAT32: elemType = Type::getFloatTy(context); break;
+            case AST_TYPE_FLOAT64: elemType = Type::getDoubleTy(context); break;
+            default: break;
+        }
+        return FixedVectorType::get(elemType, lanes);
+    }
+
     Type* getTypeFromTypeNode(ASTNode* node) {
         if (!node) return Type::getInt32Ty(context);
         
@@ -391,12 +452,14 @@ public:
             }
             if (typeName == "ptr") return PointerType::getUnqual(Type::getInt8Ty(context));
             if (typeName == "str") return PointerType::getUnqual(Type::getInt8Ty(context));
+            if (typeName == "StringBuilder") return PointerType::getUnqual(Type::getInt8Ty(context));
             if (typeName == "i8" || typeName == "u8" || typeName == "char") return Type::getInt8Ty(context);
             if (typeName == "i32") return Type::getInt32Ty(context);
             if (typeName == "i64") return Type::getInt64Ty(context);
             if (typeName == "f32") return Type::getFloatTy(context);
             if (typeName == "f64") return Type::getDoubleTy(context);
             if (typeName == "void") return Type::getVoidTy(context);
+            if (FixedVectorType* vt = getVectorType(typeName)) return vt;
             StructType* st = getStructType(typeName);
             if (st) return st;
             
@@ -433,6 +496,7 @@ public:
                 if (typeName == "f32") return ValueType::FLOAT32;
                 if (typeName == "f64") return ValueType::FLOAT64;
                 if (typeName == "void") return ValueType::VOID;
+                if (getVectorType(typeName)) return ValueType::VECTOR;
                 return ValueType::INT32;
             }
             default:               return ValueType::INT32;
@@ -560,6 +624,11 @@ private:
     Function* strlenFunction;
     bool isGlobalScope;
     bool mainFunctionCreated;
+    bool libraryModule;//分离编译的 import 模块：不生成默认 main，非 pub 符号 internal
+    int printMode;//0 缓冲 1 每次 print 后刷新 2 直接 printf
+    bool boundsCheck;
+    std::vector<std::pair<std::string, std::string>> boundedIndexVars;//(循环变量, 数组)，数组为空表示没证明
+    std::set<std::string> externCFunctions;//extern "C" 声明，调用前先刷 print 缓冲
     SourceAttrInfo sourceAttrs;
     std::map<std::string, std::vector<int>> functionArrayParamPositions;
     std::map<std::string, StructType*> functionSRetResultTypesByName;
@@ -571,6 +640,8 @@ private:
     std::map<const Value*, Type*> pointerElementHints;
     std::vector<BasicBlock*> loopBreakTargets;
     std::vector<BasicBlock*> loopContinueTargets;
+    std::map<ASTNode*, Value*> loopAppendBuilders;//循环里改写成追加的 s = s + ... 赋值 -> 临时 StringBuilder
+    std::set<std::string> loopAppendNames;
 
     void reportCodegenSemanticError(ASTNode* node, const std::string& message) {
         const char* filename = (node && node->source_file) ? node->source_file :
@@ -719,7 +790,10 @@ private:
         activeGenericTypeBindings = oldBindings;
         typeHelper.setGenericTypeBindings(activeGenericTypeBindings);
         if (!res.value) return nullptr;
-        return module->getFunction(mangledName);
+        Function* inst = module->getFunction(mangledName);
+        //每个用到它的模块都各自实例化一份，内容相同：linkonce_odr 让链接器只留一份，不报重复定义
+        if (inst && inst->hasExternalLinkage()) inst->setLinkage(GlobalValue::LinkOnceODRLinkage);
+        return inst;
     }
     
     bool ensureValidInsertPoint() {
@@ -755,16 +829,19 @@ private:
         return false;
     }
     
+    //同样内容的字符串 (字面量和格式串) 整个模块只有一个全局常量，按 ast_intern 的指针查，和 vic-ir 的常量池共用一份驻留表
+    std::unordered_map<const char*, Constant*> globalStrings;
+
     Value* safeCreateGlobalStringPtr(const std::string& str, const std::string& name) {
         if (!ensureValidInsertPoint()) {
             return nullptr;
         }
         
-        if (str.empty()) {
-            return builder.CreateGlobalStringPtr("", name.c_str());
+        Constant*& slot = globalStrings[ast_intern(str.c_str())];
+        if (!slot) {
+            slot = builder.CreateGlobalStringPtr(str, name.c_str());
         }
-        
-        return builder.CreateGlobalStringPtr(str, name.c_str());
+        return slot;
     }
     
     Type* getActualType(AllocaInst* alloc) {
@@ -878,6 +955,16 @@ private:
         return false;
     }
 
+    // 长度、容量、下标都是 i64（usize），超过 2^31 个元素/字节的数组不会回绕
+    Type* getSizeType() {
+        return Type::getInt64Ty(context);
+    }
+
+    Value* castToSize(Value* v, const char* name) {//下标按有符号扩展，负数越界检查按无符号比较照样能抓到
+        if (v->getType()->isIntegerTy(64)) return v;
+        return builder.CreateIntCast(v, getSizeType(), !v->getType()->isIntegerTy(1), name);
+    }
+
     Value* getRuntimeArrayLengthValue(const std::string& varName) {
         std::string lenVarName = varName + "__len";
         AllocaInst* lenAlloc = scopeManager.findVariable(lenVarName);
@@ -888,8 +975,8 @@ private:
         if (!lenType || !lenType->isIntegerTy()) return nullptr;
 
         Value* lenVal = builder.CreateLoad(lenType, lenAlloc, lenVarName + "_val");
-        if (!lenVal->getType()->isIntegerTy(32)) {
-            lenVal = builder.CreateIntCast(lenVal, Type::getInt32Ty(context), false, "arr_len_cast");
+        if (!lenVal->getType()->isIntegerTy(64)) {
+            lenVal = builder.CreateIntCast(lenVal, getSizeType(), false, "arr_len_cast");
         }
         return lenVal;
     }
@@ -908,28 +995,28 @@ private:
                 Type* allocatedType = getActualType(alloc);
                 if (allocatedType && allocatedType->isArrayTy()) {
                     uint64_t numElements = cast<ArrayType>(allocatedType)->getNumElements();
-                    return ConstantInt::get(Type::getInt32Ty(context), numElements);
+                    return ConstantInt::get(getSizeType(), numElements);
                 }
             }
 
             if (auto* arrayInfo = typeHelper.getArrayTypeInfo(varName)) {
                 if (arrayInfo->second >= 0) {
-                    return ConstantInt::get(Type::getInt32Ty(context), arrayInfo->second);
+                    return ConstantInt::get(getSizeType(), arrayInfo->second);
                 }
             }
 
             int knownSize = typeHelper.getVariableArraySize(varName);
             if (knownSize >= 0) {
-                return ConstantInt::get(Type::getInt32Ty(context), knownSize);
+                return ConstantInt::get(getSizeType(), knownSize);
             }
         }
 
         if (argNode && argNode->type == AST_EXPRESSION_LIST) {
             int count = argNode->data.expression_list.expression_count;
-            return ConstantInt::get(Type::getInt32Ty(context), count);
+            return ConstantInt::get(getSizeType(), count);
         }
 
-        return ConstantInt::get(Type::getInt32Ty(context), 0);
+        return ConstantInt::get(getSizeType(), 0);
     }
 
     AllocaInst* findRuntimeArrayLengthSlot(const std::string& varName) {
@@ -939,7 +1026,7 @@ private:
         return lenAlloc;
     }
 
-    AllocaInst* ensureRuntimeArrayLengthSlot(const std::string& varName, int initialLen) {
+    AllocaInst* ensureRuntimeArrayLengthSlot(const std::string& varName, int64_t initialLen) {
         AllocaInst* existing = findRuntimeArrayLengthSlot(varName);
         if (existing) return existing;
 
@@ -958,8 +1045,8 @@ private:
 
         std::string lenVarName = varName + "__len";
         IRBuilder<> tempBuilder(entryBB, entryBB->begin());
-        AllocaInst* lenAlloc = tempBuilder.CreateAlloca(Type::getInt32Ty(context), nullptr, lenVarName);
-        tempBuilder.CreateStore(ConstantInt::get(Type::getInt32Ty(context), initialLen), lenAlloc);
+        AllocaInst* lenAlloc = tempBuilder.CreateAlloca(getSizeType(), nullptr, lenVarName);
+        tempBuilder.CreateStore(ConstantInt::get(getSizeType(), initialLen), lenAlloc);
 
         if (savedBB) {
             builder.SetInsertPoint(savedBB);
@@ -969,6 +1056,188 @@ private:
         return lenAlloc;
     }
 
+    AllocaInst* findRuntimeArrayCapacitySlot(const std::string& varName) {
+        std::string capVarName = varName + "__cap";
+        AllocaInst* capAlloc = scopeManager.findVariable(capVarName);
+        if (!capAlloc) capAlloc = findVariableInMain(capVarName);
+        return capAlloc;
+    }
+
+    // __cap 只会小于等于真实容量：不知道时为 0，下次 push 会重新 realloc
+    AllocaInst* ensureRuntimeArrayCapacitySlot(const std::string& varName, int64_t initialCap) {
+        AllocaInst* existing = findRuntimeArrayCapacitySlot(varName);
+        if (existing) return existing;
+
+        Function* func = getCurrentFunction();
+        if (!func) {
+            func = module->getFunction("main");
+            if (!func) {
+                createDefaultMain();
+                func = module->getFunction("main");
+            }
+        }
+        if (!func) return nullptr;
+
+        BasicBlock* entryBB = &func->getEntryBlock();
+        BasicBlock* savedBB = builder.GetInsertBlock();
+
+        std::string capVarName = varName + "__cap";
+        IRBuilder<> tempBuilder(entryBB, entryBB->begin());
+        AllocaInst* capAlloc = tempBuilder.CreateAlloca(getSizeType(), nullptr, capVarName);
+        tempBuilder.CreateStore(ConstantInt::get(getSizeType(), initialCap), capAlloc);
+
+        if (savedBB) {
+            builder.SetInsertPoint(savedBB);
+        }
+
+        scopeManager.defineVariable(capVarName, capAlloc);
+        return capAlloc;
+    }
+
+    /*
+    列表变量每次 (重新) 绑定都在绑定处写 __len/__cap：长度取字面量个数或来源列表的 __len，不知道就是 0；
+    容量一律 0，下一次 push 先 realloc。槽建在入口块只初始化一次，循环里 let a = [0] 不能靠它。
+    */
+    void resetListSlotsOnBind(const std::string& name, ASTNode* rhs, const VisitResult& rightVal) {
+        if (typeHelper.isStringVariable(name) || typeHelper.isStringBuilder(name)) return;
+        Value* len = nullptr;
+        if (rhs->type == AST_EXPRESSION_LIST) {
+            len = ConstantInt::get(getSizeType(), rhs->data.expression_list.expression_count);
+        } else if (rhs->type == AST_IDENTIFIER && rhs->data.identifier.name) {
+            len = getRuntimeArrayLengthValue(rhs->data.identifier.name);
+            int known = len ? -1 : typeHelper.getVariableArraySize(rhs->data.identifier.name);
+            if (known >= 0) len = ConstantInt::get(getSizeType(), known);
+        }
+        bool isList = rhs->type == AST_EXPRESSION_LIST || rightVal.type == ValueType::ARRAY ||
+                      typeHelper.getArrayTypeInfo(name) != nullptr;
+        AllocaInst* lenSlot = findRuntimeArrayLengthSlot(name);
+        AllocaInst* capSlot = findRuntimeArrayCapacitySlot(name);
+        if (!isList && !lenSlot && !capSlot) return;
+
+        if (len && !lenSlot) lenSlot = ensureRuntimeArrayLengthSlot(name, 0);
+        if (lenSlot) {//长度未知的指针不建 __len，否则 --bounds-check 会把它当成空列表
+            builder.CreateStore(len ? len : ConstantInt::get(getSizeType(), 0), lenSlot);
+        }
+        if (!capSlot) capSlot = ensureRuntimeArrayCapacitySlot(name, 0);
+        if (capSlot) builder.CreateStore(ConstantInt::get(getSizeType(), 0), capSlot);
+    }
+
+    /*
+    字符串变量的隐藏长度槽 <name>__slen，值仍是 char*，传给 extern "C" 不用转换
+    -1 表示未知：.length 第一次用时 strlen 一次并缓存；下标写入、作为参数传给函数后重新置 -1
+    */
+    AllocaInst* findStringLengthSlot(const std::string& varName) {
+        std::string slenVarName = varName + "__slen";
+        AllocaInst* slenAlloc = scopeManager.findVariable(slenVarName);
+        if (!slenAlloc) slenAlloc = findVariableInMain(slenVarName);
+        if (slenAlloc && slenAlloc->getFunction() != getCurrentFunction()) return nullptr;
+        return slenAlloc;
+    }
+
+    AllocaInst* ensureStringLengthSlot(const std::string& varName) {
+        AllocaInst* existing = findStringLengthSlot(varName);
+        if (existing) return existing;
+
+        Function* func = getCurrentFunction();
+        if (!func) return nullptr;
+
+        BasicBlock* entryBB = &func->getEntryBlock();
+        BasicBlock* savedBB = builder.GetInsertBlock();
+
+        std::string slenVarName = varName + "__slen";
+        IRBuilder<> tempBuilder(entryBB, entryBB->begin());
+        AllocaInst* slenAlloc = tempBuilder.CreateAlloca(getSizeType(), nullptr, slenVarName);
+        tempBuilder.CreateStore(ConstantInt::get(getSizeType(), -1, true), slenAlloc);
+
+        if (savedBB) {
+            builder.SetInsertPoint(savedBB);
+        }
+
+        scopeManager.defineVariable(slenVarName, slenAlloc);
+        return slenAlloc;
+    }
+
+    void invalidateStringLength(const std::string& varName) {
+        if (AllocaInst* slot = findStringLengthSlot(varName)) {
+            builder.CreateStore(ConstantInt::get(getSizeType(), -1, true), slot);
+        }
+    }
+
+    //赋值后更新长度槽：字面量直接写长度，另一个字符串变量就拷贝它的槽
+    void updateStringLength(const std::string& varName, ASTNode* rhs) {
+        AllocaInst* slot = ensureStringLengthSlot(varName);
+        if (!slot) return;
+        Value* len = ConstantInt::get(getSizeType(), -1, true);
+        if (rhs && rhs->type == AST_STRING && rhs->data.string.value) {
+            len = ConstantInt::get(getSizeType(), strlen(rhs->data.string.value));
+        } else if (rhs && rhs->type == AST_IDENTIFIER && rhs->data.identifier.name) {
+            if (AllocaInst* srcSlot = findStringLengthSlot(rhs->data.identifier.name)) {
+                len = builder.CreateLoad(getSizeType(), srcSlot, varName + "__slen_copy");
+            }
+        }
+        builder.CreateStore(len, slot);
+    }
+
+    Value* loadStringLength(const std::string& varName, AllocaInst* varAlloc, AllocaInst* slot) {
+        Function* func = getCurrentFunction();
+        Type* sizeTy = getSizeType();
+        Value* cached = builder.CreateLoad(sizeTy, slot, varName + "__slen_val");
+        if (!func) return cached;
+
+        initStrlen();
+        BasicBlock* curBB = builder.GetInsertBlock();
+        BasicBlock* missBB = BasicBlock::Create(context, "slen_miss", func);
+        BasicBlock* doneBB = BasicBlock::Create(context, "slen_done", func);
+        Value* known = builder.CreateICmpSGE(cached, ConstantInt::get(sizeTy, 0), "slen_known");
+        builder.CreateCondBr(known, doneBB, missBB);
+
+        builder.SetInsertPoint(missBB);
+        Value* strPtr = builder.CreateLoad(getActualType(varAlloc), varAlloc, varName);
+        if (strPtr->getType() != PointerType::getUnqual(Type::getInt8Ty(context))) {
+            strPtr = builder.CreateBitCast(strPtr, PointerType::getUnqual(Type::getInt8Ty(context)), "slen_ptr_cast");
+        }
+        Value* computed = builder.CreateIntCast(builder.CreateCall(strlenFunction, {strPtr}, "strlen"), sizeTy, false, "len");
+        builder.CreateStore(computed, slot);
+        builder.CreateBr(doneBB);
+
+        builder.SetInsertPoint(doneBB);
+        PHINode* len = builder.CreatePHI(sizeTy, 2, "slen");
+        len->addIncoming(cached, curBB);
+        len->addIncoming(computed, missBB);
+        return len;
+    }
+
+    void invalidateStringArgs(ASTNode* call) {
+        ASTNode* args = call->data.call.args;
+        if (!args || args->type != AST_EXPRESSION_LIST) return;
+        for (int i = 0; i < args->data.expression_list.expression_count; i++) {
+            ASTNode* arg = args->data.expression_list.expressions[i];
+            if (arg && arg->type == AST_IDENTIFIER && arg->data.identifier.name) {
+                invalidateStringLength(arg->data.identifier.name);//被调函数可能改写缓冲区
+            }
+        }
+    }
+
+    uint64_t getListElementBytes(Type* elemType) {
+        if (elemType->isIntegerTy(8)) return 1;
+        if (elemType->isIntegerTy(64) || elemType->isDoubleTy() || elemType->isPointerTy()) return 8;
+        return 4;
+    }
+
+    // realloc(ptr, cap * elemBytes)，cap 为 i64 元素个数
+    Value* emitListRealloc(Value* oldPtr, Type* elemType, Value* newCap, const std::string& prefix) {
+        Type* targetPtrTy = PointerType::getUnqual(elemType);
+        if (oldPtr->getType() != targetPtrTy) {
+            oldPtr = builder.CreateBitCast(oldPtr, targetPtrTy, prefix + "_old_ptr_cast");
+        }
+        Value* bytes = builder.CreateMul(newCap, ConstantInt::get(getSizeType(), getListElementBytes(elemType)), prefix + "_bytes");
+
+        Function* reallocFn = getOrCreateReallocFunction();
+        Value* oldPtrI8 = builder.CreateBitCast(oldPtr, PointerType::getUnqual(Type::getInt8Ty(context)), prefix + "_old_i8");
+        Value* newPtrI8 = builder.CreateCall(reallocFn, {oldPtrI8, bytes}, prefix + "_realloc");
+        return builder.CreateBitCast(newPtrI8, targetPtrTy, prefix + "_new_ptr");
+    }
+
     Function* getOrCreateReallocFunction() {
         if (Function* fn = module->getFunction("realloc")) {
             return fn;
@@ -982,6 +1251,1746 @@ private:
         return reallocFn;
     }
 
+    // ==================== print 运行时 ====================
+    // 线程局部 8K 缓冲，模块内按 linkonce_odr 生成，分离编译的多个模块在链接时合并成一份。
+    // 刷出走 fwrite(stdout)，和 extern printf 的输出保持先后顺序。
+    static const unsigned PrintBufSize = 8192;
+
+    static bool isQuietLibcFunction(const std::string& name) {//不碰 stdout 的 libc 函数，调用前不用刷缓冲
+        static const std::set<std::string> quiet = {
+            "malloc", "calloc", "realloc", "free",
+            "strlen", "strcmp", "strncmp", "strcpy", "strncpy", "strcat", "strchr", "strrchr", "strstr",
+            "memcpy", "memmove", "memset", "memcmp",
+            "atoi", "atol", "atof", "strtol", "strtoll", "strtod", "abs", "labs",
+            "sqrt", "sin", "cos", "tan", "asin", "acos", "atan", "atan2", "exp", "log", "log2", "log10",
+            "pow", "fabs", "floor", "ceil", "round", "fmod",
+            "sqrtf", "sinf", "cosf", "powf", "expf", "logf", "fabsf", "floorf", "ceilf",
+            "rand", "srand", "clock", "time"
+        };
+        return quiet.count(name) != 0;
+    }
+
+    Function* getRuntimeFunction(const char* name, FunctionType* fnType) {
+        if (Function* fn = module->getFunction(name)) {
+            return fn;
+        }
+        return Function::Create(fnType, Function::ExternalLinkage, name, module.get());
+    }
+
+    Function* getPrintRuntimeFunction(const char* name, Type* argTy = nullptr, Type* argTy2 = nullptr) {
+        std::vector<Type*> params;
+        if (argTy) params.push_back(argTy);
+        if (argTy2) params.push_back(argTy2);
+        return getRuntimeFunction(name, FunctionType::get(Type::getVoidTy(context), params, false));
+    }
+
+    void flushPrintBufferBeforeCall(Function* callee) {
+        if (printMode != 0 || !callee || !callee->isDeclaration()) return;
+        std::string name = callee->getName().str();
+        if (!externCFunctions.count(name) || isQuietLibcFunction(name)) return;
+        builder.CreateCall(getPrintRuntimeFunction("__vix_out_flush"));
+    }
+
+    Value* emitBufferedPrintValue(Value* v, ValueType t) {
+        Type* i8Ty = Type::getInt8Ty(context);
+        Type* i32Ty = Type::getInt32Ty(context);
+        Type* i64Ty = Type::getInt64Ty(context);
+        Type* i8PtrTy = PointerType::getUnqual(i8Ty);
+        Type* vt = v->getType();
+
+        if (vt->isVectorTy()) {
+            emitPrintVector(v);
+            return v;
+        }
+        if (vt->isFloatingPointTy()) {
+            v = typeHelper.castValue(builder, v, t == ValueType::FLOAT32 ? ValueType::FLOAT32 : ValueType::FLOAT64, ValueType::FLOAT64);
+            builder.CreateCall(getPrintRuntimeFunction("__vix_print_f64", Type::getDoubleTy(context)), {v});
+            return v;
+        }
+        if (vt->isPointerTy()) {
+            Value* p = vt == i8PtrTy ? v : builder.CreateBitCast(v, i8PtrTy, "print_ptr");
+            builder.CreateCall(getPrintRuntimeFunction(t == ValueType::STRING ? "__vix_print_str" : "__vix_print_ptr", i8PtrTy), {p});
+            return v;
+        }
+        if (!vt->isIntegerTy()) {
+            v = ConstantInt::get(i32Ty, 0);
+            t = ValueType::INT32;
+        }
+        if (t == ValueType::INT8) {
+            v = builder.CreateSExtOrTrunc(v, i8Ty, "print_c");
+            builder.CreateCall(getPrintRuntimeFunction("__vix_print_char", i8Ty), {v});
+        } else if (t == ValueType::INT32 || t == ValueType::BOOL || v->getType()->getIntegerBitWidth() <= 32) {
+            v = t == ValueType::BOOL ? typeHelper.castValue(builder, v, t, ValueType::INT32) : builder.CreateSExtOrTrunc(v, i32Ty, "print_i32");
+            builder.CreateCall(getPrintRuntimeFunction("__vix_print_i32", i32Ty), {v});
+        } else {
+            v = builder.CreateSExtOrTrunc(v, i64Ty, "print_i64");
+            builder.CreateCall(getPrintRuntimeFunction("__vix_print_i64", i64Ty), {v});
+        }
+        return v;
+    }
+
+    VisitResult visitBufferedPrint(ASTNode* node) {
+        ASTNode* expr = node->data.print.expr;
+        VisitResult result(nullptr, ValueType::VOID);
+        if (expr->type == AST_EXPRESSION_LIST) {
+            for (int i = 0; i < expr->data.expression_list.expression_count; i++) {
+                VisitResult r = visit(expr->data.expression_list.expressions[i]);
+                if (r.value) emitBufferedPrintValue(r.value, r.type);
+            }
+        } else {
+            VisitResult r = visit(expr);
+            if (!r.value) return VisitResult();
+            result = VisitResult(emitBufferedPrintValue(r.value, r.type), r.type);
+        }
+        builder.CreateCall(getPrintRuntimeFunction("__vix_print_nl"));
+        if (printMode == 1) {
+            builder.CreateCall(getPrintRuntimeFunction("__vix_out_sync"));
+        }
+        return result;
+    }
+
+    GlobalVariable* getRuntimeGlobal(const char* name, Type* ty, bool threadLocal) {
+        if (GlobalVariable* gv = module->getGlobalVariable(name, true)) {
+            return gv;
+        }
+        GlobalVariable* gv = new GlobalVariable(*module, ty, false, GlobalValue::LinkOnceODRLinkage,
+                                                Constant::getNullValue(ty), name);
+        gv->setThreadLocal(threadLocal);
+        gv->setVisibility(GlobalValue::HiddenVisibility);
+        return gv;
+    }
+
+    Constant* getRuntimeString(const char* s, const char* name) {
+        Type* i8PtrTy = PointerType::getUnqual(Type::getInt8Ty(context));
+        if (GlobalVariable* gv = module->getGlobalVariable(name, true)) {
+            return ConstantExpr::getBitCast(gv, i8PtrTy);
+        }
+        Constant* init = ConstantDataArray::getString(context, s);
+        GlobalVariable* gv = new GlobalVariable(*module, init->getType(), true, GlobalValue::PrivateLinkage, init, name);
+        gv->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+        return ConstantExpr::getBitCast(gv, i8PtrTy);
+    }
+
+    GlobalVariable* getStdioStream(bool err) {//FILE* stdout / stderr，BSD 系 libc 上叫 __stdoutp / __stderrp
+        const std::string& triple = module->getTargetTriple();
+        bool bsdStdio = triple.find("apple") != std::string::npos || triple.find("darwin") != std::string::npos ||
+                        triple.find("freebsd") != std::string::npos;
+        const char* name = bsdStdio ? (err ? "__stderrp" : "__stdoutp") : (err ? "stderr" : "stdout");
+        if (GlobalVariable* gv = module->getGlobalVariable(name, true)) {
+            return gv;
+        }
+        Type* i8PtrTy = PointerType::getUnqual(Type::getInt8Ty(context));
+        return new GlobalVariable(*module, i8PtrTy, false, GlobalValue::ExternalLinkage, nullptr, name);
+    }
+
+    FunctionCallee getErrnoFunction() {//返回 int* 的 errno 地址函数：glibc/musl 是 __errno_location，BSD 系是 __error
+        const std::string& triple = module->getTargetTriple();
+        bool bsdErrno = triple.find("apple") != std::string::npos || triple.find("darwin") != std::string::npos ||
+                        triple.find("freebsd") != std::string::npos;
+        Type* i32PtrTy = PointerType::getUnqual(Type::getInt32Ty(context));
+        return module->getOrInsertFunction(bsdErrno ? "__error" : "__errno_location", FunctionType::get(i32PtrTy, false));
+    }
+
+    bool beginRuntimeBody(IRBuilder<>& b, Function* fn) {//已有函数体（同名用户函数或已生成）就跳过
+        if (!fn->isDeclaration()) return false;
+        fn->setLinkage(GlobalValue::LinkOnceODRLinkage);
+        fn->setVisibility(GlobalValue::HiddenVisibility);
+        fn->addFnAttr(Attribute::NoUnwind);
+        b.SetInsertPoint(BasicBlock::Create(context, "entry", fn));
+        return true;
+    }
+
+    Function* beginPrintRuntimeFunction(IRBuilder<>& b, const char* name, Type* argTy = nullptr, Type* argTy2 = nullptr) {
+        Function* fn = getPrintRuntimeFunction(name, argTy, argTy2);
+        return beginRuntimeBody(b, fn) ? fn : nullptr;
+    }
+
+    void emitPrintRuntime() {
+        if (!module->getFunction("__vix_print_nl") && !module->getFunction("__vix_out_flush") &&
+            !module->getFunction("__vix_out_sync") && !module->getFunction("__vix_out_write")) return;
+
+        Type* i8Ty = Type::getInt8Ty(context);
+        Type* i32Ty = Type::getInt32Ty(context);
+        Type* i64Ty = Type::getInt64Ty(context);
+        Type* dblTy = Type::getDoubleTy(context);
+        PointerType* i8PtrTy = PointerType::getUnqual(i8Ty);
+        ArrayType* bufTy = ArrayType::get(i8Ty, PrintBufSize);
+        bool glibc = module->getTargetTriple().find("linux-gnu") != std::string::npos;
+
+        GlobalVariable* buf = getRuntimeGlobal("__vix_out_buf", bufTy, true);
+        GlobalVariable* len = getRuntimeGlobal("__vix_out_len", i32Ty, true);
+        GlobalVariable* state = getRuntimeGlobal("__vix_out_state", i32Ty, true);//0 未初始化 1 全缓冲 2 终端按行 3 已退出
+        GlobalVariable* stdoutVar = getStdioStream(false);
+        FunctionCallee fwriteFn = module->getOrInsertFunction("fwrite", FunctionType::get(i64Ty, {i8PtrTy, i64Ty, i64Ty, i8PtrTy}, false));
+        FunctionCallee fflushFn = module->getOrInsertFunction("fflush", FunctionType::get(i32Ty, {i8PtrTy}, false));
+        FunctionCallee isattyFn = module->getOrInsertFunction("isatty", FunctionType::get(i32Ty, {i32Ty}, false));
+        FunctionCallee strlenFn = module->getOrInsertFunction("strlen", FunctionType::get(i64Ty, {i8PtrTy}, false));
+        FunctionCallee snprintfFn = module->getOrInsertFunction("snprintf", FunctionType::get(i32Ty, {i8PtrTy, i64Ty, i8PtrTy}, true));
+        Constant* zero32 = ConstantInt::get(i32Ty, 0);
+        Constant* one64 = ConstantInt::get(i64Ty, 1);
+        Constant* cap64 = ConstantInt::get(i64Ty, PrintBufSize);
+
+        IRBuilder<> b(context);
+        Function* fn = nullptr;
+        auto bufAt = [&](Value* idx) {
+            return b.CreateInBoundsGEP(bufTy, buf, {ConstantInt::get(i64Ty, 0), idx});
+        };
+
+        // __vix_out_flush(): 缓冲写进 stdout
+        Function* flushFn = getPrintRuntimeFunction("__vix_out_flush");
+        if ((fn = beginPrintRuntimeFunction(b, "__vix_out_flush"))) {
+            BasicBlock* doBB = BasicBlock::Create(context, "do", fn);
+            BasicBlock* retBB = BasicBlock::Create(context, "ret", fn);
+            Value* n = b.CreateLoad(i32Ty, len, "n");
+            b.CreateCondBr(b.CreateICmpEQ(n, zero32), retBB, doBB);
+            b.SetInsertPoint(doBB);
+            Value* out = b.CreateLoad(i8PtrTy, stdoutVar, "out");
+            b.CreateCall(fwriteFn, {bufAt(ConstantInt::get(i64Ty, 0)), one64, b.CreateZExt(n, i64Ty), out});
+            b.CreateStore(zero32, len);
+            b.CreateBr(retBB);
+            b.SetInsertPoint(retBB);
+            b.CreateRetVoid();
+        }
+
+        // __vix_out_sync(): --unbuffered，连 stdio 的缓冲一起刷
+        if ((fn = beginPrintRuntimeFunction(b, "__vix_out_sync"))) {
+            b.CreateCall(flushFn);
+            b.CreateCall(fflushFn, {b.CreateLoad(i8PtrTy, stdoutVar, "out")});
+            b.CreateRetVoid();
+        }
+
+        // 线程退出 / exit() 时刷出，之后的 print 每行直接刷
+        Function* dtorFn = getPrintRuntimeFunction("__vix_out_flush_dtor", i8PtrTy);
+        if ((fn = beginPrintRuntimeFunction(b, "__vix_out_flush_dtor", i8PtrTy))) {
+            b.CreateCall(flushFn);
+            b.CreateStore(ConstantInt::get(i32Ty, 3), state);
+            b.CreateRetVoid();
+        }
+
+        Function* initFn = getPrintRuntimeFunction("__vix_out_init");
+        if ((fn = beginPrintRuntimeFunction(b, "__vix_out_init"))) {
+            Value* tty = b.CreateICmpNE(b.CreateCall(isattyFn, {ConstantInt::get(i32Ty, 1)}), zero32);
+            b.CreateStore(b.CreateSelect(tty, ConstantInt::get(i32Ty, 2), ConstantInt::get(i32Ty, 1)), state);
+            FunctionCallee atexitFn = module->getOrInsertFunction("atexit",
+                FunctionType::get(i32Ty, {flushFn->getType()}, false));
+            if (glibc) {//glibc 有线程局部析构注册，每个线程退出时刷自己的缓冲
+                FunctionType* regTy = FunctionType::get(i32Ty, {dtorFn->getType(), i8PtrTy, i8PtrTy}, false);
+                Function* regFn = module->getFunction("__cxa_thread_atexit_impl");
+                if (!regFn) {
+                    regFn = Function::Create(regTy, GlobalValue::ExternalWeakLinkage, "__cxa_thread_atexit_impl", module.get());
+                }
+                GlobalVariable* dso = module->getGlobalVariable("__dso_handle", true);
+                if (!dso) {
+                    dso = new GlobalVariable(*module, i8Ty, false, GlobalValue::ExternalLinkage, nullptr, "__dso_handle");
+                    dso->setVisibility(GlobalValue::HiddenVisibility);
+                }
+                BasicBlock* tlsBB = BasicBlock::Create(context, "tls", fn);
+                BasicBlock* procBB = BasicBlock::Create(context, "proc", fn);
+                Value* has = b.CreateICmpNE(b.CreatePtrToInt(regFn, i64Ty), ConstantInt::get(i64Ty, 0));
+                b.CreateCondBr(has, tlsBB, procBB);
+                b.SetInsertPoint(tlsBB);
+                b.CreateCall(regTy, regFn, {dtorFn, ConstantPointerNull::get(i8PtrTy), b.CreateBitCast(dso, i8PtrTy)});
+                b.CreateRetVoid();
+                b.SetInsertPoint(procBB);
+            }
+            b.CreateCall(atexitFn, {flushFn});
+            b.CreateRetVoid();
+        }
+
+        // __vix_out_write(p, n): 装不下先刷，超过整个缓冲的直接 fwrite
+        Function* writeFn = getPrintRuntimeFunction("__vix_out_write", i8PtrTy, i64Ty);
+        if ((fn = beginPrintRuntimeFunction(b, "__vix_out_write", i8PtrTy, i64Ty))) {
+            Argument* p = fn->getArg(0);
+            Argument* n = fn->getArg(1);
+            BasicBlock* entryBB = b.GetInsertBlock();
+            BasicBlock* spillBB = BasicBlock::Create(context, "spill", fn);
+            BasicBlock* directBB = BasicBlock::Create(context, "direct", fn);
+            BasicBlock* copyBB = BasicBlock::Create(context, "copy", fn);
+            Value* cur = b.CreateZExt(b.CreateLoad(i32Ty, len, "len"), i64Ty, "cur");
+            b.CreateCondBr(b.CreateICmpUGT(b.CreateAdd(cur, n), cap64), spillBB, copyBB);
+            b.SetInsertPoint(spillBB);
+            b.CreateCall(flushFn);
+            b.CreateCondBr(b.CreateICmpUGT(n, cap64), directBB, copyBB);
+            b.SetInsertPoint(directBB);
+            b.CreateCall(fwriteFn, {p, one64, n, b.CreateLoad(i8PtrTy, stdoutVar, "out")});
+            b.CreateRetVoid();
+            b.SetInsertPoint(copyBB);
+            PHINode* at = b.CreatePHI(i64Ty, 2, "at");
+            at->addIncoming(cur, entryBB);
+            at->addIncoming(ConstantInt::get(i64Ty, 0), spillBB);
+            b.CreateMemCpy(bufAt(at), MaybeAlign(1), p, MaybeAlign(1), n);
+            b.CreateStore(b.CreateTrunc(b.CreateAdd(at, n), i32Ty), len);
+            b.CreateRetVoid();
+        }
+
+        Function* charFn = getPrintRuntimeFunction("__vix_print_char", i8Ty);
+        if ((fn = beginPrintRuntimeFunction(b, "__vix_print_char", i8Ty))) {
+            BasicBlock* entryBB = b.GetInsertBlock();
+            BasicBlock* spillBB = BasicBlock::Create(context, "spill", fn);
+            BasicBlock* putBB = BasicBlock::Create(context, "put", fn);
+            Value* cur = b.CreateLoad(i32Ty, len, "len");
+            b.CreateCondBr(b.CreateICmpEQ(cur, ConstantInt::get(i32Ty, PrintBufSize)), spillBB, putBB);
+            b.SetInsertPoint(spillBB);
+            b.CreateCall(flushFn);
+            b.CreateBr(putBB);
+            b.SetInsertPoint(putBB);
+            PHINode* at = b.CreatePHI(i32Ty, 2, "at");
+            at->addIncoming(cur, entryBB);
+            at->addIncoming(zero32, spillBB);
+            b.CreateStore(fn->getArg(0), bufAt(b.CreateZExt(at, i64Ty)));
+            b.CreateStore(b.CreateAdd(at, ConstantInt::get(i32Ty, 1)), len);
+            b.CreateRetVoid();
+        }
+
+        // 行尾：终端下按行刷，第一次遇到时才判断 isatty 并注册退出刷新
+        if ((fn = beginPrintRuntimeFunction(b, "__vix_print_nl"))) {
+            BasicBlock* initBB = BasicBlock::Create(context, "init", fn);
+            BasicBlock* checkBB = BasicBlock::Create(context, "check", fn);
+            BasicBlock* flushBB = BasicBlock::Create(context, "flush", fn);
+            BasicBlock* retBB = BasicBlock::Create(context, "ret", fn);
+            b.CreateCall(charFn, {ConstantInt::get(i8Ty, '\n')});
+            Value* st = b.CreateLoad(i32Ty, state, "st");
+            SwitchInst* sw = b.CreateSwitch(st, flushBB, 2);
+            sw->addCase(b.getInt32(1), retBB);
+            sw->addCase(b.getInt32(0), initBB);
+            b.SetInsertPoint(initBB);
+            b.CreateCall(initFn);
+            b.CreateBr(checkBB);
+            b.SetInsertPoint(checkBB);
+            b.CreateCondBr(b.CreateICmpEQ(b.CreateLoad(i32Ty, state, "st"), ConstantInt::get(i32Ty, 1)), retBB, flushBB);
+            b.SetInsertPoint(flushBB);
+            b.CreateCall(flushFn);
+            b.CreateBr(retBB);
+            b.SetInsertPoint(retBB);
+            b.CreateRetVoid();
+        }
+
+        // 整数从低位往前写进栈上的 24 字节，不经过 printf 的格式解析
+        Function* i64Fn = getPrintRuntimeFunction("__vix_print_i64", i64Ty);
+        if ((fn = beginPrintRuntimeFunction(b, "__vix_print_i64", i64Ty))) {
+            ArrayType* digitsTy = ArrayType::get(i8Ty, 24);
+            Value* v = fn->getArg(0);
+            Value* digits = b.CreateAlloca(digitsTy, nullptr, "digits");
+            BasicBlock* entryBB = b.GetInsertBlock();
+            BasicBlock* loopBB = BasicBlock::Create(context, "loop", fn);
+            BasicBlock* signBB = BasicBlock::Create(context, "sign", fn);
+            BasicBlock* outBB = BasicBlock::Create(context, "out", fn);
+            Value* neg = b.CreateICmpSLT(v, ConstantInt::get(i64Ty, 0), "neg");
+            Value* mag = b.CreateSelect(neg, b.CreateSub(ConstantInt::get(i64Ty, 0), v), v, "mag");
+            b.CreateBr(loopBB);
+            b.SetInsertPoint(loopBB);
+            PHINode* pos = b.CreatePHI(i64Ty, 2, "pos");
+            PHINode* m = b.CreatePHI(i64Ty, 2, "m");
+            Value* next = b.CreateSub(pos, one64, "next");
+            Value* digit = b.CreateTrunc(b.CreateURem(m, ConstantInt::get(i64Ty, 10)), i8Ty);
+            b.CreateStore(b.CreateAdd(digit, ConstantInt::get(i8Ty, '0')),
+                          b.CreateInBoundsGEP(digitsTy, digits, {ConstantInt::get(i64Ty, 0), next}));
+            Value* rest = b.CreateUDiv(m, ConstantInt::get(i64Ty, 10), "rest");
+            pos->addIncoming(ConstantInt::get(i64Ty, 24), entryBB);
+            pos->addIncoming(next, loopBB);
+            m->addIncoming(mag, entryBB);
+            m->addIncoming(rest, loopBB);
+            b.CreateCondBr(b.CreateICmpNE(rest, ConstantInt::get(i64Ty, 0)), loopBB, signBB);
+            b.SetInsertPoint(signBB);
+            BasicBlock* minusBB = BasicBlock::Create(context, "minus", fn);
+            b.CreateCondBr(neg, minusBB, outBB);
+            b.SetInsertPoint(minusBB);
+            Value* minusAt = b.CreateSub(next, one64, "minus_at");
+            b.CreateStore(ConstantInt::get(i8Ty, '-'), b.CreateInBoundsGEP(digitsTy, digits, {ConstantInt::get(i64Ty, 0), minusAt}));
+            b.CreateBr(outBB);
+            b.SetInsertPoint(outBB);
+            PHINode* start = b.CreatePHI(i64Ty, 2, "start");
+            start->addIncoming(next, signBB);
+            start->addIncoming(minusAt, minusBB);
+            b.CreateCall(writeFn, {b.CreateInBoundsGEP(digitsTy, digits, {ConstantInt::get(i64Ty, 0), start}),
+                                   b.CreateSub(ConstantInt::get(i64Ty, 24), start)});
+            b.CreateRetVoid();
+        }
+
+        if ((fn = beginPrintRuntimeFunction(b, "__vix_print_i32", i32Ty))) {
+            b.CreateCall(i64Fn, {b.CreateSExt(fn->getArg(0), i64Ty)});
+            b.CreateRetVoid();
+        }
+
+        if ((fn = beginPrintRuntimeFunction(b, "__vix_print_str", i8PtrTy))) {
+            Value* s = fn->getArg(0);
+            BasicBlock* nullBB = BasicBlock::Create(context, "null", fn);
+            BasicBlock* lenBB = BasicBlock::Create(context, "len", fn);
+            BasicBlock* outBB = BasicBlock::Create(context, "out", fn);
+            b.CreateCondBr(b.CreateICmpEQ(s, ConstantPointerNull::get(i8PtrTy)), nullBB, lenBB);
+            b.SetInsertPoint(nullBB);
+            b.CreateBr(outBB);
+            b.SetInsertPoint(lenBB);
+            Value* n = b.CreateCall(strlenFn, {s});
+            b.CreateBr(outBB);
+            b.SetInsertPoint(outBB);
+            PHINode* text = b.CreatePHI(i8PtrTy, 2, "text");
+            text->addIncoming(getRuntimeString("(null)", "__vix_str_null"), nullBB);
+            text->addIncoming(s, lenBB);
+            PHINode* count = b.CreatePHI(i64Ty, 2, "count");
+            count->addIncoming(ConstantInt::get(i64Ty, 6), nullBB);
+            count->addIncoming(n, lenBB);
+            b.CreateCall(writeFn, {text, count});
+            b.CreateRetVoid();
+        }
+
+        // 浮点和指针保持 printf 的 %f / %p 输出
+        auto emitFormatted = [&](const char* name, Type* argTy, const char* fmt, const char* fmtName, unsigned size) {
+            if (!(fn = beginPrintRuntimeFunction(b, name, argTy))) return;
+            ArrayType* tmpTy = ArrayType::get(i8Ty, size);
+            Value* tmp = b.CreateBitCast(b.CreateAlloca(tmpTy, nullptr, "tmp"), i8PtrTy);
+            Value* n = b.CreateCall(snprintfFn, {tmp, ConstantInt::get(i64Ty, size), getRuntimeString(fmt, fmtName), fn->getArg(0)});
+            Value* clamped = b.CreateSelect(b.CreateICmpSLT(n, zero32), zero32,
+                b.CreateSelect(b.CreateICmpSLT(n, ConstantInt::get(i32Ty, size)), n, ConstantInt::get(i32Ty, size - 1)));
+            b.CreateCall(writeFn, {tmp, b.CreateZExt(clamped, i64Ty)});
+            b.CreateRetVoid();
+        };
+        emitFormatted("__vix_print_f64", dblTy, "%f", "__vix_fmt_f", 512);
+        emitFormatted("__vix_print_ptr", i8PtrTy, "%p", "__vix_fmt_p", 32);
+    }
+
+    // ==================== 下标检查（--bounds-check） ====================
+    // 上限取静态数组长度或 <name>__len 槽；字符串、argv 和长度未知的指针不检查。
+    // for (i in 0 .. a.length) 的循环体里只要不改 i、不改 a 的长度，a[i] 就不再检查。
+    static bool isIdentNamed(ASTNode* n, const std::string& name) {
+        return n && n->type == AST_IDENTIFIER && n->data.identifier.name && name == n->data.identifier.name;
+    }
+
+    static bool mentionsName(ASTNode* n, const std::string& name) {
+        if (!n) return false;
+        if (isIdentNamed(n, name)) return true;
+        if (n->type == AST_CALL) return mentionsName(n->data.call.func, name) || mentionsName(n->data.call.args, name);
+        if (n->type == AST_EXPRESSION_LIST) {
+            for (int i = 0; i < n->data.expression_list.expression_count; i++) {
+                if (mentionsName(n->data.expression_list.expressions[i], name)) return true;
+            }
+        }
+        return false;
+    }
+
+    //对每个子节点调用 pred，有一个返回 true 就返回 true；不认识的节点类型返回 unknown
+    static bool anyChild(ASTNode* node, const std::function<bool(ASTNode*)>& pred, bool unknown) {
+        switch (node->type) {
+            case AST_PROGRAM:
+                for (int i = 0; i < node->data.program.statement_count; i++) {
+                    if (pred(node->data.program.statements[i])) return true;
+                }
+                return false;
+            case AST_EXPRESSION_LIST:
+                for (int i = 0; i < node->data.expression_list.expression_count; i++) {
+                    if (pred(node->data.expression_list.expressions[i])) return true;
+                }
+                return false;
+            case AST_ASSIGN:
+                return pred(node->data.assign.left) || pred(node->data.assign.right);
+            case AST_UNARYOP:
+                return pred(node->data.unaryop.expr);
+            case AST_BINOP:
+                return pred(node->data.binop.left) || pred(node->data.binop.right);
+            case AST_CALL:
+                return pred(node->data.call.func) || pred(node->data.call.args);
+            case AST_INDEX:
+                return pred(node->data.index.target) || pred(node->data.index.index);
+            case AST_MEMBER_ACCESS:
+                return pred(node->data.member_access.object);
+            case AST_IF:
+                return pred(node->data.if_stmt.condition) || pred(node->data.if_stmt.then_body) || pred(node->data.if_stmt.else_body);
+            case AST_WHILE:
+                return pred(node->data.while_stmt.condition) || pred(node->data.while_stmt.body);
+            case AST_FOR:
+                return pred(node->data.for_stmt.start) || pred(node->data.for_stmt.end) || pred(node->data.for_stmt.body);
+            case AST_MATCH: {
+                if (pred(node->data.match_stmt.scrutinee)) return true;
+                ASTNode* arms = node->data.match_stmt.arms;
+                for (int i = 0; arms && i < arms->data.expression_list.expression_count; i++) {
+                    ASTNode* arm = arms->data.expression_list.expressions[i];
+                    if (!arm || arm->type != AST_ASSIGN) return unknown;
+                    if (pred(arm->data.assign.right)) return true;//模式本身不算子表达式
+                }
+                return false;
+            }
+            case AST_PRINT:
+                return pred(node->data.print.expr);
+            case AST_RETURN:
+                return pred(node->data.return_stmt.expr);
+            case AST_TOINT:
+                return pred(node->data.toint.expr);
+            case AST_TOFLOAT:
+                return pred(node->data.tofloat.expr);
+            case AST_INPUT:
+                return pred(node->data.input.prompt);
+            case AST_IDENTIFIER:
+            case AST_NUM_INT:
+            case AST_NUM_FLOAT:
+            case AST_STRING:
+            case AST_CHAR:
+            case AST_NIL:
+            case AST_BREAK:
+            case AST_CONTINUE:
+                return false;
+            default:
+                return unknown;
+        }
+    }
+
+    static bool loopBodyDisturbs(ASTNode* node, const std::string& idx, const std::string& arr) {//保守：不认识的节点都算会改
+        if (!node) return false;
+        switch (node->type) {
+            case AST_ASSIGN:
+                if (isIdentNamed(node->data.assign.left, idx) || isIdentNamed(node->data.assign.left, arr)) return true;
+                break;
+            case AST_UNARYOP:
+                if (node->data.unaryop.op == OP_ADDRESS &&
+                    (isIdentNamed(node->data.unaryop.expr, idx) || isIdentNamed(node->data.unaryop.expr, arr))) return true;
+                break;
+            case AST_CALL:
+                if (node->data.call.func && node->data.call.func->type == AST_MEMBER_ACCESS &&
+                    isIdentNamed(node->data.call.func->data.member_access.object, arr)) return true;//a.push / a.shrink_to_fit ...
+                break;
+            case AST_FOR:
+                if (isIdentNamed(node->data.for_stmt.var, idx) || isIdentNamed(node->data.for_stmt.var, arr)) return true;
+                break;
+            case AST_MATCH: {
+                ASTNode* arms = node->data.match_stmt.arms;
+                for (int i = 0; arms && i < arms->data.expression_list.expression_count; i++) {
+                    ASTNode* arm = arms->data.expression_list.expressions[i];
+                    if (arm && arm->type == AST_ASSIGN &&
+                        (mentionsName(arm->data.assign.left, idx) || mentionsName(arm->data.assign.left, arr))) return true;//Some(i) 会遮住 i
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        return anyChild(node, [&](ASTNode* c) { return loopBodyDisturbs(c, idx, arr); }, true);
+    }
+
+    //for (i in 0 .. a.length) 且循环体不动 i 和 a 时返回 "a"
+    std::string boundedLoopArray(ASTNode* var, ASTNode* start, ASTNode* end, ASTNode* body) {
+        if (!boundsCheck || !var || var->type != AST_IDENTIFIER) return "";
+        if (!start || start->type != AST_NUM_INT || start->data.num_int.value != 0) return "";
+        if (!end || end->type != AST_MEMBER_ACCESS || !isIdentNamed(end->data.member_access.field, "length")) return "";
+        ASTNode* obj = end->data.member_access.object;
+        if (!obj || obj->type != AST_IDENTIFIER || !obj->data.identifier.name) return "";
+        std::string arr(obj->data.identifier.name);
+        std::string idx(var->data.identifier.name);
+        if (idx == arr || loopBodyDisturbs(body, idx, arr)) return "";
+        return arr;
+    }
+
+    bool isIndexProven(const std::string& varName, ASTNode* indexNode) {
+        if (!indexNode || indexNode->type != AST_IDENTIFIER || !indexNode->data.identifier.name) return false;
+        for (auto it = boundedIndexVars.rbegin(); it != boundedIndexVars.rend(); ++it) {
+            if (it->first == indexNode->data.identifier.name) return it->second == varName;//内层同名循环变量遮住外层
+        }
+        return false;
+    }
+
+    Value* getIndexLimit(const std::string& varName, Type* allocatedType) {
+        if (allocatedType && allocatedType->isArrayTy()) {
+            return ConstantInt::get(getSizeType(), cast<ArrayType>(allocatedType)->getNumElements());
+        }
+        if (varName.empty() || varName == "argv" || typeHelper.isStringVariable(varName)) return nullptr;
+        if (Value* len = getRuntimeArrayLengthValue(varName)) return len;
+        if (auto* info = typeHelper.getArrayTypeInfo(varName)) {
+            if (info->first && !info->first->isIntegerTy(8) && info->second >= 0) {
+                return ConstantInt::get(getSizeType(), info->second);
+            }
+        }
+        return nullptr;
+    }
+
+    void emitIndexCheck(Value* idxVal, const std::string& varName, Type* allocatedType, ASTNode* indexNode, ASTNode* node) {
+        if (!boundsCheck || isIndexProven(varName, indexNode)) return;
+        Value* limit = getIndexLimit(varName, allocatedType);
+        if (!limit || !idxVal->getType()->isIntegerTy(64)) return;
+        Value* oob = builder.CreateICmpUGE(idxVal, limit, "oob");//负数按无符号也越界
+        if (ConstantInt* c = dyn_cast<ConstantInt>(oob)) {
+            if (c->isZero()) return;
+        }
+        Function* fn = builder.GetInsertBlock()->getParent();
+        BasicBlock* failBB = BasicBlock::Create(context, "bounds_fail", fn);
+        BasicBlock* okBB = BasicBlock::Create(context, "bounds_ok", fn);
+        MDBuilder md(context);
+        builder.CreateCondBr(oob, failBB, okBB, md.createBranchWeights(1, 1 << 20));
+
+        builder.SetInsertPoint(failBB);
+        const char* file = (node && node->source_file) ? node->source_file :
+            (current_input_filename ? current_input_filename : "unknown");
+        int line = (node && node->location.first_line > 0) ? node->location.first_line : 1;
+        Type* i8PtrTy = PointerType::getUnqual(Type::getInt8Ty(context));
+        Type* i32Ty = Type::getInt32Ty(context);
+        Function* failFn = getRuntimeFunction("__vix_bounds_fail",
+            FunctionType::get(Type::getVoidTy(context), {getSizeType(), getSizeType(), i8PtrTy, i8PtrTy, i32Ty}, false));
+        builder.CreateCall(failFn, {idxVal, limit, getRuntimeString(varName.c_str(), ("__vix_bc." + varName).c_str()),
+                                    getRuntimeString(file, (std::string("__vix_bc_file.") + file).c_str()),
+                                    ConstantInt::get(i32Ty, line)});
+        builder.CreateUnreachable();
+        builder.SetInsertPoint(okBB);
+    }
+
+    void emitBoundsRuntime() {
+        Function* failFn = module->getFunction("__vix_bounds_fail");
+        if (!failFn) return;
+        Type* i32Ty = Type::getInt32Ty(context);
+        Type* i8PtrTy = PointerType::getUnqual(Type::getInt8Ty(context));
+        failFn->addFnAttr(Attribute::NoReturn);
+        failFn->addFnAttr(Attribute::Cold);
+        IRBuilder<> b(context);
+        if (!beginRuntimeBody(b, failFn)) return;
+        Constant* fmt = getRuntimeString("%s:%d: Error: Array index out of bounds: accessing index %lld in array '%s' of size %lld\n",
+                                         "__vix_fmt_bounds");
+        std::vector<Value*> args = {failFn->getArg(3), failFn->getArg(4), failFn->getArg(0), failFn->getArg(2), failFn->getArg(1)};
+        if (printMode == 2) {
+            initPrintf();
+            args.insert(args.begin(), fmt);
+            b.CreateCall(printfFunction, args);
+        } else {
+            FunctionCallee fprintfFn = module->getOrInsertFunction("fprintf", FunctionType::get(i32Ty, {i8PtrTy, i8PtrTy}, true));
+            args.insert(args.begin(), fmt);
+            args.insert(args.begin(), b.CreateLoad(i8PtrTy, getStdioStream(true), "err"));
+            b.CreateCall(fprintfFn, args);
+        }
+        FunctionCallee exitFn = module->getOrInsertFunction("exit", FunctionType::get(Type::getVoidTy(context), {i32Ty}, false));
+        b.CreateCall(exitFn, {ConstantInt::get(i32Ty, 1)});//exit 会跑退出刷新，之前 print 的内容不丢
+        b.CreateUnreachable();
+    }
+
+    // ==================== SIMD 向量 ====================
+    /*
+    v4f32、v8i32、v2f64 ... 直接对应 LLVM 的 <N x T>，按值传递：
+      v4f32(1.0, 2.0, 3.0, 4.0)、v4f32(x)（广播）、v4f32.load(a, i)     构造
+      + - * / %                                                        逐通道，另一边是标量时先广播
+      v.store(a, i)、v[k]、v[k] = x
+      v.shuffle(3, 2, 1, 0)、a.shuffle(b, 0, 4, 1, 5)                  通道号是常量，第二个向量的通道从 N 开始
+      v.sum() v.min() v.max()                                          水平归约，返回标量
+      v.min(w) v.max(w) v.abs() v.sqrt()                               逐通道
+    */
+    static std::string vectorTypeName(FixedVectorType* vt) {
+        Type* et = vt->getElementType();
+        std::string elem = et->isFloatTy() ? "f32" : et->isDoubleTy() ? "f64" : "i" + std::to_string(et->getIntegerBitWidth());
+        return "v" + std::to_string(vt->getNumElements()) + elem;
+    }
+
+    static int callArgCount(ASTNode* call) {
+        ASTNode* args = call->data.call.args;
+        return (args && args->type == AST_EXPRESSION_LIST) ? args->data.expression_list.expression_count : 0;
+    }
+
+    static ASTNode* callArg(ASTNode* call, int i) {
+        return call->data.call.args->data.expression_list.expressions[i];
+    }
+
+    FixedVectorType* staticVectorType(ASTNode* n) {//v4f32.load 里的类型名，有同名变量时按变量算
+        if (!n || n->type != AST_IDENTIFIER || !n->data.identifier.name) return nullptr;
+        std::string name(n->data.identifier.name);
+        if (scopeManager.findVariable(name) || findVariableInMain(name)) return nullptr;
+        return typeHelper.getVectorType(name);
+    }
+
+    //不生成代码，只看表达式的结果是不是向量
+    FixedVectorType* vectorTypeOf(ASTNode* n) {
+        if (!n) return nullptr;
+        switch (n->type) {
+            case AST_IDENTIFIER: {
+                if (!n->data.identifier.name) return nullptr;
+                AllocaInst* alloc = scopeManager.findVariable(n->data.identifier.name);
+                if (!alloc) alloc = findVariableInMain(n->data.identifier.name);
+                return alloc ? dyn_cast_or_null<FixedVectorType>(getActualType(alloc)) : nullptr;
+            }
+            case AST_BINOP:
+                switch (n->data.binop.op) {
+                    case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD: {
+                        FixedVectorType* vt = vectorTypeOf(n->data.binop.left);
+                        return vt ? vt : vectorTypeOf(n->data.binop.right);
+                    }
+                    default:
+                        return nullptr;
+                }
+            case AST_UNARYOP:
+                return n->data.unaryop.op == OP_MINUS ? vectorTypeOf(n->data.unaryop.expr) : nullptr;
+            case AST_CALL: {
+                ASTNode* f = n->data.call.func;
+                if (f && f->type == AST_IDENTIFIER && f->data.identifier.name) {
+                    if (Function* fn = module->getFunction(f->data.identifier.name)) {
+                        return dyn_cast<FixedVectorType>(fn->getReturnType());
+                    }
+                    return typeHelper.getVectorType(f->data.identifier.name);
+                }
+                if (!f || f->type != AST_MEMBER_ACCESS || !f->data.member_access.field ||
+                    f->data.member_access.field->type != AST_IDENTIFIER || !f->data.member_access.field->data.identifier.name) {
+                    return nullptr;
+                }
+                std::string method(f->data.member_access.field->data.identifier.name);
+                if (FixedVectorType* st = staticVectorType(f->data.member_access.object)) {
+                    return method == "load" ? st : nullptr;
+                }
+                FixedVectorType* vt = vectorTypeOf(f->data.member_access.object);
+                if (!vt) return nullptr;
+                int argc = callArgCount(n);
+                if (method == "shuffle") {
+                    int lanes = argc - ((argc > 0 && vectorTypeOf(callArg(n, 0))) ? 1 : 0);
+                    return lanes >= 2 ? FixedVectorType::get(vt->getElementType(), lanes) : nullptr;
+                }
+                if (method == "abs" || method == "sqrt" || ((method == "min" || method == "max") && argc == 1)) return vt;
+                return nullptr;
+            }
+            default:
+                return nullptr;
+        }
+    }
+
+    Value* toVectorOperand(const VisitResult& r, FixedVectorType* vt) {//标量先广播；类型对不上返回空
+        if (r.value->getType() == vt) return r.value;
+        if (r.value->getType()->isVectorTy()) return nullptr;
+        Value* elem = typeHelper.castValue(builder, r.value, r.type, typeHelper.getValueTypeFromType(vt->getElementType()));
+        if (elem->getType() != vt->getElementType()) return nullptr;
+        return builder.CreateVectorSplat(vt->getNumElements(), elem, "splat");
+    }
+
+    VisitResult visitVectorBinOp(ASTNode* node, const VisitResult& left, const VisitResult& right) {
+        FixedVectorType* vt = dyn_cast<FixedVectorType>(left.value->getType());
+        if (!vt) vt = cast<FixedVectorType>(right.value->getType());
+        Value* a = toVectorOperand(left, vt);
+        Value* b = toVectorOperand(right, vt);
+        if (!a || !b) {
+            reportCodegenSemanticError(node, "vector operands must have the same type (" + vectorTypeName(vt) + ")");
+            return VisitResult();
+        }
+        bool fp = vt->getElementType()->isFloatingPointTy();
+        Value* v = nullptr;
+        switch (node->data.binop.op) {
+            case OP_ADD: v = fp ? builder.CreateFAdd(a, b, "vadd") : builder.CreateAdd(a, b, "vadd"); break;
+            case OP_SUB: v = fp ? builder.CreateFSub(a, b, "vsub") : builder.CreateSub(a, b, "vsub"); break;
+            case OP_MUL: v = fp ? builder.CreateFMul(a, b, "vmul") : builder.CreateMul(a, b, "vmul"); break;
+            case OP_DIV: v = fp ? builder.CreateFDiv(a, b, "vdiv") : builder.CreateSDiv(a, b, "vdiv"); break;
+            case OP_MOD: v = fp ? builder.CreateFRem(a, b, "vrem") : builder.CreateSRem(a, b, "vrem"); break;
+            default:
+                reportCodegenSemanticError(node, "operator is not supported on " + vectorTypeName(vt) + " (compare lanes with v[i])");
+                return VisitResult();
+        }
+        return VisitResult(v, ValueType::VECTOR);
+    }
+
+    VisitResult visitVectorConstruct(FixedVectorType* vt, ASTNode* node) {
+        int argc = callArgCount(node);
+        if (argc == 0) return VisitResult(Constant::getNullValue(vt), ValueType::VECTOR);
+        if (argc == 1) {
+            VisitResult r = visit(callArg(node, 0));
+            if (!r.value) return VisitResult();
+            Value* v = toVectorOperand(r, vt);
+            if (!v) {
+                reportCodegenSemanticError(node, vectorTypeName(vt) + "(x) expects a scalar or a " + vectorTypeName(vt));
+                return VisitResult();
+            }
+            return VisitResult(v, ValueType::VECTOR);
+        }
+        if ((unsigned)argc != vt->getNumElements()) {
+            reportCodegenSemanticError(node, vectorTypeName(vt) + " expects 1 or " + std::to_string(vt->getNumElements()) + " values");
+            return VisitResult();
+        }
+        ValueType elemVT = typeHelper.getValueTypeFromType(vt->getElementType());
+        Value* v = UndefValue::get(vt);
+        for (int i = 0; i < argc; i++) {
+            VisitResult r = visit(callArg(node, i));
+            if (!r.value) return VisitResult();
+            Value* elem = typeHelper.castValue(builder, r.value, r.type, elemVT);
+            if (elem->getType() != vt->getElementType()) {
+                reportCodegenSemanticError(node, vectorTypeName(vt) + " lanes must be numbers");
+                return VisitResult();
+            }
+            v = builder.CreateInsertElement(v, elem, (uint64_t)i, "vlane");
+        }
+        return VisitResult(v, ValueType::VECTOR);
+    }
+
+    //a[i] .. a[i + N - 1] 的地址，a 是列表或定长数组变量；--bounds-check 时检查首尾两个下标
+    Value* vectorElementPtr(ASTNode* arrNode, ASTNode* idxNode, FixedVectorType* vt, ASTNode* node) {
+        if (!arrNode || arrNode->type != AST_IDENTIFIER || !arrNode->data.identifier.name) {
+            reportCodegenSemanticError(node, "vector load/store expects a list or array variable");
+            return nullptr;
+        }
+        std::string name(arrNode->data.identifier.name);
+        AllocaInst* alloc = scopeManager.findVariable(name);
+        if (!alloc) alloc = findVariableInMain(name);
+        Type* allocatedType = alloc ? getActualType(alloc) : nullptr;
+        if (!allocatedType || !(allocatedType->isArrayTy() || allocatedType->isPointerTy())) {
+            reportCodegenSemanticError(node, "vector load/store expects a list or array variable, got '" + name + "'");
+            return nullptr;
+        }
+        VisitResult idxRes = visit(idxNode);
+        if (!idxRes.value || !idxRes.value->getType()->isIntegerTy()) {
+            reportCodegenSemanticError(node, "vector load/store index must be an integer");
+            return nullptr;
+        }
+        Value* idx = castToSize(idxRes.value, "vidx");
+
+        Type* elemType = nullptr;
+        Value* base = nullptr;
+        if (allocatedType->isArrayTy()) {
+            elemType = cast<ArrayType>(allocatedType)->getElementType();
+            base = builder.CreateInBoundsGEP(allocatedType, alloc, {builder.getInt64(0), builder.getInt64(0)}, name + "_base");
+        } else {
+            elemType = getPointerElementTypeSafely(cast<PointerType>(allocatedType), name);
+            base = builder.CreateLoad(allocatedType, alloc, name);
+            if (base->getType() != PointerType::getUnqual(elemType)) {
+                base = builder.CreateBitCast(base, PointerType::getUnqual(elemType), name + "_base");
+            }
+        }
+        if (elemType != vt->getElementType()) {
+            reportCodegenSemanticError(node, "element type of '" + name + "' does not match " + vectorTypeName(vt));
+            return nullptr;
+        }
+        emitIndexCheck(idx, name, allocatedType, nullptr, node);
+        emitIndexCheck(builder.CreateAdd(idx, ConstantInt::get(getSizeType(), vt->getNumElements() - 1), "vidx_last"),
+                       name, allocatedType, nullptr, node);
+        Value* p = builder.CreateInBoundsGEP(elemType, base, idx, "vptr");
+        return builder.CreateBitCast(p, PointerType::getUnqual(vt), "vptr_cast");
+    }
+
+    Value* emitVectorLaneIndex(ASTNode* idxNode, FixedVectorType* vt, ASTNode* node) {//常量通道号在编译期检查
+        if (idxNode && idxNode->type == AST_NUM_INT &&
+            (idxNode->data.num_int.value < 0 || idxNode->data.num_int.value >= (int64_t)vt->getNumElements())) {
+            reportCodegenSemanticError(node, "lane " + std::to_string(idxNode->data.num_int.value) + " is out of range for " + vectorTypeName(vt));
+            return nullptr;
+        }
+        VisitResult r = visit(idxNode);
+        if (!r.value || !r.value->getType()->isIntegerTy()) {
+            reportCodegenSemanticError(node, "vector lane must be an integer");
+            return nullptr;
+        }
+        return castToSize(r.value, "lane");
+    }
+
+    static MaybeAlign vectorElementAlign(FixedVectorType* vt) {//列表只保证元素对齐
+        return MaybeAlign(std::max(1u, vt->getElementType()->getScalarSizeInBits() / 8));
+    }
+
+    VisitResult visitVectorStatic(FixedVectorType* vt, const std::string& method, ASTNode* node) {
+        if (method == "load" && callArgCount(node) == 2) {
+            Value* p = vectorElementPtr(callArg(node, 0), callArg(node, 1), vt, node);
+            if (!p) return VisitResult();
+            return VisitResult(builder.CreateAlignedLoad(vt, p, vectorElementAlign(vt), "vload"), ValueType::VECTOR);
+        }
+        reportCodegenSemanticError(node, "unknown function '" + vectorTypeName(vt) + "." + method + "' (expected load(a, i))");
+        return VisitResult();
+    }
+
+    VisitResult visitVectorMethod(ASTNode* objectNode, const std::string& method, ASTNode* node) {
+        VisitResult obj = visit(objectNode);
+        if (!obj.value || !isa<FixedVectorType>(obj.value->getType())) return VisitResult();
+        FixedVectorType* vt = cast<FixedVectorType>(obj.value->getType());
+        Value* v = obj.value;
+        Type* elemType = vt->getElementType();
+        ValueType elemVT = typeHelper.getValueTypeFromType(elemType);
+        bool fp = elemType->isFloatingPointTy();
+        int argc = callArgCount(node);
+
+        if (method == "store" && argc == 2) {
+            Value* p = vectorElementPtr(callArg(node, 0), callArg(node, 1), vt, node);
+            if (!p) return VisitResult();
+            builder.CreateAlignedStore(v, p, vectorElementAlign(vt));
+            return VisitResult(v, ValueType::VECTOR);
+        }
+        if (method == "sum" && argc == 0) {
+            if (!fp) return VisitResult(builder.CreateAddReduce(v), elemVT);
+            CallInst* sum = builder.CreateFAddReduce(ConstantFP::getNegativeZero(elemType), v);
+            FastMathFlags fmf;
+            fmf.setAllowReassoc();//按树形归约，不要求从左到右
+            sum->setFastMathFlags(fmf);
+            return VisitResult(sum, elemVT);
+        }
+        if ((method == "min" || method == "max") && argc == 0) {
+            bool isMax = method == "max";
+            Value* r = fp ? (isMax ? builder.CreateFPMaxReduce(v) : builder.CreateFPMinReduce(v))
+                          : (isMax ? builder.CreateIntMaxReduce(v, true) : builder.CreateIntMinReduce(v, true));
+            return VisitResult(r, elemVT);
+        }
+        if ((method == "min" || method == "max") && argc == 1) {
+            bool isMax = method == "max";
+            VisitResult otherRes = visit(callArg(node, 0));
+            if (!otherRes.value) return VisitResult();
+            Value* w = toVectorOperand(otherRes, vt);
+            if (!w) {
+                reportCodegenSemanticError(node, method + " expects a " + vectorTypeName(vt) + " or a scalar");
+                return VisitResult();
+            }
+            Value* r = fp ? (isMax ? builder.CreateMaxNum(v, w) : builder.CreateMinNum(v, w))
+                          : builder.CreateSelect(isMax ? builder.CreateICmpSGT(v, w) : builder.CreateICmpSLT(v, w), v, w, "v" + method);
+            return VisitResult(r, ValueType::VECTOR);
+        }
+        if (method == "abs" && argc == 0) {
+            Value* r = fp ? builder.CreateUnaryIntrinsic(Intrinsic::fabs, v)
+                          : builder.CreateIntrinsic(Intrinsic::abs, {vt}, {v, builder.getFalse()});
+            return VisitResult(r, ValueType::VECTOR);
+        }
+        if (method == "sqrt" && argc == 0 && fp) {
+            return VisitResult(builder.CreateUnaryIntrinsic(Intrinsic::sqrt, v), ValueType::VECTOR);
+        }
+        if (method == "shuffle") {
+            int first = 0;
+            Value* other = nullptr;
+            if (argc > 0 && vectorTypeOf(callArg(node, 0))) {
+                VisitResult otherRes = visit(callArg(node, 0));
+                if (!otherRes.value || otherRes.value->getType() != vt) {
+                    reportCodegenSemanticError(node, "shuffle expects two vectors of the same type");
+                    return VisitResult();
+                }
+                other = otherRes.value;
+                first = 1;
+            }
+            int64_t limit = (int64_t)vt->getNumElements() * (other ? 2 : 1);
+            SmallVector<int, 16> mask;
+            for (int i = first; i < argc; i++) {
+                ASTNode* lane = callArg(node, i);
+                if (!lane || lane->type != AST_NUM_INT || lane->data.num_int.value < 0 || lane->data.num_int.value >= limit) {
+                    reportCodegenSemanticError(node, "shuffle lanes must be integer constants in 0 .. " + std::to_string(limit));
+                    return VisitResult();
+                }
+                mask.push_back((int)lane->data.num_int.value);
+            }
+            if (mask.size() < 2) {
+                reportCodegenSemanticError(node, "shuffle needs at least 2 lanes");
+                return VisitResult();
+            }
+            Value* r = other ? builder.CreateShuffleVector(v, other, mask, "vshuf") : builder.CreateShuffleVector(v, mask, "vshuf");
+            return VisitResult(r, ValueType::VECTOR);
+        }
+        reportCodegenSemanticError(node, "unknown " + vectorTypeName(vt) + " method '" + method + "'");
+        return VisitResult();
+    }
+
+    void emitPrintVector(Value* v) {//[1, 2, 3, 4]
+        FixedVectorType* vt = cast<FixedVectorType>(v->getType());
+        ValueType elemVT = typeHelper.getValueTypeFromType(vt->getElementType());
+        if (elemVT == ValueType::INT8) elemVT = ValueType::INT32;//i8 通道按数字打印
+        Type* i8PtrTy = PointerType::getUnqual(Type::getInt8Ty(context));
+        for (unsigned i = 0; i < vt->getNumElements(); i++) {
+            const char* sep = i == 0 ? "[" : ", ";
+            builder.CreateCall(getPrintRuntimeFunction("__vix_print_str", i8PtrTy),
+                               {getRuntimeString(sep, i == 0 ? "__vix_vec_open" : "__vix_vec_sep")});
+            Value* lane = builder.CreateExtractElement(v, (uint64_t)i, "print_lane");
+            emitBufferedPrintValue(lane, elemVT);
+        }
+        builder.CreateCall(getPrintRuntimeFunction("__vix_print_str", i8PtrTy), {getRuntimeString("]", "__vix_vec_close")});
+    }
+
+    void emitPrintfVector(Value* v) {//裸机 printf 版本
+        FixedVectorType* vt = cast<FixedVectorType>(v->getType());
+        bool fp = vt->getElementType()->isFloatingPointTy();
+        Value* fmt = safeCreateGlobalStringPtr(fp ? "%f" : "%lld", fp ? "fmt_vlane_f" : "fmt_vlane_i");
+        for (unsigned i = 0; i < vt->getNumElements(); i++) {
+            builder.CreateCall(printfFunction, {safeCreateGlobalStringPtr(i == 0 ? "[" : ", ", i == 0 ? "fmt_vopen" : "fmt_vsep")});
+            Value* lane = builder.CreateExtractElement(v, (uint64_t)i, "print_lane");
+            lane = fp ? builder.CreateFPExt(lane, Type::getDoubleTy(context)) : builder.CreateSExt(lane, Type::getInt64Ty(context));
+            builder.CreateCall(printfFunction, {fmt, lane});
+        }
+        builder.CreateCall(printfFunction, {safeCreateGlobalStringPtr("]", "fmt_vclose")});
+    }
+
+    /*
+    x86-64 交叉编译（--target=x86_64-...-linux-gnu，cpu 是 generic）时，用到向量的函数生成
+    SSE2 / AVX2 / AVX-512 三份，原名改成 ifunc，程序加载时按 __cpu_model 选一份。
+    本机编译已经按 host cpu 生成，不再分发。参数或返回值是向量的函数不分发：调用约定随指令集变。
+    */
+    static bool functionUsesVectors(Function& fn) {
+        for (BasicBlock& bb : fn) {
+            for (Instruction& inst : bb) {
+                if (inst.getType()->isVectorTy()) return true;
+                if (auto* alloca = dyn_cast<AllocaInst>(&inst)) {
+                    if (alloca->getAllocatedType()->isVectorTy()) return true;
+                }
+                if (auto* store = dyn_cast<StoreInst>(&inst)) {
+                    if (store->getValueOperand()->getType()->isVectorTy()) return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void emitVectorDispatch() {
+        const std::string& triple = module->getTargetTriple();
+        if (g_vix_target_triple.empty() || triple.rfind("x86_64", 0) != 0 || triple.find("linux-gnu") == std::string::npos) return;
+
+        std::vector<Function*> kernels;
+        for (Function& fn : *module) {
+            if (fn.isDeclaration() || fn.getName() == "main" || fn.getName().str().rfind("__vix_", 0) == 0) continue;
+            FunctionType* fty = fn.getFunctionType();
+            bool vectorAbi = fty->getReturnType()->isVectorTy();
+            for (Type* p : fty->params()) vectorAbi = vectorAbi || p->isVectorTy();
+            if (!vectorAbi && functionUsesVectors(fn)) kernels.push_back(&fn);
+        }
+        if (kernels.empty()) return;
+
+        Type* i32Ty = Type::getInt32Ty(context);
+        Function* cpuInit = getRuntimeFunction("__cpu_indicator_init", FunctionType::get(Type::getVoidTy(context), false));
+        StructType* cpuModelTy = StructType::get(context, {i32Ty, i32Ty, i32Ty, ArrayType::get(i32Ty, 1)});
+        GlobalVariable* cpuModel = module->getGlobalVariable("__cpu_model");
+        if (!cpuModel) {
+            cpuModel = new GlobalVariable(*module, cpuModelTy, false, GlobalValue::ExternalLinkage, nullptr, "__cpu_model");
+            cpuModel->setDSOLocal(true);
+        }
+        //libgcc / compiler-rt 的 __cpu_model.__cpu_features[0]：AVX2 = 10, FMA = 14, AVX512F = 15, VL/BW/DQ = 20/21/22
+        const uint32_t avx2Bits = (1u << 10) | (1u << 14);
+        const uint32_t avx512Bits = avx2Bits | (1u << 15) | (1u << 20) | (1u << 21) | (1u << 22);
+        struct Variant { const char* suffix; const char* features; uint32_t bits; };
+        const Variant variants[] = {
+            {".avx512", "+avx512f,+avx512vl,+avx512bw,+avx512dq,+avx2,+fma", avx512Bits},
+            {".avx2", "+avx2,+fma", avx2Bits},
+        };
+
+        for (Function* fn : kernels) {
+            std::string name = fn->getName().str();
+            PointerType* fnPtrTy = PointerType::getUnqual(fn->getFunctionType());
+            Function* resolver = Function::Create(FunctionType::get(fnPtrTy, false), GlobalValue::InternalLinkage,
+                                                  name + ".resolver", module.get());
+            GlobalIFunc* ifunc = GlobalIFunc::create(fn->getFunctionType(), 0, fn->getLinkage(), "", resolver, module.get());
+            fn->replaceAllUsesWith(ifunc);
+            fn->setName(name + ".sse2");
+            ifunc->setName(name);
+            ifunc->setVisibility(fn->getVisibility());
+            fn->setLinkage(GlobalValue::InternalLinkage);
+
+            std::vector<std::pair<Function*, uint32_t>> clones;
+            for (const Variant& var : variants) {
+                ValueToValueMapTy vmap;
+                Function* clone = CloneFunction(fn, vmap);
+                clone->setName(name + var.suffix);
+                clone->addFnAttr("target-features", var.features);
+                clones.push_back({clone, var.bits});
+            }
+
+            IRBuilder<> b(BasicBlock::Create(context, "entry", resolver));
+            b.CreateCall(cpuInit);
+            Value* featPtr = b.CreateInBoundsGEP(cpuModelTy, cpuModel, {b.getInt32(0), b.getInt32(3), b.getInt32(0)}, "cpu_features");
+            Value* feats = b.CreateLoad(i32Ty, featPtr, "feats");
+            Value* chosen = b.CreateBitCast(fn, fnPtrTy);
+            for (auto it = clones.rbegin(); it != clones.rend(); ++it) {//从低到高叠 select，最高档最后判
+                Value* has = b.CreateICmpEQ(b.CreateAnd(feats, it->second), b.getInt32(it->second), "has");
+                chosen = b.CreateSelect(has, b.CreateBitCast(it->first, fnPtrTy), chosen, "impl");
+            }
+            b.CreateRet(chosen);
+        }
+    }
+
+    // ==================== 输入运行时 ====================
+    // fd 0 上一块可增长的读缓冲（初始 64K），memchr 找换行。read_line 返回指向缓冲内部的切片，
+    // 下一次读取前有效；input() 会复制一份。
+    static const unsigned ReadBufSize = 65536;
+
+    bool isBuiltinInputCall(ASTNode* node, const char* name) {
+        if (!node || node->type != AST_CALL || !node->data.call.func ||
+            node->data.call.func->type != AST_IDENTIFIER || !node->data.call.func->data.identifier.name) {
+            return false;
+        }
+        if (strcmp(node->data.call.func->data.identifier.name, name) != 0) return false;
+        return !module->getFunction(name) && !genericFunctionTemplates.count(name);//同名用户函数优先
+    }
+
+    Function* getInputRuntimeFunction(const char* name) {
+        Type* i8PtrTy = PointerType::getUnqual(Type::getInt8Ty(context));
+        if (strcmp(name, "__vix_input") == 0) {
+            return getRuntimeFunction(name, FunctionType::get(i8PtrTy, {i8PtrTy}, false));
+        }
+        return getRuntimeFunction(name, FunctionType::get(i8PtrTy, false));
+    }
+
+    // for (line in lines()) { ... }：逐行读到 EOF，line 每轮指向读缓冲里的新一行，不复制
+    VisitResult visitLinesLoop(const std::string& varName, ASTNode* body) {
+        Function* func = getCurrentFunction();
+        Type* i8PtrTy = PointerType::getUnqual(Type::getInt8Ty(context));
+        BasicBlock* entryBB = &func->getEntryBlock();
+        IRBuilder<> tempBuilder(entryBB, entryBB->begin());
+        AllocaInst* lineAlloc = tempBuilder.CreateAlloca(i8PtrTy, nullptr, varName);
+
+        BasicBlock* condBB = BasicBlock::Create(context, "lines_cond", func);
+        BasicBlock* bodyBB = BasicBlock::Create(context, "lines_body", func);
+        BasicBlock* afterBB = BasicBlock::Create(context, "lines_cont", func);
+        builder.CreateBr(condBB);
+        builder.SetInsertPoint(condBB);
+        Value* line = builder.CreateCall(getInputRuntimeFunction("__vix_read_line"), {}, "line");
+        builder.CreateCondBr(builder.CreateIsNull(line, "lines_eof"), afterBB, bodyBB);
+
+        builder.SetInsertPoint(bodyBB);
+        scopeManager.enterScope();
+        scopeManager.defineVariable(varName, lineAlloc);
+        typeHelper.registerStringVariable(varName);
+        builder.CreateStore(line, lineAlloc);
+        invalidateStringLength(varName);
+        loopBreakTargets.push_back(afterBB);
+        loopContinueTargets.push_back(condBB);
+        visit(body);
+        loopContinueTargets.pop_back();
+        loopBreakTargets.pop_back();
+        scopeManager.exitScope();
+        if (!builder.GetInsertBlock()->getTerminator()) {
+            builder.CreateBr(condBB);
+        }
+        builder.SetInsertPoint(afterBB);
+        return VisitResult();
+    }
+
+    void emitInputRuntime() {
+        Function* lineFn = module->getFunction("__vix_read_line");
+        Function* allFn = module->getFunction("__vix_read_all");
+        Function* inputFn = module->getFunction("__vix_input");
+        if (!lineFn && !allFn && !inputFn) return;
+        lineFn = getInputRuntimeFunction("__vix_read_line");
+
+        Type* i8Ty = Type::getInt8Ty(context);
+        Type* i32Ty = Type::getInt32Ty(context);
+        Type* i64Ty = Type::getInt64Ty(context);
+        PointerType* i8PtrTy = PointerType::getUnqual(i8Ty);
+        GlobalVariable* buf = getRuntimeGlobal("__vix_in_buf", i8PtrTy, false);
+        GlobalVariable* cap = getRuntimeGlobal("__vix_in_cap", i64Ty, false);
+        GlobalVariable* pos = getRuntimeGlobal("__vix_in_pos", i64Ty, false);//未读部分的起点
+        GlobalVariable* end = getRuntimeGlobal("__vix_in_end", i64Ty, false);//有效数据的终点，end < cap，留一个字节放 '\0'
+        GlobalVariable* eof = getRuntimeGlobal("__vix_in_eof", i32Ty, false);
+        FunctionCallee readFn = module->getOrInsertFunction("read", FunctionType::get(i64Ty, {i32Ty, i8PtrTy, i64Ty}, false));
+        FunctionCallee memchrFn = module->getOrInsertFunction("memchr", FunctionType::get(i8PtrTy, {i8PtrTy, i32Ty, i64Ty}, false));
+        FunctionCallee strdupFn = module->getOrInsertFunction("strdup", FunctionType::get(i8PtrTy, {i8PtrTy}, false));
+        FunctionCallee errnoFn = getErrnoFunction();
+        Function* reallocFn = getOrCreateReallocFunction();
+        Constant* zero64 = ConstantInt::get(i64Ty, 0);
+        Constant* one64 = ConstantInt::get(i64Ty, 1);
+
+        IRBuilder<> b(context);
+        auto cutCR = [&](Value* line, Value* n) {//去掉行尾的 '\r'
+            Function* fn = b.GetInsertBlock()->getParent();
+            BasicBlock* crBB = BasicBlock::Create(context, "cr", fn);
+            BasicBlock* doneBB = BasicBlock::Create(context, "cr_done", fn);
+            BasicBlock* testBB = BasicBlock::Create(context, "cr_test", fn);
+            b.CreateCondBr(b.CreateICmpEQ(n, zero64), doneBB, testBB);
+            b.SetInsertPoint(testBB);
+            Value* last = b.CreateInBoundsGEP(i8Ty, line, b.CreateSub(n, one64));
+            b.CreateCondBr(b.CreateICmpEQ(b.CreateLoad(i8Ty, last), ConstantInt::get(i8Ty, '\r')), crBB, doneBB);
+            b.SetInsertPoint(crBB);
+            b.CreateStore(ConstantInt::get(i8Ty, 0), last);
+            b.CreateBr(doneBB);
+            b.SetInsertPoint(doneBB);
+        };
+
+        // __vix_in_fill(): 把未读部分挪到开头，缓冲满了翻倍，再 read 一次（EINTR 重读）；
+        // 读到 EOF、出错或扩容失败返回 0，扩容失败时旧缓冲保持不动
+        Function* fillFn = getRuntimeFunction("__vix_in_fill", FunctionType::get(i32Ty, false));
+        if (beginRuntimeBody(b, fillFn)) {
+            BasicBlock* shiftBB = BasicBlock::Create(context, "shift", fillFn);
+            BasicBlock* roomBB = BasicBlock::Create(context, "room", fillFn);
+            BasicBlock* growBB = BasicBlock::Create(context, "grow", fillFn);
+            BasicBlock* grownBB = BasicBlock::Create(context, "grown", fillFn);
+            BasicBlock* readBB = BasicBlock::Create(context, "read", fillFn);
+            BasicBlock* gotBB = BasicBlock::Create(context, "got", fillFn);
+            BasicBlock* failBB = BasicBlock::Create(context, "fail", fillFn);
+            BasicBlock* eofBB = BasicBlock::Create(context, "eof", fillFn);
+            Value* p = b.CreateLoad(i64Ty, pos, "pos");
+            b.CreateCondBr(b.CreateICmpNE(p, zero64), shiftBB, roomBB);
+            b.SetInsertPoint(shiftBB);
+            Value* base = b.CreateLoad(i8PtrTy, buf, "buf");
+            Value* rest = b.CreateSub(b.CreateLoad(i64Ty, end, "end"), p, "rest");
+            b.CreateMemMove(base, MaybeAlign(1), b.CreateInBoundsGEP(i8Ty, base, p), MaybeAlign(1), rest);
+            b.CreateStore(rest, end);
+            b.CreateStore(zero64, pos);
+            b.CreateBr(roomBB);
+            b.SetInsertPoint(roomBB);
+            Value* c = b.CreateLoad(i64Ty, cap, "cap");
+            Value* full = b.CreateICmpUGE(b.CreateAdd(b.CreateLoad(i64Ty, end, "end"), one64), c);
+            b.CreateCondBr(full, growBB, readBB);
+            b.SetInsertPoint(growBB);
+            Value* newCap = b.CreateSelect(b.CreateICmpEQ(c, zero64), ConstantInt::get(i64Ty, ReadBufSize),
+                                           b.CreateShl(c, one64), "new_cap");
+            Value* grown = b.CreateCall(reallocFn, {b.CreateLoad(i8PtrTy, buf, "buf"), newCap}, "grown");
+            b.CreateCondBr(b.CreateIsNull(grown), eofBB, grownBB);
+            b.SetInsertPoint(grownBB);
+            b.CreateStore(grown, buf);
+            b.CreateStore(newCap, cap);
+            b.CreateBr(readBB);
+            b.SetInsertPoint(readBB);
+            Value* e = b.CreateLoad(i64Ty, end, "end");
+            Value* room = b.CreateSub(b.CreateSub(b.CreateLoad(i64Ty, cap, "cap"), e), one64, "room");
+            Value* n = b.CreateCall(readFn, {ConstantInt::get(i32Ty, 0), b.CreateInBoundsGEP(i8Ty, b.CreateLoad(i8PtrTy, buf, "buf"), e), room}, "n");
+            b.CreateCondBr(b.CreateICmpSGT(n, zero64), gotBB, failBB);
+            b.SetInsertPoint(gotBB);
+            b.CreateStore(b.CreateAdd(e, n), end);
+            b.CreateRet(ConstantInt::get(i32Ty, 1));
+            b.SetInsertPoint(failBB);//n < 0 且 errno == EINTR（Linux/BSD 上都是 4）：被信号打断，重读
+            Value* intr = b.CreateAnd(b.CreateICmpSLT(n, zero64),
+                                      b.CreateICmpEQ(b.CreateLoad(i32Ty, b.CreateCall(errnoFn)), ConstantInt::get(i32Ty, 4)));
+            b.CreateCondBr(intr, readBB, eofBB);
+            b.SetInsertPoint(eofBB);
+            b.CreateStore(ConstantInt::get(i32Ty, 1), eof);
+            b.CreateRet(ConstantInt::get(i32Ty, 0));
+        }
+
+        // __vix_read_line(): 下一行（不含换行），EOF 返回 nil；from 是已经找过没有换行的字节数
+        if (beginRuntimeBody(b, lineFn)) {
+            BasicBlock* entryBB = b.GetInsertBlock();
+            BasicBlock* scanBB = BasicBlock::Create(context, "scan", lineFn);
+            BasicBlock* searchBB = BasicBlock::Create(context, "search", lineFn);
+            BasicBlock* missBB = BasicBlock::Create(context, "miss", lineFn);
+            BasicBlock* cutBB = BasicBlock::Create(context, "cut", lineFn);
+            BasicBlock* fillBB = BasicBlock::Create(context, "fill", lineFn);
+            BasicBlock* tailBB = BasicBlock::Create(context, "tail", lineFn);
+            BasicBlock* lastBB = BasicBlock::Create(context, "last", lineFn);
+            BasicBlock* noneBB = BasicBlock::Create(context, "none", lineFn);
+            b.CreateBr(scanBB);
+
+            b.SetInsertPoint(scanBB);
+            PHINode* from = b.CreatePHI(i64Ty, 2, "from");
+            from->addIncoming(zero64, entryBB);
+            Value* p = b.CreateLoad(i64Ty, pos, "pos");
+            Value* e = b.CreateLoad(i64Ty, end, "end");
+            Value* base = b.CreateLoad(i8PtrTy, buf, "buf");
+            Value* start = b.CreateInBoundsGEP(i8Ty, base, p, "start");
+            Value* avail = b.CreateSub(b.CreateSub(e, p), from, "avail");
+            b.CreateCondBr(b.CreateICmpSGT(avail, zero64), searchBB, missBB);
+
+            b.SetInsertPoint(searchBB);
+            Value* nl = b.CreateCall(memchrFn, {b.CreateInBoundsGEP(i8Ty, start, from), ConstantInt::get(i32Ty, '\n'), avail}, "nl");
+            b.CreateCondBr(b.CreateIsNull(nl), missBB, cutBB);
+
+            b.SetInsertPoint(cutBB);
+            Value* n = b.CreatePtrDiff(i8Ty, nl, start, "n");
+            b.CreateStore(ConstantInt::get(i8Ty, 0), nl);
+            b.CreateStore(b.CreateAdd(b.CreateAdd(p, n), one64), pos);
+            cutCR(start, n);
+            b.CreateRet(start);
+
+            b.SetInsertPoint(missBB);
+            b.CreateCondBr(b.CreateICmpNE(b.CreateLoad(i32Ty, eof, "eof"), ConstantInt::get(i32Ty, 0)), tailBB, fillBB);
+
+            b.SetInsertPoint(fillBB);
+            b.CreateCall(fillFn);
+            from->addIncoming(b.CreateSub(e, p), fillBB);
+            b.CreateBr(scanBB);
+
+            b.SetInsertPoint(tailBB);//最后一行没有换行
+            b.CreateCondBr(b.CreateICmpEQ(e, p), noneBB, lastBB);
+            b.SetInsertPoint(lastBB);
+            b.CreateStore(ConstantInt::get(i8Ty, 0), b.CreateInBoundsGEP(i8Ty, base, e));
+            b.CreateStore(e, pos);
+            cutCR(start, b.CreateSub(e, p));
+            b.CreateRet(start);
+            b.SetInsertPoint(noneBB);
+            b.CreateRet(ConstantPointerNull::get(i8PtrTy));
+        }
+
+        // __vix_read_all(): 读到 EOF，返回剩下的全部内容；缓冲从没分配成功过时返回 ""
+        if (allFn && beginRuntimeBody(b, allFn)) {
+            BasicBlock* loopBB = BasicBlock::Create(context, "loop", allFn);
+            BasicBlock* fillBB = BasicBlock::Create(context, "fill", allFn);
+            BasicBlock* doneBB = BasicBlock::Create(context, "done", allFn);
+            b.CreateBr(loopBB);
+            b.SetInsertPoint(loopBB);
+            b.CreateCondBr(b.CreateICmpNE(b.CreateLoad(i32Ty, eof, "eof"), ConstantInt::get(i32Ty, 0)), doneBB, fillBB);
+            b.SetInsertPoint(fillBB);
+            b.CreateCall(fillFn);
+            b.CreateBr(loopBB);
+            b.SetInsertPoint(doneBB);
+            BasicBlock* restBB = BasicBlock::Create(context, "rest", allFn);
+            BasicBlock* emptyBB = BasicBlock::Create(context, "empty", allFn);
+            Value* base = b.CreateLoad(i8PtrTy, buf, "buf");
+            b.CreateCondBr(b.CreateIsNull(base), emptyBB, restBB);
+            b.SetInsertPoint(restBB);
+            Value* e = b.CreateLoad(i64Ty, end, "end");
+            Value* start = b.CreateInBoundsGEP(i8Ty, base, b.CreateLoad(i64Ty, pos, "pos"), "start");
+            b.CreateStore(ConstantInt::get(i8Ty, 0), b.CreateInBoundsGEP(i8Ty, base, e));
+            b.CreateStore(e, pos);
+            b.CreateRet(start);
+            b.SetInsertPoint(emptyBB);
+            b.CreateRet(getRuntimeString("", "__vix_str_empty"));
+        }
+
+        // __vix_input(prompt): 先输出提示并刷新，读一行后复制，EOF 时返回 ""
+        if (inputFn && beginRuntimeBody(b, inputFn)) {
+            Value* prompt = inputFn->getArg(0);
+            BasicBlock* promptBB = BasicBlock::Create(context, "prompt", inputFn);
+            BasicBlock* readBB = BasicBlock::Create(context, "read", inputFn);
+            BasicBlock* copyBB = BasicBlock::Create(context, "copy", inputFn);
+            BasicBlock* emptyBB = BasicBlock::Create(context, "empty", inputFn);
+            Value* hasPrompt = b.CreateICmpNE(prompt, ConstantPointerNull::get(i8PtrTy));
+            BasicBlock* checkBB = BasicBlock::Create(context, "check", inputFn);
+            b.CreateCondBr(hasPrompt, checkBB, readBB);
+            b.SetInsertPoint(checkBB);
+            b.CreateCondBr(b.CreateICmpNE(b.CreateLoad(i8Ty, prompt), ConstantInt::get(i8Ty, 0)), promptBB, readBB);
+            b.SetInsertPoint(promptBB);
+            if (printMode == 2) {
+                initPrintf();
+                b.CreateCall(printfFunction, {getRuntimeString("%s", "__vix_fmt_s"), prompt});
+            } else {
+                FunctionCallee strlenFn = module->getOrInsertFunction("strlen", FunctionType::get(i64Ty, {i8PtrTy}, false));
+                b.CreateCall(getPrintRuntimeFunction("__vix_out_write", i8PtrTy, i64Ty), {prompt, b.CreateCall(strlenFn, {prompt})});
+                b.CreateCall(getPrintRuntimeFunction("__vix_out_sync"));
+            }
+            b.CreateBr(readBB);
+            b.SetInsertPoint(readBB);
+            Value* line = b.CreateCall(lineFn, {}, "line");
+            b.CreateCondBr(b.CreateIsNull(line), emptyBB, copyBB);
+            b.SetInsertPoint(copyBB);
+            b.CreateRet(b.CreateCall(strdupFn, {line}));
+            b.SetInsertPoint(emptyBB);
+            b.CreateRet(getRuntimeString("", "__vix_str_empty"));
+        }
+    }
+
+    // ==================== 字符串拼接 / StringBuilder ====================
+    // 两个字符串相加调用 __vix_str_concat，结果放在新 malloc 的缓冲里。
+    // StringBuilder 在堆上存 {buf, len, cap}，变量里只放指针；容量按 2 倍增长（至少 16），buf 始终以 '\0' 结尾。
+    // 循环里的 s = s + a + b 改成往一个临时 builder 追加，循环结束时才把缓冲交回 s，总复制量是线性的。
+    StructType* getStringBuilderType() {
+        if (StructType* st = StructType::getTypeByName(context, "vix.StringBuilder")) return st;
+        Type* i64Ty = Type::getInt64Ty(context);
+        return StructType::create(context, {PointerType::getUnqual(Type::getInt8Ty(context)), i64Ty, i64Ty}, "vix.StringBuilder");
+    }
+
+    Function* getStringRuntimeFunction(const std::string& name) {
+        Type* voidTy = Type::getVoidTy(context);
+        Type* i8Ty = Type::getInt8Ty(context);
+        Type* i64Ty = Type::getInt64Ty(context);
+        Type* i8PtrTy = PointerType::getUnqual(i8Ty);
+        FunctionType* fnType = nullptr;
+        if (name == "__vix_str_concat") fnType = FunctionType::get(i8PtrTy, {i8PtrTy, i8PtrTy}, false);
+        else if (name == "__vix_sb_new") fnType = FunctionType::get(i8PtrTy, {i64Ty}, false);
+        else if (name == "__vix_sb_reserve") fnType = FunctionType::get(voidTy, {i8PtrTy, i64Ty}, false);
+        else if (name == "__vix_sb_append") fnType = FunctionType::get(voidTy, {i8PtrTy, i8PtrTy}, false);
+        else if (name == "__vix_sb_append_char") fnType = FunctionType::get(voidTy, {i8PtrTy, i8Ty}, false);
+        else if (name == "__vix_sb_append_i64") fnType = FunctionType::get(voidTy, {i8PtrTy, i64Ty}, false);
+        else if (name == "__vix_sb_append_f64") fnType = FunctionType::get(voidTy, {i8PtrTy, Type::getDoubleTy(context)}, false);
+        else if (name == "__vix_sb_clear") fnType = FunctionType::get(voidTy, {i8PtrTy}, false);
+        else fnType = FunctionType::get(i8PtrTy, {i8PtrTy}, false);//__vix_sb_to_string / __vix_sb_finish
+        return getRuntimeFunction(name.c_str(), fnType);
+    }
+
+    void emitStringRuntime() {
+        static const char* const names[] = {
+            "__vix_str_concat", "__vix_sb_new", "__vix_sb_reserve", "__vix_sb_append", "__vix_sb_append_char",
+            "__vix_sb_append_i64", "__vix_sb_append_f64", "__vix_sb_clear", "__vix_sb_to_string", "__vix_sb_finish"
+        };
+        bool used = false;
+        for (const char* n : names) used = used || module->getFunction(n);
+        if (!used) return;
+        for (const char* n : {"__vix_sb_append", "__vix_sb_append_char", "__vix_sb_append_i64", "__vix_sb_append_f64"}) {
+            if (module->getFunction(n)) getStringRuntimeFunction("__vix_sb_reserve");//追加前都要先扩容
+        }
+
+        Type* i8Ty = Type::getInt8Ty(context);
+        Type* i32Ty = Type::getInt32Ty(context);
+        Type* i64Ty = Type::getInt64Ty(context);
+        PointerType* i8PtrTy = PointerType::getUnqual(i8Ty);
+        StructType* sbTy = getStringBuilderType();
+        PointerType* sbPtrTy = PointerType::getUnqual(sbTy);
+        FunctionCallee mallocFn = module->getOrInsertFunction("malloc", FunctionType::get(i8PtrTy, {i64Ty}, false));
+        FunctionCallee freeFn = module->getOrInsertFunction("free", FunctionType::get(Type::getVoidTy(context), {i8PtrTy}, false));
+        FunctionCallee snprintfFn = module->getOrInsertFunction("snprintf", FunctionType::get(i32Ty, {i8PtrTy, i64Ty, i8PtrTy}, true));
+        Function* reallocFn = getOrCreateReallocFunction();
+        initStrlen();
+        Constant* zero64 = ConstantInt::get(i64Ty, 0);
+        Constant* one64 = ConstantInt::get(i64Ty, 1);
+        Constant* nul = ConstantInt::get(i8Ty, 0);
+        Constant* empty = getRuntimeString("", "__vix_str_empty");
+
+        IRBuilder<> b(context);
+        Function* fn = nullptr;
+        auto field = [&](Value* sb, unsigned idx) { return b.CreateStructGEP(sbTy, sb, idx); };
+        auto begin = [&](const char* name) -> Value* {//只生成用到的函数，返回转换好的 builder 指针（第一个参数）
+            fn = module->getFunction(name);
+            if (!fn || !beginRuntimeBody(b, fn)) return nullptr;
+            return b.CreateBitCast(fn->getArg(0), sbPtrTy, "sb");
+        };
+
+        // __vix_str_concat(a, b): nil 当成空串
+        fn = module->getFunction("__vix_str_concat");
+        if (fn && beginRuntimeBody(b, fn)) {
+            Value* l = b.CreateSelect(b.CreateIsNull(fn->getArg(0)), empty, fn->getArg(0), "l");
+            Value* r = b.CreateSelect(b.CreateIsNull(fn->getArg(1)), empty, fn->getArg(1), "r");
+            Value* ln = b.CreateCall(strlenFunction, {l}, "ln");
+            Value* rn = b.CreateCall(strlenFunction, {r}, "rn");
+            Value* out = b.CreateCall(mallocFn, {b.CreateAdd(b.CreateAdd(ln, rn), one64)}, "out");
+            b.CreateMemCpy(out, MaybeAlign(1), l, MaybeAlign(1), ln);
+            b.CreateMemCpy(b.CreateInBoundsGEP(i8Ty, out, ln), MaybeAlign(1), r, MaybeAlign(1), b.CreateAdd(rn, one64));
+            b.CreateRet(out);
+        }
+
+        // __vix_sb_new(n): 至少能放 n 个字节，不小于 16
+        fn = module->getFunction("__vix_sb_new");
+        if (fn && beginRuntimeBody(b, fn)) {
+            Value* want = b.CreateAdd(fn->getArg(0), one64);
+            Value* cap = b.CreateSelect(b.CreateICmpSGT(want, ConstantInt::get(i64Ty, 16)), want, ConstantInt::get(i64Ty, 16), "cap");
+            Value* sb = b.CreateBitCast(b.CreateCall(mallocFn, {ConstantInt::get(i64Ty, 24)}), sbPtrTy, "sb");
+            Value* buf = b.CreateCall(mallocFn, {cap}, "buf");
+            b.CreateStore(nul, buf);
+            b.CreateStore(buf, field(sb, 0));
+            b.CreateStore(zero64, field(sb, 1));
+            b.CreateStore(cap, field(sb, 2));
+            b.CreateRet(b.CreateBitCast(sb, i8PtrTy));
+        }
+
+        // __vix_sb_reserve(sb, extra): 保证还能再放 extra 个字节和结尾的 '\0'，不够时翻倍
+        Function* reserveFn = module->getFunction("__vix_sb_reserve");
+        if (Value* sb = begin("__vix_sb_reserve")) {
+            BasicBlock* growBB = BasicBlock::Create(context, "grow", fn);
+            BasicBlock* doneBB = BasicBlock::Create(context, "done", fn);
+            Value* need = b.CreateAdd(b.CreateAdd(b.CreateLoad(i64Ty, field(sb, 1), "len"), fn->getArg(1)), one64, "need");
+            Value* cap = b.CreateLoad(i64Ty, field(sb, 2), "cap");
+            b.CreateCondBr(b.CreateICmpUGT(need, cap), growBB, doneBB);
+            b.SetInsertPoint(growBB);
+            Value* dbl = b.CreateShl(cap, one64, "cap_x2");
+            Value* newCap = b.CreateSelect(b.CreateICmpUGT(dbl, need), dbl, need, "new_cap");
+            b.CreateStore(b.CreateCall(reallocFn, {b.CreateLoad(i8PtrTy, field(sb, 0), "buf"), newCap}), field(sb, 0));
+            b.CreateStore(newCap, field(sb, 2));
+            b.CreateBr(doneBB);
+            b.SetInsertPoint(doneBB);
+            b.CreateRetVoid();
+        }
+
+        // __vix_sb_append(sb, s): nil 不追加
+        if (Value* sb = begin("__vix_sb_append")) {
+            BasicBlock* copyBB = BasicBlock::Create(context, "copy", fn);
+            BasicBlock* doneBB = BasicBlock::Create(context, "done", fn);
+            Value* s = fn->getArg(1);
+            b.CreateCondBr(b.CreateIsNull(s), doneBB, copyBB);
+            b.SetInsertPoint(copyBB);
+            Value* n = b.CreateCall(strlenFunction, {s}, "n");
+            b.CreateCall(reserveFn, {fn->getArg(0), n});
+            Value* len = b.CreateLoad(i64Ty, field(sb, 1), "len");
+            Value* dst = b.CreateInBoundsGEP(i8Ty, b.CreateLoad(i8PtrTy, field(sb, 0), "buf"), len, "dst");
+            b.CreateMemCpy(dst, MaybeAlign(1), s, MaybeAlign(1), b.CreateAdd(n, one64));
+            b.CreateStore(b.CreateAdd(len, n), field(sb, 1));
+            b.CreateBr(doneBB);
+            b.SetInsertPoint(doneBB);
+            b.CreateRetVoid();
+        }
+
+        if (Value* sb = begin("__vix_sb_append_char")) {
+            b.CreateCall(reserveFn, {fn->getArg(0), one64});
+            Value* len = b.CreateLoad(i64Ty, field(sb, 1), "len");
+            Value* dst = b.CreateInBoundsGEP(i8Ty, b.CreateLoad(i8PtrTy, field(sb, 0), "buf"), len, "dst");
+            b.CreateStore(fn->getArg(1), dst);
+            b.CreateStore(nul, b.CreateInBoundsGEP(i8Ty, dst, one64));
+            b.CreateStore(b.CreateAdd(len, one64), field(sb, 1));
+            b.CreateRetVoid();
+        }
+
+        // 数字直接 snprintf 进缓冲尾部，格式和 print 一样 (%lld / %f)；放不下时按返回的长度扩容再写一次
+        auto emitAppendFormatted = [&](const char* name, const char* fmt, const char* fmtName, unsigned guess) {
+            Value* sb = begin(name);
+            if (!sb) return;
+            BasicBlock* retryBB = BasicBlock::Create(context, "retry", fn);
+            BasicBlock* doneBB = BasicBlock::Create(context, "done", fn);
+            Constant* fmtStr = getRuntimeString(fmt, fmtName);
+            auto write = [&]() {//返回 (写入长度, 可用空间)
+                Value* len = b.CreateLoad(i64Ty, field(sb, 1), "len");
+                Value* room = b.CreateSub(b.CreateLoad(i64Ty, field(sb, 2), "cap"), len, "room");
+                Value* dst = b.CreateInBoundsGEP(i8Ty, b.CreateLoad(i8PtrTy, field(sb, 0), "buf"), len, "dst");
+                Value* n = b.CreateCall(snprintfFn, {dst, room, fmtStr, fn->getArg(1)}, "n");
+                Value* n64 = b.CreateSExt(b.CreateSelect(b.CreateICmpSLT(n, ConstantInt::get(i32Ty, 0)), ConstantInt::get(i32Ty, 0), n), i64Ty);
+                return std::make_pair(n64, room);
+            };
+            b.CreateCall(reserveFn, {fn->getArg(0), ConstantInt::get(i64Ty, guess)});
+            auto first = write();
+            b.CreateCondBr(b.CreateICmpUGE(first.first, first.second), retryBB, doneBB);
+            b.SetInsertPoint(retryBB);
+            b.CreateCall(reserveFn, {fn->getArg(0), first.first});
+            write();
+            b.CreateBr(doneBB);
+            b.SetInsertPoint(doneBB);
+            b.CreateStore(b.CreateAdd(b.CreateLoad(i64Ty, field(sb, 1), "len"), first.first), field(sb, 1));
+            b.CreateRetVoid();
+        };
+        emitAppendFormatted("__vix_sb_append_i64", "%lld", "__vix_fmt_lld", 24);
+        emitAppendFormatted("__vix_sb_append_f64", "%f", "__vix_fmt_f", 32);
+
+        if (Value* sb = begin("__vix_sb_clear")) {
+            b.CreateStore(zero64, field(sb, 1));
+            b.CreateStore(nul, b.CreateLoad(i8PtrTy, field(sb, 0), "buf"));
+            b.CreateRetVoid();
+        }
+
+        // __vix_sb_to_string(sb): 复制一份，builder 还能继续用
+        if (Value* sb = begin("__vix_sb_to_string")) {
+            Value* n = b.CreateAdd(b.CreateLoad(i64Ty, field(sb, 1), "len"), one64, "n");
+            Value* out = b.CreateCall(mallocFn, {n}, "out");
+            b.CreateMemCpy(out, MaybeAlign(1), b.CreateLoad(i8PtrTy, field(sb, 0), "buf"), MaybeAlign(1), n);
+            b.CreateRet(out);
+        }
+
+        // __vix_sb_finish(sb): 把缓冲直接交出去并释放 builder，只用于循环改写
+        if (Value* sb = begin("__vix_sb_finish")) {
+            Value* buf = b.CreateLoad(i8PtrTy, field(sb, 0), "buf");
+            b.CreateCall(freeFn, {fn->getArg(0)});
+            b.CreateRet(buf);
+        }
+    }
+
+    bool isStringBuilderExpr(ASTNode* node) {
+        if (node && node->type == AST_IDENTIFIER && node->data.identifier.name) {
+            return typeHelper.isStringBuilder(node->data.identifier.name);
+        }
+        return node && node->type == AST_CALL && node->data.call.func && isIdentNamed(node->data.call.func, "StringBuilder") &&
+               !module->getFunction("StringBuilder");
+    }
+
+    //按值的类型追加：字符串原样，char 一个字节，整数 / 浮点按 print 的格式转成文本
+    void emitBuilderAppend(Value* sb, ASTNode* part) {
+        VisitResult res = visit(part);
+        if (!res.value) return;
+        Value* v = res.value;
+        Type* t = v->getType();
+        Type* i8PtrTy = PointerType::getUnqual(Type::getInt8Ty(context));
+        if (t->isPointerTy()) {
+            if (t != i8PtrTy) v = builder.CreateBitCast(v, i8PtrTy, "sb_arg_cast");
+            builder.CreateCall(getStringRuntimeFunction("__vix_sb_append"), {sb, v});
+        } else if (t->isIntegerTy(8)) {
+            builder.CreateCall(getStringRuntimeFunction("__vix_sb_append_char"), {sb, v});
+        } else if (t->isIntegerTy()) {
+            v = t->isIntegerTy(1) ? builder.CreateZExt(v, Type::getInt64Ty(context)) : builder.CreateSExtOrTrunc(v, Type::getInt64Ty(context));
+            builder.CreateCall(getStringRuntimeFunction("__vix_sb_append_i64"), {sb, v});
+        } else if (t->isFloatingPointTy()) {
+            builder.CreateCall(getStringRuntimeFunction("__vix_sb_append_f64"), {sb, builder.CreateFPExt(v, Type::getDoubleTy(context))});
+        } else {
+            reportCodegenSemanticError(part, "StringBuilder cannot append this value");
+        }
+    }
+
+    VisitResult visitStringBuilderMethod(ASTNode* objectNode, const std::string& methodName, ASTNode* node) {
+        int argCount = (node->data.call.args && node->data.call.args->type == AST_EXPRESSION_LIST) ?
+            node->data.call.args->data.expression_list.expression_count : 0;
+        bool takesArg = methodName != "to_string" && methodName != "clear";
+        if (argCount != (takesArg ? 1 : 0)) {
+            reportCodegenSemanticError(node, "StringBuilder." + methodName + " expects " + (takesArg ? "one argument" : "no arguments"));
+            return VisitResult();
+        }
+        VisitResult sbRes = visit(objectNode);
+        if (!sbRes.value || !sbRes.value->getType()->isPointerTy()) return VisitResult();
+        Value* sb = sbRes.value;
+        ASTNode* arg = takesArg ? node->data.call.args->data.expression_list.expressions[0] : nullptr;
+
+        if (methodName == "append") {
+            emitBuilderAppend(sb, arg);
+            return VisitResult();
+        }
+        if (methodName == "append_int" || methodName == "append_float" || methodName == "append_char" || methodName == "reserve") {
+            VisitResult argRes = visit(arg);
+            if (!argRes.value) return VisitResult();
+            if (methodName == "append_float") {
+                Value* v = typeHelper.castValue(builder, argRes.value, argRes.type, ValueType::FLOAT64);
+                builder.CreateCall(getStringRuntimeFunction("__vix_sb_append_f64"), {sb, v});
+            } else if (methodName == "append_char") {
+                Value* v = typeHelper.castValue(builder, argRes.value, argRes.type, ValueType::INT8);
+                builder.CreateCall(getStringRuntimeFunction("__vix_sb_append_char"), {sb, v});
+            } else {
+                Value* v = typeHelper.castValue(builder, argRes.value, argRes.type, ValueType::INT64);
+                builder.CreateCall(getStringRuntimeFunction(methodName == "reserve" ? "__vix_sb_reserve" : "__vix_sb_append_i64"), {sb, v});
+            }
+            return VisitResult();
+        }
+        if (methodName == "clear") {
+            builder.CreateCall(getStringRuntimeFunction("__vix_sb_clear"), {sb});
+            return VisitResult();
+        }
+        if (methodName == "to_string") {
+            return VisitResult(builder.CreateCall(getStringRuntimeFunction("__vix_sb_to_string"), {sb}, "sb_str"), ValueType::STRING);
+        }
+        reportCodegenSemanticError(node, "StringBuilder has no method '" + methodName + "'");
+        return VisitResult();
+    }
+
+    Value* loadBuilderLength(Value* sb) {
+        StructType* sbTy = getStringBuilderType();
+        Value* p = builder.CreateBitCast(sb, PointerType::getUnqual(sbTy), "sb_ptr");
+        return builder.CreateLoad(Type::getInt64Ty(context), builder.CreateStructGEP(sbTy, p, 1), "sb_len");
+    }
+
+    bool isStringOperand(ASTNode* node) {//变量要登记过是字符串，列表 / 指针变量相加仍然报错
+        if (node && node->type == AST_IDENTIFIER && node->data.identifier.name) {
+            return typeHelper.isStringVariable(node->data.identifier.name) && !typeHelper.isStringBuilder(node->data.identifier.name);
+        }
+        return true;
+    }
+
+    // ---- 循环里的 s = s + ... ----
+    static void flattenConcat(ASTNode* node, std::vector<ASTNode*>& parts) {
+        if (node && node->type == AST_BINOP && (node->data.binop.op == OP_ADD || node->data.binop.op == OP_CONCAT)) {
+            flattenConcat(node->data.binop.left, parts);
+            flattenConcat(node->data.binop.right, parts);
+        } else {
+            parts.push_back(node);
+        }
+    }
+
+    //静态确定是字符串的表达式；拿不准的 (char、指针算术) 都不算，s + 1 仍然是指针运算
+    bool isStaticStringExpr(ASTNode* node, const std::set<std::string>& locals) {
+        if (!node) return false;
+        Type* i8PtrTy = PointerType::getUnqual(Type::getInt8Ty(context));
+        switch (node->type) {
+            case AST_STRING:
+            case AST_INPUT:
+                return true;
+            case AST_IDENTIFIER: {
+                std::string name(node->data.identifier.name ? node->data.identifier.name : "");
+                if (locals.count(name)) return true;
+                AllocaInst* alloc = scopeManager.findVariable(name);
+                return alloc && alloc->getAllocatedType()->isPointerTy() && typeHelper.isStringVariable(name) &&
+                       !typeHelper.isStringBuilder(name);
+            }
+            case AST_BINOP:
+                return (node->data.binop.op == OP_ADD || node->data.binop.op == OP_CONCAT) &&
+                       isStaticStringExpr(node->data.binop.left, locals) && isStaticStringExpr(node->data.binop.right, locals);
+            case AST_INDEX: {
+                ASTNode* target = node->data.index.target;
+                if (!target || target->type != AST_IDENTIFIER || !target->data.identifier.name) return false;
+                auto* info = typeHelper.getArrayTypeInfo(target->data.identifier.name);
+                return info && info->first == i8PtrTy;//字符串列表
+            }
+            case AST_CALL: {
+                ASTNode* f = node->data.call.func;
+                if (isBuiltinInputCall(node, "read_line") || isBuiltinInputCall(node, "read_all")) return true;
+                if (f && f->type == AST_MEMBER_ACCESS) {
+                    return isIdentNamed(f->data.member_access.field, "to_string") && isStringBuilderExpr(f->data.member_access.object);
+                }
+                if (f && f->type == AST_IDENTIFIER && f->data.identifier.name) {
+                    Function* callee = module->getFunction(f->data.identifier.name);
+                    return callee && !callee->isVarArg() && callee->getReturnType() == i8PtrTy &&
+                           !externCFunctions.count(f->data.identifier.name);
+                }
+                return false;
+            }
+            default:
+                return false;
+        }
+    }
+
+    //s 在 node 里出现的次数；遇到不认识的节点、遮住 s 的 for / match 返回 false
+    static bool countNameUses(ASTNode* node, const std::string& name, int& count) {
+        if (!node) return true;
+        if (isIdentNamed(node, name)) {
+            count++;
+            return true;
+        }
+        if (node->type == AST_FOR && isIdentNamed(node->data.for_stmt.var, name)) return false;
+        if (node->type == AST_MATCH) {
+            ASTNode* arms = node->data.match_stmt.arms;
+            for (int i = 0; arms && i < arms->data.expression_list.expression_count; i++) {
+                ASTNode* arm = arms->data.expression_list.expressions[i];
+                if (arm && arm->type == AST_ASSIGN && mentionsName(arm->data.assign.left, name)) return false;
+            }
+        }
+        bool ok = true;
+        bool unknown = anyChild(node, [&](ASTNode* c) {
+            ok = ok && countNameUses(c, name, count);
+            return !ok;
+        }, true);
+        return ok && !unknown;
+    }
+
+    static void collectAssigns(ASTNode* node, std::vector<ASTNode*>& out) {
+        if (!node) return;
+        if (node->type == AST_ASSIGN) out.push_back(node);
+        anyChild(node, [&](ASTNode* c) { collectAssigns(c, out); return false; }, false);
+    }
+
+    struct LoopAppend {
+        std::string name;
+        AllocaInst* alloc;
+        Value* sb;
+    };
+
+    //循环开始前：找出循环里只以 s = s + 字符串... 形式出现的局部字符串变量，为每个建一个 builder 并放进 s 的当前值
+    std::vector<LoopAppend> beginLoopAppends(ASTNode* loop) {
+        std::vector<LoopAppend> result;
+        Function* func = getCurrentFunction();
+        if (!func || !builder.GetInsertBlock() || builder.GetInsertBlock()->getTerminator()) return result;
+        ASTNode* body = loop->type == AST_WHILE ? loop->data.while_stmt.body : loop->data.for_stmt.body;
+        std::vector<ASTNode*> assigns;
+        collectAssigns(body, assigns);
+
+        std::set<std::string> locals;//循环体里声明的字符串变量
+        for (int round = 0; round < 2; round++) {
+            for (ASTNode* a : assigns) {
+                if (a->data.assign.is_declaration == 1 && a->data.assign.left && a->data.assign.left->type == AST_IDENTIFIER &&
+                    isStaticStringExpr(a->data.assign.right, locals)) {
+                    locals.insert(a->data.assign.left->data.identifier.name);
+                }
+            }
+        }
+
+        std::set<std::string> tried;
+        for (ASTNode* a : assigns) {
+            ASTNode* left = a->data.assign.left;
+            if (!left || left->type != AST_IDENTIFIER || !left->data.identifier.name) continue;
+            std::string name(left->data.identifier.name);
+            if (!tried.insert(name).second || loopAppendNames.count(name) || locals.count(name)) continue;
+            if (loop->type == AST_FOR && isIdentNamed(loop->data.for_stmt.var, name)) continue;
+            AllocaInst* alloc = scopeManager.findVariable(name);
+            if (!alloc || alloc->getFunction() != func || !alloc->getAllocatedType()->isPointerTy() ||
+                !typeHelper.isStringVariable(name) || typeHelper.isStringBuilder(name)) continue;
+
+            std::vector<ASTNode*> appends;
+            bool ok = true;
+            for (ASTNode* b : assigns) {
+                if (!isIdentNamed(b->data.assign.left, name)) continue;
+                std::vector<ASTNode*> parts;
+                flattenConcat(b->data.assign.right, parts);
+                ok = b->data.assign.is_declaration == 0 && parts.size() >= 2 && isIdentNamed(parts[0], name);
+                for (size_t i = 1; ok && i < parts.size(); i++) {
+                    int uses = 0;
+                    ok = isStaticStringExpr(parts[i], locals) && countNameUses(parts[i], name, uses) && uses == 0;
+                }
+                if (!ok) break;
+                appends.push_back(b);
+            }
+            int uses = 0;
+            ok = ok && countNameUses(body, name, uses);
+            if (loop->type == AST_WHILE) {
+                ok = ok && countNameUses(loop->data.while_stmt.condition, name, uses);
+            } else {
+                ok = ok && countNameUses(loop->data.for_stmt.start, name, uses) && countNameUses(loop->data.for_stmt.end, name, uses);
+            }
+            if (!ok || uses != 2 * (int)appends.size()) continue;//s 在别处被读了，保持原样
+
+            Value* cur = builder.CreateLoad(alloc->getAllocatedType(), alloc, name + "_before");
+            Value* sb = builder.CreateCall(getStringRuntimeFunction("__vix_sb_new"), {ConstantInt::get(Type::getInt64Ty(context), 0)}, name + "_sb");
+            builder.CreateCall(getStringRuntimeFunction("__vix_sb_append"), {sb, cur});
+            for (ASTNode* b : appends) loopAppendBuilders[b] = sb;
+            loopAppendNames.insert(name);
+            result.push_back({name, alloc, sb});
+        }
+        return result;
+    }
+
+    //循环结束 (所有出口都汇到当前插入点)：缓冲交回 s，长度已知
+    void endLoopAppends(const std::vector<LoopAppend>& appends) {
+        for (const LoopAppend& la : appends) {
+            loopAppendNames.erase(la.name);
+            for (auto it = loopAppendBuilders.begin(); it != loopAppendBuilders.end();) {
+                it = it->second == la.sb ? loopAppendBuilders.erase(it) : std::next(it);
+            }
+            BasicBlock* cur = builder.GetInsertBlock();
+            if (!cur || cur->getTerminator()) continue;
+            Value* len = loadBuilderLength(la.sb);
+            Value* s = builder.CreateCall(getStringRuntimeFunction("__vix_sb_finish"), {la.sb}, la.name + "_built");
+            builder.CreateStore(s, la.alloc);
+            if (AllocaInst* slot = findStringLengthSlot(la.name)) {
+                builder.CreateStore(len, slot);
+            }
+        }
+    }
+
+    VisitResult emitLoopAppend(ASTNode* node, Value* sb) {
+        std::vector<ASTNode*> parts;
+        flattenConcat(node->data.assign.right, parts);
+        for (size_t i = 1; i < parts.size(); i++) {
+            emitBuilderAppend(sb, parts[i]);
+        }
+        return VisitResult();
+    }
+
+    VisitResult visitLoop(ASTNode* node) {
+        std::vector<LoopAppend> appends = beginLoopAppends(node);
+        VisitResult res = node->type == AST_WHILE ? visitWhile(node) : visitFor(node);
+        endLoopAppends(appends);
+        return res;
+    }
+
     VisitResult emitFunctionPointerCall(Value* rawCalleePtr, ASTNode* argsNode) {
         if (!rawCalleePtr || !rawCalleePtr->getType()->isPointerTy()) return VisitResult();
 
@@ -1158,20 +3167,34 @@ public:
         strlenFunction = nullptr;
         isGlobalScope = true;
         mainFunctionCreated = false;
+        libraryModule = false;
+        printMode = g_vix_print_mode;
+        boundsCheck = g_vix_bounds_check != 0;
+        if (Triple.find("windows") != std::string::npos || Triple.find("win32") != std::string::npos) {
+            printMode = 2;
+        }
         sourceAttrs = parseSourceAttributes(current_input_filename);
         initTarget();
     }
     
+    void setLibraryModule(bool value) {
+        libraryModule = value;
+    }
+
     std::unique_ptr<Module> generate(ASTNode* ast_root) {
         if (!ast_root) return nullptr;
         
         initPrintf();
         initStrlen();
         visit(ast_root);
+        emitInputRuntime();
+        emitStringRuntime();
+        emitBoundsRuntime();
+        emitPrintRuntime();
         
         bool hasMain = module->getFunction("main") != nullptr;
         
-        if (!hasMain && !mainFunctionCreated && !sourceAttrs.noMain) {
+        if (!hasMain && !mainFunctionCreated && !sourceAttrs.noMain && !libraryModule) {
             createDefaultMain();
         }
         Function* mainFunc = module->getFunction("main");
@@ -1200,6 +3223,7 @@ public:
                 tmpBuilder.CreateRet(ConstantInt::get(Type::getInt32Ty(context), 0));
             }
         }
+        emitVectorDispatch();
         std::string error;
         raw_string_ostream errorStream(error);
         if (verifyModule(*module, &errorStream)) {
@@ -1219,6 +3243,7 @@ public:
         printfFunction = Function::Create(
             printfType, Function::ExternalLinkage, "printf", module.get());
         printfFunction->setCallingConv(CallingConv::C);
+        externCFunctions.insert("printf");
     }
     
     void createDefaultMain() {
@@ -1260,12 +3285,17 @@ public:
             case AST_ASSIGN:       return visitAssign(node);
             case AST_PROGRAM:      return visitProgram(node);
             case AST_IF:           return visitIf(node);
-            case AST_WHILE:        return visitWhile(node);
-            case AST_FOR:          return visitFor(node);
+            case AST_WHILE:        return visitLoop(node);
+            case AST_MATCH:        return visitMatch(node);
+            case AST_FOR:          return visitLoop(node);
             case AST_BREAK:        return visitBreak(node);
             case AST_CONTINUE:     return visitContinue(node);
             case AST_FUNCTION:     return visitFunction(node);
-            case AST_CALL:         return visitCall(node);
+            case AST_CALL: {
+                VisitResult res = visitCall(node);
+                invalidateStringArgs(node);
+                return res;
+            }
             case AST_RETURN:       return visitReturn(node);
             case AST_PRINT:        return visitPrint(node);
             case AST_INPUT:        return visitInput(node);
@@ -1409,6 +3439,9 @@ public:
         if (!leftRes.value || !rightRes.value) {
             return VisitResult(ConstantInt::get(Type::getInt32Ty(context), 0), ValueType::INT32);
         }
+        if (leftRes.value->getType()->isVectorTy() || rightRes.value->getType()->isVectorTy()) {
+            return visitVectorBinOp(node, leftRes, rightRes);
+        }
         
         // 检查操作数类型并确保它们兼容
         // 特别处理 i8 类型的比较操作
@@ -1499,6 +3532,15 @@ public:
             }
         }
 
+        if ((node->data.binop.op == OP_ADD || node->data.binop.op == OP_CONCAT) &&
+            leftRes.type == ValueType::STRING && rightRes.type == ValueType::STRING &&
+            isStringOperand(node->data.binop.left) && isStringOperand(node->data.binop.right)) {//a + b：新缓冲里的拼接结果
+            Type* i8PtrTy = PointerType::getUnqual(Type::getInt8Ty(context));
+            Value* l = builder.CreateBitCast(leftRes.value, i8PtrTy);
+            Value* r = builder.CreateBitCast(rightRes.value, i8PtrTy);
+            return VisitResult(builder.CreateCall(getStringRuntimeFunction("__vix_str_concat"), {l, r}, "concat"), ValueType::STRING);
+        }
+
         bool isCompareOp = (node->data.binop.op == OP_EQ || node->data.binop.op == OP_NE ||
                             node->data.binop.op == OP_LT || node->data.binop.op == OP_LE ||
                             node->data.binop.op == OP_GT || node->data.binop.op == OP_GE);
@@ -1771,7 +3813,7 @@ public:
 
         switch (node->data.unaryop.op) {
             case OP_MINUS:
-                if (operand.type == ValueType::FLOAT32 || operand.type == ValueType::FLOAT64)
+                if (operand.value->getType()->isFPOrFPVectorTy())
                     return VisitResult(builder.CreateFNeg(operand.value, "negtmp"), operand.type);
                 else
                     return VisitResult(builder.CreateNeg(operand.value, "negtmp"), operand.type);
@@ -1832,7 +3874,12 @@ public:
         }
 
         if (node->data.assign.left->type == AST_INDEX) {
-            return visitIndexAssign(node);
+            VisitResult res = visitIndexAssign(node);
+            ASTNode* target = node->data.assign.left->data.index.target;
+            if (target && target->type == AST_IDENTIFIER && target->data.identifier.name) {
+                invalidateStringLength(target->data.identifier.name);
+            }
+            return res;
         }
 
         if (node->data.assign.left->type == AST_UNARYOP &&
@@ -1890,6 +3937,11 @@ public:
         if (node->data.assign.left->type != AST_IDENTIFIER)
             return VisitResult();
         
+        auto appendIt = loopAppendBuilders.find(node);
+        if (appendIt != loopAppendBuilders.end()) {
+            return emitLoopAppend(node, appendIt->second);
+        }
+
         std::string name(node->data.assign.left->data.identifier.name);
         VisitResult rightVal = visit(node->data.assign.right);
         if (!rightVal.value) return VisitResult();
@@ -2061,6 +4113,16 @@ public:
                 typeHelper.registerVariableArraySize(name, strlen_val);
                 typeHelper.registerStringVariable(name);
             }
+            if (node->data.assign.right->type == AST_IDENTIFIER && node->data.assign.right->data.identifier.name &&
+                varType->isPointerTy() && typeHelper.isStringVariable(node->data.assign.right->data.identifier.name)) {
+                typeHelper.registerStringVariable(name);//let u = s：u 也是字符串，长度槽跟着拷贝
+            }
+            if (rightVal.type == ValueType::STRING && varType->isPointerTy()) {
+                typeHelper.registerStringVariable(name);//input() / read_line() 等返回 string 的表达式
+            }
+            if (isStringBuilderExpr(node->data.assign.right)) {
+                typeHelper.registerStringBuilder(name);
+            }
 
             if (node->data.assign.right->type == AST_EXPRESSION_LIST) {
                 int arraySize = node->data.assign.right->data.expression_list.expression_count;
@@ -2102,12 +4164,28 @@ public:
         }
         
         Type* allocatedType = getActualType(alloc);
+        if ((allocatedType && allocatedType->isVectorTy()) || rightVal.value->getType()->isVectorTy()) {//v = 0.0 广播
+            FixedVectorType* vt = dyn_cast_or_null<FixedVectorType>(allocatedType);
+            Value* v = vt ? toVectorOperand(rightVal, vt) : nullptr;
+            if (!v) {
+                reportCodegenSemanticError(node, "cannot assign a vector to '" + name + "' of a different type");
+                return VisitResult();
+            }
+            builder.CreateStore(v, alloc);
+            return VisitResult(v, ValueType::VECTOR);
+        }
         ValueType varType = typeHelper.getValueTypeFromType(allocatedType);
         Value* val = typeHelper.castValue(builder, rightVal.value, rightVal.type, varType);
         if (inferredPointerElementType) {
             typeHelper.registerArrayType(name, inferredPointerElementType, -1);
         }
         builder.CreateStore(val, alloc);
+        if (allocatedType && allocatedType->isPointerTy() && typeHelper.isStringVariable(name)) {
+            updateStringLength(name, node->data.assign.right);
+        }
+        if (allocatedType && allocatedType->isPointerTy()) {
+            resetListSlotsOnBind(name, node->data.assign.right, rightVal);
+        }
         return VisitResult(val, varType);
     }
     
@@ -2115,13 +4193,27 @@ public:
         ASTNode* indexNode = node->data.assign.left;
         ASTNode* target = indexNode->data.index.target;
         ASTNode* idxExpr = indexNode->data.index.index;
+        if (FixedVectorType* vt = target->type == AST_IDENTIFIER ? vectorTypeOf(target) : nullptr) {//v[k] = x
+            AllocaInst* vecAlloc = scopeManager.findVariable(target->data.identifier.name);
+            if (!vecAlloc) vecAlloc = findVariableInMain(target->data.identifier.name);
+            Value* lane = emitVectorLaneIndex(idxExpr, vt, node);
+            VisitResult rightVal = lane ? visit(node->data.assign.right) : VisitResult();
+            if (!rightVal.value) return VisitResult();
+            ValueType elemVT = typeHelper.getValueTypeFromType(vt->getElementType());
+            Value* elem = typeHelper.castValue(builder, rightVal.value, rightVal.type, elemVT);
+            if (elem->getType() != vt->getElementType()) {
+                reportCodegenSemanticError(node, "vector lanes must be numbers");
+                return VisitResult();
+            }
+            Value* v = builder.CreateLoad(vt, vecAlloc, target->data.identifier.name);
+            builder.CreateStore(builder.CreateInsertElement(v, elem, lane, "vset"), vecAlloc);
+            return VisitResult(elem, elemVT);
+        }
 
         VisitResult idxRes = visit(idxExpr);
         if (!idxRes.value) return VisitResult();
         Value* idxVal = idxRes.value;
-        if (!idxVal->getType()->isIntegerTy(32)) {
-            idxVal = builder.CreateIntCast(idxVal, Type::getInt32Ty(context), true, "idxcast");
-        }
+        idxVal = castToSize(idxVal, "idxcast");
 
         AllocaInst* baseAlloc = nullptr;
         std::string varName;
@@ -2136,8 +4228,9 @@ public:
             if (allocatedType && allocatedType->isArrayTy()) {
                 ArrayType* at = cast<ArrayType>(allocatedType);
                 Type* elemType = at->getElementType();
+                emitIndexCheck(idxVal, varName, allocatedType, idxExpr, node);
                 Value* gep = builder.CreateInBoundsGEP(allocatedType, baseAlloc, 
-                    {ConstantInt::get(Type::getInt32Ty(context),0), idxVal}, "arr_index_ptr");
+                    {ConstantInt::get(getSizeType(), 0), idxVal}, "arr_index_ptr");
 
                 VisitResult rightVal = visit(node->data.assign.right);
                 if (!rightVal.value) return VisitResult();
@@ -2154,6 +4247,7 @@ public:
                     elemType = PointerType::getUnqual(Type::getInt8Ty(context));
                 }
 
+                emitIndexCheck(idxVal, varName, allocatedType, idxExpr, node);
                 Value* gep = builder.CreateInBoundsGEP(elemType, arrayPtr, idxVal, "ptr_index_ptr");
                 VisitResult rightVal = visit(node->data.assign.right);
                 if (!rightVal.value) return VisitResult();
@@ -2509,25 +4603,219 @@ public:
         if (!thenBB->getTerminator()) {
             builder.CreateBr(mergeBB);
         }
-        
-        func->insert(func->end(), elseBB);
-        func->insert(func->end(), mergeBB);
-        
-        builder.SetInsertPoint(elseBB);
-        if (node->data.if_stmt.else_body) {
+        
+        func->insert(func->end(), elseBB);
+        func->insert(func->end(), mergeBB);
+        
+        builder.SetInsertPoint(elseBB);
+        if (node->data.if_stmt.else_body) {
+            scopeManager.enterScope();
+            visit(node->data.if_stmt.else_body);
+            scopeManager.exitScope();
+        }
+        elseBB = builder.GetInsertBlock();
+        if (!elseBB->getTerminator()) {
+            builder.CreateBr(mergeBB);
+        }
+        
+        builder.SetInsertPoint(mergeBB);
+        return VisitResult();
+    }
+
+    //match 分支里能当 switch case 的整数常量：整数/字符字面量、None、初始值是整数的常量（type 枚举）
+    ConstantInt* matchCaseConstant(ASTNode* pattern, IntegerType* subjectTy) {
+        int64_t v;
+        if (pattern->type == AST_NUM_INT) {
+            v = pattern->data.num_int.value;
+        } else if (pattern->type == AST_CHAR) {
+            v = (signed char)pattern->data.character.value;//和 visitChar 一样按有符号 i8
+        } else if (pattern->type == AST_IDENTIFIER && pattern->data.identifier.name) {
+            std::string name(pattern->data.identifier.name);
+            if (name == "None") {
+                v = 0;
+            } else {
+                if (scopeManager.findVariable(name)) return nullptr;
+                GlobalVariable* gv = module->getGlobalVariable(name, true);
+                if (!gv || !gv->isConstant() || !gv->hasInitializer()) return nullptr;
+                auto* ci = dyn_cast<ConstantInt>(gv->getInitializer());
+                if (!ci) return nullptr;
+                v = ci->getSExtValue();
+            }
+        } else {
+            return nullptr;
+        }
+        unsigned bits = subjectTy->getBitWidth();
+        if (bits < 64 && !APInt(64, (uint64_t)v, true).isSignedIntN(bits) && !APInt(64, (uint64_t)v).isIntN(bits)) {
+            return nullptr;//超出 scrutinee 的位宽，这个分支永远不会命中
+        }
+        return ConstantInt::get(subjectTy, (uint64_t)v, true);
+    }
+
+    //与 visitBinOp 的 == 语义一致：整数按位宽扩展、有浮点转 double、指针与 0/整数比较
+    Value* matchEquals(Value* subject, Value* pat) {
+        Type* lt = subject->getType();
+        Type* rt = pat->getType();
+        if (lt->isIntegerTy() && rt->isIntegerTy()) {
+            if (lt != rt) {
+                if (lt->getIntegerBitWidth() < rt->getIntegerBitWidth()) subject = builder.CreateSExt(subject, rt, "match_sext");
+                else pat = builder.CreateSExt(pat, lt, "match_sext");
+            }
+            return builder.CreateICmpEQ(subject, pat, "match_eq");
+        }
+        if (lt->isFloatingPointTy() || rt->isFloatingPointTy()) {
+            Type* dbl = Type::getDoubleTy(context);
+            auto toDouble = [&](Value* v) -> Value* {
+                if (v->getType()->isIntegerTy()) return builder.CreateSIToFP(v, dbl, "match_itof");
+                if (v->getType()->isFloatingPointTy() && v->getType() != dbl) return builder.CreateFPExt(v, dbl, "match_fpext");
+                return v;
+            };
+            subject = toDouble(subject);
+            pat = toDouble(pat);
+            if (!subject->getType()->isDoubleTy() || !pat->getType()->isDoubleTy()) return nullptr;
+            return builder.CreateFCmpOEQ(subject, pat, "match_eq");
+        }
+        if (lt->isPointerTy() && rt->isPointerTy()) {
+            if (lt != rt) pat = builder.CreateBitCast(pat, lt, "match_ptr_cast");
+            return builder.CreateICmpEQ(subject, pat, "match_eq");
+        }
+        if (lt->isPointerTy() && rt->isIntegerTy()) {
+            if (auto* ci = dyn_cast<ConstantInt>(pat); ci && ci->isZero()) {
+                return builder.CreateIsNull(subject, "match_eq");
+            }
+            Value* asInt = builder.CreatePtrToInt(subject, Type::getInt64Ty(context), "match_ptr_int");
+            return builder.CreateICmpEQ(asInt, builder.CreateIntCast(pat, Type::getInt64Ty(context), false), "match_eq");
+        }
+        if (lt->isIntegerTy() && rt->isPointerTy()) {
+            Value* asInt = builder.CreatePtrToInt(pat, lt, "match_ptr_int");
+            return builder.CreateICmpEQ(subject, asInt, "match_eq");
+        }
+        return nullptr;
+    }
+
+    /*
+    scrutinee 只求值一次。连续的整数常量分支合成一条 switch（密集时 LLVM 自己会降成跳表），
+    其它模式（Ctor(x)、字符串、非常量标识符）按顺序比较，switch 的 default 落到下一个判断
+    */
+    VisitResult visitMatch(ASTNode* node) {
+        Function* func = getCurrentFunction();
+        ASTNode* arms = node->data.match_stmt.arms;
+        if (!func || !arms || arms->type != AST_EXPRESSION_LIST) return VisitResult();
+
+        VisitResult subjectRes = visit(node->data.match_stmt.scrutinee);
+        if (!subjectRes.value) return VisitResult();
+        Value* subject = subjectRes.value;
+        if (subject->getType()->isIntegerTy(1)) {
+            subject = builder.CreateZExt(subject, Type::getInt32Ty(context), "match_zext");
+        }
+        IntegerType* intTy = dyn_cast<IntegerType>(subject->getType());
+
+        BasicBlock* mergeBB = BasicBlock::Create(context, "matchcont");
+        SwitchInst* sw = nullptr;
+
+        auto emitArmBody = [&](BasicBlock* armBB, ASTNode* body, const char* bindName) {
+            builder.SetInsertPoint(armBB);
             scopeManager.enterScope();
-            visit(node->data.if_stmt.else_body);
+            if (bindName) {
+                BasicBlock* entryBB = &func->getEntryBlock();
+                IRBuilder<> tempBuilder(entryBB, entryBB->begin());
+                AllocaInst* bindAlloc = tempBuilder.CreateAlloca(subject->getType(), nullptr, bindName);
+                builder.CreateStore(subject, bindAlloc);
+                scopeManager.defineVariable(bindName, bindAlloc);
+                if (subjectRes.type == ValueType::STRING) {
+                    typeHelper.registerStringVariable(bindName);
+                }
+            }
+            visit(body);
             scopeManager.exitScope();
+            if (!builder.GetInsertBlock()->getTerminator()) {
+                builder.CreateBr(mergeBB);
+            }
+        };
+
+        int count = arms->data.expression_list.expression_count;
+        bool exhaustive = false;
+        for (int i = 0; i < count && !exhaustive; i++) {
+            ASTNode* arm = arms->data.expression_list.expressions[i];
+            if (!arm || arm->type != AST_ASSIGN || !arm->data.assign.left || !arm->data.assign.right) continue;
+            ASTNode* pattern = arm->data.assign.left;
+            ASTNode* body = arm->data.assign.right;
+
+            if (pattern->type == AST_IDENTIFIER && pattern->data.identifier.name &&
+                strcmp(pattern->data.identifier.name, "_") == 0) {
+                BasicBlock* armBB = BasicBlock::Create(context, "match_default", func);
+                builder.CreateBr(armBB);
+                emitArmBody(armBB, body, nullptr);
+                exhaustive = true;
+                break;
+            }
+
+            ConstantInt* caseVal = intTy ? matchCaseConstant(pattern, intTy) : nullptr;
+            if (caseVal) {
+                if (!sw) {
+                    BasicBlock* nextBB = BasicBlock::Create(context, "match_next", func);
+                    sw = builder.CreateSwitch(subject, nextBB);
+                    builder.SetInsertPoint(nextBB);
+                }
+                if (sw->findCaseValue(caseVal) != sw->case_default()) continue;//前面的分支优先
+                BasicBlock* armBB = BasicBlock::Create(context, "match_case", func);
+                sw->addCase(caseVal, armBB);
+                BasicBlock* nextBB = builder.GetInsertBlock();
+                emitArmBody(armBB, body, nullptr);
+                builder.SetInsertPoint(nextBB);
+                continue;
+            }
+            if (pattern->type == AST_NUM_INT || pattern->type == AST_CHAR) {
+                if (intTy) continue;//位宽装不下，永远不会命中
+            }
+            sw = nullptr;
+
+            Value* cond = nullptr;
+            const char* bindName = nullptr;
+            if (pattern->type == AST_CALL && pattern->data.call.args &&
+                pattern->data.call.args->type == AST_EXPRESSION_LIST &&
+                pattern->data.call.args->data.expression_list.expression_count == 1) {
+                ASTNode* bindArg = pattern->data.call.args->data.expression_list.expressions[0];
+                if (bindArg && bindArg->type == AST_IDENTIFIER) {
+                    bindName = bindArg->data.identifier.name;
+                }
+                if (subject->getType()->isPointerTy()) {
+                    cond = builder.CreateIsNotNull(subject, "match_some");
+                } else if (subject->getType()->isFloatingPointTy()) {
+                    cond = builder.CreateFCmpONE(subject, ConstantFP::get(subject->getType(), 0.0), "match_some");
+                } else {
+                    cond = builder.CreateICmpNE(subject, ConstantInt::get(subject->getType(), 0), "match_some");
+                }
+            } else {
+                ASTNode* value = pattern->type == AST_CALL ? pattern->data.call.func : pattern;
+                VisitResult patRes = visit(value);
+                if (patRes.value) {
+                    if (value->type == AST_IDENTIFIER && value->data.identifier.name &&
+                        strcmp(value->data.identifier.name, "None") == 0) {
+                        patRes.value = ConstantInt::get(Type::getInt32Ty(context), 0);
+                    }
+                    cond = matchEquals(subject, patRes.value);
+                }
+            }
+            if (!cond) {
+                llvm::errs() << "Error: Unsupported match pattern\n";
+                continue;
+            }
+
+            BasicBlock* armBB = BasicBlock::Create(context, "match_arm", func);
+            BasicBlock* nextBB = BasicBlock::Create(context, "match_next", func);
+            builder.CreateCondBr(cond, armBB, nextBB);
+            emitArmBody(armBB, body, bindName);
+            builder.SetInsertPoint(nextBB);
         }
-        elseBB = builder.GetInsertBlock();
-        if (!elseBB->getTerminator()) {
+
+        if (!exhaustive) {
             builder.CreateBr(mergeBB);
         }
-        
+        func->insert(func->end(), mergeBB);
         builder.SetInsertPoint(mergeBB);
         return VisitResult();
     }
-    
+
     VisitResult visitWhile(ASTNode* node) {
         Function* func = getCurrentFunction();
         if (!func) return VisitResult();
@@ -2582,6 +4870,10 @@ public:
         if (var_node->type != AST_IDENTIFIER) return VisitResult();
         std::string var_name(var_node->data.identifier.name);
 
+        if (!end_node && isBuiltinInputCall(start_node, "lines")) {
+            return visitLinesLoop(var_name, body_node);
+        }
+
         if (!end_node) {
             std::string iterableName;
             if (start_node->type == AST_IDENTIFIER && start_node->data.identifier.name) {
@@ -2630,7 +4922,7 @@ public:
                 if (!iterLen) {
                     if (auto* info = typeHelper.getArrayTypeInfo(iterableName)) {
                         if (info->second >= 0) {
-                            iterLen = ConstantInt::get(Type::getInt32Ty(context), info->second);
+                            iterLen = ConstantInt::get(getSizeType(), info->second);
                         }
                     }
                 }
@@ -2639,7 +4931,7 @@ public:
             if (!iterLen) {
                 if (start_node->type == AST_EXPRESSION_LIST) {
                     iterLen = ConstantInt::get(
-                        Type::getInt32Ty(context),
+                        getSizeType(),
                         start_node->data.expression_list.expression_count
                     );
                 }
@@ -2649,8 +4941,8 @@ public:
                 Value* isNull = builder.CreateIsNull(iterPtrNow, var_name + "__iterable_null");
                 iterLen = builder.CreateSelect(
                     isNull,
-                    ConstantInt::get(Type::getInt32Ty(context), 0),
-                    ConstantInt::get(Type::getInt32Ty(context), 1),
+                    ConstantInt::get(getSizeType(), 0),
+                    ConstantInt::get(getSizeType(), 1),
                     var_name + "__iterable_fallback_len"
                 );
             }
@@ -2669,9 +4961,9 @@ public:
 
             BasicBlock* savedBB3 = builder.GetInsertBlock();
             IRBuilder<> tempBuilder3(entryBB, entryBB->begin());
-            AllocaInst* idx_alloc = tempBuilder3.CreateAlloca(Type::getInt32Ty(context), nullptr, var_name + "__idx");
+            AllocaInst* idx_alloc = tempBuilder3.CreateAlloca(getSizeType(), nullptr, var_name + "__idx");
             if (savedBB3) builder.SetInsertPoint(savedBB3);
-            builder.CreateStore(ConstantInt::get(Type::getInt32Ty(context), 0), idx_alloc);
+            builder.CreateStore(ConstantInt::get(getSizeType(), 0), idx_alloc);
 
             BasicBlock* condBB = BasicBlock::Create(context, "forin_cond", func);
             BasicBlock* loopBB = BasicBlock::Create(context, "forin_body");
@@ -2680,7 +4972,7 @@ public:
 
             builder.CreateBr(condBB);
             builder.SetInsertPoint(condBB);
-            Value* curIdx = builder.CreateLoad(Type::getInt32Ty(context), idx_alloc, var_name + "__idx_val");
+            Value* curIdx = builder.CreateLoad(getSizeType(), idx_alloc, var_name + "__idx_val");
             Value* cond = builder.CreateICmpSLT(curIdx, iterLen, "forin_cond_cmp");
             func->insert(func->end(), loopBB);
             func->insert(func->end(), incBB);
@@ -2701,7 +4993,7 @@ public:
             builder.CreateBr(bodyJoinBB);
 
             builder.SetInsertPoint(bodyLoadBB);
-            Value* idxForLoad = builder.CreateLoad(Type::getInt32Ty(context), idx_alloc, var_name + "__idx_cur");
+            Value* idxForLoad = builder.CreateLoad(getSizeType(), idx_alloc, var_name + "__idx_cur");
             Value* elemPtr = builder.CreateInBoundsGEP(elemType, arrPtr, idxForLoad, "forin_elem_ptr");
             Value* loadedElem = builder.CreateLoad(elemType, elemPtr, "forin_elem");
             builder.CreateBr(bodyJoinBB);
@@ -2726,8 +5018,8 @@ public:
             }
 
             builder.SetInsertPoint(incBB);
-            Value* curIdxForInc = builder.CreateLoad(Type::getInt32Ty(context), idx_alloc, var_name + "__idx_inc");
-            Value* nextIdx = builder.CreateAdd(curIdxForInc, ConstantInt::get(Type::getInt32Ty(context), 1), "forin_idx_next");
+            Value* curIdxForInc = builder.CreateLoad(getSizeType(), idx_alloc, var_name + "__idx_inc");
+            Value* nextIdx = builder.CreateAdd(curIdxForInc, ConstantInt::get(getSizeType(), 1), "forin_idx_next");
             builder.CreateStore(nextIdx, idx_alloc);
             builder.CreateBr(condBB);
 
@@ -2744,12 +5036,20 @@ public:
         }
         
         VIX_DEBUG_LOG << "[DEBUG] For loop end value type: " << *end_val.value->getType() << "\n";
+        //0 .. a.length 这种 i64 边界用 i64 计数器，否则仍是 i32
+        Type* counterType = Type::getInt32Ty(context);
+        if (start_val.value->getType()->isIntegerTy(64) || end_val.value->getType()->isIntegerTy(64)) {
+            counterType = Type::getInt64Ty(context);
+        }
         AllocaInst* var_alloc = scopeManager.findVariable(var_name);
+        if (var_alloc && counterType->isIntegerTy(64) && getActualType(var_alloc)->isIntegerTy(32)) {
+            var_alloc = nullptr;//前一个同名循环留下的 i32 计数器装不下，另开一个
+        }
         if (!var_alloc) {
             BasicBlock* entryBB = &func->getEntryBlock();
             BasicBlock* savedBB = builder.GetInsertBlock();
             
-            Type* var_type = Type::getInt32Ty(context);
+            Type* var_type = counterType;
             IRBuilder<> tempBuilder(entryBB, entryBB->begin());
             var_alloc = tempBuilder.CreateAlloca(var_type, nullptr, var_name);
             
@@ -2759,19 +5059,149 @@ public:
             
             scopeManager.defineVariable(var_name, var_alloc);
         }
-        Value* start_val_casted = typeHelper.castValue(builder, start_val.value, start_val.type, ValueType::INT32);
-        builder.CreateStore(start_val_casted, var_alloc);
-        Value* end_val_casted = typeHelper.castValue(builder, end_val.value, end_val.type, ValueType::INT32);
+        counterType = getActualType(var_alloc);
+        if (!counterType || !counterType->isIntegerTy()) counterType = Type::getInt32Ty(context);
+        ValueType counterVT = typeHelper.getValueTypeFromType(counterType);
+        Value* start_val_casted = typeHelper.castValue(builder, start_val.value, start_val.type, counterVT);
+        Value* end_val_casted = typeHelper.castValue(builder, end_val.value, end_val.type, counterVT);
+        std::string provenArr = boundedLoopArray(var_node, start_node, end_node, body_node);
+
+        //编译期能确定方向：两端都是常量，或 0 .. a.length
+        int dir = 0;
+        ConstantInt* startC = dyn_cast<ConstantInt>(start_val_casted);
+        ConstantInt* endC = dyn_cast<ConstantInt>(end_val_casted);
+        if (startC && endC) {
+            dir = startC->getSExtValue() > endC->getSExtValue() ? -1 : 1;
+        } else if (startC && startC->isZero() && end_node->type == AST_MEMBER_ACCESS &&
+                   (isIdentNamed(end_node->data.member_access.field, "length") || isIdentNamed(end_node->data.member_access.field, "size"))) {
+            dir = 1;
+        }
+
+        //循环里的空指针检查由 LLVM 外提（unswitch）；方向要到运行时才知道且循环体会改 i 时，每轮按方向比较
+        if (dir == 0 && loopBodyDisturbs(body_node, var_name, "")) {
+            emitDirectionSelectLoop(node, var_name, var_alloc, counterType, start_val_casted, end_val_casted, provenArr);
+            return VisitResult();
+        }
+        emitRangeLoop(node, var_name, var_alloc, counterType, start_val_casted, end_val_casted, dir, provenArr);
+        return VisitResult();
+    }
+
+    // llvm.loop：mustprogress，加上 @vectorize / @unroll(n) 的提示
+    MDNode* getLoopMetadata(ASTNode* forNode) {
+        SmallVector<Metadata*, 4> ops;
+        ops.push_back(nullptr);
+        ops.push_back(MDNode::get(context, MDString::get(context, "llvm.loop.mustprogress")));
+        if (forNode->data.for_stmt.vectorize) {
+            ops.push_back(MDNode::get(context, {MDString::get(context, "llvm.loop.vectorize.enable"),
+                                                ConstantAsMetadata::get(ConstantInt::getTrue(context))}));
+        }
+        if (forNode->data.for_stmt.unroll > 1) {
+            ops.push_back(MDNode::get(context, {MDString::get(context, "llvm.loop.unroll.count"),
+                                                ConstantAsMetadata::get(builder.getInt32(forNode->data.for_stmt.unroll))}));
+        } else if (forNode->data.for_stmt.unroll == 1) {
+            ops.push_back(MDNode::get(context, MDString::get(context, "llvm.loop.unroll.disable")));
+        }
+        MDNode* loopID = MDNode::getDistinct(context, ops);
+        loopID->replaceOperandWith(0, loopID);
+        return loopID;
+    }
+
+    void visitRangeBody(ASTNode* forNode, const std::string& varName, const std::string& provenArr,
+                        BasicBlock* breakBB, BasicBlock* continueBB) {
+        loopBreakTargets.push_back(breakBB);
+        loopContinueTargets.push_back(continueBB);
+        boundedIndexVars.push_back({varName, provenArr});
+        scopeManager.enterScope();
+        visit(forNode->data.for_stmt.body);
+        scopeManager.exitScope();
+        boundedIndexVars.pop_back();
+        loopContinueTargets.pop_back();
+        loopBreakTargets.pop_back();
+        if (!builder.GetInsertBlock()->getTerminator()) {
+            builder.CreateBr(continueBB);
+        }
+    }
+
+    /*
+    for 范围循环，生成旋转后的规整形状：
+      guard: start < end ? body : end
+      body:  i = phi(start, next)，循环体
+      latch: next = i + 1 (nsw)，next < end ? body : end   !llvm.loop
+    循环体不改 i 时计数器是 SSA 的 phi；改了就每轮从变量里重新读。
+    dir == 0 (方向到运行时才知道，循环体不改 i)：guard 里算出步长 ±1 和轮数 |end - start|，
+    latch 按轮数计数退出；步长对 LLVM 是循环不变量，向量化时由它按步长为 1 做 loop versioning
+    */
+    void emitRangeLoop(ASTNode* forNode, const std::string& varName, AllocaInst* varAlloc, Type* counterType,
+                       Value* start, Value* end, int dir, const std::string& provenArr) {
+        Function* func = builder.GetInsertBlock()->getParent();
+        bool ssaCounter = dir == 0 || !loopBodyDisturbs(forNode->data.for_stmt.body, varName, "");
+        BasicBlock* bodyBB = BasicBlock::Create(context, "forbody", func);
+        BasicBlock* latchBB = BasicBlock::Create(context, "forinc", func);
+        BasicBlock* afterBB = BasicBlock::Create(context, "forcont", func);
+
+        builder.CreateStore(start, varAlloc);
+        Value* step = ConstantInt::get(counterType, dir, true);
+        Value* trip = nullptr;
+        Value* enter = nullptr;
+        if (dir == 0) {
+            Value* descending = builder.CreateICmpSGT(start, end, "for_desc");
+            step = builder.CreateSelect(descending, ConstantInt::get(counterType, -1, true), ConstantInt::get(counterType, 1), "for_step");
+            trip = builder.CreateSelect(descending, builder.CreateSub(start, end), builder.CreateSub(end, start), "for_trip");
+            enter = builder.CreateICmpNE(start, end, "for_enter");
+        } else {
+            enter = dir > 0 ? builder.CreateICmpSLT(start, end, "for_enter") : builder.CreateICmpSGT(start, end, "for_enter");
+        }
+        BasicBlock* guardBB = builder.GetInsertBlock();
+        builder.CreateCondBr(enter, bodyBB, afterBB);
+
+        builder.SetInsertPoint(bodyBB);
+        PHINode* iv = nullptr;
+        PHINode* round = nullptr;
+        if (trip) {
+            round = builder.CreatePHI(counterType, 2, "for_round");
+            round->addIncoming(ConstantInt::get(counterType, 0), guardBB);
+        }
+        if (ssaCounter) {
+            iv = builder.CreatePHI(counterType, 2, varName + ".iv");
+            iv->addIncoming(start, guardBB);
+            builder.CreateStore(iv, varAlloc);
+        }
+        visitRangeBody(forNode, varName, provenArr, afterBB, latchBB);
+
+        builder.SetInsertPoint(latchBB);
+        Value* cur = iv ? static_cast<Value*>(iv) : builder.CreateLoad(counterType, varAlloc, varName);
+        Value* next = builder.CreateNSWAdd(cur, step, "inc");
+        builder.CreateStore(next, varAlloc);
+        Value* again = nullptr;
+        if (round) {
+            Value* nextRound = builder.CreateNUWAdd(round, ConstantInt::get(counterType, 1), "for_round_next");
+            again = builder.CreateICmpULT(nextRound, trip, "forcond");
+            round->addIncoming(nextRound, latchBB);
+        } else {
+            again = dir > 0 ? builder.CreateICmpSLT(next, end, "forcond") : builder.CreateICmpSGT(next, end, "forcond");
+        }
+        BranchInst* backedge = builder.CreateCondBr(again, bodyBB, afterBB);
+        backedge->setMetadata(LLVMContext::MD_loop, getLoopMetadata(forNode));
+        if (iv) iv->addIncoming(next, latchBB);
+
+        builder.SetInsertPoint(afterBB);
+    }
+
+    //方向要到运行时才知道：start > end 时每轮 -1
+    void emitDirectionSelectLoop(ASTNode* forNode, const std::string& varName, AllocaInst* varAlloc, Type* counterType,
+                                 Value* start, Value* end, const std::string& provenArr) {
+        Function* func = builder.GetInsertBlock()->getParent();
+        builder.CreateStore(start, varAlloc);
         BasicBlock* condBB = BasicBlock::Create(context, "forcond", func);
         BasicBlock* loopBB = BasicBlock::Create(context, "forbody");
         BasicBlock* incBB = BasicBlock::Create(context, "forinc");
         BasicBlock* afterBB = BasicBlock::Create(context, "forcont");
         builder.CreateBr(condBB);
         builder.SetInsertPoint(condBB);
-        Value* cur_val = builder.CreateLoad(Type::getInt32Ty(context), var_alloc, var_name);
-        Value* descending = builder.CreateICmpSGT(start_val_casted, end_val_casted, "for_desc");
-        Value* ascCond = builder.CreateICmpSLT(cur_val, end_val_casted, "forcond_asc");
-        Value* descCond = builder.CreateICmpSGT(cur_val, end_val_casted, "forcond_desc");
+        Value* cur_val = builder.CreateLoad(counterType, varAlloc, varName);
+        Value* descending = builder.CreateICmpSGT(start, end, "for_desc");
+        Value* ascCond = builder.CreateICmpSLT(cur_val, end, "forcond_asc");
+        Value* descCond = builder.CreateICmpSGT(cur_val, end, "forcond_desc");
         Value* cond = builder.CreateSelect(descending, descCond, ascCond, "forcond");
         VIX_DEBUG_LOG << "[DEBUG] for cond direction-aware (ascending/descending)\n";
         func->insert(func->end(), loopBB);
@@ -2779,31 +5209,25 @@ public:
         func->insert(func->end(), afterBB);
         builder.CreateCondBr(cond, loopBB, afterBB);
         builder.SetInsertPoint(loopBB);
-        loopBreakTargets.push_back(afterBB);
-        loopContinueTargets.push_back(incBB);
-        scopeManager.enterScope();
-        visit(body_node);
-        scopeManager.exitScope();
-        loopContinueTargets.pop_back();
-        loopBreakTargets.pop_back();
-        if (!builder.GetInsertBlock()->getTerminator()) {
-            builder.CreateBr(incBB);
-        }
+        visitRangeBody(forNode, varName, provenArr, afterBB, incBB);
         builder.SetInsertPoint(incBB);
-        Value* cur_val_for_inc = builder.CreateLoad(Type::getInt32Ty(context), var_alloc, var_name);
-        Value* one_val = ConstantInt::get(Type::getInt32Ty(context), 1);
-        Value* neg_one_val = ConstantInt::get(Type::getInt32Ty(context), -1);
+        Value* cur_val_for_inc = builder.CreateLoad(counterType, varAlloc, varName);
+        Value* one_val = ConstantInt::get(counterType, 1);
+        Value* neg_one_val = ConstantInt::get(counterType, -1, true);
         Value* step_val = builder.CreateSelect(descending, neg_one_val, one_val, "for_step");
         Value* new_val = builder.CreateAdd(cur_val_for_inc, step_val, "inc");
-        builder.CreateStore(new_val, var_alloc);
-        builder.CreateBr(condBB);
+        builder.CreateStore(new_val, varAlloc);
+        BranchInst* backedge = builder.CreateBr(condBB);
+        backedge->setMetadata(LLVMContext::MD_loop, getLoopMetadata(forNode));
         
         builder.SetInsertPoint(afterBB);
-        return VisitResult();
     }
     
     VisitResult visitFunction(ASTNode* node, const std::string* overrideName = nullptr) {
         std::string funcName = overrideName ? *overrideName : std::string(node->data.function.name);
+        if (node->data.function.is_extern && !node->data.function.body && node->data.function.linkage) {
+            externCFunctions.insert(funcName);
+        }
         
         if (Function* existingFunc = module->getFunction(funcName)) {
             StructType* sretStructType = getStructSRetType(existingFunc);
@@ -2850,6 +5274,10 @@ public:
                                 } else if (StructType* structTy = typeHelper.getStructType(typeName)) {
                                     paramType = ValueType::POINTER;
                                     paramTypes.push_back(PointerType::getUnqual(structTy));
+                                } else if (typeName == "StringBuilder") {//按指针传，函数里追加调用方能看到
+                                    paramType = ValueType::POINTER;
+                                    paramTypes.push_back(PointerType::getUnqual(Type::getInt8Ty(context)));
+                                    typeHelper.registerStringBuilder(paramName);
                                 } else if (typeName == "ptr") {
                                     if (funcName == "main" && paramName == "argv") {
                                         paramType = ValueType::POINTER;
@@ -2874,6 +5302,9 @@ public:
                                 } else if (typeName == "str") {
                                     paramType = ValueType::STRING;
                                     paramTypes.push_back(PointerType::getUnqual(Type::getInt8Ty(context)));
+                                } else if (FixedVectorType* vt = typeHelper.getVectorType(typeName)) {
+                                    paramType = ValueType::VECTOR;
+                                    paramTypes.push_back(vt);
                                 } else {
                                     paramTypes.push_back(Type::getInt32Ty(context));
                                 }
@@ -2912,8 +5343,8 @@ public:
                             if (isArrayParam) {
                                 functionArrayParamPositions[funcName].push_back(userParamIndex);
                                 paramNames.push_back(paramName + "__len");
-                                paramTypes.push_back(Type::getInt32Ty(context));
-                                paramValueTypes.push_back(ValueType::INT32);
+                                paramTypes.push_back(getSizeType());
+                                paramValueTypes.push_back(ValueType::INT64);
                                 typeHelper.registerArrayType(paramName, arrayElementType, arrayElementCount);
                                 typeHelper.registerVariableArraySize(paramName, arrayElementCount);
                             }
@@ -2956,6 +5387,9 @@ public:
         bool isVarArg = node->data.function.vararg == 1;
         FunctionType* funcType = FunctionType::get(abiReturnType, paramTypes, isVarArg);
         Function* func = Function::Create(funcType, Function::ExternalLinkage, funcName, module.get());
+        if (libraryModule && !node->data.function.is_public && !node->data.function.is_extern) {
+            func->setLinkage(GlobalValue::InternalLinkage);
+        }
         if (useStructSRet && logicalReturnStructType) {
             registerStructSRetFunction(funcName, func, logicalReturnStructType);
             func->addParamAttr(0, Attribute::getWithStructRetType(context, logicalReturnStructType));
@@ -3000,6 +5434,7 @@ public:
                 scopeManager.defineVariable(paramNames[userIdx], alloc);
                 if (userIdx < paramValueTypes.size() && paramValueTypes[userIdx] == ValueType::STRING) {
                     typeHelper.registerStringVariable(paramNames[userIdx]);
+                    ensureStringLengthSlot(paramNames[userIdx]);
                 }
                 userIdx++;
             }
@@ -3110,6 +5545,15 @@ public:
             }
 
             std::string methodName(fieldNode->data.identifier.name);
+            if (FixedVectorType* vt = staticVectorType(objectNode)) {
+                return visitVectorStatic(vt, methodName, node);
+            }
+            if (vectorTypeOf(objectNode)) {
+                return visitVectorMethod(objectNode, methodName, node);
+            }
+            if (isStringBuilderExpr(objectNode)) {
+                return visitStringBuilderMethod(objectNode, methodName, node);
+            }
             if (methodName == "push") {
                 if (!node->data.call.args || node->data.call.args->type != AST_EXPRESSION_LIST ||
                     node->data.call.args->data.expression_list.expression_count != 1) {
@@ -3117,9 +5561,18 @@ public:
                     return VisitResult();
                 }
 
+                //长度和容量记在接收者变量的 __len / __cap 槽里，rows[i]、s.items 这种没有自己的槽，
+                //几个接收者共用一份状态会互相改坏长度，所以只接受列表变量
                 std::string objectName;
+                AllocaInst* objectAlloc = nullptr;
                 if (objectNode->type == AST_IDENTIFIER && objectNode->data.identifier.name) {
                     objectName = objectNode->data.identifier.name;
+                    objectAlloc = scopeManager.findVariable(objectName);
+                    if (!objectAlloc) objectAlloc = findVariableInMain(objectName);
+                }
+                if (!objectAlloc) {
+                    reportCodegenSemanticError(node, "push expects a list variable as receiver (pushing through an index or a field is not supported)");
+                    return VisitResult();
                 }
 
                 VisitResult objectRes = visit(objectNode);
@@ -3131,55 +5584,10 @@ public:
                 VisitResult argRes = visit(argNode);
                 if (!argRes.value) return VisitResult();
 
-                AllocaInst* objectAlloc = nullptr;
-                Value* objectSlotPtr = nullptr;
-                Type* objectSlotElemType = nullptr;
-                if (!objectName.empty()) {
-                    objectAlloc = scopeManager.findVariable(objectName);
-                    if (!objectAlloc) objectAlloc = findVariableInMain(objectName);
-                }
-
-                if (!objectAlloc && objectNode->type == AST_INDEX) {
-                    ASTNode* slotTarget = objectNode->data.index.target;
-                    ASTNode* slotIndexExpr = objectNode->data.index.index;
-                    VisitResult slotIdxRes = visit(slotIndexExpr);
-                    VisitResult slotTargetRes = visit(slotTarget);
-                    if (slotIdxRes.value && slotTargetRes.value && slotTargetRes.value->getType()->isPointerTy()) {
-                        Value* slotIdxVal = slotIdxRes.value;
-                        if (!slotIdxVal->getType()->isIntegerTy(32)) {
-                            slotIdxVal = builder.CreateIntCast(slotIdxVal, Type::getInt32Ty(context), true, "push_slot_idxcast");
-                        }
-
-                        std::string slotTargetName;
-                        if (slotTarget->type == AST_IDENTIFIER && slotTarget->data.identifier.name) {
-                            slotTargetName = slotTarget->data.identifier.name;
-                        }
-                        auto hintIt = pointerElementHints.find(slotTargetRes.value);
-                        if (hintIt != pointerElementHints.end() && hintIt->second) {
-                            objectSlotElemType = hintIt->second;
-                        } else {
-                            objectSlotElemType = getPointerElementTypeSafely(
-                                dyn_cast<PointerType>(slotTargetRes.value->getType()),
-                                slotTargetName
-                            );
-                        }
-                        objectSlotPtr = builder.CreateInBoundsGEP(objectSlotElemType, slotTargetRes.value, slotIdxVal, "push_slot_ptr");
-                    }
-                }
-
                 Type* elemType = Type::getInt32Ty(context);
-                if (objectAlloc) {
-                    Type* allocType = getActualType(objectAlloc);
-                    if (allocType && allocType->isPointerTy()) {
-                        elemType = getPointerElementTypeSafely(dyn_cast<PointerType>(allocType), objectName);
-                    }
-                } else if (objectRes.value->getType()->isPointerTy()) {
-                    auto objHintIt = pointerElementHints.find(objectRes.value);
-                    if (objHintIt != pointerElementHints.end() && objHintIt->second) {
-                        elemType = objHintIt->second;
-                    } else if (argRes.value) {
-                        elemType = argRes.value->getType();
-                    }
+                Type* allocType = getActualType(objectAlloc);
+                if (allocType && allocType->isPointerTy()) {
+                    elemType = getPointerElementTypeSafely(dyn_cast<PointerType>(allocType), objectName);
                 }
 
                 ValueType elemVT = typeHelper.getValueTypeFromType(elemType);
@@ -3192,29 +5600,15 @@ public:
                     }
                 }
 
-                std::string pushStateName = objectName;
-                if (pushStateName.empty()) {
-                    pushStateName = std::string("__tmp_push_") + std::to_string((uintptr_t)objectNode);
-                }
-
-                int initialLen = 0;
-                if (!objectName.empty()) {
-                    int known = typeHelper.getVariableArraySize(objectName);
-                    if (known >= 0) initialLen = known;
-                }
-                AllocaInst* lenSlot = ensureRuntimeArrayLengthSlot(pushStateName, initialLen);
+                int initialLen = typeHelper.getVariableArraySize(objectName);
+                AllocaInst* lenSlot = ensureRuntimeArrayLengthSlot(objectName, initialLen >= 0 ? initialLen : 0);
                 if (!lenSlot) return VisitResult();
+                AllocaInst* capSlot = ensureRuntimeArrayCapacitySlot(objectName, 0);
+                if (!capSlot) return VisitResult();
 
-                Value* oldLen = builder.CreateLoad(Type::getInt32Ty(context), lenSlot, objectName + "__len_old");
-                Value* newLen = builder.CreateAdd(oldLen, ConstantInt::get(Type::getInt32Ty(context), 1), objectName + "__len_new");
-
-                uint64_t elemBytes = 4;
-                if (elemType->isIntegerTy(8)) elemBytes = 1;
-                else if (elemType->isIntegerTy(64) || elemType->isDoubleTy() || elemType->isPointerTy()) elemBytes = 8;
-                else if (elemType->isFloatTy()) elemBytes = 4;
-
-                Value* bytesI32 = builder.CreateMul(newLen, ConstantInt::get(Type::getInt32Ty(context), elemBytes), "push_bytes_i32");
-                Value* bytesI64 = builder.CreateSExt(bytesI32, Type::getInt64Ty(context), "push_bytes_i64");
+                Type* sizeTy = getSizeType();
+                Value* oldLen = builder.CreateLoad(sizeTy, lenSlot, objectName + "__len_old");
+                Value* newLen = builder.CreateAdd(oldLen, ConstantInt::get(sizeTy, 1), objectName + "__len_new");
 
                 Value* oldPtr = objectRes.value;
                 Type* targetPtrTy = PointerType::getUnqual(elemType);
@@ -3222,39 +5616,126 @@ public:
                     oldPtr = builder.CreateBitCast(oldPtr, targetPtrTy, "push_old_ptr_cast");
                 }
 
-                Function* reallocFn = getOrCreateReallocFunction();
-                Value* oldPtrI8 = builder.CreateBitCast(oldPtr, PointerType::getUnqual(Type::getInt8Ty(context)), "push_old_i8");
-                Value* newPtrI8 = builder.CreateCall(reallocFn, {oldPtrI8, bytesI64}, "push_realloc");
-                Value* newPtr = builder.CreateBitCast(newPtrI8, targetPtrTy, "push_new_ptr");
+                // 容量不够时按 2 倍扩容（至少 4 个元素），均摊 O(1)
+                Value* oldCap = builder.CreateLoad(sizeTy, capSlot, objectName + "__cap_old");
+                Function* fn = builder.GetInsertBlock()->getParent();
+                BasicBlock* curBB = builder.GetInsertBlock();
+                BasicBlock* growBB = BasicBlock::Create(context, "push_grow", fn);
+                BasicBlock* storeBB = BasicBlock::Create(context, "push_store", fn);
+                Value* needGrow = builder.CreateICmpUGT(newLen, oldCap, "push_need_grow");
+                builder.CreateCondBr(needGrow, growBB, storeBB);
+
+                builder.SetInsertPoint(growBB);
+                Value* dblCap = builder.CreateShl(oldCap, ConstantInt::get(sizeTy, 1), "push_cap_x2");
+                Value* minCap = builder.CreateSelect(
+                    builder.CreateICmpUGT(newLen, ConstantInt::get(sizeTy, 4)), newLen, ConstantInt::get(sizeTy, 4), "push_cap_min");
+                Value* grownCap = builder.CreateSelect(
+                    builder.CreateICmpUGT(dblCap, minCap), dblCap, minCap, "push_cap_new");
+                Value* grownPtr = emitListRealloc(oldPtr, elemType, grownCap, "push");
+                builder.CreateStore(grownCap, capSlot);
+                builder.CreateBr(storeBB);
+
+                builder.SetInsertPoint(storeBB);
+                PHINode* newPtr = builder.CreatePHI(targetPtrTy, 2, "push_buf");
+                newPtr->addIncoming(oldPtr, curBB);
+                newPtr->addIncoming(grownPtr, growBB);
 
                 Value* dstPtr = builder.CreateInBoundsGEP(elemType, newPtr, oldLen, "push_dst_ptr");
                 builder.CreateStore(argCast, dstPtr);
                 builder.CreateStore(newLen, lenSlot);
 
-                if (objectAlloc) {
-                    Type* allocType = getActualType(objectAlloc);
-                    Value* storePtr = newPtr;
-                    if (allocType && allocType != targetPtrTy && allocType->isPointerTy()) {
-                        storePtr = builder.CreateBitCast(newPtr, allocType, "push_store_ptr_cast");
-                    }
-                    builder.CreateStore(storePtr, objectAlloc);
+                Value* storePtr = newPtr;
+                if (allocType && allocType != targetPtrTy && allocType->isPointerTy()) {
+                    storePtr = builder.CreateBitCast(newPtr, allocType, "push_store_ptr_cast");
                 }
+                builder.CreateStore(storePtr, objectAlloc);
 
-                if (objectSlotPtr && objectSlotElemType) {
-                    Value* slotStorePtr = newPtr;
-                    if (slotStorePtr->getType() != objectSlotElemType &&
-                        slotStorePtr->getType()->isPointerTy() && objectSlotElemType->isPointerTy()) {
-                        slotStorePtr = builder.CreateBitCast(slotStorePtr, objectSlotElemType, "push_slot_store_cast");
-                    }
-                    builder.CreateStore(slotStorePtr, objectSlotPtr);
+                typeHelper.registerArrayType(objectName, elemType, -1);
+                typeHelper.registerVariableArraySize(objectName, -1);
+
+                return VisitResult(newPtr, ValueType::POINTER);
+            }
+
+            if (methodName == "reserve" || methodName == "shrink_to_fit") {
+                bool isReserve = methodName == "reserve";
+                int argCount = (node->data.call.args && node->data.call.args->type == AST_EXPRESSION_LIST) ?
+                    node->data.call.args->data.expression_list.expression_count : 0;
+                if (argCount != (isReserve ? 1 : 0)) {
+                    llvm::errs() << "Error: " << methodName << " expects " << (isReserve ? "exactly one argument" : "no arguments") << "\n";
+                    return VisitResult();
+                }
+                if (objectNode->type != AST_IDENTIFIER || !objectNode->data.identifier.name) {
+                    llvm::errs() << "Error: " << methodName << " expects a list variable\n";
+                    return VisitResult();
                 }
 
-                if (!objectName.empty()) {
-                    typeHelper.registerArrayType(objectName, elemType, -1);
-                    typeHelper.registerVariableArraySize(objectName, -1);
+                std::string objectName(objectNode->data.identifier.name);
+                AllocaInst* objectAlloc = scopeManager.findVariable(objectName);
+                if (!objectAlloc) objectAlloc = findVariableInMain(objectName);
+                Type* allocType = objectAlloc ? getActualType(objectAlloc) : nullptr;
+                if (!allocType || !allocType->isPointerTy()) {
+                    llvm::errs() << "Error: " << methodName << " expects a list variable\n";
+                    return VisitResult();
                 }
+                Type* elemType = getPointerElementTypeSafely(dyn_cast<PointerType>(allocType), objectName);
+                if (!elemType) elemType = Type::getInt32Ty(context);
 
-                return VisitResult(newPtr, ValueType::POINTER);
+                int initialLen = 0;
+                int known = typeHelper.getVariableArraySize(objectName);
+                if (known >= 0) initialLen = known;
+                AllocaInst* lenSlot = ensureRuntimeArrayLengthSlot(objectName, initialLen);
+                AllocaInst* capSlot = ensureRuntimeArrayCapacitySlot(objectName, 0);
+                if (!lenSlot || !capSlot) return VisitResult();
+
+                Type* sizeTy = getSizeType();
+                Type* targetPtrTy = PointerType::getUnqual(elemType);
+                Value* oldPtr = builder.CreateLoad(allocType, objectAlloc, objectName + "_buf");
+                if (oldPtr->getType() != targetPtrTy) {
+                    oldPtr = builder.CreateBitCast(oldPtr, targetPtrTy, methodName + "_old_ptr_cast");
+                }
+                Value* len = builder.CreateLoad(sizeTy, lenSlot, objectName + "__len_val");
+                Value* cap = builder.CreateLoad(sizeTy, capSlot, objectName + "__cap_val");
+
+                Value* wantCap = nullptr;
+                Value* doRealloc = nullptr;
+                if (isReserve) {
+                    ASTNode* argNode = node->data.call.args->data.expression_list.expressions[0];
+                    VisitResult argRes = visit(argNode);
+                    if (!argRes.value) return VisitResult();
+                    wantCap = typeHelper.castValue(builder, argRes.value, argRes.type, ValueType::INT64);
+                    wantCap = castToSize(wantCap, "reserve_n_cast");
+                    doRealloc = builder.CreateICmpSGT(wantCap, cap, "reserve_need_grow");
+                } else {
+                    // 至少保留 1 个元素，避免 realloc(p, 0) 的实现定义行为
+                    wantCap = builder.CreateSelect(
+                        builder.CreateICmpUGT(len, ConstantInt::get(sizeTy, 0)), len, ConstantInt::get(sizeTy, 1), "shrink_cap");
+                    doRealloc = builder.CreateICmpNE(wantCap, cap, "shrink_need");
+                }
+
+                Function* fn = builder.GetInsertBlock()->getParent();
+                BasicBlock* curBB = builder.GetInsertBlock();
+                BasicBlock* reallocBB = BasicBlock::Create(context, methodName + "_realloc_bb", fn);
+                BasicBlock* contBB = BasicBlock::Create(context, methodName + "_cont", fn);
+                builder.CreateCondBr(doRealloc, reallocBB, contBB);
+
+                builder.SetInsertPoint(reallocBB);
+                Value* grownPtr = emitListRealloc(oldPtr, elemType, wantCap, methodName);
+                builder.CreateStore(wantCap, capSlot);
+                Value* storePtr = grownPtr;
+                if (allocType != targetPtrTy) {
+                    storePtr = builder.CreateBitCast(grownPtr, allocType, methodName + "_store_ptr_cast");
+                }
+                builder.CreateStore(storePtr, objectAlloc);
+                builder.CreateBr(contBB);
+
+                builder.SetInsertPoint(contBB);
+                PHINode* bufPtr = builder.CreatePHI(targetPtrTy, 2, methodName + "_buf");
+                bufPtr->addIncoming(oldPtr, curBB);
+                bufPtr->addIncoming(grownPtr, reallocBB);
+
+                typeHelper.registerArrayType(objectName, elemType, -1);
+                typeHelper.registerVariableArraySize(objectName, -1);
+                return VisitResult(bufPtr, ValueType::POINTER);
             }
 
             return VisitResult();
@@ -3270,6 +5751,33 @@ public:
         
         std::string calleeName(node->data.call.func->data.identifier.name);
 
+        if (isBuiltinInputCall(node, "read_line") || isBuiltinInputCall(node, "read_all")) {
+            Function* readFn = getInputRuntimeFunction(calleeName == "read_line" ? "__vix_read_line" : "__vix_read_all");
+            return VisitResult(builder.CreateCall(readFn, {}, calleeName), ValueType::STRING);
+        }
+        if (isBuiltinInputCall(node, "lines")) {
+            reportCodegenSemanticError(node, "lines() can only be used as 'for (line in lines())'");
+            return VisitResult();
+        }
+
+        if (FixedVectorType* vt = module->getFunction(calleeName) ? nullptr : typeHelper.getVectorType(calleeName)) {
+            return visitVectorConstruct(vt, node);
+        }
+        if (isStringBuilderExpr(node)) {//StringBuilder() / StringBuilder(初始容量)
+            int argCount = node->data.call.args ? node->data.call.args->data.expression_list.expression_count : 0;
+            Value* cap = ConstantInt::get(Type::getInt64Ty(context), 0);
+            if (argCount > 1) {
+                reportCodegenSemanticError(node, "StringBuilder expects at most one argument (initial capacity)");
+                return VisitResult();
+            }
+            if (argCount == 1) {
+                VisitResult capRes = visit(node->data.call.args->data.expression_list.expressions[0]);
+                if (!capRes.value) return VisitResult();
+                cap = typeHelper.castValue(builder, capRes.value, capRes.type, ValueType::INT64);
+            }
+            return VisitResult(builder.CreateCall(getStringRuntimeFunction("__vix_sb_new"), {cap}, "sb"), ValueType::POINTER);
+        }
+
         if (isBuiltinUnionCtorName(calleeName)) {
             int argCount = node->data.call.args ?
                 node->data.call.args->data.expression_list.expression_count : 0;
@@ -3434,13 +5942,13 @@ public:
 
                     if (!isVarArg && !isKnownVarArgFunc && isArrayParamPosition(calleeName, i)) {
                         Value* lenVal = inferArrayLengthFromArgument(argNode);
-                        Type* lenExpectedType = Type::getInt32Ty(context);
+                        Type* lenExpectedType = getSizeType();
                         if (llvmParamIndex < expectedParamCount) {
                             lenExpectedType = callee->getFunctionType()->getParamType(llvmParamIndex);
                         }
 
                         if (!lenVal->getType()->isIntegerTy()) {
-                            lenVal = typeHelper.castValue(builder, lenVal, ValueType::INT32, ValueType::INT32);
+                            lenVal = typeHelper.castValue(builder, lenVal, ValueType::INT64, ValueType::INT64);
                         }
                         if (lenVal->getType() != lenExpectedType && lenExpectedType->isIntegerTy()) {
                             lenVal = builder.CreateIntCast(lenVal, lenExpectedType, false, "arr_len_arg_cast");
@@ -3452,6 +5960,7 @@ public:
             }
         }
         
+        flushPrintBufferBeforeCall(callee);
         CallInst* callInst = builder.CreateCall(callee, args);
         if (sretAlloc) {
             return VisitResult(sretAlloc, ValueType::POINTER, sretType);
@@ -3621,7 +6130,7 @@ public:
 
             if (Value* runtimeLen = getRuntimeArrayLengthValue(varName)) {
                 VIX_DEBUG_LOG << "[DEBUG] Array length (runtime fat ptr): dynamic\n";
-                return VisitResult(runtimeLen, ValueType::INT32);
+                return VisitResult(runtimeLen, ValueType::INT64);
             }
             
             AllocaInst* alloc = scopeManager.findVariable(varName);
@@ -3637,38 +6146,43 @@ public:
                 if (allocatedType && allocatedType->isArrayTy()) {
                     ArrayType* arrayType = cast<ArrayType>(allocatedType);
                     uint64_t numElements = arrayType->getNumElements();
-                    Value* length = ConstantInt::get(Type::getInt32Ty(context), numElements);
+                    Value* length = ConstantInt::get(getSizeType(), numElements);
                     VIX_DEBUG_LOG << "[DEBUG] Arr length (s): " << numElements << "\n";
-                    return VisitResult(length, ValueType::INT32);
+                    return VisitResult(length, ValueType::INT64);
                 }
                 if (allocatedType && allocatedType->isPointerTy()) {
                     auto* arrayInfo = typeHelper.getArrayTypeInfo(varName);
+                    if (typeHelper.isStringVariable(varName) && (!arrayInfo || arrayInfo->first->isIntegerTy(8))) {
+                        if (AllocaInst* slot = findStringLengthSlot(varName)) {
+                            return VisitResult(loadStringLength(varName, alloc, slot), ValueType::INT64);
+                        }
+                    }
                     if (arrayInfo) {
                         int elementCount = arrayInfo->second;
                         if (elementCount > 0) {
-                            Value* length = ConstantInt::get(Type::getInt32Ty(context), elementCount);
+                            Value* length = ConstantInt::get(getSizeType(), elementCount);
                             VIX_DEBUG_LOG << "[DEBUG] Array length (r): " << elementCount << "\n";
-                            return VisitResult(length, ValueType::INT32);
+                            return VisitResult(length, ValueType::INT64);
                         }
                     }
                     if (typeHelper.isStringVariable(varName)) {
                         Value* strPtr = builder.CreateLoad(allocatedType, alloc, varName);
                         CallInst* strlenCall = builder.CreateCall(strlenFunction, {strPtr}, "strlen");
-                        Value* length = builder.CreateIntCast(strlenCall, Type::getInt32Ty(context), false, "len");
+                        Value* length = builder.CreateIntCast(strlenCall, getSizeType(), false, "len");
                         VIX_DEBUG_LOG << "[DEBUG] String length (strlen): dynamic\n";
-                        return VisitResult(length, ValueType::INT32);
+                        return VisitResult(length, ValueType::INT64);
                     }
                     VIX_DEBUG_LOG << "[DEBUG] Unknown pointer type, returning 0\n";
-                    Value* length = ConstantInt::get(Type::getInt32Ty(context), 0);
-                    return VisitResult(length, ValueType::INT32);
+                    Value* length = ConstantInt::get(getSizeType(), 0);
+                    return VisitResult(length, ValueType::INT64);
                 }
             }
             auto* arrayInfo = typeHelper.getArrayTypeInfo(varName);
             if (arrayInfo) {
                 int elementCount = arrayInfo->second;
-                Value* length = ConstantInt::get(Type::getInt32Ty(context), elementCount);
+                Value* length = ConstantInt::get(getSizeType(), elementCount);
                 VIX_DEBUG_LOG << "[DEBUG] Array length (type info): " << elementCount << "\n";
-                return VisitResult(length, ValueType::INT32);
+                return VisitResult(length, ValueType::INT64);
             }
             if (typeHelper.isStringVariable(varName)) {
                 AllocaInst* varAlloc = scopeManager.findVariable(varName);
@@ -3678,17 +6192,17 @@ public:
                     Type* allocatedType = getActualType(varAlloc);
                     Value* strPtr = builder.CreateLoad(allocatedType, varAlloc, varName);
                     CallInst* strlenCall = builder.CreateCall(strlenFunction, {strPtr}, "strlen");
-                    Value* length = builder.CreateIntCast(strlenCall, Type::getInt32Ty(context), false, "len");
+                    Value* length = builder.CreateIntCast(strlenCall, getSizeType(), false, "len");
                     VIX_DEBUG_LOG << "[DEBUG] String length (strlen from isStringVariable): dynamic\n";
-                    return VisitResult(length, ValueType::INT32);
+                    return VisitResult(length, ValueType::INT64);
                 }
             }
         }
         if (object->type == AST_EXPRESSION_LIST) {
             int count = object->data.expression_list.expression_count;
-            Value* length = ConstantInt::get(Type::getInt32Ty(context), count);
+            Value* length = ConstantInt::get(getSizeType(), count);
             VIX_DEBUG_LOG << "[DEBUG] Literal length: " << count << "\n";
-            return VisitResult(length, ValueType::INT32);
+            return VisitResult(length, ValueType::INT64);
         }
 
         if (object->type == AST_MEMBER_ACCESS) {
@@ -3696,16 +6210,16 @@ public:
             if (field && field->type == AST_IDENTIFIER && field->data.identifier.name) {
                 std::string memberName(field->data.identifier.name);
                 if (memberName == "scopes") {
-                    Value* length = ConstantInt::get(Type::getInt32Ty(context), 1);
+                    Value* length = ConstantInt::get(getSizeType(), 1);
                     VIX_DEBUG_LOG << "[DEBUG] Member length fallback for scopes: 1\n";
-                    return VisitResult(length, ValueType::INT32);
+                    return VisitResult(length, ValueType::INT64);
                 }
             }
         }
         
         llvm::errs() << "[WARNING] Could not determine length, returning 0\n";
-        Value* length = ConstantInt::get(Type::getInt32Ty(context), 0);
-        return VisitResult(length, ValueType::INT32);
+        Value* length = ConstantInt::get(getSizeType(), 0);
+        return VisitResult(length, ValueType::INT64);
     }
     
     VisitResult visitMemberAccess(ASTNode* node) {
@@ -3715,6 +6229,11 @@ public:
         
         if (field->type == AST_IDENTIFIER) {
             std::string fieldName(field->data.identifier.name);
+            if ((fieldName == "length" || fieldName == "size") && isStringBuilderExpr(object)) {
+                VisitResult sbRes = visit(object);
+                if (!sbRes.value) return VisitResult();
+                return VisitResult(loadBuilderLength(sbRes.value), ValueType::INT64);
+            }
             if (fieldName == "length" || fieldName == "size") {
                 return handleArrayLength(object);
             }
@@ -3902,6 +6421,9 @@ public:
             llvm::errs() << "Error: Cannot find valid insertion point for print\n";
             return VisitResult();
         }
+        if (printMode != 2) {
+            return visitBufferedPrint(node);
+        }
         
         initPrintf();
         
@@ -3963,6 +6485,10 @@ public:
                         builder.CreateCall(printfFunction, {formatStr, printValue});
                         break;
                         
+                    case ValueType::VECTOR:
+                        emitPrintfVector(printValue);
+                        break;
+                        
                     case ValueType::ARRAY:
                         formatStr = safeCreateGlobalStringPtr("%p", "fmt_p");
                         builder.CreateCall(printfFunction, {formatStr, printValue});
@@ -4036,6 +6562,11 @@ public:
                     builder.CreateCall(printfFunction, {formatStr, printValue});
                     break;
                     
+                case ValueType::VECTOR:
+                    emitPrintfVector(printValue);
+                    builder.CreateCall(printfFunction, {safeCreateGlobalStringPtr("\n", "fmt_nl")});
+                    break;
+                    
                 case ValueType::ARRAY:
                     formatStr = safeCreateGlobalStringPtr("%p\n", "fmt_p_nl");
                     builder.CreateCall(printfFunction, {formatStr, printValue});
@@ -4057,8 +6588,16 @@ public:
     }
     
     VisitResult visitInput(ASTNode* node) {
-        (void)node;
-        return VisitResult(ConstantInt::get(Type::getInt32Ty(context), 0), ValueType::INT32);
+        Type* i8PtrTy = PointerType::getUnqual(Type::getInt8Ty(context));
+        Value* prompt = ConstantPointerNull::get(cast<PointerType>(i8PtrTy));
+        if (node->data.input.prompt) {
+            VisitResult promptRes = visit(node->data.input.prompt);
+            if (promptRes.value && promptRes.value->getType()->isPointerTy()) {
+                prompt = builder.CreateBitCast(promptRes.value, i8PtrTy, "prompt");
+            }
+        }
+        Value* line = builder.CreateCall(getInputRuntimeFunction("__vix_input"), {prompt}, "input");
+        return VisitResult(line, ValueType::STRING);
     }
     
     VisitResult visitToInt(ASTNode* node) {
@@ -4149,11 +6688,18 @@ public:
             Type* llvmTy = initConst ? initConst->getType() : Type::getInt32Ty(context);
             if (!initConst) initConst = Constant::getNullValue(llvmTy);
 
+            //is_public == 2：import 进来的常量，值留给优化用，符号由定义它的模块提供
+            GlobalValue::LinkageTypes linkage = GlobalValue::ExternalLinkage;
+            if (node->data.assign.is_public == 2) {
+                linkage = GlobalValue::AvailableExternallyLinkage;
+            } else if (libraryModule && !node->data.assign.is_public) {
+                linkage = GlobalValue::InternalLinkage;
+            }
             GlobalVariable* gv = new GlobalVariable(
                 *module,
                 llvmTy,
                 true,
-                GlobalValue::ExternalLinkage,
+                linkage,
                 initConst,
                 name
             );
@@ -4233,12 +6779,18 @@ public:
         if (!initValue) {
             initValue = Constant::getNullValue(globalType);
         }
+        GlobalValue::LinkageTypes linkage = GlobalValue::ExternalLinkage;
+        if (node->data.global_decl.is_public == 2) {
+            initValue = nullptr;//import 进来的全局变量只声明
+        } else if (libraryModule && !node->data.global_decl.is_public) {
+            linkage = GlobalValue::InternalLinkage;
+        }
         
         GlobalVariable* globalVar = new GlobalVariable(
             *module,
             globalType,
             false,
-            GlobalValue::ExternalLinkage,
+            linkage,
             initValue,
             varName
         );
@@ -4251,6 +6803,12 @@ public:
         ASTNode* target = node->data.index.target;
         ASTNode* indexNode = node->data.index.index;
         
+        if (FixedVectorType* vt = vectorTypeOf(target)) {//v[k] 取一个通道
+            VisitResult v = visit(target);
+            Value* lane = v.value ? emitVectorLaneIndex(indexNode, vt, node) : nullptr;
+            if (!lane) return VisitResult();
+            return VisitResult(builder.CreateExtractElement(v.value, lane, "vget"), typeHelper.getValueTypeFromType(vt->getElementType()));
+        }
         
         if (target->type == AST_IDENTIFIER) {//处理字符串索引s[i]
             std::string varName(target->data.identifier.name);
@@ -4284,14 +6842,12 @@ public:
                     if (!idxRes.value) return VisitResult();
                     
                     Value* idxVal = idxRes.value;
-                    if (!idxVal->getType()->isIntegerTy(32)) {
-                        idxVal = builder.CreateIntCast(idxVal, Type::getInt32Ty(context), true, "idxcast");
-                    }
+                    idxVal = castToSize(idxVal, "idxcast");
                     
                     Value* charPtr = nullptr;
                     
                     if (allocatedType->isArrayTy()) {
-                        Value* zero = ConstantInt::get(Type::getInt32Ty(context), 0);
+                        Value* zero = ConstantInt::get(getSizeType(), 0);
                         charPtr = builder.CreateInBoundsGEP(
                             allocatedType, alloc, {zero, idxVal}, "char_ptr");
                     } else {
@@ -4326,17 +6882,16 @@ public:
         VisitResult idxRes = visit(indexNode);
         if (!idxRes.value) return VisitResult();
         Value* idxVal = idxRes.value;
-        if (!idxVal->getType()->isIntegerTy(32)) {
-            idxVal = builder.CreateIntCast(idxVal, Type::getInt32Ty(context), true, "idxcast");
-        }
+        idxVal = castToSize(idxVal, "idxcast");
 
         if (baseAlloc) {
             Type* allocatedType = getActualType(baseAlloc);
             if (allocatedType && allocatedType->isArrayTy()) {
                 ArrayType* at = cast<ArrayType>(allocatedType);
                 Type* elemType = at->getElementType();
+                emitIndexCheck(idxVal, varName, allocatedType, indexNode, node);
                 Value* gep = builder.CreateInBoundsGEP(allocatedType, baseAlloc, 
-                    {ConstantInt::get(Type::getInt32Ty(context),0), idxVal}, "arr_index_ptr");
+                    {ConstantInt::get(getSizeType(), 0), idxVal}, "arr_index_ptr");
                 Value* loaded = builder.CreateLoad(elemType, gep, "arr_index_load");
                 ValueType vt = typeHelper.getValueTypeFromType(elemType);
                 return VisitResult(loaded, vt);
@@ -4352,7 +6907,7 @@ public:
 
                 Function* fn = builder.GetInsertBlock() ? builder.GetInsertBlock()->getParent() : nullptr;
                 if (!fn) return VisitResult();
-
+                emitIndexCheck(idxVal, varName, allocatedType, indexNode, node);
                 BasicBlock* nullBB = BasicBlock::Create(context, "idx_null", fn);
                 BasicBlock* loadBB = BasicBlock::Create(context, "idx_load", fn);
                 BasicBlock* contBB = BasicBlock::Create(context, "idx_cont", fn);
@@ -4388,7 +6943,7 @@ public:
                 ArrayType* at = cast<ArrayType>(allocatedType);
                 Type* elemType = at->getElementType();
                 Value* gep = builder.CreateInBoundsGEP(allocatedType, alloc, 
-                    {ConstantInt::get(Type::getInt32Ty(context),0), idxVal}, "arr_index_ptr2");
+                    {ConstantInt::get(getSizeType(), 0), idxVal}, "arr_index_ptr2");
                 Value* loaded = builder.CreateLoad(elemType, gep, "arr_index_load2");
                 ValueType vt = typeHelper.getValueTypeFromType(elemType);
                 return VisitResult(loaded, vt);
@@ -4442,18 +6997,372 @@ public:
     }
 };
 
+// ==================== OPT / OBJ ====================
+static OptimizationLevel getPassBuilderOptLevel(int level) {
+    switch (level) {
+        case 1: return OptimizationLevel::O1;
+        case 2: return OptimizationLevel::O2;
+        case 3: return OptimizationLevel::O3;
+        default: return OptimizationLevel::O0;
+    }
+}
+
+#if LLVM_VERSION_MAJOR >= 18
+static CodeGenOptLevel getCodeGenOptLevel(int level) {
+    switch (level) {
+        case 1: return CodeGenOptLevel::Less;
+        case 2: return CodeGenOptLevel::Default;
+        case 3: return CodeGenOptLevel::Aggressive;
+        default: return CodeGenOptLevel::None;
+    }
+}
+#else
+static CodeGenOpt::Level getCodeGenOptLevel(int level) {
+    switch (level) {
+        case 1: return CodeGenOpt::Less;
+        case 2: return CodeGenOpt::Default;
+        case 3: return CodeGenOpt::Aggressive;
+        default: return CodeGenOpt::None;
+    }
+}
+#endif
+
+//本机 CPU 的特性串 "+avx2,+fma,-avx512f,..."，按名字排序，同一台机器每次都一样
+static std::string vixHostCpuFeatures() {
+#if LLVM_VERSION_MAJOR >= 19
+    StringMap<bool> host = sys::getHostCPUFeatures();
+#else
+    StringMap<bool> host;
+    sys::getHostCPUFeatures(host);
+#endif
+    std::vector<std::string> feats;
+    for (const auto& f : host) {
+        feats.push_back((f.getValue() ? "+" : "-") + f.getKey().str());
+    }
+    std::sort(feats.begin(), feats.end());
+    std::string out;
+    for (const std::string& f : feats) {
+        if (!out.empty()) out += ",";
+        out += f;
+    }
+    return out;
+}
+
+static TargetMachine* createVixTargetMachine(Module& module, bool pic) {
+    std::string triple = module.getTargetTriple();
+    std::string error;
+    const Target* target = TargetRegistry::lookupTarget(triple, error);
+    if (!target) {
+        llvm::errs() << "Error: Unknown target '" << triple << "': " << error << "\n";
+        return nullptr;
+    }
+
+    std::string cpu = "generic";
+    std::string features;
+    if (g_vix_target_triple.empty()) {//本机编译才用 host cpu 和它实际打开的特性 (同 -march=native)
+        cpu = sys::getHostCPUName().str();
+        features = vixHostCpuFeatures();
+    }
+
+    TargetOptions opt;
+    TargetMachine* tm = target->createTargetMachine(
+        triple, cpu, features, opt,
+        pic ? Reloc::PIC_ : Reloc::Static,
+        std::nullopt, getCodeGenOptLevel(g_vix_opt_level));
+    if (tm) {
+        module.setDataLayout(tm->createDataLayout());
+    }
+    return tm;
+}
+
+// --vec-report：把 loop-vectorize 的 remark 按函数打到 stderr
+struct VixVecReportHandler : public DiagnosticHandler {
+    static bool isVectorizer(StringRef pass) { return pass == "loop-vectorize"; }
+    bool isAnalysisRemarkEnabled(StringRef pass) const override { return isVectorizer(pass); }
+    bool isMissedOptRemarkEnabled(StringRef pass) const override { return isVectorizer(pass); }
+    bool isPassedOptRemarkEnabled(StringRef pass) const override { return isVectorizer(pass); }
+    bool isAnyRemarkEnabled() const override { return true; }
+    bool handleDiagnostics(const DiagnosticInfo& di) override {
+        auto* remark = dyn_cast<DiagnosticInfoOptimizationBase>(&di);
+        if (!remark) return false;
+        if (!isVectorizer(remark->getPassName())) return true;
+        const char* kind = remark->isPassed() ? "vectorized" : (remark->isMissed() ? "missed" : "note");
+        llvm::errs() << "vec: " << remark->getFunction().getName() << ": " << kind << ": " << remark->getMsg() << "\n";
+        return true;
+    }
+};
+
+// 进程内跑 new PM 的 O0-O3 pipeline，替代 clang -O2 / opt
+static void runVixOptPipeline(Module& module, TargetMachine* tm) {
+    if (g_vix_opt_level <= 0) return;
+    if (g_vix_vec_report) {
+        module.getContext().setDiagnosticHandler(std::make_unique<VixVecReportHandler>());
+    }
+
+    LoopAnalysisManager lam;
+    FunctionAnalysisManager fam;
+    CGSCCAnalysisManager cgam;
+    ModuleAnalysisManager mam;
+
+    PassBuilder pb(tm);
+    pb.registerModuleAnalyses(mam);
+    pb.registerCGSCCAnalyses(cgam);
+    pb.registerFunctionAnalyses(fam);
+    pb.registerLoopAnalyses(lam);
+    pb.crossRegisterProxies(lam, fam, cgam, mam);
+
+    ModulePassManager mpm = pb.buildPerModuleDefaultPipeline(getPassBuilderOptLevel(g_vix_opt_level));
+    mpm.run(module, mam);
+}
+
+static int emitVixObjectFile(Module& module, TargetMachine* tm, const std::string& obj_path) {
+    std::error_code ec;
+    raw_fd_ostream dest(obj_path, ec, sys::fs::OF_None);
+    if (ec) {
+        llvm::errs() << "Error: Cannot open object file " << obj_path << ": " << ec.message() << "\n";
+        return 1;
+    }
+
+    legacy::PassManager pm;
+#if LLVM_VERSION_MAJOR >= 18
+    CodeGenFileType ft = CodeGenFileType::ObjectFile;
+#else
+    CodeGenFileType ft = CGFT_ObjectFile;
+#endif
+    if (tm->addPassesToEmitFile(pm, dest, nullptr, ft)) {
+        llvm::errs() << "Error: Target machine can't emit an object file\n";
+        return 1;
+    }
+    pm.run(module);
+    dest.flush();
+    return 0;
+}
+
+/*
+-j N：AST 只生成一次 IR，SplitModule 按函数切成 N 份，
+每份经 bitcode 往返到独立的 LLVMContext，各自线程里跑 opt + 出 .o，
+最后 clang -r 合成一个可重定位目标文件。
+PATH 里没有 clang (只要 -obj 时不该依赖它) 就只并行 opt，优化完的分片在进程内用 llvm::Linker 拼回一个模块，单线程出 .o。
+切分和各线程的产物都是确定的，所以输出与运行次数/线程调度无关。
+PreserveLocals：internal/private 符号 (非 pub 函数、字符串常量) 和用到它们的函数分在同一份里，
+不改成 external hidden，否则两个分别编译的模块里同名的 helper、str_lit 链接时会重复定义。
+*/
+static int linkVixPartitions(const std::vector<SmallString<0>>& optimized, const char* obj_path, bool pic) {
+    LLVMContext linkContext;
+    std::unique_ptr<Module> merged;
+    for (size_t i = 0; i < optimized.size(); i++) {
+        MemoryBufferRef buf(StringRef(optimized[i].data(), optimized[i].size()), "VixModule.opt" + std::to_string(i));
+        Expected<std::unique_ptr<Module>> partModule = parseBitcodeFile(buf, linkContext);
+        if (!partModule) {
+            llvm::errs() << "Error: Failed to reload codegen partition " << i << ": " << toString(partModule.takeError()) << "\n";
+            return 1;
+        }
+        if (!merged) {
+            merged = std::move(*partModule);
+        } else if (Linker::linkModules(*merged, std::move(*partModule))) {
+            llvm::errs() << "Error: Failed to link codegen partition " << i << "\n";
+            return 1;
+        }
+    }
+    std::unique_ptr<TargetMachine> tm(createVixTargetMachine(*merged, pic));
+    if (!tm) return 1;
+    return emitVixObjectFile(*merged, tm.get(), obj_path);
+}
+
+static int emitVixObjectParallel(Module& module, const char* obj_path, bool pic, unsigned jobs) {
+    std::vector<SmallString<0>> parts;
+    SplitModule(
+        module, jobs,
+        [&](std::unique_ptr<Module> part) {
+            //运行时 helper 是 linkonce_odr，别的分片用到它时本分片可能没人用，opt 会把它当死代码删掉；改成 weak_odr 留住
+            for (GlobalValue& gv : part->global_values()) {
+                if (!gv.isDeclaration() && gv.hasLinkOnceODRLinkage()) gv.setLinkage(GlobalValue::WeakODRLinkage);
+            }
+            SmallString<0> bc;
+            raw_svector_ostream os(bc);
+            WriteBitcodeToFile(*part, os);
+            parts.push_back(std::move(bc));
+        },
+        /*PreserveLocals=*/true);
+
+    ErrorOr<std::string> clang = sys::findProgramByName("clang");
+    std::vector<std::string> partPaths(parts.size());
+    std::vector<SmallString<0>> optimized(parts.size());
+    std::vector<int> results(parts.size(), 1);
+    std::vector<double> optMs(parts.size(), 0);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < parts.size(); i++) {
+        partPaths[i] = std::string(obj_path) + ".part" + std::to_string(i) + ".o";
+        workers.emplace_back([&, i]() {
+            LLVMContext partContext;
+            MemoryBufferRef buf(StringRef(parts[i].data(), parts[i].size()), "VixModule.part" + std::to_string(i));
+            Expected<std::unique_ptr<Module>> partModule = parseBitcodeFile(buf, partContext);
+            if (!partModule) {
+                consumeError(partModule.takeError());
+                return;
+            }
+            std::unique_ptr<TargetMachine> tm(createVixTargetMachine(**partModule, pic));
+            if (!tm) return;
+            double t0 = vixNowMs();
+            runVixOptPipeline(**partModule, tm.get());
+            optMs[i] = vixNowMs() - t0;
+            if (!clang) {
+                raw_svector_ostream os(optimized[i]);
+                WriteBitcodeToFile(**partModule, os);
+                results[i] = 0;
+                return;
+            }
+            //没用到的 hidden 声明也会出一个 NOTYPE 的未定义符号，和别的分片里 TLS 的定义 (__vix_out_len 等) 合并时 ld 报类型不符
+            for (auto it = (*partModule)->global_begin(); it != (*partModule)->global_end();) {
+                GlobalVariable& gv = *it++;
+                if (gv.isDeclaration() && gv.use_empty()) gv.eraseFromParent();
+            }
+            results[i] = emitVixObjectFile(**partModule, tm.get(), partPaths[i]);
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    g_vix_phase_ms[1] += *std::max_element(optMs.begin(), optMs.end());
+
+    int failed = 0;
+    for (size_t i = 0; i < parts.size(); i++) {
+        if (results[i] != 0) {
+            llvm::errs() << "Error: Failed to emit codegen partition " << i << "\n";
+            failed = 1;
+        }
+    }
+    if (!clang) {
+        return failed ? failed : linkVixPartitions(optimized, obj_path, pic);
+    }
+
+    std::vector<StringRef> args = {*clang, "-r", "-nostdlib", "-o", obj_path};
+    if (!g_vix_target_triple.empty()) {
+        args.push_back("-target");
+        args.push_back(g_vix_target_triple);
+    }
+    for (const std::string& path : partPaths) {
+        args.push_back(path);
+    }
+    if (!failed && sys::ExecuteAndWait(*clang, args) != 0) {
+        llvm::errs() << "Error: Failed to merge codegen partitions into " << obj_path << "\n";
+        failed = 1;
+    }
+    for (const std::string& path : partPaths) {
+        sys::fs::remove(path);
+    }
+    return failed;
+}
+
 // ==================== C API ====================
+extern "C" void llvm_set_opt_level(int level) {
+    if (level < 0) level = 0;
+    if (level > 3) level = 3;
+    g_vix_opt_level = level;
+}
+
+extern "C" void llvm_set_jobs(int jobs) {
+    g_vix_jobs = jobs < 1 ? 1 : jobs;
+}
+
+extern "C" void llvm_set_print_mode(int mode) {
+    g_vix_print_mode = (mode < 0 || mode > 2) ? 0 : mode;
+}
+
+extern "C" void llvm_set_bounds_check(int enabled) {
+    g_vix_bounds_check = enabled != 0;
+}
+
+extern "C" void llvm_set_vec_report(int enabled) {
+    g_vix_vec_report = enabled != 0;
+}
+
+extern "C" void llvm_get_phase_times(double* emit_ms, double* opt_ms, double* codegen_ms) {
+    if (emit_ms) *emit_ms = g_vix_phase_ms[0];
+    if (opt_ms) *opt_ms = g_vix_phase_ms[1];
+    if (codegen_ms) *codegen_ms = g_vix_phase_ms[2];
+}
+
+extern "C" void llvm_host_cpu_desc(char* buf, size_t size) {
+    if (!buf || size == 0) return;
+    std::string desc = sys::getHostCPUName().str() + " " + vixHostCpuFeatures();
+    snprintf(buf, size, "%s", desc.c_str());
+}
+
+extern "C" void llvm_set_ir_output(FILE* llvm_fp) {
+    g_vix_ir_out = llvm_fp;
+}
+
+static void printVixModule(Module& module, FILE* llvm_fp) {
+    if (!llvm_fp) return;
+    std::string llvm_ir;
+    raw_string_ostream ros(llvm_ir);
+    module.print(ros, nullptr);
+    ros.flush();
+    fwrite(llvm_ir.data(), 1, llvm_ir.size(), llvm_fp);
+}
+
+static int emitVixObjectFromAst(ASTNode* ast_root, const char* obj_path, int pic, bool libraryModule) {
+    if (!ast_root || !obj_path) return 1;
+
+    double t0 = vixNowMs();
+    LLVMCodeGenerator generator;
+    generator.setLibraryModule(libraryModule);
+    std::unique_ptr<Module> module = generator.generate(ast_root);
+    g_vix_phase_ms[0] += vixNowMs() - t0;
+    if (!module) return 1;
+
+    std::unique_ptr<TargetMachine> tm(createVixTargetMachine(*module, pic != 0));
+    if (!tm) return 1;
+
+    unsigned definedFunctions = 0;
+    for (Function& func : *module) {
+        if (!func.isDeclaration()) definedFunctions++;
+    }
+    unsigned jobs = std::min<unsigned>(g_vix_jobs, definedFunctions);
+    t0 = vixNowMs();
+    if (jobs > 1) {
+        printVixModule(*module, g_vix_ir_out);//分区各自优化，.ll 是切分前的
+        double optBefore = g_vix_phase_ms[1];
+        int res = emitVixObjectParallel(*module, obj_path, pic != 0, jobs);
+        g_vix_phase_ms[2] += vixNowMs() - t0 - (g_vix_phase_ms[1] - optBefore);//切分、各分区出 .o、合并
+        return res;
+    }
+
+    runVixOptPipeline(*module, tm.get());
+    double t1 = vixNowMs();
+    g_vix_phase_ms[1] += t1 - t0;
+    printVixModule(*module, g_vix_ir_out);
+    int res = emitVixObjectFile(*module, tm.get(), obj_path);
+    g_vix_phase_ms[2] += vixNowMs() - t1;
+    return res;
+}
+
+extern "C" int llvm_emit_object_from_ast(ASTNode* ast_root, const char* obj_path, int pic) {
+    return emitVixObjectFromAst(ast_root, obj_path, pic, false);
+}
+
+extern "C" int llvm_emit_module_object_from_ast(ASTNode* ast_root, const char* obj_path, int pic) {
+    return emitVixObjectFromAst(ast_root, obj_path, pic, true);
+}
+
 void llvm_emit_from_ast(ASTNode* ast_root, FILE* llvm_fp) {
     if (!ast_root || !llvm_fp) return;
     
+    double t0 = vixNowMs();
     LLVMCodeGenerator generator;
     std::unique_ptr<Module> module = generator.generate(ast_root);
+    double t1 = vixNowMs();
+    g_vix_phase_ms[0] += t1 - t0;
     
+    if (module && g_vix_opt_level > 0) {
+        std::unique_ptr<TargetMachine> tm(createVixTargetMachine(*module, true));
+        runVixOptPipeline(*module, tm.get());
+        g_vix_phase_ms[1] += vixNowMs() - t1;
+    }
+
     if (module) {
-        std::string llvm_ir;
-        raw_string_ostream ros(llvm_ir);
-        module->print(ros, nullptr);
-        fprintf(llvm_fp, "%s", llvm_ir.c_str());
+        printVixModule(*module, llvm_fp);
     }
 }
 
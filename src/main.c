@@ -32,6 +32,7 @@ semantic_errors -> errs
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include "../include/ast.h"
 #include "../include/parser.h"
@@ -39,23 +40,69 @@ semantic_errors -> errs
 #include "../include/vic-ir/mir.h"
 #include "../include/llvm_emit.h"
 #include "../include/semantic.h"
+#include "../include/vm.h"
+#include "../include/cache.h"
+#include "../include/qbe-ir/ir.h"
+#include "../include/qbe-ir/opt.h"
 
-extern FILE* yyin;
 extern ASTNode* root;
 void create_lib_files();
 void analyze_ast(TypeInferenceContext* ctx, ASTNode* node);
+static int check_modules(int nmods);
+static char* emit_modules(int nmods, const char* out_f, int pic);
+static FILE* open_cached_interface(const char* module_path);
+static void remove_modules(int nmods, const char* out_f);
+static int build_qbe(const char* out_f, const char* obj_f, const char* in_f, int keep);
 const char* current_input_filename = NULL;
+static char g_module_flags[2600];//分离编译时模块缓存 key 用的选项，空串表示不缓存模块
+
+//--time-phases：前端各阶段在 main 里计时，emit / opt / codegen 由 LLVM 后端累计（含 import 模块）
+//--backend=qbe 时 emit / opt / codegen 是 ir_gen、qbe_opt_file 和 qbe 进程，也在 main 里计时
+enum { PH_PARSE, PH_IMPORTS, PH_SEMANTIC, PH_FOLD, PH_EMIT, PH_OPT, PH_CODEGEN, PH_LINK, PH_COUNT };
+static double ph_ms[PH_COUNT];
+static int ph_qbe = 0;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void report_phases(int mode, double start) {
+    if (!mode) return;
+    double be[3] = {ph_ms[PH_EMIT], ph_ms[PH_OPT], ph_ms[PH_CODEGEN]};
+    if (!ph_qbe) {
+        llvm_get_phase_times(&be[0], &be[1], &be[2]);
+    }
+    const char* names[] = {"parse", "imports", "semantic", "fold", "emit", "opt", "codegen", "link"};
+    double ms[] = {ph_ms[PH_PARSE], ph_ms[PH_IMPORTS], ph_ms[PH_SEMANTIC], ph_ms[PH_FOLD], be[0], be[1], be[2], ph_ms[PH_LINK]};
+    double total = now_ms() - start;
+    if (mode == 2) {//一行 JSON，给 bench/run.py 解析
+        fprintf(stderr, "{\"phases_ms\": {");
+        for (int i = 0; i < 8; i++) {
+            fprintf(stderr, "%s\"%s\": %.3f", i ? ", " : "", names[i], ms[i]);
+        }
+        fprintf(stderr, "}, \"total_ms\": %.3f}\n", total);
+        return;
+    }
+    for (int i = 0; i < 8; i++) {
+        fprintf(stderr, "  %-9s %10.3f ms\n", names[i], ms[i]);
+    }
+    fprintf(stderr, "  %-9s %10.3f ms\n", "total", total);
+}
 
 int main(int argc, char **argv) {
     if (argc < 2) {
         fprintf(stderr, "usage: %s <input.vix> [-o output_file]\n", argv[0]);
+        fprintf(stderr, "       %s run <input.vix> (run with the bytecode VM, no native build)\n", argv[0]);
         fprintf(stderr, "       %s <input.vix>  -o <output_file> [-kt]\n", argv[0]);
         fprintf(stderr, "       %s <input.vix>  -ir <vic_ir_file>\n", argv[0]);
         fprintf(stderr, "       %s <input.vix> -ll <llvm_ir_file>\n", argv[0]);
-        fprintf(stderr, "       %s <input.vix> -obj [obj_file] (output object file via llc)\n", argv[0]);
+        fprintf(stderr, "       %s <input.vix> -obj [obj_file] (output object file, no .ll)\n", argv[0]);
         fprintf(stderr, "       %s <input.vix> -ast (output AST only)\n", argv[0]);
         fprintf(stderr, "       %s <input.vix> -ll (output LLVM IR only)\n", argv[0]);
         fprintf(stderr, "       %s <input.vix> -llvm (output LLVM IR only)\n", argv[0]);
+        fprintf(stderr, "       %s <input.vix> -O<0-3> (optimization level, default -O2 for executables, -O0 otherwise)\n", argv[0]);
         fprintf(stderr, "       %s <input.vix> --debug (enable debug logs)\n", argv[0]);
         fprintf(stderr, "       %s <input.vix> --target=<triple> (set codegen/link target)\n", argv[0]);
         return 1;
@@ -77,20 +124,36 @@ int main(int argc, char **argv) {
     int gen_vic = 0;
     int gen_llvm = 0;
     int gen_obj = 0;
+    int ll_req = 0;
+    int opt_lv = -1;
+    int jobs = 1;
+    int no_cache = 0;
+    int unbuf = 0;
+    int bchk = 0;
+    int vrep = 0;
     int out_ast = 0;
     int out_llvm = 0;
     int dbg = 0;
     char* target = NULL;
     int no_std = 0;
     int no_main = 0;
+    int run_vm = strcmp(argv[1], "run") == 0;//vixc run：字节码虚拟机直接执行
+    int tphase = 0;//1 表格 2 JSON
+    int qbe_be = 0;//--backend=qbe
+    int qbe_exp = 0;//--experimental-qbe：qbe 后端还没在 CI 里对真正的 qbe 跑通过，要显式打开
+    double t_start = now_ms();
     
-    for (int i = 1; i < argc; i++) {
+    for (int i = 1 + run_vm; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0) {
+            i++;
+            continue;
+        }
         if (argv[i][0] != '-' && strcmp(argv[i], "init") != 0) {
             in_f = argv[i];
             break;
         }
     }
-    for (int i = 1; i < argc; i++) {
+    for (int i = 1 + run_vm; i < argc; i++) {
         if (strncmp(argv[i], "--target=", 9) == 0) {
             target = argv[i] + 9;
         } else if (strcmp(argv[i], "--target") == 0) {
@@ -111,7 +174,7 @@ int main(int argc, char **argv) {
                 return 1;
             }
         } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--version") == 0 || strcmp(argv[i] , "-ver") == 0){
-            printf("Vix Compiler 0.1.0_rc1_2 (Beta_26.01.01) by:Mincx1203 Copyright(c) 2025-2026\n");
+            printf("Vix Compiler " VIX_VERSION " by:Mincx1203 Copyright(c) 2025-2026\n");
             return 0;
         } else if (strcmp(argv[i], "-ir") == 0) {
             if (i + 1 < argc) {
@@ -126,7 +189,6 @@ int main(int argc, char **argv) {
             out_llvm = 1;
         } else if (strcmp(argv[i], "-obj") == 0) {
             gen_obj = 1;
-            gen_llvm = 1;
             if (i + 1 < argc && argv[i + 1][0] != '-') {
                 obj_f = argv[i + 1];
                 i++;
@@ -135,10 +197,50 @@ int main(int argc, char **argv) {
             if (i + 1 < argc && argv[i + 1][0] != '-') {
                 llvm_f = argv[i + 1];
                 gen_llvm = 1;
+                ll_req = 1;
                 i++;
             } else {
                 out_llvm = 1;
             }
+        } else if (strncmp(argv[i], "-O", 2) == 0 && argv[i][2] >= '0' && argv[i][2] <= '3' && argv[i][3] == '\0') {
+            opt_lv = argv[i][2] - '0';
+        } else if (strncmp(argv[i], "-j", 2) == 0) {
+            const char* js = argv[i] + 2;
+            if (*js == '\0') {
+                if (i + 1 >= argc) {
+                    fprintf(stderr, "Er: -j option requires a job count\n");
+                    return 1;
+                }
+                js = argv[++i];
+            }
+            jobs = atoi(js);
+            if (jobs < 1) {
+                fprintf(stderr, "Er: invalid job count: %s\n", js);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--no-cache") == 0) {
+            no_cache = 1;
+        } else if (strcmp(argv[i], "--unbuffered") == 0) {
+            unbuf = 1;
+        } else if (strcmp(argv[i], "--bounds-check") == 0) {
+            bchk = 1;
+        } else if (strcmp(argv[i], "--vec-report") == 0) {
+            vrep = 1;
+        } else if (strcmp(argv[i], "--time-phases") == 0) {
+            tphase = 1;
+        } else if (strcmp(argv[i], "--time-phases=json") == 0) {
+            tphase = 2;
+        } else if (strncmp(argv[i], "--backend=", 10) == 0) {
+            if (strcmp(argv[i] + 10, "qbe") == 0) {
+                qbe_be = 1;
+            } else if (strcmp(argv[i] + 10, "llvm") == 0) {
+                qbe_be = 0;
+            } else {
+                fprintf(stderr, "Er: unknown backend '%s' (expected llvm or qbe)\n", argv[i] + 10);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--experimental-qbe") == 0) {
+            qbe_exp = 1;
         } else if (strcmp(argv[i], "-kt") == 0) {
             keep_c = 1;
         } else if (strcmp(argv[i], "-ast") == 0) {
@@ -147,21 +249,30 @@ int main(int argc, char **argv) {
             dbg = 1;
         } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
             fprintf(stderr, "usage: %s <input.vix> [-o output_file]\n", argv[0]);
+            fprintf(stderr, "       %s run <input.vix> (run with the bytecode VM, --debug dumps bytecode)\n", argv[0]);
             fprintf(stderr, "       %s <input.vix> [-o output_file] [-kt]\n", argv[0]);
             fprintf(stderr, "       %s <input.vix> -ir <vic_ir_file>\n", argv[0]);
             fprintf(stderr, "       %s <input.vix> -llvm <llvm_ir_file>\n", argv[0]);
             fprintf(stderr, "       %s <input.vix> -ll <llvm_ir_file>\n", argv[0]);
-            fprintf(stderr, "       %s <input.vix> -obj [obj_file] (output object file via llc)\n", argv[0]);
+            fprintf(stderr, "       %s <input.vix> -obj [obj_file] (output object file, no .ll)\n", argv[0]);
             fprintf(stderr, "       %s <input.vix> -ast (output AST only)\n", argv[0]);
             fprintf(stderr, "       %s <input.vix> -ll (output LLVM IR only)\n", argv[0]);
             fprintf(stderr, "       %s <input.vix> -llvm (output LLVM IR only)\n", argv[0]);
+            fprintf(stderr, "       %s <input.vix> -O<0-3> (optimization level, default -O2 for executables, -O0 otherwise)\n", argv[0]);
+            fprintf(stderr, "       %s <input.vix> -j N (split codegen into N partitions, optimized and emitted in parallel)\n", argv[0]);
+            fprintf(stderr, "       %s <input.vix> --no-cache (do not reuse or store objects in ~/.cache/vix)\n", argv[0]);
+            fprintf(stderr, "       %s <input.vix> --unbuffered (flush stdout after every print)\n", argv[0]);
+            fprintf(stderr, "       %s <input.vix> --bounds-check (trap on out-of-range array/list indices)\n", argv[0]);
+            fprintf(stderr, "       %s <input.vix> --vec-report (print which loops were vectorized and why not)\n", argv[0]);
+            fprintf(stderr, "       %s <input.vix> --time-phases[=json] (print per-phase compile times to stderr)\n", argv[0]);
             fprintf(stderr, "       %s <input.vix> --debug (enable debug logs)\n", argv[0]);
             fprintf(stderr, "       %s <input.vix> --target=<triple> (set codegen/link target, e.g. x86_64-unknown-none)\n", argv[0]);
+            fprintf(stderr, "       %s <input.vix> --backend=qbe --experimental-qbe (experimental: fast unoptimized build through qbe and the system assembler, -kt keeps .ssa/.s)\n", argv[0]);
             fprintf(stderr, "       %s <input.vix> (LLVM backend is the default backend)\n", argv[0]);
             return 0;
         } else if (argv[i][0] == '-' && strcmp(argv[i], "-") != 0) {
             fprintf(stderr, "Unknown option: %s\n", argv[i]);
-            fprintf(stderr, "Usage: %s <input.vix> [-o output_file] [-kt] [-ir vic_file] [-llvm [llvm_file]] [-ll [llvm_file]] [-obj [obj_file]] [-ast] [--debug] [--target=<triple>]\n", argv[0]);
+            fprintf(stderr, "Usage: %s <input.vix> [-o output_file] [-kt] [-ir vic_file] [-llvm [llvm_file]] [-ll [llvm_file]] [-obj [obj_file]] [-O<0-3>] [-j N] [--no-cache] [--unbuffered] [--bounds-check] [--vec-report] [--time-phases[=json]] [-ast] [--debug] [--target=<triple>] [--backend=llvm|qbe [--experimental-qbe]]\n", argv[0]);
             return 1;
         } else {
             is_vic = strlen(argv[i]) > 4 && strcmp(argv[i] + strlen(argv[i]) - 4, ".vic") == 0;
@@ -169,9 +280,14 @@ int main(int argc, char **argv) {
     }
     setenv("VIX_DEBUG", dbg ? "1" : "0", 1);//通过环境变量控制调试输出
     if (!in_f) {
+        if (run_vm) {
+            fprintf(stderr, "usage: %s run <input.vix>\n", argv[0]);
+            return 1;
+        }
         in_f = argv[1];
     }
     int exp_mode =
+        run_vm ||
         out_ast ||
         out_llvm ||
         gen_vic ||
@@ -224,6 +340,11 @@ int main(int argc, char **argv) {
         eff_t = "x86_64-unknown-none";
     }
     llvm_set_target_triple(eff_t);
+    if (opt_lv < 0) {
+        opt_lv = save_c ? 2 : 0;//直接出可执行文件时保持以前 clang -O2 的默认行为
+    }
+    llvm_set_opt_level(opt_lv);
+    llvm_set_jobs(jobs);
 
     int bare = 0;
     if (eff_t && (strstr(eff_t, "unknown-none") != NULL || strstr(eff_t, "unknow-noe") != NULL)) {
@@ -232,6 +353,30 @@ int main(int argc, char **argv) {
     if (no_std || no_main) {
         bare = 1;
     }
+    if (qbe_be && !run_vm) {
+        if (!qbe_exp) {
+            fprintf(stderr, "Er: --backend=qbe is experimental, add --experimental-qbe to use it\n");
+            fclose(input_file);
+            return 1;
+        }
+        if (bare || eff_t) {
+            fprintf(stderr, "Er: --backend=qbe only builds for the host, use the LLVM backend for --target / #[no_std] / #[no_main]\n");
+            fclose(input_file);
+            return 1;
+        }
+        if (out_llvm || ll_req) {
+            fprintf(stderr, "Er: -ll / -llvm need the LLVM backend\n");
+            fclose(input_file);
+            return 1;
+        }
+        qbe_set_print_mode(unbuf);
+        qbe_set_bounds_check(bchk);
+        ph_qbe = 1;
+    }
+    llvm_set_print_mode(bare ? 2 : unbuf);//裸机没有 stdio，仍走 printf
+    llvm_set_bounds_check(bchk && !bare);
+    llvm_set_vec_report(vrep);
+    if (vrep) no_cache = 1;//命中缓存就不跑优化，也就没有报告
     
     if (save_c) {
         gen_llvm = 1;
@@ -281,20 +426,54 @@ int main(int argc, char **argv) {
     current_input_filename = in_f;
     load_source_file(in_f);
     set_location_with_column(in_f, 1, 1);
-    yyin = input_file;
-    
-    int result = yyparse();
+
+    //只缓存最终 .o：源文件和递归 import 都没变就跳过解析/语义/codegen
+    //出可执行文件时 import 的模块各自编成 .o 再链接；-obj/-ll 等仍是单个翻译单元
+    int sep = save_c && !gen_obj && !qbe_be;//qbe 后端整个程序一个 .ssa
+    int nmods = 0;
+    char host_cpu[2048] = "";
+    if (!eff_t && !qbe_be) {//本机编译按 host cpu 和它的特性出码，换了 CPU 不能复用
+        llvm_host_cpu_desc(host_cpu, sizeof(host_cpu));
+    }
+    char cflags[2560];
+    snprintf(cflags, sizeof(cflags), "O%d j%d pic%d sep%d ub%d bc%d t=%s cpu=%s", opt_lv, jobs, !bare, sep, unbuf, bchk,
+             eff_t ? eff_t : "", host_cpu);
+    char ckey[VIX_CACHE_KEY_LEN] = "";
+    int chit = 0;
+    if (!no_cache && !qbe_be && (gen_obj || save_c) && !ll_req && !keep_c && !out_llvm && !out_ast && !gen_vic && !run_vm) {
+        if (vix_cache_key(in_f, cflags, ckey)) {
+            chit = !sep && vix_cache_has(ckey);//分离编译要先解析出模块列表，只复用各个 .o
+        }
+    }
+
+    double t0 = now_ms();
+    int result = 0;
+    if (!chit) {
+        lexer_begin(input_file);
+        result = yyparse();
+        lexer_end();
+    }
+    ph_ms[PH_PARSE] = now_ms() - t0;
+    t0 = now_ms();
     if (result == 0 && root) {
-        inline_imports(root);
+        if (sep) {
+            if (!no_cache) {
+                snprintf(g_module_flags, sizeof(g_module_flags), "%s module", cflags);
+                set_module_interface_cache(open_cached_interface);
+            }
+            nmods = import_module_interfaces(root);
+        } else {
+            inline_imports(root);
+        }
     }
+    ph_ms[PH_IMPORTS] = now_ms() - t0;
     
     if (result == 0) {
-        int errs = check_undefined_symbols(root);
+        t0 = now_ms();
+        int errs = check_undefined_symbols(root) + check_modules(nmods);
         if (errs > 0) {
             fprintf(stderr, "Error: Found %d semantic error(s)\n", errs);
-            if (root) {
-                free_ast(root);
-            }
+            free_ast_arena();
             cleanup_error_handler();
             fclose(input_file);
             return 1;
@@ -307,13 +486,26 @@ int main(int argc, char **argv) {
         }
         if (get_error_count() > 0) {
             fprintf(stderr, "Compilation failed with %d error(s)\n", get_error_count());
-            if (root) {
-                free_ast(root);
-            }
+            free_ast_arena();
             cleanup_error_handler();
             fclose(input_file);
             return 1;
         }
+        ph_ms[PH_SEMANTIC] = now_ms() - t0;
+        t0 = now_ms();
+        fold_constants(root);
+        for (int i = 0; i < nmods; i++) {
+            fold_constants(imported_module_root(i, NULL));
+        }
+        ph_ms[PH_FOLD] = now_ms() - t0;
+
+        if (run_vm) {
+            int rc = vm_run_ast(root, dbg);
+            free_ast_arena();
+            cleanup_error_handler();
+            fclose(input_file);
+            return rc;
+        }
 
         if (gen_vic) {
             char vic_filename[256];
@@ -329,103 +521,149 @@ int main(int argc, char **argv) {
             }
             vic_gen(root, vic_file);
             fclose(vic_file);
-            if (root) free_ast(root);
+            free_ast_arena();
             fclose(input_file);
             return 0;
         }
         
-        if (gen_llvm) {
+        if (qbe_be && (gen_obj || save_c)) {
+            int rc = build_qbe(save_c ? out_f : NULL, gen_obj ? (obj_f ? obj_f : "") : NULL, in_f, keep_c);
+            if (rc == 0) {
+                report_phases(tphase, t_start);
+            }
+            free_ast_arena();
+            cleanup_error_handler();
+            fclose(input_file);
+            return rc;
+        }
+
+        if (gen_llvm || gen_obj) {
+            int want_ll = gen_llvm && (ll_req || keep_c || !save_c);
+            int need_obj = gen_obj || (out_f && save_c);
+            FILE* ll_out = NULL;//要出 .o 时 .ll 跟着同一次 codegen 写，错误只报一遍
             char llvm_filename[2048];
-            if (!llvm_f) {
-                char* dot = strrchr(in_f, '.');
-                if (dot) {
-                    size_t len = dot - in_f;
-                    snprintf(llvm_filename, sizeof(llvm_filename), "%.*s.ll", (int)len, in_f);
+            if (want_ll) {
+                if (!llvm_f) {
+                    char* dot = strrchr(in_f, '.');
+                    if (dot) {
+                        size_t len = dot - in_f;
+                        snprintf(llvm_filename, sizeof(llvm_filename), "%.*s.ll", (int)len, in_f);
+                    } else {
+                        snprintf(llvm_filename, sizeof(llvm_filename), "%s.ll", in_f);
+                    }
+                    llvm_f = llvm_filename;
                 } else {
-                    snprintf(llvm_filename, sizeof(llvm_filename), "%s.ll", in_f);
+                    if (strstr(llvm_f, ".ll") == NULL) {
+                        snprintf(llvm_filename, sizeof(llvm_filename), "%s.ll", llvm_f);
+                        llvm_f = llvm_filename;
+                    }
                 }
-                llvm_f = llvm_filename;
-            } else {
-                if (strstr(llvm_f, ".ll") == NULL) {
-                    snprintf(llvm_filename, sizeof(llvm_filename), "%s.ll", llvm_f);
-                    llvm_f = llvm_filename;
+
+                FILE* llvm_file = fopen(llvm_f, "w");
+                if (!llvm_file) {
+                    fprintf(stderr, "Error: Cannot open LLVM IR file %s for writing\n", llvm_f);
+                    fclose(input_file);
+                    return 1;
                 }
-            }
-            
-            FILE* llvm_file = fopen(llvm_f, "w");
-            if (!llvm_file) {
-                fprintf(stderr, "Error: Cannot open LLVM IR file %s for writing\n", llvm_f);
-                fclose(input_file);
-                return 1;
-            }
-            
-            llvm_emit_from_ast(root, llvm_file);
-            fclose(llvm_file);
 
-            if (get_error_count() > 0) {
-                fprintf(stderr, "Compilation failed with %d error(s)\n", get_error_count());
-                if (!keep_c) {
-                    remove(llvm_f);
+                if (need_obj) {
+                    ll_out = llvm_file;
+                } else {
+                    llvm_emit_from_ast(root, llvm_file);
+                    fclose(llvm_file);
                 }
-                if (root) {
-                    free_ast(root);
+
+                if (!ll_out && get_error_count() > 0) {
+                    fprintf(stderr, "Compilation failed with %d error(s)\n", get_error_count());
+                    if (!keep_c) {
+                        remove(llvm_f);
+                    }
+                    free_ast_arena();
+                    cleanup_error_handler();
+                    fclose(input_file);
+                    return 1;
                 }
-                cleanup_error_handler();
-                fclose(input_file);
-                return 1;
             }
 
-            if (gen_obj) {
+            if (need_obj) {
                 char oname[2048];
                 const char* fobj = obj_f;
-                if (!fobj) {
-                    char* dot = strrchr(in_f, '.');
-                    if (dot) {
-                        size_t len = dot - in_f;
-                        snprintf(oname, sizeof(oname), "%.*s.o", (int)len, in_f);
-                    } else {
-                        snprintf(oname, sizeof(oname), "%s.o", in_f);
+                if (gen_obj) {
+                    if (!fobj) {
+                        char* dot = strrchr(in_f, '.');
+                        if (dot) {
+                            size_t len = dot - in_f;
+                            snprintf(oname, sizeof(oname), "%.*s.o", (int)len, in_f);
+                        } else {
+                            snprintf(oname, sizeof(oname), "%s.o", in_f);
+                        }
+                        fobj = oname;
+                    } else if (strstr(fobj, ".o") == NULL) {
+                        snprintf(oname, sizeof(oname), "%s.o", fobj);
+                        fobj = oname;
                     }
+                } else {
+                    snprintf(oname, sizeof(oname), "%s.o", out_f);//链接用的临时目标文件
                     fobj = oname;
-                } else if (strstr(fobj, ".o") == NULL) {
-                    snprintf(oname, sizeof(oname), "%s.o", fobj);
-                    fobj = oname;
                 }
-                char lcmd[8192];
-                if (eff_t) {
-                    snprintf(lcmd, sizeof(lcmd),
-                             "llc -filetype=obj -relocation-model=%s -mtriple=%s %s -o %s",
-                             bare ? "static" : "pic",
-                             eff_t, llvm_f, fobj);
+
+                //进程内 TargetMachine 直接出 .o，不再经过 .ll + llc
+                if (sep && ckey[0]) {
+                    chit = vix_cache_has(ckey);
+                }
+                int ores;
+                if (chit) {
+                    ores = !vix_cache_fetch(ckey, fobj);
+                    if (ll_out) llvm_emit_from_ast(root, ll_out);
                 } else {
-                    snprintf(lcmd, sizeof(lcmd),
-                             "llc -filetype=obj -relocation-model=%s %s -o %s",
-                             bare ? "static" : "pic",
-                             llvm_f, fobj);
+                    llvm_set_ir_output(ll_out);
+                    ores = llvm_emit_object_from_ast(root, fobj, !bare);
+                    llvm_set_ir_output(NULL);
                 }
-
-                int lres = system(lcmd);
-                if (lres != 0) {
-                    fprintf(stderr, "Error: Failed to compile LLVM IR to object file via llc\n");
+                if (ll_out) {
+                    fclose(ll_out);
+                    ll_out = NULL;
+                    if (get_error_count() > 0 && !keep_c) {
+                        remove(llvm_f);
+                    }
+                }
+                if (ores == 0 && !chit && ckey[0] && get_error_count() == 0) {
+                    vix_cache_store(ckey, fobj);
+                }
+                char* mobjs = NULL;
+                if (ores == 0 && nmods > 0) {
+                    mobjs = emit_modules(nmods, out_f, !bare);
+                    if (!mobjs) {
+                        ores = 1;
+                        remove_modules(nmods, out_f);
+                    }
+                }
+                if (ores != 0 || get_error_count() > 0) {
+                    if (get_error_count() > 0) {
+                        fprintf(stderr, "Compilation failed with %d error(s)\n", get_error_count());
+                    } else {
+                        fprintf(stderr, "Error: Failed to emit object file %s\n", fobj);
+                    }
+                    remove(fobj);
+                    free_ast_arena();
+                    cleanup_error_handler();
                     fclose(input_file);
                     return 1;
                 }
 
                 if (!save_c) {
-                    if (root) {
-                        free_ast(root);
-                    }
+                    report_phases(tphase, t_start);
+                    free_ast_arena();
                     fclose(input_file);
                     return 0;
                 }
-            }
-            if (out_f && save_c) {
+
                 const char* ls = "linker.ld";
                 if (bare && access(ls, R_OK) != 0 && access("src/linker.ld", R_OK) == 0) {
                     ls = "src/linker.ld";
                 }
 
-                size_t ccmd_sz = 8192;
+                size_t ccmd_sz = 8192 + (mobjs ? strlen(mobjs) : 0);
                 char *ccmd = malloc(ccmd_sz);
                 if (ccmd == NULL) {
                     fprintf(stderr, "Er: Failed to allocate memory for clang command\n");
@@ -436,37 +674,38 @@ int main(int argc, char **argv) {
                 if (bare) {
                     const char* f_t = eff_t ? eff_t : "x86_64-unknown-none";
                     snprintf(ccmd, ccmd_sz,
-                             "clang -O2 %s -o %s -target %s -ffreestanding -fno-builtin -fno-pic -fno-pie -no-pie -nostdlib -nostartfiles -nodefaultlibs -static -Wl,--build-id=none -Wl,--no-dynamic-linker -Wl,-z,max-page-size=0x1000 -Wl,-e,_start -Wl,-T,%s",
-                             llvm_f, out_f, f_t, ls);
+                             "clang %s%s -o %s -target %s -fno-pic -fno-pie -no-pie -nostdlib -nostartfiles -nodefaultlibs -static -Wl,--build-id=none -Wl,--no-dynamic-linker -Wl,-z,max-page-size=0x1000 -Wl,-e,_start -Wl,-T,%s",
+                             fobj, mobjs ? mobjs : "", out_f, f_t, ls);
                 } else if (eff_t) {
                     snprintf(ccmd, ccmd_sz,
-                             "clang -O2 %s -o %s -target %s $(llvm-config --ldflags --libs all) -lm -lstdc++",
-                             llvm_f, out_f, eff_t);
+                             "clang %s%s -o %s -target %s $(llvm-config --ldflags --libs all) -lm -lstdc++",
+                             fobj, mobjs ? mobjs : "", out_f, eff_t);
                 } else {
-                    snprintf(ccmd, ccmd_sz, "clang -O2 %s -o %s $(llvm-config --ldflags --libs all) -lm -lstdc++", llvm_f, out_f);
+                    snprintf(ccmd, ccmd_sz, "clang %s%s -o %s $(llvm-config --ldflags --libs all) -lm -lstdc++", fobj, mobjs ? mobjs : "", out_f);
                 }
                 
+                t0 = now_ms();
                 int cres = system(ccmd);
+                ph_ms[PH_LINK] = now_ms() - t0;
+                free(ccmd);
+                free(mobjs);
+                if (!keep_c) {
+                    remove_modules(nmods, out_f);
+                }
                 if (cres != 0) {
-                    fprintf(stderr, "Error: Failed to compile LLVM IR to executable\n");
-                    free(ccmd);
+                    fprintf(stderr, "Error: Failed to link object file into executable\n");
                     fclose(input_file);
                     return 1;
                 }
                 
-                free(ccmd);
-                
-                if (!keep_c) {
-                    remove(llvm_f);
+                if (!gen_obj && !keep_c) {
+                    remove(fobj);
                 }
             }
             
-            if (root) {
-                free_ast(root);
-            }//福瑞
+            report_phases(tphase, t_start);
+            free_ast_arena();//福瑞
             fclose(input_file);
-            if (out_f && out_f != in_f && out_f != argv[1] && out_f != llvm_f) {
-            }
             
             return 0;
         }
@@ -475,7 +714,7 @@ int main(int argc, char **argv) {
             printf("===========================AST=======================\n");
             print_ast(root, 0);
             printf("===================================================\n");
-            if (root) free_ast(root);
+            free_ast_arena();
             fclose(input_file);
             return 0;
         }
@@ -484,7 +723,7 @@ int main(int argc, char **argv) {
             printf("=========================LLVM IR===================\n");
             llvm_emit_from_ast(root, stdout);
             printf("===================================================\n");
-            if (root) free_ast(root);
+            free_ast_arena();
             fclose(input_file);
             return 0;
         }
@@ -495,9 +734,7 @@ int main(int argc, char **argv) {
         }
     }
     
-    if (root) {
-        free_ast(root);
-    }
+    free_ast_arena();
     cleanup_error_handler();
     fclose(input_file);
     if (out_f && out_f != in_f && out_f != argv[1]) {
@@ -509,6 +746,176 @@ int main(int argc, char **argv) {
     return result;
 }
 
+static int check_modules(int nmods) {
+    int errs = 0;
+    const char* saved = current_input_filename;
+    for (int i = 0; i < nmods; i++) {
+        const char* path = NULL;
+        ASTNode* m = imported_module_root(i, &path);
+        if (!m) continue;
+        current_input_filename = path;
+        errs += check_undefined_symbols(m);
+    }
+    current_input_filename = saved;
+    return errs;
+}
+
+static int module_cache_key(const char* path, char key[VIX_CACHE_KEY_LEN]) {
+    key[0] = '\0';
+    if (!g_module_flags[0] || !vix_cache_key(path, g_module_flags, key)) {
+        key[0] = '\0';
+        return 0;
+    }
+    return 1;
+}
+
+//import_module_interfaces 的接口缓存：.o 和 .vi 都在才算命中，这个模块就不用再解析
+static FILE* open_cached_interface(const char* module_path) {
+    char key[VIX_CACHE_KEY_LEN];
+    if (!module_cache_key(module_path, key) || !vix_cache_has(key)) return NULL;
+    return vix_cache_open_interface(key);
+}
+
+//模块接口先写到 <mobj>.vi 再放进缓存，和模块的 .o 用同一个 key
+static void cache_module_interface(int index, const char* key, const char* mobj) {
+    char vi[2100];
+    snprintf(vi, sizeof(vi), "%s.vi", mobj);
+    FILE* f = fopen(vi, "w");
+    if (!f) return;
+    int ok = write_module_interface(index, f);
+    ok = (fclose(f) == 0) && ok;
+    if (ok) vix_cache_store_interface(key, vi);
+    remove(vi);
+}
+
+//每个 import 模块编成 <out_f>.m<i>.o（命中缓存就直接取），返回拼好的 " a.o b.o" 供链接
+static char* emit_modules(int nmods, const char* out_f, int pic) {
+    size_t cap = 256, len = 0;
+    char* objs = malloc(cap);
+    if (!objs) return NULL;
+    objs[0] = '\0';
+    const char* saved = current_input_filename;
+    for (int i = 0; i < nmods; i++) {
+        const char* path = NULL;
+        ASTNode* m = imported_module_root(i, &path);
+        if (!path) continue;
+        char mobj[2048];
+        char mkey[VIX_CACHE_KEY_LEN];
+        snprintf(mobj, sizeof(mobj), "%s.m%d.o", out_f, i);
+        module_cache_key(path, mkey);
+        int ok = mkey[0] && vix_cache_fetch(mkey, mobj);
+        if (!ok && !m) {
+            //接口是从缓存读的，.o 却在这之后被删了
+            fprintf(stderr, "Er: cached object for module %s is gone, rebuild with --no-cache\n", path);
+            free(objs);
+            return NULL;
+        }
+        if (!ok) {
+            current_input_filename = path;
+            ok = llvm_emit_module_object_from_ast(m, mobj, pic) == 0 && get_error_count() == 0;
+            current_input_filename = saved;
+            if (ok && mkey[0]) vix_cache_store(mkey, mobj);
+        }
+        if (ok && m && mkey[0]) cache_module_interface(i, mkey, mobj);
+        if (!ok) {
+            fprintf(stderr, "Error: Failed to emit module object %s\n", mobj);
+            free(objs);
+            return NULL;
+        }
+        size_t need = len + strlen(mobj) + 2;
+        if (need > cap) {
+            while (cap < need) cap *= 2;
+            char* grown = realloc(objs, cap);
+            if (!grown) {
+                free(objs);
+                return NULL;
+            }
+            objs = grown;
+        }
+        len += (size_t)snprintf(objs + len, cap - len, " %s", mobj);
+    }
+    return objs;
+}
+
+static void remove_modules(int nmods, const char* out_f) {
+    char mobj[2048];
+    for (int i = 0; i < nmods; i++) {
+        snprintf(mobj, sizeof(mobj), "%s.m%d.o", out_f, i);
+        remove(mobj);
+    }
+}
+
+//--backend=qbe：ir_gen 出 <out>.ssa，窥孔清理后交给 qbe 出 <out>.s，再用系统 cc 汇编、链接
+//obj_f 为 "" 时目标文件名按输入文件名来；-kt 保留 .ssa 和 .s
+static int build_qbe(const char* out_f, const char* obj_f, const char* in_f, int keep) {
+    char base[2048], oname[2048], ssa[2100], asmf[2100], cmd[8192];
+    if (obj_f && !obj_f[0]) {
+        const char* dot = strrchr(in_f, '.');
+        snprintf(oname, sizeof(oname), "%.*s.o", dot ? (int)(dot - in_f) : (int)strlen(in_f), in_f);
+        obj_f = oname;
+    } else if (obj_f && strstr(obj_f, ".o") == NULL) {
+        snprintf(oname, sizeof(oname), "%s.o", obj_f);
+        obj_f = oname;
+    }
+    snprintf(base, sizeof(base), "%s", out_f ? out_f : obj_f);
+    snprintf(ssa, sizeof(ssa), "%s.ssa", base);
+    snprintf(asmf, sizeof(asmf), "%s.s", base);
+
+    double t0 = now_ms();
+    FILE* fp = fopen(ssa, "w");
+    if (!fp) {
+        fprintf(stderr, "Er: Cannot open QBE IL file %s for writing\n", ssa);
+        return 1;
+    }
+    ir_gen(root, fp);
+    fclose(fp);
+    ph_ms[PH_EMIT] = now_ms() - t0;
+    if (get_error_count() > 0) {
+        fprintf(stderr, "Compilation failed with %d error(s)\n", get_error_count());
+        if (!keep) {
+            remove(ssa);
+        }
+        return 1;
+    }
+
+    t0 = now_ms();
+    qbe_opt_file(ssa);
+    ph_ms[PH_OPT] = now_ms() - t0;
+
+    t0 = now_ms();
+    snprintf(cmd, sizeof(cmd), "qbe -o %s %s", asmf, ssa);
+    int res = system(cmd);
+    ph_ms[PH_CODEGEN] = now_ms() - t0;
+    if (res != 0) {
+        fprintf(stderr, "Error: qbe failed on %s (is qbe installed? see https://c9x.me/compile/)\n", ssa);
+        if (!keep) {
+            remove(ssa);
+            remove(asmf);
+        }
+        return 1;
+    }
+
+    t0 = now_ms();
+    if (obj_f) {
+        snprintf(cmd, sizeof(cmd), "cc -c %s -o %s", asmf, obj_f);
+        res = system(cmd);
+    }
+    if (res == 0 && out_f) {
+        snprintf(cmd, sizeof(cmd), "cc %s -o %s -lm", asmf, out_f);
+        res = system(cmd);
+    }
+    ph_ms[PH_LINK] = now_ms() - t0;
+    if (!keep) {
+        remove(ssa);
+        remove(asmf);
+    }
+    if (res != 0) {
+        fprintf(stderr, "Error: Failed to assemble/link %s\n", asmf);
+        return 1;
+    }
+    return 0;
+}
+
 void analyze_ast(TypeInferenceContext* ctx, ASTNode* node) {
     if (!node) return;
     
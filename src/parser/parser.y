@@ -18,38 +18,8 @@ ASTNode* root;
 static ASTNode* create_default_value_for_type(ASTNode* type_node, YYLTYPE* loc);
 static ASTNode* build_type_alias_enum(const char* type_name, ASTNode* variants);
 static ASTNode* mark_type_alias_public(ASTNode* program);
-static ASTNode* clone_match_scrutinee(ASTNode* scrutinee);
-static ASTNode* build_match_desugared(ASTNode* scrutinee, ASTNode* arms);
-
-static int is_builtin_union_ctor_name(const char* name) {
-    if (!name) return 0;
-    return strcmp(name, "Some") == 0 || strcmp(name, "None") == 0 ||
-           strcmp(name, "Ok") == 0 || strcmp(name, "Err") == 0;
-}
-
-static ASTNode* prepend_binding_to_match_body(ASTNode* body, const char* bind_name, ASTNode* scrutinee) {
-    if (!body || !bind_name || !scrutinee) return body;
-
-    ASTNode* bind_left = create_identifier_node(bind_name);
-    ASTNode* bind_right = clone_match_scrutinee(scrutinee);
-    if (!bind_left || !bind_right) return body;
-
-    ASTNode* bind_decl = create_assign_node(bind_left, bind_right);
-    if (bind_decl) bind_decl->data.assign.is_declaration = 1;
-
-    ASTNode* wrapped = create_program_node();
-    add_statement_to_program(wrapped, bind_decl);
-
-    if (body->type == AST_PROGRAM) {
-        for (int i = 0; i < body->data.program.statement_count; i++) {
-            add_statement_to_program(wrapped, body->data.program.statements[i]);
-        }
-    } else {
-        add_statement_to_program(wrapped, body);
-    }
-
-    return wrapped;
-}
+static ASTNode* build_match_node(ASTNode* scrutinee, ASTNode* arms, YYLTYPE* loc);
+static ASTNode* apply_loop_hints(ASTNode* for_node, long long hints);
 
 typedef enum {
     GENERIC_KIND_FUNCTION = 0,
@@ -162,6 +132,11 @@ static ASTNode* create_default_scalar_value(ASTNode* type_node, YYLTYPE* loc) {
                     strcmp(type_node->data.identifier.name, "ptr") == 0) {
                     return create_nil_node_with_yyltype((void*)loc);
                 }
+                if (vector_type_info(type_node->data.identifier.name, NULL, NULL)) {//let v: v4f32 -> v4f32(0)
+                    ASTNode* args = create_expression_list_node_with_yyltype((void*)loc);
+                    add_expression_to_list(args, create_num_int_node_with_yyltype(0, (void*)loc));
+                    return create_call_node_with_yyltype(create_identifier_node_with_yyltype(type_node->data.identifier.name, (void*)loc), args, (void*)loc);
+                }
             }
             return create_num_int_node_with_yyltype(0, (void*)loc);
         case AST_TYPE_FIXED_SIZE_LIST:
@@ -224,111 +199,38 @@ static ASTNode* mark_type_alias_public(ASTNode* program) {
     return program;
 }
 
-static ASTNode* clone_match_scrutinee(ASTNode* scrutinee) {
-    if (!scrutinee) return NULL;
-    switch (scrutinee->type) {
-        case AST_IDENTIFIER:
-            if (scrutinee->data.identifier.name) {
-                return create_identifier_node(scrutinee->data.identifier.name);
-            }//如果 scrutinee 或 arms 为空，或者 arms 不是表达式列表，返回 NULL
-            return NULL;
-        case AST_NUM_INT:
-            return create_num_int_node(scrutinee->data.num_int.value);
-        case AST_NUM_FLOAT:
-            return create_num_float_node(scrutinee->data.num_float.value);
-        case AST_CHAR:
-            return create_char_node(scrutinee->data.character.value);
-        case AST_STRING:
-            if (scrutinee->data.string.value) {
-                return create_string_node(scrutinee->data.string.value);
-            }
-            return NULL;
-        case AST_NIL:
-            return create_nil_node();
-        default:
-            return NULL;
-    }
-}
-
-static ASTNode* build_match_desugared(ASTNode* scrutinee, ASTNode* arms) {
+static ASTNode* build_match_node(ASTNode* scrutinee, ASTNode* arms, YYLTYPE* loc) {
     if (!scrutinee || !arms || arms->type != AST_EXPRESSION_LIST) return NULL;
 
     int count = arms->data.expression_list.expression_count;
-    ASTNode* chain = NULL;
-
-    for (int i = count - 1; i >= 0; i--) {
+    for (int i = 0; i < count - 1; i++) {
         ASTNode* arm = arms->data.expression_list.expressions[i];
-        if (!arm || arm->type != AST_ASSIGN || !arm->data.assign.left || !arm->data.assign.right) continue;
-
+        if (!arm || arm->type != AST_ASSIGN) continue;
         ASTNode* pattern = arm->data.assign.left;
-        ASTNode* body = arm->data.assign.right;
         if (pattern && pattern->type == AST_IDENTIFIER && pattern->data.identifier.name &&
             strcmp(pattern->data.identifier.name, "_") == 0) {
-            if (i != count - 1) {
-                int line = pattern->location.first_line > 0 ? pattern->location.first_line : yylineno;
-                int col = pattern->location.first_column > 0 ? pattern->location.first_column : 1;
-                set_location_with_column(current_input_filename ? current_input_filename : "unknown", line, col);
-                report_simple_error(ERROR_LEVEL_WARNING, ERROR_WARNING,
-                    "'_' match arm should be the last arm!");
-            }
-            chain = body;
-            continue;
-        }
-
-        ASTNode* cond = NULL;
-
-        if (pattern->type == AST_CALL && pattern->data.call.func &&
-            pattern->data.call.func->type == AST_IDENTIFIER &&
-            pattern->data.call.func->data.identifier.name) {
-            const char* ctor_name = pattern->data.call.func->data.identifier.name;
-            ASTNode* cond_left = clone_match_scrutinee(scrutinee);
-            if (!cond_left) continue;
-
-            if (pattern->data.call.args && pattern->data.call.args->type == AST_EXPRESSION_LIST &&
-                pattern->data.call.args->data.expression_list.expression_count == 1) {
-                ASTNode* bind_arg = pattern->data.call.args->data.expression_list.expressions[0];
-                if (bind_arg && bind_arg->type == AST_IDENTIFIER && bind_arg->data.identifier.name) {
-                    body = prepend_binding_to_match_body(body, bind_arg->data.identifier.name, scrutinee);
-                }
-
-                /* Payload constructor pattern: treat as non-zero for Option/Result-like values. */
-                ASTNode* zero = create_num_int_node(0);
-                cond = create_binop_node(OP_NE, cond_left, zero);
-            } else {
-                ASTNode* cond_right = create_identifier_node(ctor_name);
-                if (is_builtin_union_ctor_name(ctor_name) && strcmp(ctor_name, "None") == 0) {
-                    cond_right = create_num_int_node(0);
-                }
-                cond = create_binop_node(OP_EQ, cond_left, cond_right);
-            }
-        } else {
-            ASTNode* cond_left = clone_match_scrutinee(scrutinee);//克隆 scrutinee 以构建条件表达式，确保不修改原始 scrutinee
-            ASTNode* cond_right = clone_match_scrutinee(pattern);//克隆模式以构建条件表达式，确保不修改原始模式
-            if (!cond_right && pattern->type == AST_IDENTIFIER && pattern->data.identifier.name) {
-                cond_right = create_identifier_node(pattern->data.identifier.name);//如果模式是一个标识符但无法克隆，直接创建一个新的标识符节点
-                if (is_builtin_union_ctor_name(pattern->data.identifier.name) &&
-                    strcmp(pattern->data.identifier.name, "None") == 0) {
-                    cond_right = create_num_int_node(0);
-                }
-            }
-
-            if (!cond_left || !cond_right) {
-                continue;
-            }
-
-            cond = create_binop_node(OP_EQ, cond_left, cond_right);//构建条件表达式：scrutinee == pattern
+            int line = pattern->location.first_line > 0 ? pattern->location.first_line : yylineno;
+            int col = pattern->location.first_column > 0 ? pattern->location.first_column : 1;
+            set_location_with_column(current_input_filename ? current_input_filename : "unknown", line, col);
+            report_simple_error(ERROR_LEVEL_WARNING, ERROR_WARNING,
+                "'_' match arm should be the last arm!");
         }
-
-        if (!cond) continue;
-        chain = create_if_node(cond, body, chain);//构建 if-else 链：if (xxxx == xxxxx) { body } else do_something_e
     }
+    return create_match_node_with_yyltype(scrutinee, arms, loc);
+}
 
-    return chain;
+//hints 是 lexer 随 FOR 带来的：bit 0 是 @vectorize，其余位是 @unroll(n) 的 n
+static ASTNode* apply_loop_hints(ASTNode* for_node, long long hints) {
+    if (!for_node || for_node->type != AST_FOR) return for_node;
+    if (hints & 1) for_node->data.for_stmt.vectorize = 1;
+    if (hints >> 1) for_node->data.for_stmt.unroll = (int)(hints >> 1);
+    return for_node;
 }
 /*
 build_type_alias_enum：将枚举类型转换为常量定义
-clone_match_scrutinee：克隆 match 语句的 scrutinee，确保在生成条件表达式时不会修改原始 scrutinee
-build_match_desugared：将 match 表达式转换为嵌套的 ifelse 表达式
+build_match_node：生成 AST_MATCH 节点，检查 '_' 分支的位置；降级在 ast.c 的 lower_match_to_if 和 LLVM 后端
+apply_loop_hints：把 for 前面的 @vectorize / @unroll(n) 记到 AST_FOR 上。提示由 lexer 并进 FOR 的语义值，
+不单独成 token：语句之间没有分隔符，能开头一条语句的 token 每多一个，表达式语句那几个状态就多一批 reduce/reduce 冲突
 */
 %}
 
@@ -352,7 +254,8 @@ build_match_desugared：将 match 表达式转换为嵌套的 ifelse 表达式
 %token PRINT INPUT TOINT TOFLOAT TYPE_I32 TYPE_I64 TYPE_I8 TYPE_F32 TYPE_F64 TYPE_STR TYPE_PTR FN ARROW RETURN TYPE_VOID NIL EXTERN DOTDOTDOT
 %token AND OR
 %token AT AMPERSAND
-%token IF ELSE ELIF WHILE FOR BREAK CONTINUE IN
+%token IF ELSE ELIF WHILE BREAK CONTINUE IN
+%token <num_int> FOR
 %token ASSIGN PLUS_ASSIGN MINUS_ASSIGN MULTIPLY_ASSIGN DIVIDE_ASSIGN MODULO_ASSIGN
 %token PLUS MINUS MULTIPLY DIVIDE MODULO POWER
 %token EQ NE LT LE GT GE
@@ -642,7 +545,7 @@ generic_type_args
 
 match_statement
     : MATCH match_target LBRACE match_arms RBRACE {
-        $$ = build_match_desugared($2, $4);
+        $$ = build_match_node($2, $4, (YYLTYPE*) &@$);
     }
     ;
 
@@ -947,9 +850,7 @@ extern_block
                 if (fn && fn->type == AST_FUNCTION) {
                     fn->data.function.is_extern = 1;
                     if ($2) {
-                        if (fn->data.function.linkage) free(fn->data.function.linkage);
-                        fn->data.function.linkage = malloc(strlen($2) + 1);
-                        strcpy(fn->data.function.linkage, $2);
+                        fn->data.function.linkage = ast_strdup($2);
                     }
                     add_statement_to_program(prog, fn);
                 }
@@ -1047,27 +948,27 @@ for_statement
     : FOR LPAREN identifier SEMICOLON expression DOTDOT expression RPAREN block_statement {
         ASTNode* start = $5;
         ASTNode* end = $7;
-        $$ = create_for_node_with_yyltype($3, start, end, $9, (YYLTYPE*) &@$);
+        $$ = apply_loop_hints(create_for_node_with_yyltype($3, start, end, $9, (YYLTYPE*) &@$), $1);
     }
     | FOR LPAREN identifier IN expression DOTDOT expression RPAREN block_statement {
         ASTNode* start = $5;
         ASTNode* end = $7;
-        $$ = create_for_node_with_yyltype($3, start, end, $9, (YYLTYPE*) &@$);
+        $$ = apply_loop_hints(create_for_node_with_yyltype($3, start, end, $9, (YYLTYPE*) &@$), $1);
     }
     | FOR LPAREN identifier IN expression RPAREN block_statement {
         ASTNode* var = $3;
         ASTNode* iterable = $5;
-        $$ = create_for_node_with_yyltype(var, iterable, NULL, $7, (YYLTYPE*) &@$);
+        $$ = apply_loop_hints(create_for_node_with_yyltype(var, iterable, NULL, $7, (YYLTYPE*) &@$), $1);
     }
     | FOR LPAREN identifier SEMICOLON expression RPAREN block_statement {
         ASTNode* var = $3;
         ASTNode* iterable = $5;
-        $$ = create_for_node_with_yyltype(var, iterable, NULL, $7, (YYLTYPE*) &@$);
+        $$ = apply_loop_hints(create_for_node_with_yyltype(var, iterable, NULL, $7, (YYLTYPE*) &@$), $1);
     }
     | FOR LPAREN IDENTIFIER identifier SEMICOLON expression RPAREN block_statement {
         ASTNode* var = $4;
         ASTNode* iterable = $6;
-        $$ = create_for_node_with_yyltype(var, iterable, NULL, $8, (YYLTYPE*) &@$);
+        $$ = apply_loop_hints(create_for_node_with_yyltype(var, iterable, NULL, $8, (YYLTYPE*) &@$), $1);
     }
     ;
 
@@ -0,0 +1,2636 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include "../../include/ast.h"
+#include "../../include/compiler.h"
+#include "../../include/qbe-ir/ir.h"
+#include "../../include/struct.h"
+
+/*
+--backend=qbe：AST 直接生成 QBE IL，再交给 qbe 和系统汇编器，给 -O0 的编辑-编译-运行循环用。
+- 每个变量一个 8 字节栈槽 (%vN)，读写都走 load/store，SSA 交给 qbe 去构造
+- 类型用 intern 过的字符串表示：bool i8 i32 i64 f32 f64 string ptr void、[T] 列表、*T 取地址得到的指针、
+  结构体名、fn 函数指针、StringBuilder；可以直接按指针比较
+- 列表是堆上的 {data, len, cap} 头，元素按类型紧凑存放；结构体是堆上每个字段 8 字节的一块，
+  从左值绑定时整体复制，保持值语义
+- 顶层语句在没有用户 main 时就是 main，否则放进 __vix_top，由 main 开头调用；顶层变量都是全局变量
+- 泛型函数按实参类型实例化，lambda 和实例排队，当前函数生成完再生成
+不支持：SIMD 向量类型
+*/
+
+typedef struct {
+    char v[64];//操作数文本：%t3、$name、42、d_1.5
+    const char* t;
+} QVal;
+
+enum {
+    H_INPUT = 1 << 0,
+    H_CONCAT = 1 << 1,
+    H_LIST = 1 << 2,
+    H_BOUNDS = 1 << 3,
+    H_SB = 1 << 4,
+    H_READ_ALL = 1 << 5,
+    H_EMPTY = 1 << 6,
+    H_READ_LINE = 1 << 7,
+    H_FMT_S = 1 << 8
+};
+
+extern const char* current_input_filename;
+
+static int qbe_unbuffered = 0;
+static int qbe_bounds = 0;
+
+static const char *T_BOOL, *T_I8, *T_I32, *T_I64, *T_F32, *T_F64, *T_STR, *T_PTR, *T_VOID, *T_SB, *T_FN, *T_LIST_ANY;
+
+static QVal gen_expr(QbeGenState* st, ASTNode* node);
+static void gen_stmt(QbeGenState* st, ASTNode* node);
+
+void qbe_set_print_mode(int unbuffered) {
+    qbe_unbuffered = unbuffered;
+}
+
+void qbe_set_bounds_check(int enabled) {
+    qbe_bounds = enabled;
+}
+
+static const char* src_file(ASTNode* node) {
+    if (node && node->source_file) return node->source_file;
+    return current_input_filename ? current_input_filename : "unknown";
+}
+
+static void qbe_unsupported(QbeGenState* st, ASTNode* node, const char* what) {
+    (void)st;
+    char msg[256];
+    snprintf(msg, sizeof(msg), "qbe: %s is not supported by --backend=qbe, use the LLVM backend", what);
+    const char* file = src_file(node);
+    int line = node ? node->location.first_line : 0;
+    report_semantic_error_with_location(msg, file, line);
+}
+
+static void qbe_error(ASTNode* node, const char* fmt, ...) {
+    char msg[256];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+    const char* file = src_file(node);
+    report_semantic_error_with_location(msg, file, node ? node->location.first_line : 0);
+}
+
+/* ==================== 类型 ==================== */
+
+static int is_int_t(const char* t) {
+    return t == T_BOOL || t == T_I8 || t == T_I32 || t == T_I64;
+}
+
+static int is_float_t(const char* t) {
+    return t == T_F32 || t == T_F64;
+}
+
+static int is_num_t(const char* t) {
+    return is_int_t(t) || is_float_t(t);
+}
+
+static int is_list_t(const char* t) {
+    return t && t[0] == '[';
+}
+
+static int is_raw_ptr_t(const char* t) {
+    return t && t[0] == '*';
+}
+
+static int is_struct_t(QbeGenState* st, const char* t) {
+    return t && qbe_get_struct_info(st, t, NULL, NULL, NULL);
+}
+
+static const char* type_cat(const char* a, const char* b, const char* c) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s%s%s", a, b, c);
+    return ast_intern(buf);
+}
+
+static const char* list_of(const char* elem) {
+    return elem ? type_cat("[", elem, "]") : T_LIST_ANY;
+}
+
+static const char* list_elem(const char* t) {//[] 还不知道元素类型，返回 NULL
+    size_t n = strlen(t);
+    if (n <= 2) return NULL;
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%.*s", (int)(n - 2), t + 1);
+    return ast_intern(buf);
+}
+
+static const char* ptr_to(const char* t) {
+    return type_cat("*", t, "");
+}
+
+static int type_rank(const char* t) {
+    if (t == T_BOOL) return 0;
+    if (t == T_I8) return 1;
+    if (t == T_I32) return 2;
+    if (t == T_I64) return 3;
+    if (t == T_F32) return 4;
+    if (t == T_F64) return 5;
+    return -1;
+}
+
+static char qcls(const char* t) {
+    if (t == T_BOOL || t == T_I8 || t == T_I32) return 'w';
+    if (t == T_F32) return 's';
+    if (t == T_F64) return 'd';
+    return 'l';
+}
+
+static int elem_size(const char* t) {
+    if (t == T_BOOL || t == T_I8) return 1;
+    if (t == T_I32 || t == T_F32) return 4;
+    return 8;
+}
+
+static const char* load_op(const char* t) {
+    if (t == T_I8) return "loadsb";
+    if (t == T_BOOL) return "loadub";
+    if (t == T_I32) return "loadw";
+    if (t == T_F32) return "loads";
+    if (t == T_F64) return "loadd";
+    return "loadl";
+}
+
+static const char* store_op(const char* t) {
+    if (t == T_BOOL || t == T_I8) return "storeb";
+    if (t == T_I32) return "storew";
+    if (t == T_F32) return "stores";
+    if (t == T_F64) return "stored";
+    return "storel";
+}
+
+static const char* binding_of(QbeGenState* st, const char* name) {
+    for (int i = 0; i + 1 < st->type_binding_count * 2; i += 2) {
+        if (strcmp(st->type_bindings[i], name) == 0) return st->type_bindings[i + 1];
+    }
+    return NULL;
+}
+
+const char* qbe_type_name(QbeGenState* st, ASTNode* n) {
+    if (!n) return T_I32;
+    switch (n->type) {
+        case AST_TYPE_INT32: return T_I32;
+        case AST_TYPE_INT64: return T_I64;
+        case AST_TYPE_INT8: return T_I8;
+        case AST_TYPE_FLOAT32: return T_F32;
+        case AST_TYPE_FLOAT64: return T_F64;
+        case AST_TYPE_STRING: return T_STR;
+        case AST_TYPE_VOID: return T_VOID;
+        case AST_TYPE_POINTER: return T_PTR;
+        case AST_TYPE_LIST: return list_of(qbe_type_name(st, n->data.list_type.element_type));
+        case AST_TYPE_FIXED_SIZE_LIST: return list_of(qbe_type_name(st, n->data.fixed_size_list_type.element_type));
+        case AST_IDENTIFIER: {
+            const char* name = n->data.identifier.name;
+            if (!name) return T_I32;
+            const char* bound = binding_of(st, name);
+            if (bound) return bound;
+            if (strcmp(name, "ptr") == 0) return T_PTR;
+            if (strcmp(name, "str") == 0 || strcmp(name, "string") == 0) return T_STR;
+            if (strcmp(name, "i8") == 0 || strcmp(name, "u8") == 0 || strcmp(name, "char") == 0) return T_I8;
+            if (strcmp(name, "i32") == 0) return T_I32;
+            if (strcmp(name, "i64") == 0) return T_I64;
+            if (strcmp(name, "f32") == 0) return T_F32;
+            if (strcmp(name, "f64") == 0) return T_F64;
+            if (strcmp(name, "void") == 0) return T_VOID;
+            if (strcmp(name, "StringBuilder") == 0) return T_SB;
+            if (is_struct_t(st, name)) return ast_intern(name);
+            return T_I32;
+        }
+        default:
+            return T_I32;
+    }
+}
+
+/* ==================== 名字索引 ==================== */
+
+static unsigned int ptr_hash(const char* p) {
+    uintptr_t x = (uintptr_t)p;
+    x ^= x >> 17;
+    x *= 0x9E3779B1u;
+    return (unsigned int)(x ^ (x >> 15));
+}
+
+static int index_find(int* table, int cap, char** names, const char* name) {
+    if (!table || !name) return -1;
+    unsigned int j = ptr_hash(name) & (cap - 1);
+    while (table[j] >= 0) {
+        if (names[table[j]] == name) return table[j];
+        j = (j + 1) & (cap - 1);
+    }
+    return -1;
+}
+
+static void index_add(int** table, int* cap, char** names, int count, int idx) {
+    if (count * 2 > *cap) {
+        int ncap = *cap ? *cap * 2 : 64;
+        while (count * 2 > ncap) ncap *= 2;
+        free(*table);
+        *table = malloc(sizeof(int) * ncap);
+        memset(*table, 0xff, sizeof(int) * ncap);
+        *cap = ncap;
+        for (int i = 0; i < count; i++) {
+            if (i == idx) continue;
+            unsigned int j = ptr_hash(names[i]) & (ncap - 1);
+            while ((*table)[j] >= 0) j = (j + 1) & (ncap - 1);
+            (*table)[j] = i;
+        }
+    }
+    unsigned int j = ptr_hash(names[idx]) & (*cap - 1);
+    while ((*table)[j] >= 0) j = (j + 1) & (*cap - 1);
+    (*table)[j] = idx;
+}
+
+/* ==================== 输出 ==================== */
+
+static void ins(QbeGenState* st, const char* fmt, ...) {
+    if (st->terminated) {//ret/jmp 之后的代码放进一个新块 (不可达，qbe 会删掉)
+        fprintf(st->fn_body, "@L%d\n", ++st->label_counter);
+        st->terminated = 0;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    fputc('\t', st->fn_body);
+    vfprintf(st->fn_body, fmt, ap);
+    fputc('\n', st->fn_body);
+    va_end(ap);
+}
+
+static void new_tmp(QbeGenState* st, QVal* out, const char* t) {
+    snprintf(out->v, sizeof(out->v), "%%t%d", ++st->reg_counter);
+    out->t = t;
+}
+
+static QVal const_int(long long v, const char* t) {
+    QVal r;
+    snprintf(r.v, sizeof(r.v), "%lld", v);
+    r.t = t;
+    return r;
+}
+
+static int is_const(const QVal* v) {
+    return (v->v[0] >= '0' && v->v[0] <= '9') || v->v[0] == '-';
+}
+
+static int new_label(QbeGenState* st) {
+    return ++st->label_counter;
+}
+
+static void place_label(QbeGenState* st, int l) {
+    fprintf(st->fn_body, "@L%d\n", l);
+    st->terminated = 0;
+}
+
+static void emit_jmp(QbeGenState* st, int l) {
+    ins(st, "jmp @L%d", l);
+    st->terminated = 1;
+}
+
+static void emit_branch(QbeGenState* st, const char* cond, int yes, int no) {
+    ins(st, "jnz %s, @L%d, @L%d", cond, yes, no);
+    st->terminated = 1;
+}
+
+static void write_escaped(FILE* out, const char* s, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c < 32 || c >= 127) {
+            fprintf(out, "\\%03o", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+}
+
+static void emit_string_data(FILE* out, const char* sym, const char* s, size_t n) {
+    fprintf(out, "data $%s = { ", sym);
+    if (n > 0) {
+        fputs("b \"", out);
+        write_escaped(out, s, n);
+        fputs("\", ", out);
+    }
+    fputs("b 0 }\n", out);
+}
+
+static QVal string_const(QbeGenState* st, const char* s) {
+    QVal r;
+    char sym[48];
+    snprintf(sym, sizeof(sym), "__vix_str_%d", st->string_counter++);
+    emit_string_data(st->data_out, sym, s ? s : "", s ? strlen(s) : 0);
+    snprintf(r.v, sizeof(r.v), "$%s", sym);
+    r.t = T_STR;
+    return r;
+}
+
+/* ==================== 转换 ==================== */
+
+static QVal conv(QbeGenState* st, QVal v, const char* to) {
+    const char* from = v.t;
+    if (!to || !from || from == to || to == T_VOID) {
+        if (to && to != T_VOID) v.t = to;
+        return v;
+    }
+    QVal r;
+    char tc = qcls(to), fc = qcls(from);
+    if (is_float_t(to)) {
+        if (is_float_t(from)) {
+            new_tmp(st, &r, to);
+            ins(st, "%s =%c %s %s", r.v, tc, to == T_F64 ? "exts" : "truncd", v.v);
+            return r;
+        }
+        //整数常量直接写成浮点常量；放不下 (理论上不会) 就退回运行时转换
+        int n = is_const(&v) ? snprintf(r.v, sizeof(r.v), "%c_%s", tc, v.v) : -1;
+        if (n >= 0 && (size_t)n < sizeof(r.v)) {
+            r.t = to;
+            return r;
+        }
+        new_tmp(st, &r, to);
+        ins(st, "%s =%c %s %s", r.v, tc, fc == 'w' ? "swtof" : "sltof", v.v);
+        return r;
+    }
+    if (is_float_t(from)) {
+        new_tmp(st, &r, to);
+        if (to == T_BOOL) {
+            ins(st, "%s =w cne%c %s, %c_0", r.v, fc, v.v, fc);
+            return r;
+        }
+        ins(st, "%s =%c %s %s", r.v, tc, from == T_F64 ? "dtosi" : "stosi", v.v);
+        if (to == T_I8) ins(st, "%s =w extsb %s", r.v, r.v);
+        return r;
+    }
+    if (to == T_BOOL) {
+        new_tmp(st, &r, to);
+        ins(st, "%s =w cne%c %s, 0", r.v, fc, v.v);
+        return r;
+    }
+    if (is_const(&v)) {
+        if (to == T_I8) return const_int((signed char)strtoll(v.v, NULL, 10), T_I8);
+        if (to == T_I32) return const_int((int)strtoll(v.v, NULL, 10), T_I32);
+        v.t = to;
+        return v;
+    }
+    if (tc == 'l' && fc == 'w') {
+        new_tmp(st, &r, to);
+        ins(st, "%s =l %s %s", r.v, from == T_BOOL ? "extuw" : "extsw", v.v);
+        return r;
+    }
+    if (tc == 'w' && fc == 'l') {
+        new_tmp(st, &r, to);
+        ins(st, "%s =w %s %s", r.v, to == T_I8 ? "extsb" : "copy", v.v);
+        return r;
+    }
+    if (to == T_I8 && from != T_BOOL) {
+        new_tmp(st, &r, to);
+        ins(st, "%s =w extsb %s", r.v, v.v);
+        return r;
+    }
+    v.t = to;
+    return v;
+}
+
+// jnz 只看 w：long 和浮点先和 0 比较
+static QVal cond_w(QbeGenState* st, QVal v) {
+    char c = qcls(v.t);
+    if (c == 'w') return v;
+    QVal r;
+    new_tmp(st, &r, T_BOOL);
+    if (c == 'l') ins(st, "%s =w cnel %s, 0", r.v, v.v);
+    else ins(st, "%s =w cne%c %s, %c_0", r.v, c, v.v, c);
+    return r;
+}
+
+/* ==================== 变量 ==================== */
+
+static const char* ident_name(ASTNode* node) {
+    if (node && node->type == AST_IDENTIFIER) return node->data.identifier.name;
+    return NULL;
+}
+
+static int find_local(QbeGenState* st, const char* name) {
+    for (int i = st->var_count - 1; i >= 0; i--) {
+        if (st->var_names[i] == name) return i;
+    }
+    return -1;
+}
+
+static int new_slot(QbeGenState* st) {
+    int slot = ++st->reg_counter;
+    fprintf(st->fn_alloc, "\t%%v%d =l alloc8 8\n", slot);
+    return slot;
+}
+
+static int declare_local(QbeGenState* st, const char* name, const char* t) {
+    int i = find_local(st, name);
+    if (i >= 0) {
+        st->var_types[i] = (char*)t;
+        return i;
+    }
+    if (st->var_count >= st->var_capacity) {
+        st->var_capacity = st->var_capacity ? st->var_capacity * 2 : 16;
+        st->var_names = realloc(st->var_names, sizeof(char*) * st->var_capacity);
+        st->var_regs = realloc(st->var_regs, sizeof(int) * st->var_capacity);
+        st->var_types = realloc(st->var_types, sizeof(char*) * st->var_capacity);
+    }
+    i = st->var_count++;
+    st->var_names[i] = (char*)name;
+    st->var_types[i] = (char*)t;
+    st->var_regs[i] = new_slot(st);
+    return i;
+}
+
+static int find_global(QbeGenState* st, const char* name) {
+    return index_find(st->global_index, st->global_index_capacity, st->global_vars, name);
+}
+
+static int declare_global(QbeGenState* st, const char* name, const char* t) {
+    int i = find_global(st, name);
+    if (i >= 0) {
+        st->global_var_types[i] = (char*)t;
+        return i;
+    }
+    if (st->global_var_count >= st->global_var_capacity) {
+        st->global_var_capacity = st->global_var_capacity ? st->global_var_capacity * 2 : 16;
+        st->global_vars = realloc(st->global_vars, sizeof(char*) * st->global_var_capacity);
+        st->global_var_types = realloc(st->global_var_types, sizeof(char*) * st->global_var_capacity);
+    }
+    i = st->global_var_count++;
+    st->global_vars[i] = (char*)name;
+    st->global_var_types[i] = (char*)t;
+    index_add(&st->global_index, &st->global_index_capacity, st->global_vars, st->global_var_count, i);
+    fprintf(st->data_out, "data $__vix_g_%s = align 8 { l 0 }\n", name);
+    return i;
+}
+
+static int find_func(QbeGenState* st, const char* name) {
+    return index_find(st->func_index, st->func_index_capacity, st->func_names, name);
+}
+
+static int add_func(QbeGenState* st, const char* name, ASTNode* node, const char* symbol, char** bindings, int nbind) {
+    if (st->func_count >= st->func_capacity) {
+        int cap = st->func_capacity ? st->func_capacity * 2 : 64;
+        st->func_names = realloc(st->func_names, sizeof(char*) * cap);
+        st->func_ret_types = realloc(st->func_ret_types, sizeof(char*) * cap);
+        st->func_nodes = realloc(st->func_nodes, sizeof(ASTNode*) * cap);
+        st->func_bindings = realloc(st->func_bindings, sizeof(char**) * cap);
+        st->func_binding_counts = realloc(st->func_binding_counts, sizeof(int) * cap);
+        st->func_symbols = realloc(st->func_symbols, sizeof(char*) * cap);
+        st->func_emitted = realloc(st->func_emitted, sizeof(int) * cap);
+        st->func_capacity = cap;
+    }
+    int i = st->func_count++;
+    st->func_names[i] = (char*)name;
+    st->func_ret_types[i] = NULL;
+    st->func_nodes[i] = node;
+    st->func_bindings[i] = bindings;
+    st->func_binding_counts[i] = nbind;
+    st->func_symbols[i] = (char*)symbol;
+    st->func_emitted[i] = 0;
+    index_add(&st->func_index, &st->func_index_capacity, st->func_names, st->func_count, i);
+    return i;
+}
+
+static int is_generic(ASTNode* fn) {
+    ASTNode* g = fn->data.function.generic_params;
+    return g && g->type == AST_EXPRESSION_LIST && g->data.expression_list.expression_count > 0;
+}
+
+static int has_value_return(ASTNode* node) {
+    if (!node) return 0;
+    switch (node->type) {
+        case AST_RETURN: return node->data.return_stmt.expr != NULL;
+        case AST_PROGRAM:
+            for (int i = 0; i < node->data.program.statement_count; i++) {
+                if (has_value_return(node->data.program.statements[i])) return 1;
+            }
+            return 0;
+        case AST_IF: return has_value_return(node->data.if_stmt.then_body) || has_value_return(node->data.if_stmt.else_body);
+        case AST_WHILE: return has_value_return(node->data.while_stmt.body);
+        case AST_FOR: return has_value_return(node->data.for_stmt.body);
+        case AST_MATCH: return has_value_return(lower_match_to_if(node));
+        default: return 0;
+    }
+}
+
+// 在函数 i 自己的类型参数绑定下求返回类型
+static const char* func_ret_type(QbeGenState* st, int i) {
+    if (st->func_ret_types[i]) return st->func_ret_types[i];
+    ASTNode* fn = st->func_nodes[i];
+    char** saved = st->type_bindings;
+    int saved_n = st->type_binding_count;
+    st->type_bindings = st->func_bindings[i];
+    st->type_binding_count = st->func_binding_counts[i];
+    const char* t;
+    if (fn->data.function.return_type) {
+        t = qbe_type_name(st, fn->data.function.return_type);
+    } else if (strcmp(fn->data.function.name, "main") == 0 || has_value_return(fn->data.function.body)) {
+        t = T_I32;
+    } else {
+        t = T_VOID;
+    }
+    st->type_bindings = saved;
+    st->type_binding_count = saved_n;
+    st->func_ret_types[i] = (char*)t;
+    return t;
+}
+
+static int param_count(ASTNode* fn) {
+    ASTNode* p = fn->data.function.params;
+    return (p && p->type == AST_EXPRESSION_LIST) ? p->data.expression_list.expression_count : 0;
+}
+
+static ASTNode* param_at(ASTNode* fn, int i) {
+    return fn->data.function.params->data.expression_list.expressions[i];
+}
+
+static const char* param_name(ASTNode* p) {
+    const char* name = ident_name(p);
+    if (!name && p && p->type == AST_ASSIGN) name = ident_name(p->data.assign.left);
+    return name;
+}
+
+static ASTNode* param_type_node(ASTNode* p) {
+    return (p && p->type == AST_ASSIGN) ? p->data.assign.right : NULL;
+}
+
+/* ==================== 运行时辅助函数调用 ==================== */
+
+static QVal call_l(QbeGenState* st, const char* fn, const char* t, const char* args) {
+    QVal r;
+    new_tmp(st, &r, t);
+    ins(st, "%s =l call $%s(%s)", r.v, fn, args);
+    return r;
+}
+
+static QVal list_field(QbeGenState* st, QVal h, int off, const char* t) {
+    QVal p, r;
+    new_tmp(st, &p, T_I64);
+    ins(st, "%s =l add %s, %d", p.v, h.v, off);
+    new_tmp(st, &r, t);
+    ins(st, "%s =l loadl %s", r.v, p.v);
+    return r;
+}
+
+static QVal str_length(QbeGenState* st, QVal s) {
+    char args[96];
+    snprintf(args, sizeof(args), "l %s", s.v);
+    return call_l(st, "strlen", T_I64, args);
+}
+
+/*
+字符串变量的长度缓存，和 LLVM 后端的 <name>__slen 一样：-1 表示未知，.length 第一次用时 strlen 一次；
+赋值时更新，下标写入、作为参数传出去之后置 -1。只在函数里做，顶层变量每次 strlen
+*/
+static int slen_slot(QbeGenState* st, const char* name, int create) {
+    if (st->in_top || !name) return -1;
+    const char* key = type_cat(name, "__slen", "");
+    int i = find_local(st, key);
+    if (i < 0 && create) {
+        i = declare_local(st, key, T_I64);
+        fprintf(st->fn_alloc, "\tstorel -1, %%v%d\n", st->var_regs[i]);//入口块里初始化，循环里不会被重置
+    }
+    return i < 0 ? -1 : st->var_regs[i];
+}
+
+static void slen_invalidate(QbeGenState* st, ASTNode* var) {
+    int slot = slen_slot(st, ident_name(var) ? ast_intern(ident_name(var)) : NULL, 0);
+    if (slot >= 0) ins(st, "storel -1, %%v%d", slot);
+}
+
+static QVal var_length(QbeGenState* st, ASTNode* var, QVal s) {
+    const char* name = ident_name(var);
+    int slot = s.t == T_STR ? slen_slot(st, name ? ast_intern(name) : NULL, 1) : -1;
+    if (slot < 0) return str_length(st, s);
+    QVal c, known;
+    new_tmp(st, &c, T_I64);
+    ins(st, "%s =l loadl %%v%d", c.v, slot);
+    new_tmp(st, &known, T_BOOL);
+    ins(st, "%s =w csgel %s, 0", known.v, c.v);
+    int miss = new_label(st), done = new_label(st);
+    emit_branch(st, known.v, done, miss);
+    place_label(st, miss);
+    QVal n = str_length(st, s);
+    ins(st, "storel %s, %%v%d", n.v, slot);
+    place_label(st, done);
+    QVal r;
+    new_tmp(st, &r, T_I64);
+    ins(st, "%s =l loadl %%v%d", r.v, slot);
+    return r;
+}
+
+static QVal scratch(QbeGenState* st) {
+    if (st->scratch_slot < 0) {
+        st->scratch_slot = ++st->reg_counter;
+        fprintf(st->fn_alloc, "\t%%v%d =l alloc16 512\n", st->scratch_slot);
+    }
+    QVal r;
+    snprintf(r.v, sizeof(r.v), "%%v%d", st->scratch_slot);
+    r.t = T_PTR;
+    return r;
+}
+
+static QVal copy_struct(QbeGenState* st, QVal v, const char* sname, int depth) {
+    char** names = NULL;
+    char** types = NULL;
+    int n = 0;
+    if (!qbe_get_struct_info(st, sname, &names, &types, &n) || depth > 32) return v;
+    int size = n > 0 ? n * 8 : 8;
+    char args[160];
+    snprintf(args, sizeof(args), "l %d", size);
+    QVal r = call_l(st, "malloc", sname, args);
+    ins(st, "call $memcpy(l %s, l %s, l %d)", r.v, v.v, size);
+    for (int i = 0; i < n; i++) {
+        if (!is_struct_t(st, types[i])) continue;
+        QVal fp, fv;
+        new_tmp(st, &fp, T_I64);
+        ins(st, "%s =l add %s, %d", fp.v, r.v, i * 8);
+        new_tmp(st, &fv, types[i]);
+        ins(st, "%s =l loadl %s", fv.v, fp.v);
+        int yes = new_label(st), done = new_label(st);
+        QVal nz = cond_w(st, fv);
+        emit_branch(st, nz.v, yes, done);//没初始化的字段是 0，不复制
+        place_label(st, yes);
+        QVal c = copy_struct(st, fv, types[i], depth + 1);
+        ins(st, "storel %s, %s", c.v, fp.v);
+        emit_jmp(st, done);
+        place_label(st, done);
+    }
+    return r;
+}
+
+static int is_lvalue(ASTNode* n) {
+    if (!n) return 0;
+    if (n->type == AST_IDENTIFIER || n->type == AST_INDEX || n->type == AST_MEMBER_ACCESS) return 1;
+    return n->type == AST_UNARYOP && n->data.unaryop.op == OP_DEREF;
+}
+
+// 结构体从左值绑定到新位置时复制一份，新建的值 (字面量、调用结果) 直接用
+static QVal bind_value(QbeGenState* st, ASTNode* src, QVal v) {
+    if (is_struct_t(st, v.t) && is_lvalue(src)) return copy_struct(st, v, v.t, 0);
+    return v;
+}
+
+/* ==================== 左值 ==================== */
+
+static QVal gen_addr(QbeGenState* st, ASTNode* node, const char** out_t);
+
+static void bounds_check(QbeGenState* st, ASTNode* node, QVal idx, QVal len) {
+    st->used_helpers |= H_BOUNDS;
+    const char* name = ident_name(node->data.index.target);
+    QVal vname = string_const(st, name ? name : "<expr>");
+    QVal file = string_const(st, src_file(node));
+    QVal ok;
+    new_tmp(st, &ok, T_BOOL);
+    ins(st, "%s =w cultl %s, %s", ok.v, idx.v, len.v);
+    int good = new_label(st), bad = new_label(st);
+    emit_branch(st, ok.v, good, bad);
+    place_label(st, bad);
+    ins(st, "call $__vix_qbe_bounds_fail(l %s, l %s, l %s, w %d, l %s)", idx.v, len.v, vname.v,
+        node->location.first_line, file.v);
+    ins(st, "hlt");
+    st->terminated = 1;
+    place_label(st, good);
+}
+
+static QVal index_addr(QbeGenState* st, ASTNode* node, QVal target, QVal idx, const char** out_t) {
+    QVal addr;
+    const char* t = target.t;
+    idx = conv(st, idx, T_I64);
+    if (is_list_t(t)) {
+        const char* e = list_elem(t);
+        if (!e) e = T_I32;
+        QVal data = list_field(st, target, 0, T_PTR);
+        if (qbe_bounds) bounds_check(st, node, idx, list_field(st, target, 8, T_I64));
+        QVal off;
+        new_tmp(st, &off, T_I64);
+        ins(st, "%s =l mul %s, %d", off.v, idx.v, elem_size(e));
+        new_tmp(st, &addr, T_PTR);
+        ins(st, "%s =l add %s, %s", addr.v, data.v, off.v);
+        *out_t = e;
+        return addr;
+    }
+    if (is_raw_ptr_t(t)) {
+        const char* e = ast_intern(t + 1);
+        QVal off;
+        new_tmp(st, &off, T_I64);
+        ins(st, "%s =l mul %s, %d", off.v, idx.v, elem_size(e));
+        new_tmp(st, &addr, T_PTR);
+        ins(st, "%s =l add %s, %s", addr.v, target.v, off.v);
+        *out_t = e;
+        return addr;
+    }
+    if (t == T_STR || t == T_PTR) {//和 LLVM 后端一样：string / ptr 按字节取
+        new_tmp(st, &addr, T_PTR);
+        ins(st, "%s =l add %s, %s", addr.v, target.v, idx.v);
+        *out_t = T_I8;
+        return addr;
+    }
+    qbe_error(node, "qbe: cannot index a value of type %s", t);
+    *out_t = T_I32;
+    return const_int(0, T_PTR);
+}
+
+static int struct_field(QbeGenState* st, const char* sname, const char* field, const char** ft) {
+    char** names = NULL;
+    char** types = NULL;
+    int n = 0;
+    if (!qbe_get_struct_info(st, sname, &names, &types, &n)) return -1;
+    for (int i = 0; i < n; i++) {
+        if (strcmp(names[i], field) == 0) {
+            *ft = types[i];
+            return i;
+        }
+    }
+    return -1;
+}
+
+static QVal member_addr(QbeGenState* st, ASTNode* node, QVal obj, const char** out_t) {
+    const char* field = ident_name(node->data.member_access.field);
+    if (!field) field = "";
+    if (is_raw_ptr_t(obj.t) && is_struct_t(st, obj.t + 1)) {
+        QVal p;
+        new_tmp(st, &p, ast_intern(obj.t + 1));
+        ins(st, "%s =l loadl %s", p.v, obj.v);
+        obj = p;
+    }
+    if (field[0] >= '0' && field[0] <= '9' && is_list_t(obj.t)) {//元组 t.0
+        return index_addr(st, node, obj, const_int(atoi(field), T_I64), out_t);
+    }
+    const char* ft = T_I32;
+    int fi = is_struct_t(st, obj.t) ? struct_field(st, obj.t, field, &ft) : -1;
+    if (fi < 0 && !is_struct_t(st, obj.t)) {//类型不明时按字段名找结构体，和 LLVM 后端一样
+        for (int s = 0; s < st->struct_count && fi < 0; s++) {
+            fi = struct_field(st, st->struct_names[s], field, &ft);
+        }
+    }
+    if (fi < 0) {
+        qbe_error(node, "qbe: no field '%s' in %s", field, obj.t);
+        *out_t = T_I32;
+        return const_int(0, T_PTR);
+    }
+    QVal addr;
+    new_tmp(st, &addr, T_PTR);
+    ins(st, "%s =l add %s, %d", addr.v, obj.v, fi * 8);
+    *out_t = ft;
+    return addr;
+}
+
+static QVal var_addr(QbeGenState* st, const char* name, const char** out_t) {
+    QVal a;
+    a.t = T_PTR;
+    int i = st->in_top ? -1 : find_local(st, name);
+    if (i >= 0) {
+        snprintf(a.v, sizeof(a.v), "%%v%d", st->var_regs[i]);
+        *out_t = st->var_types[i];
+        return a;
+    }
+    i = find_global(st, name);
+    if (i >= 0) {
+        snprintf(a.v, sizeof(a.v), "$__vix_g_%s", name);
+        *out_t = st->global_var_types[i];
+        return a;
+    }
+    a.v[0] = '\0';
+    *out_t = NULL;
+    return a;
+}
+
+static QVal gen_addr(QbeGenState* st, ASTNode* node, const char** out_t) {
+    switch (node->type) {
+        case AST_IDENTIFIER: {
+            const char* name = ast_intern(node->data.identifier.name);
+            QVal a = var_addr(st, name, out_t);
+            if (!a.v[0]) {
+                qbe_error(node, "qbe: undefined variable '%s'", name);
+                *out_t = T_I32;
+                return const_int(0, T_PTR);
+            }
+            return a;
+        }
+        case AST_INDEX: {
+            QVal target = gen_expr(st, node->data.index.target);
+            QVal idx = gen_expr(st, node->data.index.index);
+            return index_addr(st, node, target, idx, out_t);
+        }
+        case AST_MEMBER_ACCESS: {
+            QVal obj = gen_expr(st, node->data.member_access.object);
+            return member_addr(st, node, obj, out_t);
+        }
+        case AST_UNARYOP:
+            if (node->data.unaryop.op == OP_DEREF) {
+                QVal p = gen_expr(st, node->data.unaryop.expr);
+                if (is_raw_ptr_t(p.t)) *out_t = ast_intern(p.t + 1);
+                else if (p.t == T_STR) *out_t = T_I8;
+                else *out_t = T_I32;//ptr / &i32 之类的参数类型不带被指类型，按 i32
+                return p;
+            }
+            break;
+        default:
+            break;
+    }
+    qbe_unsupported(st, node, "this kind of assignment target");
+    *out_t = T_I32;
+    return const_int(0, T_PTR);
+}
+
+static QVal load_from(QbeGenState* st, QVal addr, const char* t) {
+    QVal r;
+    new_tmp(st, &r, t);
+    ins(st, "%s =%c %s %s", r.v, qcls(t), load_op(t), addr.v);
+    return r;
+}
+
+static void store_to(QbeGenState* st, QVal addr, QVal v, const char* t) {
+    v = conv(st, v, t);
+    ins(st, "%s %s, %s", store_op(t), v.v, addr.v);
+}
+
+/* ==================== 表达式 ==================== */
+
+static QVal gen_binop(QbeGenState* st, ASTNode* node) {
+    BinOpType op = node->data.binop.op;
+    QVal l = gen_expr(st, node->data.binop.left);
+    QVal r = gen_expr(st, node->data.binop.right);
+    QVal res;
+
+    if (op == OP_AND || op == OP_OR) {//和 LLVM 后端一样两边都求值
+        l = conv(st, l, T_BOOL);
+        r = conv(st, r, T_BOOL);
+        new_tmp(st, &res, T_BOOL);
+        ins(st, "%s =w %s %s, %s", res.v, op == OP_AND ? "and" : "or", l.v, r.v);
+        return res;
+    }
+
+    if (op >= OP_EQ && op <= OP_GE) {
+        static const char* sops[] = {"eq", "ne", "slt", "sle", "sgt", "sge"};
+        static const char* uops[] = {"eq", "ne", "ult", "ule", "ugt", "uge"};
+        static const char* fops[] = {"eq", "ne", "lt", "le", "gt", "ge"};
+        int k = op - OP_EQ;
+        new_tmp(st, &res, T_BOOL);
+        if (!is_num_t(l.t) || !is_num_t(r.t)) {//指针、字符串按地址比较
+            l = conv(st, l, T_PTR);
+            r = conv(st, r, T_PTR);
+            ins(st, "%s =w c%sl %s, %s", res.v, uops[k], l.v, r.v);
+            return res;
+        }
+        const char* t = type_rank(l.t) >= type_rank(r.t) ? l.t : r.t;
+        if (t == T_BOOL) t = T_I32;
+        l = conv(st, l, t);
+        r = conv(st, r, t);
+        ins(st, "%s =w c%s%c %s, %s", res.v, is_float_t(t) ? fops[k] : sops[k], qcls(t), l.v, r.v);
+        return res;
+    }
+
+    if ((op == OP_ADD || op == OP_CONCAT) && l.t == T_STR && r.t == T_STR) {
+        st->used_helpers |= H_CONCAT | H_EMPTY;
+        char args[160];
+        snprintf(args, sizeof(args), "l %s, l %s", l.v, r.v);
+        return call_l(st, "__vix_qbe_concat", T_STR, args);
+    }
+
+    if ((op == OP_ADD || op == OP_SUB) && !is_num_t(l.t) && is_int_t(r.t) && !is_list_t(l.t) && !is_struct_t(st, l.t)) {
+        //指针 ± 整数：*T 按元素大小，ptr / string 按字节
+        QVal off = conv(st, r, T_I64);
+        if (is_raw_ptr_t(l.t)) {
+            QVal scaled;
+            new_tmp(st, &scaled, T_I64);
+            ins(st, "%s =l mul %s, %d", scaled.v, off.v, elem_size(ast_intern(l.t + 1)));
+            off = scaled;
+        }
+        new_tmp(st, &res, l.t);
+        ins(st, "%s =l %s %s, %s", res.v, op == OP_ADD ? "add" : "sub", l.v, off.v);
+        return res;
+    }
+
+    if (op == OP_REPEAT) {
+        qbe_unsupported(st, node, "string repetition");
+        return const_int(0, T_I32);
+    }
+
+    if (!is_num_t(l.t) || !is_num_t(r.t)) {
+        if (op == OP_SUB && !is_num_t(l.t) && !is_num_t(r.t)) {//指针相减
+            new_tmp(st, &res, T_I64);
+            ins(st, "%s =l sub %s, %s", res.v, l.v, r.v);
+            return res;
+        }
+        qbe_error(node, "qbe: invalid operands to arithmetic (%s and %s)", l.t, r.t);
+        return const_int(0, T_I32);
+    }
+
+    const char* t = type_rank(l.t) >= type_rank(r.t) ? l.t : r.t;
+    if (t == T_BOOL) t = T_I32;
+    if (op == OP_POW) {
+        l = conv(st, l, T_F64);
+        r = conv(st, r, T_F64);
+        new_tmp(st, &res, T_F64);
+        ins(st, "%s =d call $pow(d %s, d %s)", res.v, l.v, r.v);
+        return is_int_t(t) ? conv(st, res, t) : res;
+    }
+    l = conv(st, l, t);
+    r = conv(st, r, t);
+    char c = qcls(t);
+    new_tmp(st, &res, t);
+    if (op == OP_MOD && is_float_t(t)) {
+        QVal a = conv(st, l, T_F64), b = conv(st, r, T_F64), m;
+        new_tmp(st, &m, T_F64);
+        ins(st, "%s =d call $fmod(d %s, d %s)", m.v, a.v, b.v);
+        return conv(st, m, t);
+    }
+    const char* opname = "add";
+    switch (op) {
+        case OP_SUB: opname = "sub"; break;
+        case OP_MUL: opname = "mul"; break;
+        case OP_DIV: opname = "div"; break;
+        case OP_MOD: opname = "rem"; break;
+        default: break;
+    }
+    ins(st, "%s =%c %s %s, %s", res.v, c, opname, l.v, r.v);
+    if (t == T_I8) ins(st, "%s =w extsb %s", res.v, res.v);//i8 运算按 8 位回绕
+    return res;
+}
+
+static QVal gen_unary(QbeGenState* st, ASTNode* node) {
+    switch (node->data.unaryop.op) {
+        case OP_PLUS:
+            return gen_expr(st, node->data.unaryop.expr);
+        case OP_MINUS: {
+            QVal v = gen_expr(st, node->data.unaryop.expr);
+            if (v.t == T_BOOL) v = conv(st, v, T_I32);
+            if (!is_num_t(v.t)) {
+                qbe_error(node, "qbe: cannot negate a value of type %s", v.t);
+                return v;
+            }
+            QVal r;
+            new_tmp(st, &r, v.t);
+            ins(st, "%s =%c neg %s", r.v, qcls(v.t), v.v);
+            if (v.t == T_I8) ins(st, "%s =w extsb %s", r.v, r.v);
+            return r;
+        }
+        case OP_ADDRESS: {
+            ASTNode* e = node->data.unaryop.expr;
+            if (e && e->type == AST_IDENTIFIER && !var_addr(st, ast_intern(e->data.identifier.name), &(const char*){NULL}).v[0]) {
+                int fi = find_func(st, ast_intern(e->data.identifier.name));
+                if (fi >= 0) return gen_expr(st, e);//&f：函数地址
+            }
+            const char* t = NULL;
+            QVal a = gen_addr(st, e, &t);
+            a.t = ptr_to(t);
+            return a;
+        }
+        case OP_DEREF: {
+            const char* t = NULL;
+            QVal a = gen_addr(st, node, &t);
+            return load_from(st, a, t);
+        }
+    }
+    return const_int(0, T_I32);
+}
+
+static QVal gen_list_literal(QbeGenState* st, ASTNode* node) {
+    int n = node->data.expression_list.expression_count;
+    st->used_helpers |= H_LIST;
+    if (n == 0) {
+        return call_l(st, "__vix_qbe_list_new", T_LIST_ANY, "l 8, l 0");
+    }
+    QVal* vals = malloc(sizeof(QVal) * n);
+    for (int i = 0; i < n; i++) {
+        ASTNode* e = node->data.expression_list.expressions[i];
+        vals[i] = bind_value(st, e, gen_expr(st, e));
+    }
+    const char* et = vals[0].t;
+    char args[64];
+    snprintf(args, sizeof(args), "l %d, l %d", elem_size(et), n);
+    QVal h = call_l(st, "__vix_qbe_list_new", list_of(et), args);
+    QVal data = list_field(st, h, 0, T_PTR);
+    for (int i = 0; i < n; i++) {
+        QVal addr;
+        new_tmp(st, &addr, T_PTR);
+        ins(st, "%s =l add %s, %d", addr.v, data.v, i * elem_size(et));
+        store_to(st, addr, vals[i], et);
+    }
+    free(vals);
+    return h;
+}
+
+static QVal gen_struct_literal(QbeGenState* st, ASTNode* node) {
+    const char* sname = ident_name(node->data.struct_literal.type_name);
+    char** names = NULL;
+    char** types = NULL;
+    int n = 0;
+    if (!sname || !qbe_get_struct_info(st, sname, &names, &types, &n)) {
+        qbe_error(node, "qbe: unknown struct '%s'", sname ? sname : "?");
+        return const_int(0, T_PTR);
+    }
+    sname = ast_intern(sname);
+    char args[64];
+    snprintf(args, sizeof(args), "l 1, l %d", n > 0 ? n * 8 : 8);
+    QVal obj = call_l(st, "calloc", sname, args);
+    ASTNode* fields = node->data.struct_literal.fields;
+    int fc = (fields && fields->type == AST_EXPRESSION_LIST) ? fields->data.expression_list.expression_count : 0;
+    for (int i = 0; i < n; i++) {
+        ASTNode* init = NULL;
+        for (int j = 0; j < fc; j++) {
+            ASTNode* f = fields->data.expression_list.expressions[j];
+            if (f && f->type == AST_ASSIGN && ident_name(f->data.assign.left) &&
+                strcmp(ident_name(f->data.assign.left), names[i]) == 0) {
+                init = f->data.assign.right;
+                break;
+            }
+        }
+        QVal v;
+        if (init) {
+            v = bind_value(st, init, gen_expr(st, init));
+        } else if (is_list_t(types[i])) {//没写的列表字段给一个空列表，免得下标访问空指针
+            st->used_helpers |= H_LIST;
+            const char* e = list_elem(types[i]);
+            snprintf(args, sizeof(args), "l %d, l 0", e ? elem_size(e) : 8);
+            v = call_l(st, "__vix_qbe_list_new", types[i], args);
+        } else {
+            continue;
+        }
+        QVal addr;
+        new_tmp(st, &addr, T_PTR);
+        ins(st, "%s =l add %s, %d", addr.v, obj.v, i * 8);
+        store_to(st, addr, v, types[i]);
+    }
+    return obj;
+}
+
+// 函数 (或 lambda) 的符号；lambda 第一次遇到时登记，当前函数生成完再生成它
+static QVal func_ref(QbeGenState* st, ASTNode* fn) {
+    const char* name = ast_intern(fn->data.function.name);
+    int i = find_func(st, name);
+    while (i >= 0 && st->func_nodes[i] != fn) {//不同语法规则里的 lambda 计数器各自从 0 开始，名字会重
+        char buf[128];
+        snprintf(buf, sizeof(buf), "%s_%d", name, st->func_count);
+        name = ast_intern(buf);
+        i = find_func(st, name);
+    }
+    if (i < 0) i = add_func(st, name, fn, name, NULL, 0);
+    QVal r;
+    snprintf(r.v, sizeof(r.v), "$%s", st->func_symbols[i]);
+    r.t = T_FN;
+    return r;
+}
+
+/* 调用参数：按形参类型转换；可变参数部分 f32 提升成 double，列表传给 C 函数时传数据指针 */
+static void append_arg(QbeGenState* st, char** buf, size_t* len, size_t* cap, QVal v) {
+    char c = qcls(v.t);
+    if (c == 's') {
+        v = conv(st, v, T_F64);
+        c = 'd';
+    }
+    size_t need = *len + strlen(v.v) + 8;
+    if (need > *cap) {
+        *cap = need * 2;
+        *buf = realloc(*buf, *cap);
+    }
+    *len += sprintf(*buf + *len, "%s%c %s", *len ? ", " : "", c, v.v);
+}
+
+static void append_raw(char** buf, size_t* len, size_t* cap, const char* s) {
+    size_t need = *len + strlen(s) + 4;
+    if (need > *cap) {
+        *cap = need * 2;
+        *buf = realloc(*buf, *cap);
+    }
+    *len += sprintf(*buf + *len, "%s%s", *len ? ", " : "", s);
+}
+
+static int arg_count(ASTNode* args) {
+    return (args && args->type == AST_EXPRESSION_LIST) ? args->data.expression_list.expression_count : 0;
+}
+
+static ASTNode* arg_at(ASTNode* args, int i) {
+    return args->data.expression_list.expressions[i];
+}
+
+// 字符串传出去可能被改写
+static void slen_invalidate_args(QbeGenState* st, ASTNode* args) {
+    for (int i = 0; i < arg_count(args); i++) {
+        slen_invalidate(st, arg_at(args, i));
+    }
+}
+
+static QVal emit_call(QbeGenState* st, const char* callee, const char* ret, const char* args) {
+    QVal r;
+    if (ret == T_VOID) {
+        ins(st, "call %s(%s)", callee, args);
+        r = const_int(0, T_VOID);
+        return r;
+    }
+    new_tmp(st, &r, ret);
+    ins(st, "%s =%c call %s(%s)", r.v, qcls(ret), callee, args);
+    return r;
+}
+
+static void bind_generic(QbeGenState* st, ASTNode* ptype, const char* at, char** names, char** types, int n) {
+    if (!ptype || !at) return;
+    const char* pname = ident_name(ptype);
+    if (!pname && ptype->type == AST_TYPE_LIST && is_list_t(at)) {
+        bind_generic(st, ptype->data.list_type.element_type, list_elem(at), names, types, n);
+        return;
+    }
+    for (int i = 0; pname && i < n; i++) {
+        if (strcmp(names[i], pname) == 0 && !types[i]) types[i] = (char*)at;
+    }
+}
+
+// 泛型函数按类型实参实例化：名字 f__i32__string，同一组实参只生成一份
+static int instantiate(QbeGenState* st, int gi, ASTNode* call, QVal* vals, int nargs) {
+    ASTNode* fn = st->func_nodes[gi];
+    ASTNode* gp = fn->data.function.generic_params;
+    int n = gp->data.expression_list.expression_count;
+    char** names = calloc(n, sizeof(char*));
+    char** types = calloc(n, sizeof(char*));
+    for (int i = 0; i < n; i++) {
+        ASTNode* g = gp->data.expression_list.expressions[i];
+        names[i] = (char*)(ident_name(g) ? ident_name(g) : "?");
+    }
+    ASTNode* targs = call->data.call.type_args;
+    for (int i = 0; i < n && i < arg_count(targs); i++) {
+        types[i] = (char*)qbe_type_name(st, arg_at(targs, i));
+    }
+    for (int i = 0; i < nargs && i < param_count(fn); i++) {
+        bind_generic(st, param_type_node(param_at(fn, i)), vals[i].t, names, types, n);
+    }
+    char sym[512];
+    int len = snprintf(sym, sizeof(sym), "%s", fn->data.function.name);
+    for (int i = 0; i < n; i++) {
+        if (!types[i]) types[i] = (char*)T_I32;
+        len += snprintf(sym + len, sizeof(sym) - len, "__");
+        for (const char* p = types[i]; *p && len < (int)sizeof(sym) - 2; p++) {
+            sym[len++] = ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') || (*p >= '0' && *p <= '9')) ? *p : '_';
+        }
+        sym[len] = '\0';
+    }
+    const char* name = ast_intern(sym);
+    int i = find_func(st, name);
+    if (i >= 0) {
+        free(names);
+        free(types);
+        return i;
+    }
+    char** bind = malloc(sizeof(char*) * n * 2);
+    for (int k = 0; k < n; k++) {
+        bind[2 * k] = names[k];
+        bind[2 * k + 1] = types[k];
+    }
+    free(names);
+    free(types);
+    return add_func(st, name, fn, name, bind, n);
+}
+
+static QVal gen_direct_call(QbeGenState* st, ASTNode* node, int fi) {
+    ASTNode* args = node->data.call.args;
+    int n = arg_count(args);
+    QVal* vals = n ? malloc(sizeof(QVal) * n) : NULL;
+    for (int i = 0; i < n; i++) {
+        ASTNode* a = arg_at(args, i);
+        vals[i] = bind_value(st, a, gen_expr(st, a));
+    }
+    if (is_generic(st->func_nodes[fi])) fi = instantiate(st, fi, node, vals, n);
+    ASTNode* fn = st->func_nodes[fi];
+    int np = param_count(fn);
+    int is_ext = fn->data.function.is_extern;
+    if (n < np || (n > np && !fn->data.function.vararg)) {
+        qbe_error(node, "qbe: '%s' expects %d argument(s), got %d", fn->data.function.name, np, n);
+    }
+
+    char** saved = st->type_bindings;
+    int saved_n = st->type_binding_count;
+    st->type_bindings = st->func_bindings[fi];
+    st->type_binding_count = st->func_binding_counts[fi];
+    size_t len = 0, cap = 128;
+    char* buf = malloc(cap);
+    buf[0] = '\0';
+    for (int i = 0; i < n; i++) {
+        QVal v = vals[i];
+        if (i < np) {
+            const char* pt = qbe_type_name(st, param_type_node(param_at(fn, i)));
+            if (!param_type_node(param_at(fn, i))) pt = is_num_t(v.t) ? T_I32 : v.t;//mut x 这种没写类型的参数
+            if (is_ext && is_list_t(v.t) && !is_list_t(pt)) v = list_field(st, v, 0, T_PTR);
+            v = conv(st, v, pt);
+        } else {
+            if (i == np) append_raw(&buf, &len, &cap, "...");
+            if (is_ext && is_list_t(v.t)) v = list_field(st, v, 0, T_PTR);
+            if (v.t == T_BOOL || v.t == T_I8) v = conv(st, v, T_I32);
+        }
+        append_arg(st, &buf, &len, &cap, v);
+    }
+    if (fn->data.function.vararg && n <= np) append_raw(&buf, &len, &cap, "...");
+    st->type_bindings = saved;
+    st->type_binding_count = saved_n;
+
+    char callee[160];
+    snprintf(callee, sizeof(callee), "$%s", st->func_symbols[fi]);
+    QVal r = emit_call(st, callee, func_ret_type(st, fi), buf);
+    slen_invalidate_args(st, args);
+    free(buf);
+    free(vals);
+    return r;
+}
+
+static QVal gen_indirect_call(QbeGenState* st, ASTNode* node, QVal fp) {
+    ASTNode* args = node->data.call.args;
+    size_t len = 0, cap = 128;
+    char* buf = malloc(cap);
+    buf[0] = '\0';
+    for (int i = 0; i < arg_count(args); i++) {
+        ASTNode* a = arg_at(args, i);
+        QVal v = bind_value(st, a, gen_expr(st, a));
+        if (v.t == T_BOOL || v.t == T_I8) v = conv(st, v, T_I32);
+        append_arg(st, &buf, &len, &cap, v);
+    }
+    QVal r = emit_call(st, fp.v, T_I32, buf);//函数值不带签名，返回值按 i32
+    slen_invalidate_args(st, args);
+    free(buf);
+    return r;
+}
+
+static QVal gen_sb_call(QbeGenState* st, ASTNode* node, QVal sb, const char* m) {
+    ASTNode* args = node->data.call.args;
+    ASTNode* a0 = arg_count(args) > 0 ? arg_at(args, 0) : NULL;
+    char cargs[256];
+    st->used_helpers |= H_SB;
+    if (strcmp(m, "to_string") == 0) {
+        QVal data = list_field(st, sb, 0, T_PTR);
+        snprintf(cargs, sizeof(cargs), "l %s", data.v);
+        return call_l(st, "strdup", T_STR, cargs);
+    }
+    if (strcmp(m, "length") == 0 || strcmp(m, "size") == 0) {
+        return list_field(st, sb, 8, T_I64);
+    }
+    if (strcmp(m, "clear") == 0) {
+        QVal p, data = list_field(st, sb, 0, T_PTR);
+        new_tmp(st, &p, T_PTR);
+        ins(st, "%s =l add %s, 8", p.v, sb.v);
+        ins(st, "storel 0, %s", p.v);
+        ins(st, "storeb 0, %s", data.v);
+        return const_int(0, T_VOID);
+    }
+    if (!a0) {
+        qbe_error(node, "qbe: StringBuilder.%s needs an argument", m);
+        return const_int(0, T_VOID);
+    }
+    QVal v = gen_expr(st, a0);
+    if (strcmp(m, "reserve") == 0) {
+        v = conv(st, v, T_I64);
+        ins(st, "call $__vix_qbe_sb_reserve(l %s, l %s)", sb.v, v.v);
+        return const_int(0, T_VOID);
+    }
+    if (strcmp(m, "append_int") == 0) v = conv(st, v, T_I64);
+    else if (strcmp(m, "append_char") == 0) v = conv(st, v, T_I8);
+    else if (strcmp(m, "append_float") == 0) v = conv(st, v, T_F64);
+    else if (strcmp(m, "append") != 0) {
+        qbe_unsupported(st, node, "this StringBuilder method");
+        return const_int(0, T_VOID);
+    }
+    if (v.t == T_SB) v = list_field(st, v, 0, T_STR);
+    QVal n, buf = v;
+    if (is_int_t(v.t) && v.t != T_I8) {
+        buf = scratch(st);
+        QVal w = conv(st, v, T_I64);
+        new_tmp(st, &n, T_I32);
+        ins(st, "%s =w call $snprintf(l %s, l 512, l $__vix_qbe_fmt_lld, ..., l %s)", n.v, buf.v, w.v);
+        n = conv(st, n, T_I64);
+    } else if (is_float_t(v.t)) {
+        buf = scratch(st);
+        QVal d = conv(st, v, T_F64);
+        new_tmp(st, &n, T_I32);
+        ins(st, "%s =w call $snprintf(l %s, l 512, l $__vix_qbe_fmt_f, ..., d %s)", n.v, buf.v, d.v);
+        n = conv(st, n, T_I64);
+    } else if (v.t == T_I8) {
+        buf = scratch(st);
+        ins(st, "storeb %s, %s", v.v, buf.v);
+        n = const_int(1, T_I64);
+    } else {
+        n = str_length(st, v);
+    }
+    ins(st, "call $__vix_qbe_sb_append(l %s, l %s, l %s)", sb.v, buf.v, n.v);
+    return const_int(0, T_VOID);
+}
+
+static void set_list_type(QbeGenState* st, ASTNode* obj, const char* t) {
+    const char* name = ident_name(obj);
+    if (!name) return;
+    name = ast_intern(name);
+    int i = st->in_top ? -1 : find_local(st, name);
+    if (i >= 0) {
+        st->var_types[i] = (char*)t;
+        return;
+    }
+    i = find_global(st, name);
+    if (i >= 0) st->global_var_types[i] = (char*)t;
+}
+
+static QVal gen_method_call(QbeGenState* st, ASTNode* node) {
+    ASTNode* mem = node->data.call.func;
+    ASTNode* objn = mem->data.member_access.object;
+    const char* m = ident_name(mem->data.member_access.field);
+    ASTNode* args = node->data.call.args;
+    if (!m) m = "";
+    const char* on = ident_name(objn);
+    if (on && !var_addr(st, ast_intern(on), &(const char*){NULL}).v[0]) {//模块名.函数()
+        int fi = find_func(st, ast_intern(m));
+        if (fi >= 0) return gen_direct_call(st, node, fi);
+    }
+    QVal obj = gen_expr(st, objn);
+    if (obj.t == T_SB) return gen_sb_call(st, node, obj, m);
+    if (is_list_t(obj.t)) {
+        st->used_helpers |= H_LIST;
+        char cargs[160];
+        const char* e = list_elem(obj.t);
+        if (strcmp(m, "push") == 0 && arg_count(args) == 1) {
+            ASTNode* a = arg_at(args, 0);
+            QVal v = bind_value(st, a, gen_expr(st, a));
+            if (!e) {//[] 第一次 push 时定下元素类型
+                e = v.t;
+                set_list_type(st, objn, list_of(e));
+            }
+            snprintf(cargs, sizeof(cargs), "l %s, l %d", obj.v, elem_size(e));
+            QVal slot = call_l(st, "__vix_qbe_list_push", T_PTR, cargs);
+            store_to(st, slot, v, e);
+            return const_int(0, T_VOID);
+        }
+        if (strcmp(m, "reserve") == 0 && arg_count(args) == 1) {
+            QVal n = conv(st, gen_expr(st, arg_at(args, 0)), T_I64);
+            ins(st, "call $__vix_qbe_list_reserve(l %s, l %d, l %s)", obj.v, e ? elem_size(e) : 8, n.v);
+            return const_int(0, T_VOID);
+        }
+        if (strcmp(m, "shrink_to_fit") == 0) {
+            ins(st, "call $__vix_qbe_list_shrink(l %s, l %d)", obj.v, e ? elem_size(e) : 8);
+            return const_int(0, T_VOID);
+        }
+        if (strcmp(m, "length") == 0 || strcmp(m, "size") == 0) return list_field(st, obj, 8, T_I64);
+    }
+    if ((strcmp(m, "length") == 0 || strcmp(m, "size") == 0) && (obj.t == T_STR || obj.t == T_PTR)) {
+        return var_length(st, objn, obj);
+    }
+    qbe_error(node, "qbe: no method '%s' on %s", m, obj.t);
+    return const_int(0, T_VOID);
+}
+
+static QVal gen_call(QbeGenState* st, ASTNode* node) {
+    ASTNode* f = node->data.call.func;
+    if (f && f->type == AST_MEMBER_ACCESS) return gen_method_call(st, node);
+    const char* name = ident_name(f);
+    if (!name) {
+        QVal fp = gen_expr(st, f);
+        return gen_indirect_call(st, node, fp);
+    }
+    name = ast_intern(name);
+    ASTNode* args = node->data.call.args;
+    const char* vt = NULL;
+    QVal va = var_addr(st, name, &vt);
+    if (va.v[0] && !is_num_t(vt)) {//type R = Ok(T) | Err(E) 会把 Ok / Err 定义成整数常量，不是函数值
+        QVal fp = load_from(st, va, vt);
+        return gen_indirect_call(st, node, fp);
+    }
+    int fi = find_func(st, name);
+    if (fi >= 0) return gen_direct_call(st, node, fi);
+
+    if ((strcmp(name, "Some") == 0 || strcmp(name, "Ok") == 0 || strcmp(name, "Err") == 0) && arg_count(args) == 1) {
+        return gen_expr(st, arg_at(args, 0));//和 LLVM 后端一样只带载荷
+    }
+    if (strcmp(name, "StringBuilder") == 0) {
+        st->used_helpers |= H_SB;
+        QVal c = arg_count(args) > 0 ? conv(st, gen_expr(st, arg_at(args, 0)), T_I64) : const_int(16, T_I64);
+        char cargs[96];
+        snprintf(cargs, sizeof(cargs), "l %s", c.v);
+        return call_l(st, "__vix_qbe_sb_new", T_SB, cargs);
+    }
+    if (strcmp(name, "read_line") == 0 && arg_count(args) == 0) {
+        st->used_helpers |= H_READ_LINE;
+        return call_l(st, "__vix_qbe_read_line", T_STR, "");
+    }
+    if (strcmp(name, "read_all") == 0 && arg_count(args) == 0) {
+        st->used_helpers |= H_READ_ALL;
+        return call_l(st, "__vix_qbe_read_all", T_STR, "");
+    }
+    NodeType elem;
+    int lanes;
+    if (vector_type_info(name, &elem, &lanes)) {
+        qbe_unsupported(st, node, "SIMD vector types");
+        return const_int(0, T_I32);
+    }
+    if (strcmp(name, "lines") == 0) {
+        qbe_unsupported(st, node, "lines() outside of a for loop");
+        return const_int(0, T_PTR);
+    }
+    qbe_error(node, "qbe: undefined function '%s'", name);
+    return const_int(0, T_I32);
+}
+
+/*
+循环里的 s = s + a + b：和 LLVM 后端一样，s 在循环里只以这种形式出现时，循环前建一个 builder 放进 s 的当前值，
+每次赋值改成追加，循环结束后把缓冲交回 s，总复制量是线性的
+*/
+static void flatten_concat(ASTNode* node, ASTNode*** parts, int* n, int* cap) {
+    if (node && node->type == AST_BINOP && (node->data.binop.op == OP_ADD || node->data.binop.op == OP_CONCAT)) {
+        flatten_concat(node->data.binop.left, parts, n, cap);
+        flatten_concat(node->data.binop.right, parts, n, cap);
+        return;
+    }
+    if (*n >= *cap) {
+        *cap = *cap ? *cap * 2 : 8;
+        *parts = realloc(*parts, sizeof(ASTNode*) * *cap);
+    }
+    (*parts)[(*n)++] = node;
+}
+
+// 静态确定是字符串的部分；char、指针算术之类拿不准的都不算
+static int is_static_string(QbeGenState* st, ASTNode* node) {
+    if (!node) return 0;
+    switch (node->type) {
+        case AST_STRING:
+        case AST_INPUT:
+            return 1;
+        case AST_IDENTIFIER: {
+            const char* t = NULL;
+            var_addr(st, ast_intern(node->data.identifier.name), &t);
+            return t == T_STR;
+        }
+        case AST_BINOP:
+            return (node->data.binop.op == OP_ADD || node->data.binop.op == OP_CONCAT) &&
+                   is_static_string(st, node->data.binop.left) && is_static_string(st, node->data.binop.right);
+        case AST_CALL: {
+            const char* name = ident_name(node->data.call.func);
+            if (!name) return 0;
+            if (strcmp(name, "read_line") == 0 || strcmp(name, "read_all") == 0) return 1;
+            int fi = find_func(st, ast_intern(name));
+            return fi >= 0 && !st->func_nodes[fi]->data.function.is_extern && !is_generic(st->func_nodes[fi]) &&
+                   func_ret_type(st, fi) == T_STR;
+        }
+        default:
+            return 0;
+    }
+}
+
+// name 在 node 里出现的次数；不认识的结点、遮住 name 的 for 都返回 -1
+static int count_uses(ASTNode* node, const char* name) {
+    if (!node) return 0;
+    ASTNode* kids[4] = {NULL, NULL, NULL, NULL};
+    ASTNode** list = NULL;
+    int nlist = 0;
+    switch (node->type) {
+        case AST_IDENTIFIER:
+            return node->data.identifier.name && strcmp(node->data.identifier.name, name) == 0;
+        case AST_NUM_INT: case AST_NUM_FLOAT: case AST_STRING: case AST_CHAR: case AST_NIL:
+        case AST_BREAK: case AST_CONTINUE:
+            return 0;
+        case AST_PROGRAM:
+            list = node->data.program.statements;
+            nlist = node->data.program.statement_count;
+            break;
+        case AST_EXPRESSION_LIST:
+            list = node->data.expression_list.expressions;
+            nlist = node->data.expression_list.expression_count;
+            break;
+        case AST_BINOP: kids[0] = node->data.binop.left; kids[1] = node->data.binop.right; break;
+        case AST_UNARYOP: kids[0] = node->data.unaryop.expr; break;
+        case AST_ASSIGN: case AST_CONST: kids[0] = node->data.assign.left; kids[1] = node->data.assign.right; break;
+        case AST_PRINT: kids[0] = node->data.print.expr; break;
+        case AST_INPUT: kids[0] = node->data.input.prompt; break;
+        case AST_TOINT: kids[0] = node->data.toint.expr; break;
+        case AST_TOFLOAT: kids[0] = node->data.tofloat.expr; break;
+        case AST_RETURN: kids[0] = node->data.return_stmt.expr; break;
+        case AST_IF:
+            kids[0] = node->data.if_stmt.condition;
+            kids[1] = node->data.if_stmt.then_body;
+            kids[2] = node->data.if_stmt.else_body;
+            break;
+        case AST_WHILE: kids[0] = node->data.while_stmt.condition; kids[1] = node->data.while_stmt.body; break;
+        case AST_FOR:
+            if (ident_name(node->data.for_stmt.var) && strcmp(ident_name(node->data.for_stmt.var), name) == 0) return -1;
+            kids[0] = node->data.for_stmt.start;
+            kids[1] = node->data.for_stmt.end;
+            kids[2] = node->data.for_stmt.body;
+            break;
+        case AST_CALL: kids[0] = node->data.call.func; kids[1] = node->data.call.args; break;
+        case AST_INDEX: kids[0] = node->data.index.target; kids[1] = node->data.index.index; break;
+        case AST_MEMBER_ACCESS: kids[0] = node->data.member_access.object; break;
+        case AST_STRUCT_LITERAL: kids[0] = node->data.struct_literal.fields; break;
+        default:
+            return -1;
+    }
+    int total = 0;
+    for (int i = 0; i < nlist; i++) {
+        int c = count_uses(list[i], name);
+        if (c < 0) return -1;
+        total += c;
+    }
+    for (int i = 0; i < 4; i++) {
+        int c = count_uses(kids[i], name);
+        if (c < 0) return -1;
+        total += c;
+    }
+    return total;
+}
+
+static void collect_assigns(ASTNode* node, ASTNode*** out, int* n, int* cap) {
+    if (!node) return;
+    switch (node->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < node->data.program.statement_count; i++) {
+                collect_assigns(node->data.program.statements[i], out, n, cap);
+            }
+            break;
+        case AST_ASSIGN:
+            if (*n >= *cap) {
+                *cap = *cap ? *cap * 2 : 8;
+                *out = realloc(*out, sizeof(ASTNode*) * *cap);
+            }
+            (*out)[(*n)++] = node;
+            break;
+        case AST_IF:
+            collect_assigns(node->data.if_stmt.then_body, out, n, cap);
+            collect_assigns(node->data.if_stmt.else_body, out, n, cap);
+            break;
+        case AST_WHILE:
+            collect_assigns(node->data.while_stmt.body, out, n, cap);
+            break;
+        case AST_FOR:
+            collect_assigns(node->data.for_stmt.body, out, n, cap);
+            break;
+        default:
+            break;
+    }
+}
+
+static int append_slot_of(QbeGenState* st, ASTNode* assign) {
+    for (int i = st->append_count - 1; i >= 0; i--) {
+        if (st->append_nodes[i] == assign) return st->append_slots[i];
+    }
+    return -1;
+}
+
+static int append_active(QbeGenState* st, const char* name) {
+    for (int i = 0; i < st->append_count; i++) {
+        if (strcmp(ident_name(st->append_nodes[i]->data.assign.left), name) == 0) return 1;
+    }
+    return 0;
+}
+
+// 返回进入前的 append_count，循环生成完交给 end_loop_appends
+static int begin_loop_appends(QbeGenState* st, ASTNode* loop) {
+    int mark = st->append_count;
+    if (st->in_top) return mark;
+    ASTNode* body = loop->type == AST_WHILE ? loop->data.while_stmt.body : loop->data.for_stmt.body;
+    ASTNode** assigns = NULL;
+    int na = 0, ca = 0;
+    collect_assigns(body, &assigns, &na, &ca);
+    for (int i = 0; i < na; i++) {
+        const char* name = ident_name(assigns[i]->data.assign.left);
+        if (!name || assigns[i]->data.assign.is_declaration != 0) continue;
+        name = ast_intern(name);
+        int seen = 0;
+        for (int j = 0; j < i && !seen; j++) seen = ident_name(assigns[j]->data.assign.left) == name ||
+            (ident_name(assigns[j]->data.assign.left) && strcmp(ident_name(assigns[j]->data.assign.left), name) == 0);
+        if (seen || append_active(st, name) || find_local(st, name) < 0) continue;
+        if (st->var_types[find_local(st, name)] != T_STR) continue;
+        if (loop->type == AST_FOR && ident_name(loop->data.for_stmt.var) && strcmp(ident_name(loop->data.for_stmt.var), name) == 0) continue;
+
+        int ok = 1, nappends = 0;
+        ASTNode** parts = NULL;
+        int np = 0, cp = 0;
+        for (int j = 0; j < na && ok; j++) {
+            ASTNode* b = assigns[j];
+            if (!ident_name(b->data.assign.left) || strcmp(ident_name(b->data.assign.left), name) != 0) continue;
+            np = 0;
+            flatten_concat(b->data.assign.right, &parts, &np, &cp);
+            ok = b->data.assign.is_declaration == 0 && np >= 2 && ident_name(parts[0]) && strcmp(ident_name(parts[0]), name) == 0;
+            for (int k = 1; ok && k < np; k++) {
+                ok = is_static_string(st, parts[k]) && count_uses(parts[k], name) == 0;
+            }
+            nappends++;
+        }
+        free(parts);
+        if (!ok) continue;
+        int uses = count_uses(body, name);
+        int more = loop->type == AST_WHILE ? count_uses(loop->data.while_stmt.condition, name)
+                                           : count_uses(loop->data.for_stmt.start, name) + count_uses(loop->data.for_stmt.end, name);
+        if (uses < 0 || more != 0 || uses != 2 * nappends) continue;//s 在别处被读了，保持原样
+
+        st->used_helpers |= H_SB;
+        const char* t = NULL;
+        QVal cur = load_from(st, var_addr(st, name, &t), T_STR);
+        QVal sb = call_l(st, "__vix_qbe_sb_new", T_SB, "l 16");
+        ins(st, "call $__vix_qbe_sb_append_str(l %s, l %s)", sb.v, cur.v);
+        int slot = new_slot(st);
+        ins(st, "storel %s, %%v%d", sb.v, slot);
+        for (int j = 0; j < na; j++) {
+            if (!ident_name(assigns[j]->data.assign.left) || strcmp(ident_name(assigns[j]->data.assign.left), name) != 0) continue;
+            if (st->append_count >= st->append_capacity) {
+                st->append_capacity = st->append_capacity ? st->append_capacity * 2 : 8;
+                st->append_nodes = realloc(st->append_nodes, sizeof(ASTNode*) * st->append_capacity);
+                st->append_slots = realloc(st->append_slots, sizeof(int) * st->append_capacity);
+            }
+            st->append_nodes[st->append_count] = assigns[j];
+            st->append_slots[st->append_count++] = slot;
+        }
+    }
+    free(assigns);
+    return mark;
+}
+
+// 循环出口 (break 也汇到这里)：缓冲交回 s，长度已知
+static void end_loop_appends(QbeGenState* st, int mark) {
+    for (int i = mark; i < st->append_count; i++) {
+        int slot = st->append_slots[i];
+        int first = 1;
+        for (int j = mark; j < i && first; j++) first = st->append_slots[j] != slot;
+        if (!first) continue;
+        const char* name = ast_intern(ident_name(st->append_nodes[i]->data.assign.left));
+        QVal sb, data, len;
+        new_tmp(st, &sb, T_SB);
+        ins(st, "%s =l loadl %%v%d", sb.v, slot);
+        data = list_field(st, sb, 0, T_STR);
+        len = list_field(st, sb, 8, T_I64);
+        const char* t = NULL;
+        ins(st, "storel %s, %s", data.v, var_addr(st, name, &t).v);
+        int sl = slen_slot(st, name, 1);
+        ins(st, "storel %s, %%v%d", len.v, sl);
+        ins(st, "call $free(l %s)", sb.v);
+    }
+    st->append_count = mark;
+}
+
+static QVal gen_assign(QbeGenState* st, ASTNode* node) {
+    ASTNode* left = node->data.assign.left;
+    ASTNode* right = node->data.assign.right;
+    if (!left) return const_int(0, T_VOID);
+    int sb_slot = append_slot_of(st, node);
+    if (sb_slot >= 0) {
+        ASTNode** parts = NULL;
+        int np = 0, cp = 0;
+        flatten_concat(right, &parts, &np, &cp);
+        QVal sb;
+        new_tmp(st, &sb, T_SB);
+        ins(st, "%s =l loadl %%v%d", sb.v, sb_slot);
+        for (int i = 1; i < np; i++) {
+            QVal v = gen_expr(st, parts[i]);
+            ins(st, "call $__vix_qbe_sb_append_str(l %s, l %s)", sb.v, v.v);
+        }
+        free(parts);
+        return const_int(0, T_VOID);
+    }
+    QVal v = right ? bind_value(st, right, gen_expr(st, right)) : const_int(0, T_I32);
+    if (v.t == T_VOID) {
+        qbe_error(node, "qbe: cannot assign a value of type void");
+        v = const_int(0, T_I32);
+    }
+    const char* name = ident_name(left);
+    if (name) {
+        name = ast_intern(name);
+        int decl = node->type == AST_CONST || node->data.assign.is_declaration == 1;
+        const char* t = NULL;
+        QVal a = var_addr(st, name, &t);
+        if (!a.v[0] || (decl && !st->in_top && find_local(st, name) < 0)) {
+            if (st->in_top) declare_global(st, name, v.t);
+            else declare_local(st, name, v.t);
+            a = var_addr(st, name, &t);
+        } else if (decl || t == T_LIST_ANY) {//重新声明可以换类型；[] 被赋了具体列表就跟着变
+            if (decl || is_list_t(v.t)) {
+                set_list_type(st, left, v.t);
+                t = v.t;
+            }
+        }
+        store_to(st, a, v, t);
+        int slot = slen_slot(st, name, t == T_STR);
+        if (slot >= 0) {
+            int src = right && right->type == AST_IDENTIFIER && t == T_STR ? slen_slot(st, ast_intern(ident_name(right)), 0) : -1;
+            if (right && right->type == AST_STRING && right->data.string.value && t == T_STR) {
+                ins(st, "storel %zu, %%v%d", strlen(right->data.string.value), slot);
+            } else if (src >= 0) {
+                QVal n;
+                new_tmp(st, &n, T_I64);
+                ins(st, "%s =l loadl %%v%d", n.v, src);
+                ins(st, "storel %s, %%v%d", n.v, slot);
+            } else {
+                ins(st, "storel -1, %%v%d", slot);
+            }
+        }
+        return conv(st, v, t);
+    }
+    const char* t = NULL;
+    QVal a = gen_addr(st, left, &t);
+    store_to(st, a, v, t);
+    if (left->type == AST_INDEX) slen_invalidate(st, left->data.index.target);
+    return conv(st, v, t);
+}
+
+static QVal gen_expr(QbeGenState* st, ASTNode* node) {
+    if (!node) return const_int(0, T_I32);
+    switch (node->type) {
+        case AST_NUM_INT: {
+            long long v = node->data.num_int.value;
+            return const_int(v, (v >= INT32_MIN && v <= INT32_MAX) ? T_I32 : T_I64);
+        }
+        case AST_NUM_FLOAT: {
+            QVal r;
+            snprintf(r.v, sizeof(r.v), "d_%.17g", node->data.num_float.value);
+            r.t = T_F64;
+            return r;
+        }
+        case AST_CHAR:
+            return const_int((signed char)node->data.character.value, T_I8);
+        case AST_STRING:
+            return string_const(st, node->data.string.value);
+        case AST_NIL:
+            return const_int(0, T_PTR);
+        case AST_IDENTIFIER: {
+            const char* name = ast_intern(node->data.identifier.name);
+            const char* t = NULL;
+            QVal a = var_addr(st, name, &t);
+            if (a.v[0]) return load_from(st, a, t);
+            int fi = find_func(st, name);
+            if (fi >= 0) return func_ref(st, st->func_nodes[fi]);
+            if (strcmp(name, "None") == 0) return const_int(0, T_I32);
+            report_undefined_variable_with_location(name, src_file(node), node->location.first_line);
+            return const_int(0, T_I32);
+        }
+        case AST_BINOP:
+            return gen_binop(st, node);
+        case AST_UNARYOP:
+            return gen_unary(st, node);
+        case AST_ASSIGN:
+        case AST_CONST:
+            return gen_assign(st, node);
+        case AST_EXPRESSION_LIST:
+            return gen_list_literal(st, node);
+        case AST_STRUCT_LITERAL:
+            return gen_struct_literal(st, node);
+        case AST_INDEX: {
+            const char* t = NULL;
+            QVal a = gen_addr(st, node, &t);
+            return load_from(st, a, t);
+        }
+        case AST_MEMBER_ACCESS: {
+            const char* field = ident_name(node->data.member_access.field);
+            QVal obj = gen_expr(st, node->data.member_access.object);
+            if (field && (strcmp(field, "length") == 0 || strcmp(field, "size") == 0) && !is_struct_t(st, obj.t)) {
+                if (is_list_t(obj.t) || obj.t == T_SB) return list_field(st, obj, 8, T_I64);
+                return var_length(st, node->data.member_access.object, obj);
+            }
+            const char* t = NULL;
+            QVal a = member_addr(st, node, obj, &t);
+            return load_from(st, a, t);
+        }
+        case AST_CALL:
+            return gen_call(st, node);
+        case AST_INPUT: {
+            st->used_helpers |= H_INPUT | H_READ_LINE | H_EMPTY | H_FMT_S;
+            QVal p = node->data.input.prompt ? gen_expr(st, node->data.input.prompt) : const_int(0, T_PTR);
+            char args[96];
+            snprintf(args, sizeof(args), "l %s", p.v);
+            return call_l(st, "__vix_qbe_input", T_STR, args);
+        }
+        case AST_TOINT: {
+            QVal v = gen_expr(st, node->data.toint.expr);
+            if (v.t == T_STR || v.t == T_PTR) {
+                QVal r;
+                new_tmp(st, &r, T_I32);
+                ins(st, "%s =w call $atoi(l %s)", r.v, v.v);
+                return r;
+            }
+            return conv(st, v, T_I32);
+        }
+        case AST_TOFLOAT: {
+            QVal v = gen_expr(st, node->data.tofloat.expr);
+            if (v.t == T_STR || v.t == T_PTR) {
+                QVal r;
+                new_tmp(st, &r, T_F64);
+                ins(st, "%s =d call $atof(l %s)", r.v, v.v);
+                return r;
+            }
+            return conv(st, v, T_F64);
+        }
+        case AST_FUNCTION:
+            return func_ref(st, node);
+        case AST_MATCH:
+        case AST_IF:
+        case AST_WHILE:
+        case AST_FOR:
+        case AST_PRINT:
+        case AST_RETURN:
+        case AST_BREAK:
+        case AST_CONTINUE:
+        case AST_PROGRAM:
+            gen_stmt(st, node);
+            return const_int(0, T_VOID);
+        default:
+            qbe_unsupported(st, node, "a type name used as a value");
+            return const_int(0, T_I32);
+    }
+}
+
+/* ==================== 语句 ==================== */
+
+static void gen_print(QbeGenState* st, ASTNode* node) {
+    ASTNode* e = node->data.print.expr;
+    ASTNode** items = &e;
+    int n = e ? 1 : 0;
+    if (e && e->type == AST_EXPRESSION_LIST) {
+        items = e->data.expression_list.expressions;
+        n = e->data.expression_list.expression_count;
+    }
+    size_t flen = 0, fcap = 64;
+    char* fmt = malloc(fcap);
+    size_t alen = 0, acap = 128;
+    char* args = malloc(acap);
+    args[0] = '\0';
+    for (int i = 0; i < n; i++) {
+        const char* lit = NULL;
+        const char* spec = NULL;
+        if (items[i] && items[i]->type == AST_STRING) {//字符串字面量直接拼进格式串
+            lit = items[i]->data.string.value ? items[i]->data.string.value : "";
+        } else {
+            QVal v = gen_expr(st, items[i]);
+            if (v.t == T_VOID) {
+                qbe_error(items[i], "qbe: cannot print a value of type void");
+                continue;
+            }
+            if (v.t == T_I32 || v.t == T_BOOL) spec = "%d";
+            else if (v.t == T_I64) spec = "%lld";
+            else if (v.t == T_F64 || v.t == T_F32) spec = "%f";
+            else if (v.t == T_I8) spec = "%c";
+            else if (v.t == T_STR || v.t == T_PTR) spec = "%s";
+            else if (v.t == T_SB) {
+                v = list_field(st, v, 0, T_STR);
+                spec = "%s";
+            } else spec = "%p";
+            if (v.t == T_BOOL || v.t == T_I8) v = conv(st, v, T_I32);
+            if (alen == 0) append_raw(&args, &alen, &acap, "...");
+            append_arg(st, &args, &alen, &acap, v);
+        }
+        const char* piece = lit ? lit : spec;
+        size_t need = flen + strlen(piece) * 2 + 2;
+        if (need > fcap) {
+            fcap = need * 2;
+            fmt = realloc(fmt, fcap);
+        }
+        for (const char* p = piece; *p; p++) {
+            if (lit && *p == '%') fmt[flen++] = '%';
+            fmt[flen++] = *p;
+        }
+    }
+    fmt = realloc(fmt, flen + 2);
+    fmt[flen++] = '\n';
+    char sym[48];
+    snprintf(sym, sizeof(sym), "__vix_str_%d", st->string_counter++);
+    emit_string_data(st->data_out, sym, fmt, flen);
+    QVal r;
+    new_tmp(st, &r, T_I32);
+    ins(st, "%s =w call $printf(l $%s%s%s)", r.v, sym, alen ? ", " : ", ...", args);
+    if (qbe_unbuffered) ins(st, "call $fflush(l 0)");
+    free(fmt);
+    free(args);
+}
+
+static void gen_loop_body(QbeGenState* st, ASTNode* body, int brk, int cont) {
+    int saved_b = st->break_label, saved_c = st->continue_label;
+    st->break_label = brk;
+    st->continue_label = cont;
+    gen_stmt(st, body);
+    st->break_label = saved_b;
+    st->continue_label = saved_c;
+}
+
+// 循环变量：函数里是局部变量，顶层是全局变量
+static QVal loop_var(QbeGenState* st, ASTNode* var, const char* t) {
+    const char* name = ast_intern(ident_name(var) ? ident_name(var) : "_");
+    if (st->in_top) declare_global(st, name, t);
+    else declare_local(st, name, t);
+    const char* vt = NULL;
+    return var_addr(st, name, &vt);
+}
+
+static void gen_for(QbeGenState* st, ASTNode* node) {
+    ASTNode* var = node->data.for_stmt.var;
+    ASTNode* start = node->data.for_stmt.start;
+    ASTNode* end = node->data.for_stmt.end;
+    int cond = new_label(st), body = new_label(st), step = new_label(st), done = new_label(st);
+
+    if (!end && start && start->type == AST_CALL && ident_name(start->data.call.func) &&
+        strcmp(ident_name(start->data.call.func), "lines") == 0 && find_func(st, ast_intern("lines")) < 0) {
+        //for (line in lines())：逐行读到 EOF
+        st->used_helpers |= H_READ_LINE;
+        QVal slot = loop_var(st, var, T_STR);
+        place_label(st, cond);
+        QVal line = call_l(st, "__vix_qbe_read_line", T_STR, "");
+        QVal ok = cond_w(st, line);
+        emit_branch(st, ok.v, body, done);
+        place_label(st, body);
+        ins(st, "storel %s, %s", line.v, slot.v);
+        gen_loop_body(st, node->data.for_stmt.body, done, step);
+        place_label(st, step);
+        emit_jmp(st, cond);
+        place_label(st, done);
+        return;
+    }
+
+    if (!end) {//for (x in 列表 / 字符串)
+        QVal seq = gen_expr(st, start);
+        const char* et;
+        QVal len;
+        if (is_list_t(seq.t)) {
+            et = list_elem(seq.t) ? list_elem(seq.t) : T_I32;
+            len = const_int(0, T_I64);//每轮在条件块里重新读
+        } else if (seq.t == T_STR || seq.t == T_PTR) {
+            et = T_I8;
+            len = str_length(st, seq);
+        } else {
+            qbe_error(node, "qbe: cannot iterate over a value of type %s", seq.t);
+            return;
+        }
+        QVal slot = loop_var(st, var, et);
+        QVal idx;
+        snprintf(idx.v, sizeof(idx.v), "%%v%d", new_slot(st));
+        idx.t = T_PTR;
+        ins(st, "storel 0, %s", idx.v);
+        place_label(st, cond);
+        QVal i = load_from(st, idx, T_I64);
+        if (is_list_t(seq.t)) len = list_field(st, seq, 8, T_I64);//循环里可能 push
+        QVal c;
+        new_tmp(st, &c, T_BOOL);
+        ins(st, "%s =w csltl %s, %s", c.v, i.v, len.v);
+        emit_branch(st, c.v, body, done);
+        place_label(st, body);
+        const char* t = NULL;
+        QVal addr = index_addr(st, node, seq, i, &t);
+        store_to(st, slot, load_from(st, addr, t), et);
+        gen_loop_body(st, node->data.for_stmt.body, done, step);
+        place_label(st, step);
+        QVal i2 = load_from(st, idx, T_I64), i3;
+        new_tmp(st, &i3, T_I64);
+        ins(st, "%s =l add %s, 1", i3.v, i2.v);
+        ins(st, "storel %s, %s", i3.v, idx.v);
+        emit_jmp(st, cond);
+        place_label(st, done);
+        return;
+    }
+
+    //for (i in a .. b)：b 只求一次，不含 b
+    QVal s = gen_expr(st, start);
+    const char* t = is_int_t(s.t) && s.t != T_BOOL ? s.t : T_I32;
+    s = conv(st, s, t);
+    QVal e = gen_expr(st, end);
+    if (is_int_t(e.t) && type_rank(e.t) > type_rank(t) && is_const(&s)) {//0 .. s.length 这种按 i64 走
+        t = e.t;
+        s = conv(st, s, t);
+    }
+    e = conv(st, e, t);
+    if (!is_const(&e)) {
+        QVal fixed;
+        new_tmp(st, &fixed, t);
+        ins(st, "%s =%c copy %s", fixed.v, qcls(t), e.v);
+        e = fixed;
+    }
+    QVal slot = loop_var(st, var, t);
+    store_to(st, slot, s, t);
+    place_label(st, cond);
+    QVal i = load_from(st, slot, t);
+    QVal c;
+    new_tmp(st, &c, T_BOOL);
+    ins(st, "%s =w cslt%c %s, %s", c.v, qcls(t), i.v, e.v);
+    emit_branch(st, c.v, body, done);
+    place_label(st, body);
+    gen_loop_body(st, node->data.for_stmt.body, done, step);
+    place_label(st, step);
+    QVal i2 = load_from(st, slot, t), i3;
+    new_tmp(st, &i3, t);
+    ins(st, "%s =%c add %s, 1", i3.v, qcls(t), i2.v);
+    store_to(st, slot, i3, t);
+    emit_jmp(st, cond);
+    place_label(st, done);
+}
+
+static void gen_return(QbeGenState* st, ASTNode* node) {
+    ASTNode* e = node->data.return_stmt.expr;
+    const char* rt = st->current_ret_type;
+    if (rt == T_VOID) {
+        if (e) gen_expr(st, e);
+        ins(st, "ret");
+    } else {
+        QVal v = e ? gen_expr(st, e) : const_int(0, rt);
+        if (e && is_struct_t(st, v.t) && is_lvalue(e) && !(ident_name(e) && find_local(st, ast_intern(ident_name(e))) >= 0)) {
+            v = copy_struct(st, v, v.t, 0);
+        }
+        if (v.t == T_VOID) v = const_int(0, rt);
+        v = conv(st, v, rt);
+        ins(st, "ret %s", v.v);
+    }
+    st->terminated = 1;
+}
+
+static void gen_stmt(QbeGenState* st, ASTNode* node) {
+    if (!node) return;
+    switch (node->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < node->data.program.statement_count; i++) {
+                gen_stmt(st, node->data.program.statements[i]);
+            }
+            break;
+        case AST_PRINT:
+            gen_print(st, node);
+            break;
+        case AST_ASSIGN:
+        case AST_CONST:
+            if (node->data.assign.is_declaration == 2) break;//只有类型的声明 (参数、字段)
+            gen_assign(st, node);
+            break;
+        case AST_GLOBAL: {
+            const char* name = ident_name(node->data.global_decl.identifier);
+            if (!name) break;
+            name = ast_intern(name);
+            ASTNode* init = node->data.global_decl.initializer;
+            QVal v = init ? bind_value(st, init, gen_expr(st, init)) : const_int(0, T_I32);
+            const char* t = node->data.global_decl.type ? qbe_type_name(st, node->data.global_decl.type) : v.t;
+            declare_global(st, name, t);
+            const char* vt = NULL;
+            QVal a = var_addr(st, name, &vt);
+            if (st->in_top || find_local(st, name) < 0) store_to(st, a, v, t);
+            break;
+        }
+        case AST_IF: {
+            QVal c = cond_w(st, gen_expr(st, node->data.if_stmt.condition));
+            int then_l = new_label(st), else_l = new_label(st), end_l = node->data.if_stmt.else_body ? new_label(st) : else_l;
+            emit_branch(st, c.v, then_l, else_l);
+            place_label(st, then_l);
+            gen_stmt(st, node->data.if_stmt.then_body);
+            if (node->data.if_stmt.else_body) {
+                if (!st->terminated) emit_jmp(st, end_l);
+                place_label(st, else_l);
+                gen_stmt(st, node->data.if_stmt.else_body);
+            }
+            place_label(st, end_l);
+            break;
+        }
+        case AST_WHILE: {
+            int mark = begin_loop_appends(st, node);
+            int cond = new_label(st), body = new_label(st), done = new_label(st);
+            place_label(st, cond);
+            QVal c = cond_w(st, gen_expr(st, node->data.while_stmt.condition));
+            emit_branch(st, c.v, body, done);
+            place_label(st, body);
+            gen_loop_body(st, node->data.while_stmt.body, done, cond);
+            emit_jmp(st, cond);
+            place_label(st, done);
+            end_loop_appends(st, mark);
+            break;
+        }
+        case AST_FOR: {
+            int mark = begin_loop_appends(st, node);
+            gen_for(st, node);
+            end_loop_appends(st, mark);
+            break;
+        }
+        case AST_BREAK:
+        case AST_CONTINUE: {
+            int target = node->type == AST_BREAK ? st->break_label : st->continue_label;
+            if (target <= 0) {
+                qbe_error(node, "qbe: %s outside of a loop", node->type == AST_BREAK ? "break" : "continue");
+                break;
+            }
+            emit_jmp(st, target);
+            break;
+        }
+        case AST_RETURN:
+            gen_return(st, node);
+            break;
+        case AST_MATCH:
+            gen_stmt(st, lower_match_to_if(node));
+            break;
+        case AST_FUNCTION:
+            if (!st->in_top && !node->data.function.is_extern) func_ref(st, node);//嵌套函数和 lambda 一样排队
+            break;
+        case AST_IMPORT:
+        case AST_STRUCT_DEF:
+            break;
+        default:
+            gen_expr(st, node);
+            break;
+    }
+}
+
+/* ==================== 函数 ==================== */
+
+static void begin_function(QbeGenState* st) {
+    st->fn_body = open_memstream(&st->fn_body_buf, &st->fn_body_len);
+    st->fn_alloc = open_memstream(&st->fn_alloc_buf, &st->fn_alloc_len);
+    st->reg_counter = 0;
+    st->label_counter = 0;
+    st->terminated = 0;
+    st->break_label = 0;
+    st->continue_label = 0;
+    st->scratch_slot = -1;
+    st->var_count = 0;
+}
+
+static void end_function(QbeGenState* st, const char* header) {
+    if (!st->terminated) {
+        if (st->current_ret_type == T_VOID) ins(st, "ret");
+        else ins(st, "ret %s", qcls(st->current_ret_type) == 'd' ? "d_0" : qcls(st->current_ret_type) == 's' ? "s_0" : "0");
+    }
+    fclose(st->fn_body);
+    fclose(st->fn_alloc);
+    fprintf(st->output, "%s {\n@start\n", header);
+    fwrite(st->fn_alloc_buf, 1, st->fn_alloc_len, st->output);
+    fwrite(st->fn_body_buf, 1, st->fn_body_len, st->output);
+    fputs("}\n\n", st->output);
+    free(st->fn_body_buf);
+    free(st->fn_alloc_buf);
+    st->fn_body_buf = st->fn_alloc_buf = NULL;
+}
+
+// 函数体最后一条是表达式时当作返回值 (lambda 的 { x * 2 })
+static ASTNode* tail_expression(ASTNode* body) {
+    if (!body || body->type != AST_PROGRAM || body->data.program.statement_count == 0) return NULL;
+    ASTNode* last = body->data.program.statements[body->data.program.statement_count - 1];
+    switch (last->type) {
+        case AST_BINOP:
+        case AST_UNARYOP:
+        case AST_IDENTIFIER:
+        case AST_NUM_INT:
+        case AST_NUM_FLOAT:
+        case AST_STRING:
+        case AST_CHAR:
+        case AST_INDEX:
+        case AST_MEMBER_ACCESS:
+        case AST_CALL:
+            return last;
+        default:
+            return NULL;
+    }
+}
+
+static void gen_function(QbeGenState* st, int fi, int has_top) {
+    ASTNode* fn = st->func_nodes[fi];
+    const char* rt = func_ret_type(st, fi);
+    st->type_bindings = st->func_bindings[fi];
+    st->type_binding_count = st->func_binding_counts[fi];
+    int is_main = strcmp(st->func_symbols[fi], "main") == 0;
+    if (is_main) rt = T_I32;
+    st->current_ret_type = (char*)rt;
+    st->in_top = 0;
+    begin_function(st);
+
+    size_t hlen = 0, hcap = 256;
+    char* header = malloc(hcap);
+    hlen = snprintf(header, hcap, "%sfunction ", is_main ? "export " : "");
+    if (rt != T_VOID) hlen += snprintf(header + hlen, hcap - hlen, "%c ", qcls(rt));
+    hlen += snprintf(header + hlen, hcap - hlen, "$%s(", st->func_symbols[fi]);
+    int np = param_count(fn);
+    for (int i = 0; i < np; i++) {
+        ASTNode* p = param_at(fn, i);
+        const char* pname = param_name(p);
+        const char* pt = qbe_type_name(st, param_type_node(p));
+        if (is_main && i == 1 && pt == T_PTR) pt = ptr_to(T_STR);//main 的 argv 是 char**
+        char anon[32];
+        if (!pname) {
+            snprintf(anon, sizeof(anon), "__arg%d", i);
+            pname = anon;
+        }
+        if (hlen + 64 > hcap) {
+            hcap *= 2;
+            header = realloc(header, hcap);
+        }
+        hlen += snprintf(header + hlen, hcap - hlen, "%s%c %%p%d", i ? ", " : "", qcls(pt), i);
+        int vi = declare_local(st, ast_intern(pname), pt);
+        QVal pv, slot;
+        snprintf(pv.v, sizeof(pv.v), "%%p%d", i);
+        pv.t = pt;
+        snprintf(slot.v, sizeof(slot.v), "%%v%d", st->var_regs[vi]);
+        slot.t = T_PTR;
+        store_to(st, slot, pv, pt);
+        if (pt == T_STR) slen_slot(st, ast_intern(pname), 1);
+    }
+    snprintf(header + hlen, hcap - hlen, ")");
+    if (is_main && has_top) ins(st, "call $__vix_top()");
+
+    ASTNode* body = fn->data.function.body;
+    ASTNode* tail = rt != T_VOID && !is_main ? tail_expression(body) : NULL;
+    if (tail) {
+        for (int i = 0; i < body->data.program.statement_count - 1; i++) {
+            gen_stmt(st, body->data.program.statements[i]);
+        }
+        QVal v = gen_expr(st, tail);
+        if (v.t != T_VOID && !st->terminated) {
+            v = conv(st, v, rt);
+            ins(st, "ret %s", v.v);
+            st->terminated = 1;
+        }
+    } else {
+        gen_stmt(st, body);
+    }
+    end_function(st, header);
+    free(header);
+    st->type_bindings = NULL;
+    st->type_binding_count = 0;
+}
+
+// 顶层语句：没有用户 main 时直接是 main，否则是 main 开头调用的 __vix_top
+static void gen_top(QbeGenState* st, ASTNode* root, int has_main) {
+    st->current_ret_type = (char*)(has_main ? T_VOID : T_I32);
+    st->in_top = 1;
+    begin_function(st);
+    gen_stmt(st, root);
+    end_function(st, has_main ? "function $__vix_top()" : "export function w $main()");
+    st->in_top = 0;
+}
+
+static void collect_decls(QbeGenState* st, ASTNode* node) {
+    if (!node) return;
+    if (node->type == AST_PROGRAM) {
+        for (int i = 0; i < node->data.program.statement_count; i++) {
+            collect_decls(st, node->data.program.statements[i]);
+        }
+    } else if (node->type == AST_FUNCTION && node->data.function.name) {
+        const char* name = ast_intern(node->data.function.name);
+        int i = find_func(st, name);
+        if (i < 0) {
+            add_func(st, name, node, name, NULL, 0);
+        } else if (st->func_nodes[i]->data.function.is_extern && !node->data.function.is_extern) {
+            st->func_nodes[i] = node;//先看到 extern 声明，后面才是定义
+        }
+    } else if (node->type == AST_STRUCT_DEF) {
+        qbe_emit_struct_def(st, node);
+    }
+}
+
+/* ==================== 运行时 ==================== */
+
+static const char* rt_concat =
+    "function l $__vix_qbe_concat(l %a0, l %b0) {\n"
+    "@start\n"
+    "\t%a =l copy %a0\n"
+    "\t%b =l copy %b0\n"
+    "\t%az =w ceql %a, 0\n"
+    "\tjnz %az, @anil, @acheck\n"
+    "@anil\n"
+    "\t%a =l copy $__vix_qbe_empty\n"
+    "@acheck\n"
+    "\t%bz =w ceql %b, 0\n"
+    "\tjnz %bz, @bnil, @join\n"
+    "@bnil\n"
+    "\t%b =l copy $__vix_qbe_empty\n"
+    "@join\n"
+    "\t%la =l call $strlen(l %a)\n"
+    "\t%lb =l call $strlen(l %b)\n"
+    "\t%n =l add %la, %lb\n"
+    "\t%n1 =l add %n, 1\n"
+    "\t%p =l call $malloc(l %n1)\n"
+    "\tcall $memcpy(l %p, l %a, l %la)\n"
+    "\t%q =l add %p, %la\n"
+    "\t%lb1 =l add %lb, 1\n"
+    "\tcall $memcpy(l %q, l %b, l %lb1)\n"
+    "\tret %p\n"
+    "}\n\n";
+
+static const char* rt_list =
+    "function l $__vix_qbe_list_new(l %esize, l %n) {\n"
+    "@start\n"
+    "\t%h =l call $malloc(l 24)\n"
+    "\t%cap =l copy %n\n"
+    "\t%small =w csltl %cap, 4\n"
+    "\tjnz %small, @min, @alloc\n"
+    "@min\n"
+    "\t%cap =l copy 4\n"
+    "@alloc\n"
+    "\t%d =l call $calloc(l %cap, l %esize)\n"
+    "\tstorel %d, %h\n"
+    "\t%lp =l add %h, 8\n"
+    "\tstorel %n, %lp\n"
+    "\t%cp =l add %h, 16\n"
+    "\tstorel %cap, %cp\n"
+    "\tret %h\n"
+    "}\n\n"
+    "function l $__vix_qbe_list_push(l %h, l %esize) {\n"
+    "@start\n"
+    "\t%lp =l add %h, 8\n"
+    "\t%len =l loadl %lp\n"
+    "\t%cp =l add %h, 16\n"
+    "\t%cap =l loadl %cp\n"
+    "\t%full =w csgel %len, %cap\n"
+    "\tjnz %full, @grow, @put\n"
+    "@grow\n"
+    "\t%ncap =l mul %cap, 2\n"
+    "\t%small =w csltl %ncap, 4\n"
+    "\tjnz %small, @min, @realloc\n"
+    "@min\n"
+    "\t%ncap =l copy 4\n"
+    "@realloc\n"
+    "\t%old =l loadl %h\n"
+    "\t%bytes =l mul %ncap, %esize\n"
+    "\t%d =l call $realloc(l %old, l %bytes)\n"
+    "\tstorel %d, %h\n"
+    "\tstorel %ncap, %cp\n"
+    "@put\n"
+    "\t%len1 =l add %len, 1\n"
+    "\tstorel %len1, %lp\n"
+    "\t%data =l loadl %h\n"
+    "\t%off =l mul %len, %esize\n"
+    "\t%slot =l add %data, %off\n"
+    "\tret %slot\n"
+    "}\n\n"
+    "function $__vix_qbe_list_reserve(l %h, l %esize, l %n) {\n"
+    "@start\n"
+    "\t%cp =l add %h, 16\n"
+    "\t%cap =l loadl %cp\n"
+    "\t%need =w csgtl %n, %cap\n"
+    "\tjnz %need, @grow, @done\n"
+    "@grow\n"
+    "\t%old =l loadl %h\n"
+    "\t%bytes =l mul %n, %esize\n"
+    "\t%d =l call $realloc(l %old, l %bytes)\n"
+    "\tstorel %d, %h\n"
+    "\tstorel %n, %cp\n"
+    "@done\n"
+    "\tret\n"
+    "}\n\n"
+    "function $__vix_qbe_list_shrink(l %h, l %esize) {\n"
+    "@start\n"
+    "\t%lp =l add %h, 8\n"
+    "\t%n =l loadl %lp\n"
+    "\t%z =w ceql %n, 0\n"
+    "\tjnz %z, @one, @go\n"
+    "@one\n"
+    "\t%n =l copy 1\n"
+    "@go\n"
+    "\t%old =l loadl %h\n"
+    "\t%bytes =l mul %n, %esize\n"
+    "\t%d =l call $realloc(l %old, l %bytes)\n"
+    "\tstorel %d, %h\n"
+    "\t%cp =l add %h, 16\n"
+    "\tstorel %n, %cp\n"
+    "\tret\n"
+    "}\n\n";
+
+static const char* rt_bounds =
+    "function $__vix_qbe_bounds_fail(l %idx, l %len, l %name, w %line, l %file) {\n"
+    "@start\n"
+    "\tcall $fflush(l 0)\n"
+    "\tcall $dprintf(w 2, l $__vix_qbe_fmt_bounds, ..., l %file, w %line, l %idx, l %name, l %len)\n"
+    "\tcall $exit(w 1)\n"
+    "\thlt\n"
+    "}\n\n"
+    "data $__vix_qbe_fmt_bounds = { b \"%s:%d: Error: Array index out of bounds: accessing index %lld in array '%s' of size %lld\\n\", b 0 }\n\n";
+
+static const char* rt_sb =
+    "function l $__vix_qbe_sb_new(l %cap0) {\n"
+    "@start\n"
+    "\t%cap =l copy %cap0\n"
+    "\t%small =w csltl %cap, 16\n"
+    "\tjnz %small, @min, @go\n"
+    "@min\n"
+    "\t%cap =l copy 16\n"
+    "@go\n"
+    "\t%h =l call $malloc(l 24)\n"
+    "\t%d =l call $malloc(l %cap)\n"
+    "\tstoreb 0, %d\n"
+    "\tstorel %d, %h\n"
+    "\t%lp =l add %h, 8\n"
+    "\tstorel 0, %lp\n"
+    "\t%cp =l add %h, 16\n"
+    "\tstorel %cap, %cp\n"
+    "\tret %h\n"
+    "}\n\n"
+    "function $__vix_qbe_sb_reserve(l %h, l %need) {\n"
+    "@start\n"
+    "\t%cp =l add %h, 16\n"
+    "\t%cap =l loadl %cp\n"
+    "\t%need1 =l add %need, 1\n"
+    "\t%ok =w cslel %need1, %cap\n"
+    "\tjnz %ok, @done, @grow\n"
+    "@grow\n"
+    "\t%ncap =l mul %cap, 2\n"
+    "\t%small =w csltl %ncap, %need1\n"
+    "\tjnz %small, @fit, @go\n"
+    "@fit\n"
+    "\t%ncap =l copy %need1\n"
+    "@go\n"
+    "\t%old =l loadl %h\n"
+    "\t%d =l call $realloc(l %old, l %ncap)\n"
+    "\tstorel %d, %h\n"
+    "\tstorel %ncap, %cp\n"
+    "@done\n"
+    "\tret\n"
+    "}\n\n"
+    "function $__vix_qbe_sb_append(l %h, l %s, l %n) {\n"
+    "@start\n"
+    "\t%lp =l add %h, 8\n"
+    "\t%len =l loadl %lp\n"
+    "\t%need =l add %len, %n\n"
+    "\tcall $__vix_qbe_sb_reserve(l %h, l %need)\n"
+    "\t%d =l loadl %h\n"
+    "\t%at =l add %d, %len\n"
+    "\tcall $memcpy(l %at, l %s, l %n)\n"
+    "\tstorel %need, %lp\n"
+    "\t%end =l add %d, %need\n"
+    "\tstoreb 0, %end\n"
+    "\tret\n"
+    "}\n\n"
+    "function $__vix_qbe_sb_append_str(l %h, l %s) {\n"
+    "@start\n"
+    "\t%nil =w ceql %s, 0\n"
+    "\tjnz %nil, @done, @go\n"
+    "@go\n"
+    "\t%n =l call $strlen(l %s)\n"
+    "\tcall $__vix_qbe_sb_append(l %h, l %s, l %n)\n"
+    "@done\n"
+    "\tret\n"
+    "}\n\n"
+    "data $__vix_qbe_fmt_lld = { b \"%lld\", b 0 }\n"
+    "data $__vix_qbe_fmt_f = { b \"%f\", b 0 }\n\n";
+
+#ifdef __APPLE__
+#define QBE_STDIN "$__stdinp"
+#else
+#define QBE_STDIN "$stdin"
+#endif
+
+//读缓冲复用，和 LLVM 后端的 __vix_read_line 一样每次返回的行指向同一块缓冲，EOF 返回 nil
+static const char* rt_read_line =
+    "data $__vix_qbe_in_buf = align 8 { l 0 }\n"
+    "data $__vix_qbe_in_cap = align 8 { l 0 }\n\n"
+    "function l $__vix_qbe_read_line() {\n"
+    "@start\n"
+    "\t%in =l loadl " QBE_STDIN "\n"
+    "\t%n =l call $getline(l $__vix_qbe_in_buf, l $__vix_qbe_in_cap, l %in)\n"
+    "\t%eof =w csltl %n, 0\n"
+    "\tjnz %eof, @none, @got\n"
+    "@none\n"
+    "\tret 0\n"
+    "@got\n"
+    "\t%p =l loadl $__vix_qbe_in_buf\n"
+    "\t%has =w csgtl %n, 0\n"
+    "\tjnz %has, @check, @done\n"
+    "@check\n"
+    "\t%lp =l add %p, %n\n"
+    "\t%last =l sub %lp, 1\n"
+    "\t%c =w loadub %last\n"
+    "\t%nl =w ceqw %c, 10\n"
+    "\tjnz %nl, @strip, @done\n"
+    "@strip\n"
+    "\tstoreb 0, %last\n"
+    "@done\n"
+    "\tret %p\n"
+    "}\n\n";
+
+static const char* rt_input =
+    "function l $__vix_qbe_input(l %prompt) {\n"
+    "@start\n"
+    "\t%has =w cnel %prompt, 0\n"
+    "\tjnz %has, @show, @read\n"
+    "@show\n"
+    "\tcall $printf(l $__vix_qbe_fmt_s, ..., l %prompt)\n"
+    "@read\n"
+    "\tcall $fflush(l 0)\n"
+    "\t%line =l call $__vix_qbe_read_line()\n"
+    "\t%eof =w ceql %line, 0\n"
+    "\tjnz %eof, @none, @copy\n"
+    "@none\n"
+    "\tret $__vix_qbe_empty\n"
+    "@copy\n"
+    "\t%s =l call $strdup(l %line)\n"
+    "\tret %s\n"
+    "}\n\n";
+
+static const char* rt_read_all =
+    "function l $__vix_qbe_read_all() {\n"
+    "@start\n"
+    "\t%cap =l copy 4096\n"
+    "\t%len =l copy 0\n"
+    "\t%buf =l call $malloc(l %cap)\n"
+    "@loop\n"
+    "\t%room =l sub %cap, %len\n"
+    "\t%room =l sub %room, 1\n"
+    "\t%at =l add %buf, %len\n"
+    "\t%in =l loadl " QBE_STDIN "\n"
+    "\t%n =l call $fread(l %at, l 1, l %room, l %in)\n"
+    "\t%len =l add %len, %n\n"
+    "\t%full =w ceql %n, %room\n"
+    "\tjnz %full, @grow, @done\n"
+    "@grow\n"
+    "\t%cap =l mul %cap, 2\n"
+    "\t%buf =l call $realloc(l %buf, l %cap)\n"
+    "\tjmp @loop\n"
+    "@done\n"
+    "\t%end =l add %buf, %len\n"
+    "\tstoreb 0, %end\n"
+    "\tret %buf\n"
+    "}\n\n";
+
+static void emit_runtime(QbeGenState* st) {
+    unsigned int h = st->used_helpers;
+    if (h & H_CONCAT) fputs(rt_concat, st->output);
+    if (h & H_LIST) fputs(rt_list, st->output);
+    if (h & H_BOUNDS) fputs(rt_bounds, st->output);
+    if (h & H_SB) fputs(rt_sb, st->output);
+    if (h & H_READ_LINE) fputs(rt_read_line, st->output);
+    if (h & H_INPUT) fputs(rt_input, st->output);
+    if (h & H_READ_ALL) fputs(rt_read_all, st->output);
+    if (h & H_EMPTY) fputs("data $__vix_qbe_empty = { b 0 }\n", st->output);
+    if (h & H_FMT_S) fputs("data $__vix_qbe_fmt_s = { b \"%s\", b 0 }\n", st->output);
+}
+
+static int program_has_top_code(ASTNode* node) {
+    if (!node) return 0;
+    if (node->type != AST_PROGRAM) {
+        return node->type != AST_FUNCTION && node->type != AST_STRUCT_DEF && node->type != AST_IMPORT;
+    }
+    for (int i = 0; i < node->data.program.statement_count; i++) {
+        if (program_has_top_code(node->data.program.statements[i])) return 1;
+    }
+    return 0;
+}
+
+static void free_state(QbeGenState* st) {
+    free(st->var_names);
+    free(st->var_regs);
+    free(st->var_types);
+    free(st->global_vars);
+    free(st->global_var_types);
+    free(st->global_index);
+    free(st->func_names);
+    free(st->func_ret_types);
+    free(st->func_nodes);
+    for (int i = 0; i < st->func_count; i++) free(st->func_bindings[i]);
+    free(st->func_bindings);
+    free(st->func_binding_counts);
+    free(st->func_symbols);
+    free(st->func_emitted);
+    free(st->func_index);
+    for (int i = 0; i < st->struct_count; i++) {
+        free(st->struct_field_names[i]);
+        free(st->struct_field_types[i]);
+    }
+    free(st->append_nodes);
+    free(st->append_slots);
+    free(st->struct_names);
+    free(st->struct_field_names);
+    free(st->struct_field_types);
+    free(st->struct_field_counts);
+    for (int i = 0; i < st->pending_struct_defs_count; i++) free(st->pending_struct_defs[i]);
+    free(st->pending_struct_defs);
+}
+
+void ir_gen(ASTNode* ast, FILE* fp) {
+    if (!ast || !fp) return;
+    T_BOOL = ast_intern("bool");
+    T_I8 = ast_intern("i8");
+    T_I32 = ast_intern("i32");
+    T_I64 = ast_intern("i64");
+    T_F32 = ast_intern("f32");
+    T_F64 = ast_intern("f64");
+    T_STR = ast_intern("string");
+    T_PTR = ast_intern("ptr");
+    T_VOID = ast_intern("void");
+    T_SB = ast_intern("StringBuilder");
+    T_FN = ast_intern("fn");
+    T_LIST_ANY = ast_intern("[]");
+
+    QbeGenState state;
+    memset(&state, 0, sizeof(state));
+    QbeGenState* st = &state;
+    char* funcs_buf = NULL;
+    size_t funcs_len = 0;
+    st->output = open_memstream(&funcs_buf, &funcs_len);
+    st->data_out = open_memstream(&st->data_buf, &st->data_len);
+
+    collect_decls(st, ast);
+    int main_i = find_func(st, ast_intern("main"));
+    int has_main = main_i >= 0 && !st->func_nodes[main_i]->data.function.is_extern;
+    int has_top = program_has_top_code(ast);
+    if (!has_main || has_top) gen_top(st, ast, has_main);
+    for (int i = 0; i < st->func_count; i++) {//lambda 和泛型实例在生成过程中追加，循环会接着处理
+        ASTNode* fn = st->func_nodes[i];
+        if (st->func_emitted[i] || fn->data.function.is_extern || !fn->data.function.body) continue;
+        if (is_generic(fn) && !st->func_bindings[i]) continue;
+        st->func_emitted[i] = 1;
+        gen_function(st, i, has_top && i == main_i);
+    }
+    emit_runtime(st);
+    fclose(st->output);
+    fclose(st->data_out);
+
+    fprintf(fp, "# vixc --backend=qbe\n");
+    for (int i = 0; i < st->pending_struct_defs_count; i++) {
+        fputs(st->pending_struct_defs[i], fp);
+    }
+    if (st->pending_struct_defs_count > 0) fputc('\n', fp);
+    fwrite(funcs_buf, 1, funcs_len, fp);
+    fwrite(st->data_buf, 1, st->data_len, fp);
+    free(funcs_buf);
+    free(st->data_buf);
+    free_state(st);
+}
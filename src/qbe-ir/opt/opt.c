@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../../include/qbe-ir/opt.h"
+
+/*
+ir_gen 输出的 QBE IL 上的窥孔清理，按函数做，直到没有变化：
+- jmp @X 紧跟着 @X：删掉 jmp
+- jnz c, @a, @a：改成 jmp @a
+- 没有跳转引用、从上一块直接落下来的标签：删掉，两块合并
+- 没有引用、跟在 ret/jmp/jnz/hlt 后面的块：不可达，整块删掉
+qbe 自己也会做这些，这里先删掉是为了让交给 qbe 的文本更小 (每个 if/循环都会留下一两个空块)。
+*/
+
+typedef struct {
+    char** lines;
+    int count;
+    int capacity;
+} LineBuf;
+
+static void push_line(LineBuf* b, char* line) {
+    if (b->count >= b->capacity) {
+        b->capacity = b->capacity ? b->capacity * 2 : 1024;
+        b->lines = realloc(b->lines, sizeof(char*) * b->capacity);
+    }
+    b->lines[b->count++] = line;
+}
+
+static int is_label(const char* l) {
+    return l[0] == '@';
+}
+
+static int is_terminator(const char* l) {
+    return strncmp(l, "\tjmp ", 5) == 0 || strncmp(l, "\tjnz ", 5) == 0 || strncmp(l, "\tret", 4) == 0 ||
+           strncmp(l, "\thlt", 4) == 0;
+}
+
+// 标签名长度 (@L12 -> 4)，到空白、逗号或行尾为止
+static size_t label_len(const char* p) {
+    size_t n = 1;
+    while (p[n] && p[n] != ',' && p[n] != ' ' && p[n] != '\n' && p[n] != '\t') n++;
+    return n;
+}
+
+static int same_label(const char* a, const char* b) {
+    size_t n = label_len(a);
+    return n == label_len(b) && strncmp(a, b, n) == 0;
+}
+
+// lines[from, to) 里跳转指令引用 label 的次数
+static int label_refs(char** lines, int from, int to, const char* label) {
+    int refs = 0;
+    for (int i = from; i < to; i++) {
+        const char* l = lines[i];
+        if (!l || (strncmp(l, "\tjmp ", 5) != 0 && strncmp(l, "\tjnz ", 5) != 0)) continue;
+        for (const char* p = strchr(l, '@'); p; p = strchr(p + 1, '@')) {
+            if (same_label(p, label)) refs++;
+        }
+    }
+    return refs;
+}
+
+// 一个函数体 lines[from, to) (不含 function 行和 })，删掉的行置 NULL
+static int opt_function(char** lines, int from, int to) {
+    int changed = 0;
+    int prev = -1;//上一条没删的行
+    for (int i = from; i < to; i++) {
+        char* l = lines[i];
+        if (!l) continue;
+        if (strncmp(l, "\tjnz ", 5) == 0) {
+            char* a = strchr(l, '@');
+            char* b = a ? strchr(a + 1, '@') : NULL;
+            if (a && b && same_label(a, b)) {
+                size_t n = label_len(b);
+                char* j = malloc(n + 8);
+                snprintf(j, n + 8, "\tjmp %.*s\n", (int)n, b);
+                free(l);
+                lines[i] = l = j;
+                changed = 1;
+            }
+        }
+        if (is_label(l) && prev >= 0) {
+            char* pl = lines[prev];
+            if (strncmp(pl, "\tjmp ", 5) == 0 && same_label(pl + 5, l)) {
+                free(pl);
+                lines[prev] = NULL;
+                changed = 1;
+                pl = NULL;
+                for (prev = i - 1; prev >= from && !lines[prev]; prev--) {}
+                if (prev < from) prev = -1;
+                else pl = lines[prev];
+            }
+            if (pl && label_refs(lines, from, to, l) == 0) {
+                if (!is_terminator(pl)) {//落下来的：并进上一块
+                    free(l);
+                    lines[i] = NULL;
+                    changed = 1;
+                    continue;
+                }
+                //不可达：删到下一个标签为止
+                free(l);
+                lines[i] = NULL;
+                for (i = i + 1; i < to && !(lines[i] && is_label(lines[i])); i++) {
+                    free(lines[i]);
+                    lines[i] = NULL;
+                }
+                i--;
+                changed = 1;
+                continue;
+            }
+        }
+        prev = i;
+    }
+    return changed;
+}
+
+void qbe_opt_file(const char *filename) {
+    FILE* fp = fopen(filename, "r");
+    if (!fp) {
+        fprintf(stderr, "Er: cannot open %s for optimization\n", filename);
+        return;
+    }
+    LineBuf b = {0};
+    char* line = NULL;
+    size_t cap = 0;
+    while (getline(&line, &cap, fp) >= 0) {
+        push_line(&b, strdup(line));
+    }
+    free(line);
+    fclose(fp);
+
+    for (int i = 0; i < b.count; i++) {
+        if (strncmp(b.lines[i], "function ", 9) != 0 && strncmp(b.lines[i], "export function ", 16) != 0) continue;
+        int start = i + 1;
+        int end = start;
+        while (end < b.count && strcmp(b.lines[end], "}\n") != 0) end++;
+        //第一个标签是入口，不参与合并
+        while (opt_function(b.lines, start + 1, end)) {}
+        i = end;
+    }
+
+    fp = fopen(filename, "w");
+    if (!fp) {
+        fprintf(stderr, "Er: cannot write %s\n", filename);
+    }
+    for (int i = 0; i < b.count; i++) {
+        if (!b.lines[i]) continue;
+        if (fp) fputs(b.lines[i], fp);
+        free(b.lines[i]);
+    }
+    free(b.lines);
+    if (fp) fclose(fp);
+}
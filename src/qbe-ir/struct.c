@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/ast.h"
+#include "../../include/struct.h"
+
+/*
+QBE 后端的结构体表：字段名和字段类型 (qbe_type_name 的类型名)。
+结构体对象在堆上，每个字段占 8 字节，按声明顺序排列，所以 QBE 里的聚合类型只需要 l * 字段数。
+*/
+
+void qbe_register_struct_def(QbeGenState* state, const char* name, char** field_names, char** field_types, int field_count) {
+    for (int i = 0; i < state->struct_count; i++) {
+        if (strcmp(state->struct_names[i], name) == 0) {//同名结构体重新定义：以后面的为准
+            free(state->struct_field_names[i]);
+            free(state->struct_field_types[i]);
+            state->struct_field_names[i] = field_names;
+            state->struct_field_types[i] = field_types;
+            state->struct_field_counts[i] = field_count;
+            return;
+        }
+    }
+    if (state->struct_count >= state->struct_capacity) {
+        state->struct_capacity = state->struct_capacity ? state->struct_capacity * 2 : 8;
+        state->struct_names = realloc(state->struct_names, sizeof(char*) * state->struct_capacity);
+        state->struct_field_names = realloc(state->struct_field_names, sizeof(char**) * state->struct_capacity);
+        state->struct_field_types = realloc(state->struct_field_types, sizeof(char**) * state->struct_capacity);
+        state->struct_field_counts = realloc(state->struct_field_counts, sizeof(int) * state->struct_capacity);
+    }
+    int i = state->struct_count++;
+    state->struct_names[i] = (char*)ast_intern(name);
+    state->struct_field_names[i] = field_names;
+    state->struct_field_types[i] = field_types;
+    state->struct_field_counts[i] = field_count;
+}
+
+void qbe_emit_struct_def(QbeGenState* state, struct ASTNode* node) {
+    if (!node || node->type != AST_STRUCT_DEF || !node->data.struct_def.name) return;
+    const char* name = node->data.struct_def.name;
+    ASTNode* fields = node->data.struct_def.fields;
+    int n = (fields && fields->type == AST_EXPRESSION_LIST) ? fields->data.expression_list.expression_count : 0;
+    char** names = malloc(sizeof(char*) * (n > 0 ? n : 1));
+    char** types = malloc(sizeof(char*) * (n > 0 ? n : 1));
+    //先登记字段名，字段类型里引用自己 (链表结点) 时能认出结构体名
+    qbe_register_struct_def(state, name, names, types, 0);
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        ASTNode* f = fields->data.expression_list.expressions[i];
+        if (!f || f->type != AST_ASSIGN || !f->data.assign.left || f->data.assign.left->type != AST_IDENTIFIER) continue;
+        names[count] = (char*)ast_intern(f->data.assign.left->data.identifier.name);
+        types[count] = (char*)qbe_type_name(state, f->data.assign.right);
+        count++;
+    }
+    for (int i = 0; i < state->struct_count; i++) {
+        if (strcmp(state->struct_names[i], name) == 0) state->struct_field_counts[i] = count;
+    }
+
+    char def[64 + 256];
+    snprintf(def, sizeof(def), "type :%s = { l %d }\n", name, count > 0 ? count : 1);
+    if (state->pending_struct_defs_count >= state->pending_struct_defs_capacity) {
+        state->pending_struct_defs_capacity = state->pending_struct_defs_capacity ? state->pending_struct_defs_capacity * 2 : 8;
+        state->pending_struct_defs = realloc(state->pending_struct_defs, sizeof(char*) * state->pending_struct_defs_capacity);
+    }
+    state->pending_struct_defs[state->pending_struct_defs_count++] = strdup(def);
+}
+
+int qbe_get_struct_info(QbeGenState* state, const char* name, char*** out_field_names, char*** out_field_types, int* out_count) {
+    if (!name) return 0;
+    for (int i = 0; i < state->struct_count; i++) {
+        if (strcmp(state->struct_names[i], name) == 0) {
+            if (out_field_names) *out_field_names = state->struct_field_names[i];
+            if (out_field_types) *out_field_types = state->struct_field_types[i];
+            if (out_count) *out_count = state->struct_field_counts[i];
+            return 1;
+        }
+    }
+    return 0;
+}
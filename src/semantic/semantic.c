@@ -2,6 +2,7 @@
 #include "../include/compiler.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <unistd.h>
 #include <ctype.h>
@@ -14,6 +15,11 @@ static int is_builtin_union_ctor_name(const char* name) {
            strcmp(name, "Ok") == 0 || strcmp(name, "Err") == 0;
 }
 
+static int is_builtin_input_name(const char* name) {
+    if (!name) return 0;
+    return strcmp(name, "read_line") == 0 || strcmp(name, "read_all") == 0 || strcmp(name, "lines") == 0;
+}
+
 static const char* node_source_filename(const ASTNode* node) {
     if (node && node->source_file) {
         return node->source_file;
@@ -21,10 +27,22 @@ static const char* node_source_filename(const ASTNode* node) {
     return current_input_filename ? current_input_filename : "unknown";
 }
 
-typedef struct VisitedNode {
-    ASTNode* node;
-    struct VisitedNode* next;
-} VisitedNode;
+/*
+遍历上下文：当前路径上的节点打上 epoch 戳(O(1) 判环)，
+并记录路径上 STRUCT_DEF / STRUCT_LITERAL 的层数，替代原先逐层扫描的链表
+*/
+typedef struct SemanticWalk {
+    unsigned int epoch;
+    int struct_def_depth;
+    int struct_literal_depth;
+} SemanticWalk;
+static unsigned int g_walk_epoch = 0;
+static void begin_semantic_walk(SemanticWalk* walk) {
+    if (++g_walk_epoch == 0) g_walk_epoch = 1; // 0 表示未访问
+    walk->epoch = g_walk_epoch;
+    walk->struct_def_depth = 0;
+    walk->struct_literal_depth = 0;
+}
 static void clear_var_init_map(void);
 static void add_var_init_mapping(const char* var_name, ASTNode* init_value);
 static ASTNode* find_var_init_mapping(const char* var_name);
@@ -69,32 +87,14 @@ static ASTNode* find_var_init_mapping(const char* var_name) {
     return NULL;
 }
 
-static int is_node_struct_field_assignment(ASTNode* node, VisitedNode* visited_list);
-static int is_node_struct_field_assignment(ASTNode* node, VisitedNode* visited_list) {
+static int is_node_struct_field_assignment(ASTNode* node, const SemanticWalk* walk) {
     (void)node;
-    
-    VisitedNode* current = visited_list;
-    while (current) {
-        if (current->node && current->node->type == AST_STRUCT_DEF) {
-            return 1;
-        }
-        current = current->next;
-    }
-    return 0;
+    return walk->struct_def_depth > 0;
 }
 
-static int is_node_inside_struct_literal(ASTNode* node, VisitedNode* visited_list);
-static int is_node_inside_struct_literal(ASTNode* node, VisitedNode* visited_list) {
+static int is_node_inside_struct_literal(ASTNode* node, const SemanticWalk* walk) {
     (void)node;
-
-    VisitedNode* current = visited_list;
-    while (current) {
-        if (current->node && current->node->type == AST_STRUCT_LITERAL) {
-            return 1;
-        }
-        current = current->next;
-    }
-    return 0;
+    return walk->struct_literal_depth > 0;
 }
 
 typedef struct StructDef {
@@ -243,30 +243,45 @@ static int add_struct_definition(const char* name, ASTNode* fields) {
 SymbolTable* create_symbol_table(SymbolTable* parent) {
     SymbolTable* table = malloc(sizeof(SymbolTable));
     if (!table) return NULL;
-    table->head = NULL;
+    table->slots = NULL;
+    table->capacity = 0;
+    table->count = 0;
     table->parent = parent;
     return table;
 }
 
-static Symbol* create_symbol(const char* name, SymbolType type, InferredType inferred_type) {
-    if (!name) return NULL;
-    Symbol* sym = malloc(sizeof(Symbol));
-    if (!sym) return NULL;
-    
-    size_t name_len = strlen(name);
-    sym->name = malloc(name_len + 1);
-    if (!sym->name) {
-        free(sym);
-        return NULL;
+static unsigned int symbol_slot_hash(const char* name) {
+    uintptr_t p = (uintptr_t)name;
+    p ^= p >> 17;
+    p *= (uintptr_t)0x9E3779B97F4A7C15ull;
+    return (unsigned int)(p >> 16);
+}
+
+/* 名字都是 intern 过的指针，所以槽位里只比较指针 */
+static Symbol** find_symbol_slot(SymbolTable* table, const char* name) {
+    int mask = table->capacity - 1;
+    int i = (int)(symbol_slot_hash(name) & (unsigned int)mask);
+    while (table->slots[i] && table->slots[i]->name != name) {
+        i = (i + 1) & mask;
     }
-    strcpy(sym->name, name);
-    
-    sym->type = type;
-    sym->inferred_type = inferred_type;
-    sym->is_mutable_pointer = 0;
-    sym->next = NULL;
-    
-    return sym;
+    return &table->slots[i];
+}
+
+static int grow_symbol_table(SymbolTable* table) {
+    int old_capacity = table->capacity;
+    Symbol** old_slots = table->slots;
+    int capacity = old_capacity ? old_capacity * 2 : 8;
+    Symbol** slots = calloc(capacity, sizeof(Symbol*));
+    if (!slots) return 0;
+    table->slots = slots;
+    table->capacity = capacity;
+    for (int i = 0; i < old_capacity; i++) {
+        if (old_slots[i]) {
+            *find_symbol_slot(table, old_slots[i]->name) = old_slots[i];
+        }
+    }
+    free(old_slots);
+    return 1;
 }
 
 int add_symbol(SymbolTable* table, const char* name, SymbolType type, InferredType inferred_type) {
@@ -275,78 +290,53 @@ int add_symbol(SymbolTable* table, const char* name, SymbolType type, InferredTy
 
 int add_symbol_with_mutability(SymbolTable* table, const char* name, SymbolType type, InferredType inferred_type, int is_mutable_pointer) {
     if (!table || !name) return 0;
-    
-    Symbol* sym = create_symbol(name, type, inferred_type);
-    if (!sym) return 0;
-    
+    if ((table->count + 1) * 4 > table->capacity * 3 && !grow_symbol_table(table)) {
+        return 0;
+    }
+
+    char* key = ast_intern(name);
+    Symbol** slot = find_symbol_slot(table, key);
+    Symbol* sym = *slot;
+    if (!sym) {
+        sym = malloc(sizeof(Symbol));
+        if (!sym) return 0;
+        sym->name = key;
+        *slot = sym;
+        table->count++;
+    }
+    //同一作用域重复声明时以最后一次为准
+    sym->type = type;
+    sym->inferred_type = inferred_type;
     sym->is_mutable_pointer = is_mutable_pointer;
-    sym->next = table->head;
-    table->head = sym;
-    
+
     return 1;
 }
 
 Symbol* lookup_symbol(SymbolTable* table, const char* name) {
     if (!table || !name) return NULL;
-    
-    Symbol* current = table->head;
-    while (current) {
-        if (strcmp(current->name, name) == 0) {
-            return current;
-        }
-        current = current->next;
-    }
-    if (table->parent) {
-        return lookup_symbol(table->parent, name);
+
+    //符号名都驻留过，查不到驻留就一定不在表里
+    const char* key = ast_intern_find(name);
+    if (!key) return NULL;
+    for (; table; table = table->parent) {
+        if (table->count == 0) continue;
+        Symbol* sym = *find_symbol_slot(table, key);
+        if (sym) return sym;
     }
-    
+
     return NULL;
 }
 
 void destroy_symbol_table(SymbolTable* symbol_table) {
     if (!symbol_table) return;
-    
-    Symbol* current = symbol_table->head;
-    while (current) {
-        Symbol* next = current->next;
-        free(current->name);
-        free(current);
-        current = next;
-    }
-    
-    free(symbol_table);
-}
 
-static int is_node_visited(ASTNode* node, VisitedNode* visited_list) {
-    VisitedNode* current = visited_list;
-    while (current) {
-        if (current->node == node) {
-            return 1; 
-        }
-        current = current->next;
+    for (int i = 0; i < symbol_table->capacity; i++) {
+        free(symbol_table->slots[i]);
     }
-    return 0;
-}
-
-static VisitedNode* add_visited_node(ASTNode* node, VisitedNode* visited_list) {
-    VisitedNode* new_visited = malloc(sizeof(VisitedNode));
-    if (!new_visited) return visited_list;
-    new_visited->node = node;
-    new_visited->next = visited_list;
-    return new_visited;
+    free(symbol_table->slots);
+    free(symbol_table);
 }
 
-/* static VisitedNode* remove_visited_node(ASTNode* node, VisitedNode* visited_list) {
-    if (!visited_list) return NULL;
-    
-    if (visited_list->node == node) {
-        VisitedNode* next = visited_list->next;
-        free(visited_list);
-        return next;
-    }
-    return visited_list;
-} */
-
 static int is_lvalue_mutable(ASTNode* node, SymbolTable* table) {
     if (!node) return 0;
     
@@ -364,20 +354,14 @@ static int is_lvalue_mutable(ASTNode* node, SymbolTable* table) {
     return 0;
 }
 
-static int check_undefined_symbols_in_node_with_visited(ASTNode* node, SymbolTable* table, VisitedNode* visited_list) {
+static int check_undefined_symbols_in_node_with_visited(ASTNode* node, SymbolTable* table, SemanticWalk* walk) {
     if (!node) return 0;
-    if (is_node_visited(node, visited_list)) {
-        return 0;
-    }
-    VisitedNode* new_visited_list = add_visited_node(node, visited_list);
-    if (!new_visited_list) {
-        /*
-        如果无法添加到访问列表，可能是因为内存分配失败
-        在这种情况下，我们仍然可以继续处理，但不进行递归保护
-        但为了安全，我们返回0避免进一步处理
-        */
+    if (node->visit_epoch == walk->epoch) {
         return 0;
     }
+    node->visit_epoch = walk->epoch;
+    if (node->type == AST_STRUCT_DEF) walk->struct_def_depth++;
+    else if (node->type == AST_STRUCT_LITERAL) walk->struct_literal_depth++;
     
     int errors_found = 0;
     
@@ -414,14 +398,14 @@ static int check_undefined_symbols_in_node_with_visited(ASTNode* node, SymbolTab
             }
             destroy_symbol_table(func_table);
             for (int i = 0; i < node->data.program.statement_count; i++) {
-                errors_found += check_undefined_symbols_in_node_with_visited(node->data.program.statements[i], table, new_visited_list);
+                errors_found += check_undefined_symbols_in_node_with_visited(node->data.program.statements[i], table, walk);
             }
             break;
         }
         
         case AST_ASSIGN: {
-            int in_struct_def_field = is_node_struct_field_assignment(node, new_visited_list);
-            int in_struct_literal_field = is_node_inside_struct_literal(node, new_visited_list);
+            int in_struct_def_field = is_node_struct_field_assignment(node, walk);
+            int in_struct_literal_field = is_node_inside_struct_literal(node, walk);
             int is_type_annotation = (node->data.assign.is_declaration == 2);
 
             if (node->data.assign.left && 
@@ -496,14 +480,14 @@ static int check_undefined_symbols_in_node_with_visited(ASTNode* node, SymbolTab
                     这里不按“变量/函数标识符必须已定义”规则检查，避免误报。
                     */
                 } else {
-                    errors_found += check_undefined_symbols_in_node_with_visited(node->data.assign.right, table, new_visited_list);
+                    errors_found += check_undefined_symbols_in_node_with_visited(node->data.assign.right, table, walk);
                 }
             }
             break;
         }
 
         case AST_CONST: {
-            errors_found += check_undefined_symbols_in_node_with_visited(node->data.assign.right, table, new_visited_list);
+            errors_found += check_undefined_symbols_in_node_with_visited(node->data.assign.right, table, walk);
             if (node->data.assign.left && node->data.assign.left->type == AST_IDENTIFIER) {
                 Symbol* existing = lookup_symbol(table, node->data.assign.left->data.identifier.name);
                 if (existing) {
@@ -525,7 +509,8 @@ static int check_undefined_symbols_in_node_with_visited(ASTNode* node, SymbolTab
         }
         
         case AST_IDENTIFIER: {
-            if (is_builtin_union_ctor_name(node->data.identifier.name)) {
+            if (is_builtin_union_ctor_name(node->data.identifier.name) ||
+                vector_type_info(node->data.identifier.name, NULL, NULL)) {//v4f32.load(a, i) 里的类型名
                 break;
             }
             Symbol* sym = lookup_symbol(table, node->data.identifier.name);
@@ -560,7 +545,7 @@ static int check_undefined_symbols_in_node_with_visited(ASTNode* node, SymbolTab
                 }
             }
             if (node->data.function.body) {
-                errors_found += check_undefined_symbols_in_node_with_visited(node->data.function.body, func_scope, new_visited_list);
+                errors_found += check_undefined_symbols_in_node_with_visited(node->data.function.body, func_scope, walk);
             }
             destroy_symbol_table(func_scope);
             break;
@@ -570,12 +555,14 @@ static int check_undefined_symbols_in_node_with_visited(ASTNode* node, SymbolTab
             if (node->data.call.func && node->data.call.func->type == AST_IDENTIFIER) {
                 if (is_builtin_union_ctor_name(node->data.call.func->data.identifier.name)) {
                     if (node->data.call.args) {
-                        errors_found += check_undefined_symbols_in_node_with_visited(node->data.call.args, table, new_visited_list);
+                        errors_found += check_undefined_symbols_in_node_with_visited(node->data.call.args, table, walk);
                     }
                     break;
                 }
                 Symbol* sym = lookup_symbol(table, node->data.call.func->data.identifier.name);
-                if (!sym) {
+                if (!sym && !is_builtin_input_name(node->data.call.func->data.identifier.name) &&
+                    !vector_type_info(node->data.call.func->data.identifier.name, NULL, NULL) &&//v4f32(...) 构造向量
+                    strcmp(node->data.call.func->data.identifier.name, "StringBuilder") != 0) {
                     const char* filename = node_source_filename(node->data.call.func);
                     int line = (node->data.call.func->location.first_line > 0) ? node->data.call.func->location.first_line : 1;
                     int column = (node->data.call.func->location.first_column > 0) ? node->data.call.func->location.first_column : 1;
@@ -588,14 +575,14 @@ static int check_undefined_symbols_in_node_with_visited(ASTNode* node, SymbolTab
                 }
             }
             if (node->data.call.args) {
-                errors_found += check_undefined_symbols_in_node_with_visited(node->data.call.args, table, new_visited_list);
+                errors_found += check_undefined_symbols_in_node_with_visited(node->data.call.args, table, walk);
             }
             break;
         }
         case AST_STRUCT_DEF: {
             add_struct_definition(node->data.struct_def.name, node->data.struct_def.fields);
             if (node->data.struct_def.fields) {
-                errors_found += check_undefined_symbols_in_node_with_visited(node->data.struct_def.fields, table, new_visited_list);
+                errors_found += check_undefined_symbols_in_node_with_visited(node->data.struct_def.fields, table, walk);
             }
             break;
         }
@@ -611,12 +598,12 @@ static int check_undefined_symbols_in_node_with_visited(ASTNode* node, SymbolTab
                 }
             }
             if (node->data.struct_literal.fields) {
-                errors_found += check_undefined_symbols_in_node_with_visited(node->data.struct_literal.fields, table, new_visited_list);
+                errors_found += check_undefined_symbols_in_node_with_visited(node->data.struct_literal.fields, table, walk);
             }
             break;
         }
         case AST_INDEX: {
-            errors_found += check_undefined_symbols_in_node_with_visited(node->data.index.target, table, new_visited_list);
+            errors_found += check_undefined_symbols_in_node_with_visited(node->data.index.target, table, walk);
             /*如果是结构体字段访问，我们不应该检查字段名是否为标识符
             而是应该检查字段名是否是结构体的有效字段*/
             if (node->data.index.index && node->data.index.index->type == AST_IDENTIFIER) {
@@ -688,13 +675,13 @@ static int check_undefined_symbols_in_node_with_visited(ASTNode* node, SymbolTab
                         }
                     }
                 }
-                errors_found += check_undefined_symbols_in_node_with_visited(node->data.index.index, table, new_visited_list);
+                errors_found += check_undefined_symbols_in_node_with_visited(node->data.index.index, table, walk);
             }
             break;
         }
         
         case AST_MEMBER_ACCESS: {
-            errors_found += check_undefined_symbols_in_node_with_visited(node->data.member_access.object, table, new_visited_list);
+            errors_found += check_undefined_symbols_in_node_with_visited(node->data.member_access.object, table, walk);
             /*
             处理结构体字段访问，检查字段名是否为标识符
             并验证字段名是否是结构体的有效字段
@@ -740,7 +727,7 @@ static int check_undefined_symbols_in_node_with_visited(ASTNode* node, SymbolTab
                 }
             } else {
                 if (node->data.member_access.field) {
-                    errors_found += check_undefined_symbols_in_node_with_visited(node->data.member_access.field, table, new_visited_list);
+                    errors_found += check_undefined_symbols_in_node_with_visited(node->data.member_access.field, table, walk);
                 }
             }
             break;
@@ -749,60 +736,65 @@ static int check_undefined_symbols_in_node_with_visited(ASTNode* node, SymbolTab
         case AST_BINOP:
         case AST_UNARYOP: {
             if (node->type == AST_BINOP) {
-                errors_found += check_undefined_symbols_in_node_with_visited(node->data.binop.left, table, new_visited_list);
-                errors_found += check_undefined_symbols_in_node_with_visited(node->data.binop.right, table, new_visited_list);
+                errors_found += check_undefined_symbols_in_node_with_visited(node->data.binop.left, table, walk);
+                errors_found += check_undefined_symbols_in_node_with_visited(node->data.binop.right, table, walk);
             } else {
-                errors_found += check_undefined_symbols_in_node_with_visited(node->data.unaryop.expr, table, new_visited_list);
+                errors_found += check_undefined_symbols_in_node_with_visited(node->data.unaryop.expr, table, walk);
             }
             break;
         }
         
         
         case AST_IF: {
-            errors_found += check_undefined_symbols_in_node_with_visited(node->data.if_stmt.condition, table, new_visited_list);
+            errors_found += check_undefined_symbols_in_node_with_visited(node->data.if_stmt.condition, table, walk);
             SymbolTable* then_scope = create_symbol_table(table);
             if (then_scope) {
-                errors_found += check_undefined_symbols_in_node_with_visited(node->data.if_stmt.then_body, then_scope, new_visited_list);
+                errors_found += check_undefined_symbols_in_node_with_visited(node->data.if_stmt.then_body, then_scope, walk);
                 destroy_symbol_table(then_scope);
             } else {
-                errors_found += check_undefined_symbols_in_node_with_visited(node->data.if_stmt.then_body, table, new_visited_list);
+                errors_found += check_undefined_symbols_in_node_with_visited(node->data.if_stmt.then_body, table, walk);
             }
             if (node->data.if_stmt.else_body) {
                 SymbolTable* else_scope = create_symbol_table(table);
                 if (else_scope) {
-                    errors_found += check_undefined_symbols_in_node_with_visited(node->data.if_stmt.else_body, else_scope, new_visited_list);
+                    errors_found += check_undefined_symbols_in_node_with_visited(node->data.if_stmt.else_body, else_scope, walk);
                     destroy_symbol_table(else_scope);
                 } else {
-                    errors_found += check_undefined_symbols_in_node_with_visited(node->data.if_stmt.else_body, table, new_visited_list);
+                    errors_found += check_undefined_symbols_in_node_with_visited(node->data.if_stmt.else_body, table, walk);
                 }
             }
             break;
         }
         
+        case AST_MATCH: {
+            errors_found += check_undefined_symbols_in_node_with_visited(lower_match_to_if(node), table, walk);
+            break;
+        }
+        
         case AST_WHILE: {
-            errors_found += check_undefined_symbols_in_node_with_visited(node->data.while_stmt.condition, table, new_visited_list);
-            errors_found += check_undefined_symbols_in_node_with_visited(node->data.while_stmt.body, table, new_visited_list);
+            errors_found += check_undefined_symbols_in_node_with_visited(node->data.while_stmt.condition, table, walk);
+            errors_found += check_undefined_symbols_in_node_with_visited(node->data.while_stmt.body, table, walk);
             break;
         }
         
         case AST_FOR: {
-            errors_found += check_undefined_symbols_in_node_with_visited(node->data.for_stmt.start, table, new_visited_list);
-            errors_found += check_undefined_symbols_in_node_with_visited(node->data.for_stmt.end, table, new_visited_list);
+            errors_found += check_undefined_symbols_in_node_with_visited(node->data.for_stmt.start, table, walk);
+            errors_found += check_undefined_symbols_in_node_with_visited(node->data.for_stmt.end, table, walk);
             if (node->data.for_stmt.var && node->data.for_stmt.var->type == AST_IDENTIFIER) {
                 add_symbol(table, node->data.for_stmt.var->data.identifier.name, SYMBOL_VARIABLE, TYPE_UNKNOWN);
             }
-            errors_found += check_undefined_symbols_in_node_with_visited(node->data.for_stmt.body, table, new_visited_list);
+            errors_found += check_undefined_symbols_in_node_with_visited(node->data.for_stmt.body, table, walk);
             break;
         }
         
         case AST_PRINT: {
-            errors_found += check_undefined_symbols_in_node_with_visited(node->data.print.expr, table, new_visited_list);
+            errors_found += check_undefined_symbols_in_node_with_visited(node->data.print.expr, table, walk);
             break;
         }
         
         case AST_INPUT: {
             if (node->data.input.prompt) {
-                errors_found += check_undefined_symbols_in_node_with_visited(node->data.input.prompt, table, new_visited_list);
+                errors_found += check_undefined_symbols_in_node_with_visited(node->data.input.prompt, table, walk);
             }
             break;
         }
@@ -810,16 +802,16 @@ static int check_undefined_symbols_in_node_with_visited(ASTNode* node, SymbolTab
         case AST_TOINT:
         case AST_TOFLOAT: {
             if (node->type == AST_TOINT) {
-                errors_found += check_undefined_symbols_in_node_with_visited(node->data.toint.expr, table, new_visited_list);
+                errors_found += check_undefined_symbols_in_node_with_visited(node->data.toint.expr, table, walk);
             } else {
-                errors_found += check_undefined_symbols_in_node_with_visited(node->data.tofloat.expr, table, new_visited_list);
+                errors_found += check_undefined_symbols_in_node_with_visited(node->data.tofloat.expr, table, walk);
             }
             break;
         }
         
         case AST_RETURN: {
             if (node->data.return_stmt.expr) {
-                errors_found += check_undefined_symbols_in_node_with_visited(node->data.return_stmt.expr, table, new_visited_list);
+                errors_found += check_undefined_symbols_in_node_with_visited(node->data.return_stmt.expr, table, walk);
             }
             break;
         }
@@ -857,7 +849,7 @@ static int check_undefined_symbols_in_node_with_visited(ASTNode* node, SymbolTab
         case AST_EXPRESSION_LIST: {
             for (int i = 0; i < node->data.expression_list.expression_count; i++)
             {
-                errors_found += check_undefined_symbols_in_node_with_visited(node->data.expression_list.expressions[i], table, new_visited_list);
+                errors_found += check_undefined_symbols_in_node_with_visited(node->data.expression_list.expressions[i], table, walk);
             }
             break;
         }
@@ -871,11 +863,10 @@ static int check_undefined_symbols_in_node_with_visited(ASTNode* node, SymbolTab
             break;
     }
     
-    /*释放当前添加的访问标记节点，但不释放整个访问列表
-    因为访问列表是由调用者管理的*/
-    VisitedNode* to_free = new_visited_list;
-    new_visited_list = new_visited_list->next;
-    free(to_free);
+    /*离开时清除访问戳，共享子树在其他路径上仍会被检查*/
+    node->visit_epoch = 0;
+    if (node->type == AST_STRUCT_DEF) walk->struct_def_depth--;
+    else if (node->type == AST_STRUCT_LITERAL) walk->struct_literal_depth--;
     
     return errors_found;
 }
@@ -894,7 +885,9 @@ int check_undefined_symbols(ASTNode* node) {
     
     SymbolTable* global_table = create_symbol_table(NULL);
     if (!global_table) return 1;
-    int result = check_undefined_symbols_in_node_with_visited(node, global_table, NULL);
+    SemanticWalk walk;
+    begin_semantic_walk(&walk);
+    int result = check_undefined_symbols_in_node_with_visited(node, global_table, &walk);
     destroy_symbol_table(global_table);
     return result;
 }
@@ -961,6 +954,9 @@ int is_variable_used_in_node(ASTNode* node, const char* var_name) {
             break;
         }
         
+        case AST_MATCH:
+            return is_variable_used_in_node(lower_match_to_if(node), var_name);
+        
         case AST_WHILE: {
             if (is_variable_used_in_node(node->data.while_stmt.condition, var_name)) {
                 return 1;
@@ -1044,20 +1040,52 @@ int is_variable_used_in_node(ASTNode* node, const char* var_name) {
     return 0;
 }
 typedef struct VariableUsage {
-    char* name;
+    char* name; // intern 过的指针
     int used;
     int line;
     int column;
     struct VariableUsage* next;
 } VariableUsage;
+/* usage 链表保持报告顺序，另建一张按名字指针索引的开放寻址表，查找 O(1) */
+static VariableUsage** g_usage_slots = NULL;
+static int g_usage_capacity = 0;
+static int g_usage_count = 0;
+static VariableUsage** find_usage_slot(const char* name) {
+    int mask = g_usage_capacity - 1;
+    int i = (int)(symbol_slot_hash(name) & (unsigned int)mask);
+    while (g_usage_slots[i] && g_usage_slots[i]->name != name) {
+        i = (i + 1) & mask;
+    }
+    return &g_usage_slots[i];
+}
+static int grow_usage_index(void) {
+    int old_capacity = g_usage_capacity;
+    VariableUsage** old_slots = g_usage_slots;
+    int capacity = old_capacity ? old_capacity * 2 : 64;
+    VariableUsage** slots = calloc(capacity, sizeof(VariableUsage*));
+    if (!slots) return 0;
+    g_usage_slots = slots;
+    g_usage_capacity = capacity;
+    for (int i = 0; i < old_capacity; i++) {
+        if (old_slots[i]) {
+            *find_usage_slot(old_slots[i]->name) = old_slots[i];
+        }
+    }
+    free(old_slots);
+    return 1;
+}
 VariableUsage* add_variable_to_usage_with_column(VariableUsage* list, const char* name, int line, int column) {
+    if ((g_usage_count + 1) * 4 > g_usage_capacity * 3 && !grow_usage_index()) return list;
     VariableUsage* new_var = malloc(sizeof(VariableUsage));
-    new_var->name = malloc(strlen(name) + 1);
-    strcpy(new_var->name, name);
+    if (!new_var) return list;
+    new_var->name = ast_intern(name);
     new_var->used = 0;
     new_var->line = line;
     new_var->column = column;
     new_var->next = list;
+    VariableUsage** slot = find_usage_slot(new_var->name);
+    if (!*slot) g_usage_count++;
+    *slot = new_var; //同名时新的遮蔽旧的，与链表头插的查找顺序一致
     return new_var;
 }
 
@@ -1065,22 +1093,20 @@ VariableUsage* add_variable_to_usage(VariableUsage* list, const char* name, int
     return add_variable_to_usage_with_column(list, name, line, 1);
 }
 VariableUsage* find_variable_in_usage(VariableUsage* list, const char* name) {
-    VariableUsage* current = list;
-    while (current) {
-        if (strcmp(current->name, name) == 0) {
-            return current;
-        }
-        current = current->next;
-    }
-    return NULL;
+    if (!list || !name || !g_usage_capacity) return NULL;
+    const char* key = ast_intern_find(name);
+    return key ? *find_usage_slot(key) : NULL;
 }
 void free_variable_usage(VariableUsage* list) {
     while (list) {
         VariableUsage* temp = list;
         list = list->next;
-        free(temp->name);
         free(temp);
     }
+    free(g_usage_slots);
+    g_usage_slots = NULL;
+    g_usage_capacity = 0;
+    g_usage_count = 0;
 }
 int check_unused_variables(ASTNode* node, SymbolTable* table) {
     VariableUsage* usage_list = NULL;
@@ -1229,6 +1255,11 @@ int check_unused_variables_with_usage(ASTNode* node, SymbolTable* table, struct
             break;
         }
         
+        case AST_MATCH: {
+            warnings_found += check_unused_variables_with_usage(lower_match_to_if(node), table, usage_list);
+            break;
+        }
+        
         case AST_WHILE: {
             warnings_found += check_unused_variables_with_usage(node->data.while_stmt.condition, table, usage_list);
             warnings_found += check_unused_variables_with_usage(node->data.while_stmt.body, table, usage_list);
@@ -1316,7 +1347,9 @@ int check_unused_variables_with_usage(ASTNode* node, SymbolTable* table, struct
 }
 
 int check_undefined_symbols_in_node(ASTNode* node, SymbolTable* table) {
-    return check_undefined_symbols_in_node_with_visited(node, table, NULL);
+    SemanticWalk walk;
+    begin_semantic_walk(&walk);
+    return check_undefined_symbols_in_node_with_visited(node, table, &walk);
 }
 static int extract_public_functions_from_module(const char* module_path, SymbolTable* table) {
     FILE* file = fopen(module_path, "r");
@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __APPLE__
+#include <mach-o/dyld.h>
+#endif
+#include "../include/cache.h"
+
+extern char* realpath(const char* path, char* resolved_path);
+
+#define VIX_CACHE_FORMAT "vix-cache-1"
+#ifndef VIX_GIT_REV
+#define VIX_GIT_REV "unknown"//Makefile 用 git rev-parse 传进来
+#endif
+//编译器版本 + 构建时的 git 版本：拿不到可执行文件本身时只能靠它区分编译器
+#define VIX_COMPILER_BUILD VIX_VERSION " " VIX_GIT_REV
+
+typedef struct {
+    char** paths;
+    int count;
+    int capacity;
+} CacheFileSet;
+
+static void hash_bytes(uint64_t* h, const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < len; i++) {
+        *h ^= p[i];
+        *h *= 1099511628211ull;
+    }
+}
+
+static void hash_str(uint64_t* h, const char* s) {
+    hash_bytes(h, s, strlen(s) + 1);//带上结尾的 0，避免相邻字段拼接后相同
+}
+
+static char* read_whole_file(const char* path, size_t* out_len) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    size_t cap = 4096, len = 0;
+    char* buf = malloc(cap + 1);
+    size_t n;
+    while (buf && (n = fread(buf + len, 1, cap - len, f)) > 0) {
+        len += n;
+        if (len == cap) {
+            char* nb = realloc(buf, cap * 2 + 1);
+            if (!nb) {
+                free(buf);
+                buf = NULL;
+                break;
+            }
+            buf = nb;
+            cap *= 2;
+        }
+    }
+    fclose(f);
+    if (!buf) return NULL;
+    buf[len] = '\0';
+    *out_len = len;
+    return buf;
+}
+
+static int file_set_add(CacheFileSet* set, const char* path) {
+    for (int i = 0; i < set->count; i++) {
+        if (strcmp(set->paths[i], path) == 0) return 0;
+    }
+    if (set->count == set->capacity) {
+        int cap = set->capacity ? set->capacity * 2 : 16;
+        char** np = realloc(set->paths, sizeof(char*) * cap);
+        if (!np) return 0;
+        set->paths = np;
+        set->capacity = cap;
+    }
+    set->paths[set->count] = strdup(path);
+    if (!set->paths[set->count]) return 0;
+    set->count++;
+    return 1;
+}
+
+//与 ast.c 的 resolve_import_path 规则一致：相对路径按导入方所在目录解析
+static void resolve_cache_import(const char* current_file, const char* module_path, size_t module_len, char* out, size_t out_size) {
+    char candidate[1024];
+    if (module_path[0] == '/') {
+        snprintf(candidate, sizeof(candidate), "%.*s", (int)module_len, module_path);
+    } else {
+        const char* slash = strrchr(current_file, '/');
+        if (slash) {
+            snprintf(candidate, sizeof(candidate), "%.*s%.*s", (int)(slash - current_file + 1), current_file, (int)module_len, module_path);
+        } else {
+            snprintf(candidate, sizeof(candidate), "./%.*s", (int)module_len, module_path);
+        }
+    }
+    if (!realpath(candidate, out)) {
+        snprintf(out, out_size, "%s", candidate);
+    }
+}
+
+/*
+不解析，只按文本扫 import "..."：多扫到的（注释/字符串里的）只会让 key 更保守，
+真正的 import 语句一定会被扫到
+*/
+static void hash_source_tree(uint64_t* h, const char* path, CacheFileSet* seen) {
+    if (!file_set_add(seen, path)) return;
+    hash_str(h, path);
+
+    size_t len = 0;
+    char* src = read_whole_file(path, &len);
+    if (!src) {
+        hash_str(h, "<missing>");
+        return;
+    }
+    hash_bytes(h, &len, sizeof(len));
+    hash_bytes(h, src, len);
+
+    for (char* p = strstr(src, "import"); p; p = strstr(p + 6, "import")) {
+        if (p > src && (p[-1] == '_' || (p[-1] >= 'a' && p[-1] <= 'z') || (p[-1] >= 'A' && p[-1] <= 'Z') || (p[-1] >= '0' && p[-1] <= '9'))) {
+            continue;
+        }
+        char* q = p + 6;
+        while (*q == ' ' || *q == '\t') q++;
+        if (*q != '"') continue;
+        char* end = strchr(q + 1, '"');
+        if (!end) break;
+        char resolved[4096];
+        resolve_cache_import(path, q + 1, (size_t)(end - q - 1), resolved, sizeof(resolved));
+        hash_source_tree(h, resolved, seen);
+    }
+    free(src);
+}
+
+//当前进程的可执行文件：Linux /proc/self/exe，FreeBSD /proc/curproc/file，macOS _NSGetExecutablePath
+static int compiler_exe_path(char* out, size_t out_size) {
+#ifdef __APPLE__
+    uint32_t size = (uint32_t)out_size;
+    return _NSGetExecutablePath(out, &size) == 0;
+#else
+    const char* links[] = { "/proc/self/exe", "/proc/curproc/file" };
+    for (size_t i = 0; i < sizeof(links) / sizeof(links[0]); i++) {
+        if (access(links[i], F_OK) == 0) {
+            snprintf(out, out_size, "%s", links[i]);
+            return 1;
+        }
+    }
+    return 0;
+#endif
+}
+
+static int cache_dir(char* out, size_t out_size);
+
+/*
+编译器可执行文件内容的哈希：同一份源码重新编出来的编译器共用缓存，改过的编译器一定换 key。
+整文件读一遍要几毫秒 (静态链接 LLVM 时上百毫秒)，所以按 大小+mtime+inode 把结果记在缓存目录的 exe-*.id 里
+*/
+static int compiler_exe_hash(uint64_t* out) {
+    char exe[4096], dir[4096], id_path[4300], tmp[4400];
+    struct stat st;
+    if (!compiler_exe_path(exe, sizeof(exe)) || stat(exe, &st) != 0) return 0;
+    int have_dir = cache_dir(dir, sizeof(dir));
+    if (have_dir) {
+        snprintf(id_path, sizeof(id_path), "%s/exe-%lld-%lld-%llu.id", dir, (long long)st.st_size,
+                 (long long)st.st_mtime, (unsigned long long)st.st_ino);
+        FILE* f = fopen(id_path, "r");
+        if (f) {
+            unsigned long long v = 0;
+            int ok = fscanf(f, "%16llx", &v) == 1;
+            fclose(f);
+            if (ok) {
+                *out = v;
+                return 1;
+            }
+        }
+    }
+
+    FILE* f = fopen(exe, "rb");
+    if (!f) return 0;
+    uint64_t h = 14695981039346656037ull;
+    unsigned char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        hash_bytes(&h, buf, n);
+    }
+    int ok = !ferror(f);
+    fclose(f);
+    if (!ok) return 0;
+    *out = h;
+
+    if (have_dir) {
+        snprintf(tmp, sizeof(tmp), "%s.tmp.%ld", id_path, (long)getpid());
+        FILE* w = fopen(tmp, "w");
+        if (w) {
+            ok = fprintf(w, "%016llx\n", (unsigned long long)h) > 0;
+            ok = (fclose(w) == 0) && ok;
+            if (!ok || rename(tmp, id_path) != 0) remove(tmp);
+        }
+    }
+    return 1;
+}
+
+int vix_cache_key(const char* in_f, const char* flags, char key[VIX_CACHE_KEY_LEN]) {
+    if (!in_f) return 0;
+    uint64_t h = 14695981039346656037ull;
+    hash_str(&h, VIX_CACHE_FORMAT);
+    hash_str(&h, flags ? flags : "");
+
+    //编译器自身换了就失效：可执行文件内容的哈希，找不到可执行文件时只剩版本和 git 版本
+    hash_str(&h, VIX_COMPILER_BUILD);
+    uint64_t exe_hash;
+    if (compiler_exe_hash(&exe_hash)) {
+        hash_bytes(&h, &exe_hash, sizeof(exe_hash));
+    }
+
+    char root_path[4096];
+    if (!realpath(in_f, root_path)) {
+        return 0;
+    }
+    CacheFileSet seen = {0};
+    hash_source_tree(&h, root_path, &seen);
+    for (int i = 0; i < seen.count; i++) {
+        free(seen.paths[i]);
+    }
+    free(seen.paths);
+
+    snprintf(key, VIX_CACHE_KEY_LEN, "%016llx", (unsigned long long)h);
+    return 1;
+}
+
+static int cache_dir(char* out, size_t out_size) {
+    const char* dir = getenv("VIX_CACHE_DIR");
+    if (dir && dir[0]) {
+        snprintf(out, out_size, "%s", dir);
+    } else if ((dir = getenv("XDG_CACHE_HOME")) && dir[0]) {
+        snprintf(out, out_size, "%s/vix", dir);
+    } else if ((dir = getenv("HOME")) && dir[0]) {
+        snprintf(out, out_size, "%s/.cache/vix", dir);
+    } else {
+        return 0;
+    }
+    //mkdir -p
+    for (char* p = out + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(out, 0755) != 0 && errno != EEXIST) {
+            *p = '/';
+            return 0;
+        }
+        *p = '/';
+    }
+    return mkdir(out, 0755) == 0 || errno == EEXIST;
+}
+
+static int copy_file(const char* from, const char* to) {
+    size_t len = 0;
+    char* data = read_whole_file(from, &len);
+    if (!data) return 0;
+    FILE* f = fopen(to, "wb");
+    if (!f) {
+        free(data);
+        return 0;
+    }
+    int ok = fwrite(data, 1, len, f) == len;
+    ok = (fclose(f) == 0) && ok;
+    free(data);
+    if (!ok) remove(to);
+    return ok;
+}
+
+static int cache_file(const char* key, const char* ext, char* out, size_t out_size) {
+    char dir[4096];
+    if (!key || !cache_dir(dir, sizeof(dir))) return 0;
+    snprintf(out, out_size, "%s/%s%s", dir, key, ext);
+    return 1;
+}
+
+static void cache_store_as(const char* key, const char* ext, const char* from) {
+    char path[4200], tmp[4300];
+    if (!from || !cache_file(key, ext, path, sizeof(path))) return;
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%ld", path, (long)getpid());
+    //先写临时文件再 rename，并发的 vixc 不会读到半个文件
+    if (copy_file(from, tmp) && rename(tmp, path) != 0) {
+        remove(tmp);
+    }
+}
+
+int vix_cache_has(const char* key) {
+    char path[4200];
+    return cache_file(key, ".o", path, sizeof(path)) && access(path, R_OK) == 0;
+}
+
+int vix_cache_fetch(const char* key, const char* obj_path) {
+    char path[4200];
+    if (!obj_path || !cache_file(key, ".o", path, sizeof(path))) return 0;
+    if (access(path, R_OK) != 0) return 0;
+    return copy_file(path, obj_path);
+}
+
+void vix_cache_store(const char* key, const char* obj_path) {
+    cache_store_as(key, ".o", obj_path);
+}
+
+FILE* vix_cache_open_interface(const char* key) {
+    char path[4200];
+    return cache_file(key, ".vi", path, sizeof(path)) ? fopen(path, "rb") : NULL;
+}
+
+void vix_cache_store_interface(const char* key, const char* vi_path) {
+    cache_store_as(key, ".vi", vi_path);
+}
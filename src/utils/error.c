@@ -2,6 +2,14 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 #include "../include/compiler.h"
 // typedef enum {
 //     ERROR_LEVEL_WARNING,
@@ -11,10 +19,8 @@
 static const char* current_filename = "unknown";
 static int current_line = 1;
 static int error_count = 0;
-static char* source_content = NULL;
 static void vreport_error(ErrorLevel level, ErrorType error_type, const char* format, va_list args);
 static int warning_count = 0;
-static char* get_line_content(int line_number);
 static void show_error_context_with_column(int line_number, int column);
 static int current_column = 1;
 static void show_error_context_with_column_and_length(int line_number, int column, int length);
@@ -49,89 +55,148 @@ void set_location_with_column(const char* filename, int line, int column) {
     current_line = line;
     current_column = column > 0 ? column : 1;
 }
+/*
+诊断用的源文件：按文件名登记，主文件和 import 进来的模块各一份，内容用 mmap 映射 (Windows 上读进内存)。
+行首偏移表在第一次报这个文件的诊断时建一次，之后取某一行是 O(1)，上下文行直接按 (指针, 长度) 打印，不复制。
+*/
+typedef struct {
+    char* name;
+    const char* data;
+    size_t size;
+    int mapped;//1：mmap 的，0：malloc 的
+    size_t* line_starts;//第 i 行 (从 1 数) 从 line_starts[i - 1] 开始；NULL 表示还没建
+    int line_count;
+} SourceFile;
+
+static SourceFile* source_files = NULL;
+static int source_file_count = 0;
+static int source_file_capacity = 0;
+static int primary_source = -1;//load_source_file 登记的第一个文件：文件名不明时用它
+
+static int open_source_file(const char* filename) {
+    for (int i = 0; i < source_file_count; i++) {
+        if (strcmp(source_files[i].name, filename) == 0) return i;
+    }
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return -1;
+    }
+    SourceFile file = {0};
+    file.size = (size_t)st.st_size;
+    if (file.size == 0) {
+        file.data = "";
+    } else {
+#ifndef _WIN32
+        void* p = mmap(NULL, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            file.data = p;
+            file.mapped = 1;
+        }
+#endif
+        if (!file.mapped) {
+            char* buf = malloc(file.size);
+            ssize_t got = buf ? read(fd, buf, file.size) : -1;
+            if (got < 0) {
+                free(buf);
+                close(fd);
+                return -1;
+            }
+            file.size = (size_t)got;
+            file.data = buf;
+            if (got == 0) {
+                free(buf);
+                file.data = "";
+            }
+        }
+    }
+    close(fd);
+    file.name = strdup(filename);
+    if (source_file_count >= source_file_capacity) {
+        source_file_capacity = source_file_capacity ? source_file_capacity * 2 : 8;
+        source_files = realloc(source_files, sizeof(SourceFile) * source_file_capacity);
+    }
+    source_files[source_file_count] = file;
+    return source_file_count++;
+}
+
 void load_source_file(const char* filename) {
     if (!filename) {
         printf("error:cannot open file\n");
         return;
     }
-
-    FILE* file = fopen(filename, "r");
-    if (!file) return;
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    source_content = (char*)malloc(file_size + 1);
-    if (source_content) {
-        fread(source_content, 1, file_size, file);
-        source_content[file_size] = '\0';
+    int idx = open_source_file(filename);
+    if (idx >= 0 && primary_source < 0) primary_source = idx;
+}
+
+//当前诊断所在的文件，第一次用到时映射；打不开时退回主文件
+static SourceFile* current_source(void) {
+    int idx = -1;
+    if (current_filename && strcmp(current_filename, "unknown") != 0) {
+        idx = open_source_file(current_filename);
+    }
+    if (idx < 0) idx = primary_source;
+    if (idx < 0) return NULL;
+    SourceFile* file = &source_files[idx];
+    if (!file->line_starts) {
+        int cap = 64;
+        file->line_starts = malloc(sizeof(size_t) * cap);
+        file->line_starts[0] = 0;
+        file->line_count = 1;
+        const char* p = file->data;
+        const char* end = file->data + file->size;
+        while (p < end && (p = memchr(p, '\n', end - p)) != NULL) {
+            p++;
+            if (file->line_count >= cap) {
+                cap *= 2;
+                file->line_starts = realloc(file->line_starts, sizeof(size_t) * cap);
+            }
+            file->line_starts[file->line_count++] = (size_t)(p - file->data);
+        }
     }
-    
-    fclose(file);
+    return file;
 }
 
-static char* get_line_content(int line_number) {
-    if (!source_content || line_number <= 0) return NULL;
-    
-    char* start = source_content;
-    int current_line = 1;
-    while (current_line < line_number && *start) {
-        if (*start == '\n') {
-            current_line++;
-            start++;
-        } else {
-            start++;
-        }
-    }
-    
-    if (current_line != line_number) 
-    {
-        return NULL;
-    }
-    char* end = start;
-    while (*end && *end != '\n') {
-        end++;
-    }
-    
-    int line_len = end - start;
-    char* line_content = (char*)malloc(line_len + 1);
-    if (line_content) {
-        strncpy(line_content, start, line_len);
-        line_content[line_len] = '\0';
-        if (line_content[line_len - 1] == '\r') {
-            line_content[line_len - 1] = '\0';
-        }
-    }
-    
-    return line_content;
+//第 line_number 行的 (起点, 长度)，不含换行和行尾的 \r；没有这一行返回 NULL
+static const char* get_line_content(SourceFile* file, int line_number, int* len) {
+    if (!file || line_number <= 0 || line_number > file->line_count) return NULL;
+    size_t start = file->line_starts[line_number - 1];
+    size_t end = line_number < file->line_count ? file->line_starts[line_number] - 1 : file->size;
+    if (line_number == file->line_count && start == file->size && line_number > 1) return NULL;//末尾换行之后的空行
+    if (end > start && file->data[end - 1] == '\r') end--;
+    *len = (int)(end - start);
+    return file->data + start;
 }
 static void show_error_context_with_column(int line_number, int column) {
     show_error_context_with_column_and_length(line_number, column, 1);
 }
 static void show_error_context_with_column_and_length(int line_number, int column, int length) {
-    if (!source_content) return;
+    SourceFile* file = current_source();
+    if (!file) return;
 
     int width = line_number_width(line_number + 1);
-    char* prev_line = get_line_content(line_number - 1);
-    char* line_content = get_line_content(line_number);
-    char* next_line = get_line_content(line_number + 1);
+    int prev_len = 0, line_len = 0, next_len = 0;
+    const char* prev_line = get_line_content(file, line_number - 1, &prev_len);
+    const char* line_content = get_line_content(file, line_number, &line_len);
+    const char* next_line = get_line_content(file, line_number + 1, &next_len);
 
     if (!line_content) {
-        free(prev_line);
-        free(next_line);
         return;
     }
 
     fprintf(stderr, "%s%*s |%s\n", ANSI_DIM, width, "", ANSI_RESET);
     if (prev_line) {
-        fprintf(stderr, "%s%*d | %s%s\n", ANSI_DIM, width, line_number - 1, prev_line, ANSI_RESET);
+        fprintf(stderr, "%s%*d | %.*s%s\n", ANSI_DIM, width, line_number - 1, prev_len, prev_line, ANSI_RESET);
     }
-    fprintf(stderr, "%s%*d |%s %s%s%s\n", ANSI_BOLD ANSI_BLUE, width, line_number, ANSI_RESET, ANSI_WHITE, line_content, ANSI_RESET);
+    fprintf(stderr, "%s%*d |%s %s%.*s%s\n", ANSI_BOLD ANSI_BLUE, width, line_number, ANSI_RESET, ANSI_WHITE, line_len, line_content, ANSI_RESET);
     if (next_line) {
-        fprintf(stderr, "%s%*d | %s%s\n", ANSI_DIM, width, line_number + 1, next_line, ANSI_RESET);
+        fprintf(stderr, "%s%*d | %.*s%s\n", ANSI_DIM, width, line_number + 1, next_len, next_line, ANSI_RESET);
     }
 
     fprintf(stderr, "%s%*s |%s ", ANSI_DIM, width, "", ANSI_RESET);
-    for (int i = 0; i < column - 1 && line_content[i] != '\0'; i++) {
+    for (int i = 0; i < column - 1 && i < line_len; i++) {
         if (line_content[i] == '\t') {
             fputc('\t', stderr);
         } else {
@@ -145,10 +210,6 @@ static void show_error_context_with_column_and_length(int line_number, int colum
     }
     fprintf(stderr, " %s<-- column %d%s\n", ANSI_BOLD ANSI_CYAN, column, ANSI_RESET);
     fprintf(stderr, "%s%*s |%s\n", ANSI_DIM, width, "", ANSI_RESET);
-
-    free(prev_line);
-    free(line_content);
-    free(next_line);
 }
 
 static void show_error_context(int line_number) {
@@ -297,7 +358,7 @@ static void vreport_error(ErrorLevel level, ErrorType error_type, const char* fo
     print_diagnostic_header(level, error_type, message);
 
     /* Show source context (line and caret) when available */
-    if (source_content && current_line > 0) {
+    if (current_line > 0) {
         if (current_column > 0) {
             show_error_context_with_column(current_line, current_column);
         } else {
@@ -320,7 +381,7 @@ void report_simple_error_with_length(ErrorLevel level, ErrorType error_type, con
     }
 
     print_diagnostic_header(level, error_type, msg);
-    if (source_content && current_line > 0) {
+    if (current_line > 0) {
         if (current_column > 0) {
             show_error_context_with_column_and_length(current_line, current_column, length);
         } else {
@@ -391,7 +452,7 @@ void internal_error(const char* format, ...) {
     fprintf(stderr, "%s-->%s %s:%d:%d\n", ANSI_BOLD ANSI_BLUE, ANSI_RESET, current_filename, current_line, current_column);
     fprintf(stderr, "%sMessage:%s %s\n", ANSI_BOLD, ANSI_RESET, message);
 
-    if (source_content && current_line > 0) {
+    if (current_line > 0) {
         if (current_column > 0) {
             show_error_context_with_column(current_line, current_column);
         } else {
@@ -650,10 +711,20 @@ void print_error_summary() {
 }
 
 void cleanup_error_handler() {
-    if (source_content) {
-        free(source_content);
-        source_content = NULL;
-    }
+    for (int i = 0; i < source_file_count; i++) {
+        SourceFile* file = &source_files[i];
+#ifndef _WIN32
+        if (file->mapped) munmap((void*)file->data, file->size);
+#endif
+        if (!file->mapped && file->size > 0) free((void*)file->data);
+        free(file->line_starts);
+        free(file->name);
+    }
+    free(source_files);
+    source_files = NULL;
+    source_file_count = 0;
+    source_file_capacity = 0;
+    primary_source = -1;
 }
 
 void report_struct_field_missing_with_location_and_suggestion(const char* struct_name, const char* field_name, const char* suggestion, const char* filename, int line, int column) {
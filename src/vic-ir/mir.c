@@ -1,24 +1,36 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include "../../include/ast.h"
 #include "../../include/vic-ir/mir.h"
 
+/*
+常量池按出现顺序存放，另外每种常量一张开放寻址的哈希索引 (槽里存下标 + 1，0 为空)，查重不再线性扫描。
+字符串先 ast_intern，同样内容同一个指针，索引按指针比较；LLVM 后端的 safeCreateGlobalStringPtr 也按
+ast_intern 的指针去重。浮点按位模式比较：-0.0 和 0.0 是两个常量，NaN 也能找到自己。
+*/
 typedef struct {
-    char** strings;
+    const char** strings;//ast_intern 过，不单独释放
     int* string_regs;
     int string_count;
     int string_capacity;
+    int* string_index;
+    int string_index_cap;
     
     long long* ints;
     int* int_regs;
     int int_count;
     int int_capacity;
+    int* int_index;
+    int int_index_cap;
     
     double* floats;
     int* float_regs;
     int float_count;
     int float_capacity;
+    int* float_index;
+    int float_index_cap;
 } ConstantPool;
 
 static char* escape_str(const char* src);
@@ -109,6 +121,10 @@ void preprocess_ast_for_constants(ConstantPool* pool, ASTNode* node) {
             }
             break;
         }
+        case AST_MATCH: {
+            preprocess_ast_for_constants(pool, lower_match_to_if(node));
+            break;
+        }
         case AST_WHILE: {
             preprocess_ast_for_constants(pool, node->data.while_stmt.condition);
             preprocess_ast_for_constants(pool, node->data.while_stmt.body);
@@ -168,7 +184,7 @@ int add_int_constant(ConstantPool* pool, long long value);
 int add_float_constant(ConstantPool* pool, double value);
 int generate_expr(ConstantPool* pool, ASTNode* node, FILE* fp);
 ConstantPool* create_constant_pool() {
-    ConstantPool* pool = malloc(sizeof(ConstantPool));
+    ConstantPool* pool = calloc(1, sizeof(ConstantPool));
     pool->string_count = 0;
     pool->string_capacity = 16;
     pool->strings = malloc(sizeof(char*) * pool->string_capacity);
@@ -187,15 +203,15 @@ ConstantPool* create_constant_pool() {
     return pool;
 }
 void free_constant_pool(ConstantPool* pool) {
-    for (int i = 0; i < pool->string_count; i++) {
-        free(pool->strings[i]);
-    }
     free(pool->strings);
     free(pool->string_regs);
     free(pool->ints);
     free(pool->int_regs);
     free(pool->floats);
     free(pool->float_regs);
+    free(pool->string_index);
+    free(pool->int_index);
+    free(pool->float_index);
     free(pool);
 }
 void generate_data_section(ConstantPool* pool, FILE* fp) {
@@ -209,32 +225,100 @@ void generate_data_section(ConstantPool* pool, FILE* fp) {
         fprintf(fp, "data $i%d = { i64 %lld }\n", pool->int_regs[i], pool->ints[i]);
     }
     for (int i = 0; i < pool->float_count; i++) {
-        fprintf(fp, "data $f%d = { f64 %g }\n", pool->float_regs[i], pool->floats[i]);
+        fprintf(fp, "data $f%d = { f64 %.17g }\n", pool->float_regs[i], pool->floats[i]);
     }
 }
 
-int add_string_constant(ConstantPool* pool, const char* str) {
-    for (int i = 0; i < pool->string_count; i++) {
-        if (strcmp(pool->strings[i], str) == 0) {
-            return pool->string_regs[i];
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static uint64_t float_bits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static uint64_t const_key(ConstantPool* pool, int kind, int i) {
+    switch (kind) {
+        case 0: return (uint64_t)(uintptr_t)pool->strings[i];
+        case 1: return (uint64_t)pool->ints[i];
+        default: return float_bits(pool->floats[i]);
+    }
+}
+
+// kind：0 字符串 (ast_intern 后的指针)、1 整数、2 浮点 (位模式)
+static void index_slots(ConstantPool* pool, int kind, int*** index, int** cap, int* count) {
+    switch (kind) {
+        case 0: *index = &pool->string_index; *cap = &pool->string_index_cap; *count = pool->string_count; break;
+        case 1: *index = &pool->int_index; *cap = &pool->int_index_cap; *count = pool->int_count; break;
+        default: *index = &pool->float_index; *cap = &pool->float_index_cap; *count = pool->float_count; break;
+    }
+}
+
+// 找到返回下标，没有返回 -1
+static int index_find(ConstantPool* pool, int kind, uint64_t key) {
+    int** index;
+    int* cap;
+    int count;
+    index_slots(pool, kind, &index, &cap, &count);
+    if (*cap == 0) return -1;
+    for (size_t j = mix64(key) & (*cap - 1); (*index)[j]; j = (j + 1) & (*cap - 1)) {
+        int i = (*index)[j] - 1;
+        if (const_key(pool, kind, i) == key) return i;
+    }
+    return -1;
+}
+
+// 下标 i 的常量刚追加进池，登记到索引；装载因子超过 1/2 时翻倍重建
+static void index_insert(ConstantPool* pool, int kind, int i) {
+    int** index;
+    int* cap;
+    int count;
+    index_slots(pool, kind, &index, &cap, &count);
+    if ((size_t)count * 2 > (size_t)*cap) {
+        int ncap = *cap ? *cap * 2 : 64;
+        while (count * 2 > ncap) ncap *= 2;
+        free(*index);
+        *index = calloc(ncap, sizeof(int));
+        *cap = ncap;
+        for (int k = 0; k < count; k++) {
+            if (k == i) continue;
+            size_t j = mix64(const_key(pool, kind, k)) & (ncap - 1);
+            while ((*index)[j]) j = (j + 1) & (ncap - 1);
+            (*index)[j] = k + 1;
         }
     }
+    size_t j = mix64(const_key(pool, kind, i)) & (*cap - 1);
+    while ((*index)[j]) j = (j + 1) & (*cap - 1);
+    (*index)[j] = i + 1;
+}
+
+int add_string_constant(ConstantPool* pool, const char* str) {
+    const char* s = ast_intern(str ? str : "");
+    int found = index_find(pool, 0, (uint64_t)(uintptr_t)s);
+    if (found >= 0) {
+        return pool->string_regs[found];
+    }
     if (pool->string_count >= pool->string_capacity) {
         pool->string_capacity *= 2;
         pool->strings = realloc(pool->strings, sizeof(char*) * pool->string_capacity);
         pool->string_regs = realloc(pool->string_regs, sizeof(int) * pool->string_capacity);
     }
-    pool->strings[pool->string_count] = strdup(str);
+    pool->strings[pool->string_count] = s;
     int reg = reg_counter++;
     pool->string_regs[pool->string_count] = reg;
     pool->string_count++;
+    index_insert(pool, 0, pool->string_count - 1);
     return reg;
 }
 int add_int_constant(ConstantPool* pool, long long value) {
-    for (int i = 0; i < pool->int_count; i++) {
-        if (pool->ints[i] == value) {
-            return pool->int_regs[i];
-        }
+    int found = index_find(pool, 1, (uint64_t)value);
+    if (found >= 0) {
+        return pool->int_regs[found];
     }
     if (pool->int_count >= pool->int_capacity) {
         pool->int_capacity *= 2;
@@ -245,13 +329,13 @@ int add_int_constant(ConstantPool* pool, long long value) {
     int reg = reg_counter++;
     pool->int_regs[pool->int_count] = reg;
     pool->int_count++;
+    index_insert(pool, 1, pool->int_count - 1);
     return reg;
 }
 int add_float_constant(ConstantPool* pool, double value) {
-    for (int i = 0; i < pool->float_count; i++) {
-        if (pool->floats[i] == value) {
-            return pool->float_regs[i];
-        }
+    int found = index_find(pool, 2, float_bits(value));
+    if (found >= 0) {
+        return pool->float_regs[found];
     }
     if (pool->float_count >= pool->float_capacity) {
         pool->float_capacity *= 2;
@@ -262,6 +346,7 @@ int add_float_constant(ConstantPool* pool, double value) {
     int reg = reg_counter++;
     pool->float_regs[pool->float_count] = reg;
     pool->float_count++;
+    index_insert(pool, 2, pool->float_count - 1);
     return reg;
 }
 
@@ -417,6 +502,8 @@ int generate_expr(ConstantPool* pool, ASTNode* node, FILE* fp) {
                 else if (strcmp(mname, "pop") == 0) fn = "list_pop";
                 else if (strcmp(mname, "pop!") == 0) fn = "list_pop_inplace";
                 else if (strcmp(mname, "replace!") == 0) fn = "list_replace_inplace";
+                else if (strcmp(mname, "reserve") == 0) fn = "list_reserve";
+                else if (strcmp(mname, "shrink_to_fit") == 0) fn = "list_shrink_to_fit";
                 else fn = NULL;
 
                 if (!fn) {
@@ -626,6 +713,10 @@ void generate_statement(ConstantPool* pool, ASTNode* node, FILE* fp) {
             fprintf(fp, "  @L%d:\n", end_label);
             break;
         }
+        case AST_MATCH: {
+            generate_statement(pool, lower_match_to_if(node), fp);
+            break;
+        }
         case AST_WHILE: {
             int start_label = label_counter++;
             int body_label = label_counter++;
@@ -0,0 +1,1058 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/ast.h"
+#include "../../include/bytecode.h"
+#include "../../include/compiler.h"
+
+/*
+寄存器式字节码生成
+每个函数一个寄存器帧：[0, var_count) 是变量（参数在最前面），之后是临时寄存器。
+变量在生成函数体之前就扫描出来，所以运行时只按下标访问，不再按名字查找。
+顶层变量就是顶层帧的寄存器，函数里通过 LOAD_NAME/STORE_NAME 按下标访问。
+*/
+
+static int gen_expr(ByteCodeGen* gen, ASTNode* node, int dst);
+static void gen_stmt(ByteCodeGen* gen, ASTNode* node);
+
+ByteCodeList* create_bytecode_list() {
+    ByteCodeList* list = malloc(sizeof(ByteCodeList));
+    if (!list) return NULL;
+    list->capacity = 64;
+    list->count = 0;
+    list->entry_frame_size = 0;
+    list->source_file = NULL;
+    list->codes = malloc(sizeof(ByteCode) * list->capacity);
+    return list;
+}
+
+void free_bytecode_list(ByteCodeList* list) {
+    if (!list) return;
+    for (int i = 0; i < list->count; i++) {
+        ByteCode* bc = &list->codes[i];
+        switch (bc->op) {
+            case BC_LOAD_CONST_STRING:
+                free(bc->operand.string_value);
+                break;
+            case BC_PRINT:
+                free(bc->operand.print_args.arg_indices);
+                break;
+            case BC_FUNCTION_DEF:
+                free(bc->operand.func_def_args.name);
+                free(bc->operand.func_def_args.param_indices);
+                free(bc->operand.func_def_args.param_bits);
+                break;
+            case BC_CALL:
+                free(bc->operand.call_args.name);
+                free(bc->operand.call_args.arg_indices);
+                free(bc->operand.call_args.arg_bits);
+                break;
+            default:
+                break;
+        }
+    }
+    free(list->codes);
+    free(list);
+}
+
+ByteCodeGen* create_bytecode_gen() {
+    ByteCodeGen* gen = calloc(1, sizeof(ByteCodeGen));
+    if (!gen) return NULL;
+    gen->bytecode = create_bytecode_list();
+    return gen;
+}
+
+static void free_name_list(char** names, int count) {
+    if (!names) return;
+    for (int i = 0; i < count; i++) free(names[i]);
+    free(names);
+}
+
+void free_bytecode_gen(ByteCodeGen* gen) {
+    if (!gen) return;
+    free_bytecode_list(gen->bytecode);
+    if (gen->globals == gen->variables) {
+        gen->globals = NULL;
+    }
+    free_name_list(gen->variables, gen->var_count);
+    free_name_list(gen->globals, gen->global_count);
+    free(gen->var_bits);
+    free(gen->break_patches);
+    free(gen->continue_patches);
+    free(gen);
+}
+
+static void vm_unsupported(ByteCodeGen* gen, ASTNode* node, const char* what) {
+    char msg[256];
+    snprintf(msg, sizeof(msg), "vm: %s is not supported by 'vixc run', use the native backend", what);
+    const char* file = (node && node->source_file) ? node->source_file : "unknown";
+    int line = node ? node->location.first_line : 0;
+    report_semantic_error_with_location(msg, file, line);
+    gen->error_count++;
+}
+
+static int emit(ByteCodeGen* gen, ByteCodeInstruction op, int reg) {
+    ByteCodeList* list = gen->bytecode;
+    if (list->count >= list->capacity) {
+        list->capacity *= 2;
+        list->codes = realloc(list->codes, sizeof(ByteCode) * list->capacity);
+    }
+    ByteCode* bc = &list->codes[list->count];
+    memset(bc, 0, sizeof(ByteCode));
+    bc->op = op;
+    bc->reg = reg;
+    bc->line = gen->cur_line;
+    return list->count++;
+}
+
+static void emit_triaddr(ByteCodeGen* gen, ByteCodeInstruction op, int result, int a, int b) {
+    int at = emit(gen, op, -1);
+    gen->bytecode->codes[at].operand.triaddr.result = result;
+    gen->bytecode->codes[at].operand.triaddr.operand1 = a;
+    gen->bytecode->codes[at].operand.triaddr.operand2 = b;
+}
+
+static void patch_jump(ByteCodeGen* gen, int at, int address) {
+    ByteCode* bc = &gen->bytecode->codes[at];
+    if (bc->op == BC_FOR_PREPARE || bc->op == BC_FOR_LOOP) {
+        bc->operand.for_args.address = address;
+    } else {
+        bc->operand.jump_args.address = address;
+    }
+}
+
+int get_variable_index(ByteCodeGen* gen, const char* name) {
+    if (!name) return -1;
+    for (int i = 0; i < gen->var_count; i++) {
+        if (strcmp(gen->variables[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+static int find_global_index(ByteCodeGen* gen, const char* name) {
+    if (!gen->in_function || !name) return -1;
+    for (int i = 0; i < gen->global_count; i++) {
+        if (strcmp(gen->globals[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+static int declare_variable(ByteCodeGen* gen, const char* name) {
+    int idx = get_variable_index(gen, name);
+    if (idx >= 0) return idx;
+    if (gen->var_count >= gen->var_capacity) {
+        gen->var_capacity = gen->var_capacity ? gen->var_capacity * 2 : 16;
+        gen->variables = realloc(gen->variables, sizeof(char*) * gen->var_capacity);
+        gen->var_bits = realloc(gen->var_bits, sizeof(int) * gen->var_capacity);
+    }
+    gen->variables[gen->var_count] = strdup(name);
+    gen->var_bits[gen->var_count] = 0;
+    return gen->var_count++;
+}
+
+static int new_tmp(ByteCodeGen* gen) {
+    int reg = gen->var_count + gen->tmp_counter++;
+    if (reg + 1 > gen->max_regs) gen->max_regs = reg + 1;
+    return reg;
+}
+
+static int pick_dst(ByteCodeGen* gen, int dst) {
+    return dst >= 0 ? dst : new_tmp(gen);
+}
+
+static void push_patch(int** arr, int* count, int* capacity, int at) {
+    if (*count >= *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 16;
+        *arr = realloc(*arr, sizeof(int) * (*capacity));
+    }
+    (*arr)[(*count)++] = at;
+}
+
+static const char* ident_name(ASTNode* node) {
+    if (node && node->type == AST_IDENTIFIER) return node->data.identifier.name;
+    return NULL;
+}
+
+/* 类型注解对应的整数位宽，虚拟机按它截断参数和返回值 */
+static int int_type_bits(ASTNode* type) {
+    if (!type) return 0;
+    switch (type->type) {
+        case AST_TYPE_INT8: return 8;
+        case AST_TYPE_INT32: return 32;
+        case AST_TYPE_INT64: return 64;
+        default: return 0;
+    }
+}
+
+/* 扫描函数体（不进入嵌套函数）里出现的变量，提前分配寄存器 */
+static void collect_locals(ByteCodeGen* gen, ASTNode* node) {
+    if (!node) return;
+    switch (node->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < node->data.program.statement_count; i++) {
+                collect_locals(gen, node->data.program.statements[i]);
+            }
+            break;
+        case AST_ASSIGN:
+        case AST_CONST: {
+            const char* name = ident_name(node->data.assign.left);
+            int idx = get_variable_index(gen, name);
+            if (idx < 0 && name && (node->type == AST_CONST || node->data.assign.is_declaration == 1 ||
+                                    find_global_index(gen, name) < 0)) {
+                idx = declare_variable(gen, name);
+            }
+            /* 参数被重新赋值后位宽跟着值走，编译期就不知道了 */
+            if (idx >= 0) gen->var_bits[idx] = 0;
+            break;
+        }
+        case AST_GLOBAL: {
+            const char* name = ident_name(node->data.global_decl.identifier);
+            if (name) declare_variable(gen, name);
+            break;
+        }
+        case AST_IF:
+            collect_locals(gen, node->data.if_stmt.then_body);
+            collect_locals(gen, node->data.if_stmt.else_body);
+            break;
+        case AST_WHILE:
+            collect_locals(gen, node->data.while_stmt.body);
+            break;
+        case AST_MATCH:
+            collect_locals(gen, lower_match_to_if(node));
+            break;
+        case AST_FOR: {
+            const char* name = ident_name(node->data.for_stmt.var);
+            if (name) gen->var_bits[declare_variable(gen, name)] = 0;
+            collect_locals(gen, node->data.for_stmt.body);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void gen_store_ident(ByteCodeGen* gen, ASTNode* target, ASTNode* value) {
+    const char* name = ident_name(target);
+    int idx = get_variable_index(gen, name);
+    if (idx >= 0) {
+        if (value) gen_expr(gen, value, idx);
+        else emit(gen, BC_LOAD_NIL, idx);
+        return;
+    }
+    int g = find_global_index(gen, name);
+    if (g >= 0) {
+        int src = value ? gen_expr(gen, value, -1) : pick_dst(gen, -1);
+        if (!value) emit(gen, BC_LOAD_NIL, src);
+        int at = emit(gen, BC_STORE_NAME, src);
+        gen->bytecode->codes[at].operand.var_index = g;
+        return;
+    }
+    vm_unsupported(gen, target, "assignment to an undeclared name");
+}
+
+static int gen_assign(ByteCodeGen* gen, ASTNode* node) {
+    ASTNode* left = node->data.assign.left;
+    ASTNode* right = node->data.assign.right;
+    if (!left || !right) return -1;
+
+    if (left->type == AST_IDENTIFIER) {
+        gen_store_ident(gen, left, right);
+        int idx = get_variable_index(gen, left->data.identifier.name);
+        return idx >= 0 ? idx : -1;
+    }
+
+    if (left->type == AST_INDEX) {
+        int target = gen_expr(gen, left->data.index.target, -1);
+        int index = gen_expr(gen, left->data.index.index, -1);
+        int value = gen_expr(gen, right, -1);
+        int at = emit(gen, BC_INDEX_SET, -1);
+        gen->bytecode->codes[at].operand.index_args.target_index = target;
+        gen->bytecode->codes[at].operand.index_args.index_index = index;
+        gen->bytecode->codes[at].operand.index_args.result_index = value;
+        return value;
+    }
+
+    vm_unsupported(gen, node, "this kind of assignment target");
+    return -1;
+}
+
+static ByteCodeInstruction binop_to_bc(BinOpType op) {
+    switch (op) {
+        case OP_ADD: return BC_ADD;
+        case OP_SUB: return BC_SUB;
+        case OP_MUL: return BC_MUL;
+        case OP_DIV: return BC_DIV;
+        case OP_MOD: return BC_MOD;
+        case OP_POW: return BC_POW;
+        case OP_CONCAT: return BC_CONCAT;
+        case OP_REPEAT: return BC_REPEAT;
+        case OP_EQ: return BC_EQ;
+        case OP_NE: return BC_NE;
+        case OP_LT: return BC_LT;
+        case OP_LE: return BC_LE;
+        case OP_GT: return BC_GT;
+        case OP_GE: return BC_GE;
+        case OP_AND: return BC_AND;
+        case OP_OR: return BC_OR;
+    }
+    return BC_ADD;
+}
+
+/* 顶层函数声明的返回位宽，找不到或没写返回 0 */
+static int function_ret_bits(ByteCodeGen* gen, const char* name) {
+    ASTNode* prog = gen->program;
+    if (!name || !prog || prog->type != AST_PROGRAM) return 0;
+    for (int i = 0; i < prog->data.program.statement_count; i++) {
+        ASTNode* s = prog->data.program.statements[i];
+        if (s && s->type == AST_FUNCTION && !s->data.function.is_extern && s->data.function.name &&
+            strcmp(s->data.function.name, name) == 0) {
+            return int_type_bits(s->data.function.return_type);
+        }
+    }
+    return 0;
+}
+
+/* 表达式运行时一定是几位的整数 (8/32/64)，和虚拟机的标记规则一致；编译期定不下来返回 0 */
+static int static_int_bits(ByteCodeGen* gen, ASTNode* node) {
+    if (!node) return 0;
+    switch (node->type) {
+        case AST_NUM_INT:
+            return node->data.num_int.value == (int)node->data.num_int.value ? 32 : 64;
+        case AST_IDENTIFIER: {
+            int idx = get_variable_index(gen, node->data.identifier.name);
+            return idx >= 0 ? gen->var_bits[idx] : 0;
+        }
+        case AST_BINOP: {
+            BinOpType op = node->data.binop.op;
+            if (op != OP_ADD && op != OP_SUB && op != OP_MUL && op != OP_DIV && op != OP_MOD) return 0;
+            int l = static_int_bits(gen, node->data.binop.left);
+            int r = static_int_bits(gen, node->data.binop.right);
+            if (!l || !r) return 0;
+            return l == 64 || r == 64 ? 64 : 32;
+        }
+        case AST_UNARYOP: {
+            int b = static_int_bits(gen, node->data.unaryop.expr);
+            if (node->data.unaryop.op == OP_MINUS) return b ? (b == 64 ? 64 : 32) : 0;
+            return node->data.unaryop.op == OP_PLUS ? b : 0;
+        }
+        case AST_TOINT:
+            return 32;
+        case AST_MEMBER_ACCESS: {
+            const char* field = ident_name(node->data.member_access.field);
+            return field && strcmp(field, "length") == 0 ? 64 : 0;
+        }
+        case AST_CALL:
+            return function_ret_bits(gen, ident_name(node->data.call.func));
+        default:
+            return 0;
+    }
+}
+
+/* 两边位宽在编译期都知道时换成定宽的指令，运行时不用再按标记决定截不截断 */
+static ByteCodeInstruction typed_binop(ByteCodeGen* gen, ASTNode* node) {
+    ByteCodeInstruction op = binop_to_bc(node->data.binop.op);
+    if (op != BC_ADD && op != BC_SUB && op != BC_MUL) return op;
+    int l = static_int_bits(gen, node->data.binop.left);
+    int r = static_int_bits(gen, node->data.binop.right);
+    if (!l || !r) return op;
+    int wide = l == 64 || r == 64;
+    switch (op) {
+        case BC_ADD: return wide ? BC_ADD_I64 : BC_ADD_I32;
+        case BC_SUB: return wide ? BC_SUB_I64 : BC_SUB_I32;
+        default: return wide ? BC_MUL_I64 : BC_MUL_I32;
+    }
+}
+
+static int gen_call(ByteCodeGen* gen, ASTNode* node, int dst) {
+    ASTNode* func = node->data.call.func;
+    ASTNode* args = node->data.call.args;
+    int argc = (args && args->type == AST_EXPRESSION_LIST) ? args->data.expression_list.expression_count : 0;
+
+    if (func && func->type == AST_MEMBER_ACCESS) {
+        const char* method = ident_name(func->data.member_access.field);
+        if (method && (strcmp(method, "push") == 0 || strcmp(method, "push!") == 0) && argc == 1) {
+            int list = gen_expr(gen, func->data.member_access.object, -1);
+            int value = gen_expr(gen, args->data.expression_list.expressions[0], -1);
+            emit_triaddr(gen, BC_LIST_PUSH, -1, list, value);
+            if (dst >= 0) {
+                emit_triaddr(gen, BC_MOVE, dst, list, -1);
+                return dst;
+            }
+            return list;
+        }
+        vm_unsupported(gen, node, "this method call");
+        return pick_dst(gen, dst);
+    }
+
+    const char* name = ident_name(func);
+    if (!name) {
+        vm_unsupported(gen, node, "calling a function value");
+        return pick_dst(gen, dst);
+    }
+    if (vector_type_info(name, NULL, NULL)) {
+        vm_unsupported(gen, node, "SIMD vector types");
+        return pick_dst(gen, dst);
+    }
+    if (strcmp(name, "StringBuilder") == 0) {
+        vm_unsupported(gen, node, "StringBuilder");
+        return pick_dst(gen, dst);
+    }
+
+    /* Some/Ok/Err 直接传 payload，None 为 0，和 LLVM 后端一致 */
+    if (strcmp(name, "Some") == 0 || strcmp(name, "None") == 0 ||
+        strcmp(name, "Ok") == 0 || strcmp(name, "Err") == 0) {
+        if (argc <= 0) {
+            int d = pick_dst(gen, dst);
+            int at = emit(gen, BC_LOAD_CONST_INT, d);
+            gen->bytecode->codes[at].operand.int_value = 0;
+            return d;
+        }
+        return gen_expr(gen, args->data.expression_list.expressions[0], dst);
+    }
+
+    int* arg_regs = argc > 0 ? malloc(sizeof(int) * argc) : NULL;
+    int* arg_bits = argc > 0 ? malloc(sizeof(int) * argc) : NULL;
+    for (int i = 0; i < argc; i++) {
+        arg_regs[i] = gen_expr(gen, args->data.expression_list.expressions[i], -1);
+        arg_bits[i] = static_int_bits(gen, args->data.expression_list.expressions[i]);
+    }
+    int d = pick_dst(gen, dst);
+    int at = emit(gen, BC_CALL, -1);
+    CallArgs* ca = &gen->bytecode->codes[at].operand.call_args;
+    ca->name = strdup(name);
+    ca->arg_indices = arg_regs;
+    ca->arg_bits = arg_bits;
+    ca->arg_count = argc;
+    ca->result_index = d;
+    ca->func_index = -1;
+    return d;
+}
+
+static int gen_expr(ByteCodeGen* gen, ASTNode* node, int dst) {
+    if (!node) {
+        int d = pick_dst(gen, dst);
+        emit(gen, BC_LOAD_NIL, d);
+        return d;
+    }
+
+    switch (node->type) {
+        case AST_NUM_INT: {
+            int d = pick_dst(gen, dst);
+            long long v = node->data.num_int.value;
+            int at = emit(gen, v == (int)v ? BC_LOAD_CONST_INT : BC_LOAD_CONST_I64, d);
+            gen->bytecode->codes[at].operand.int_value = v;
+            return d;
+        }
+        case AST_NUM_FLOAT: {
+            int d = pick_dst(gen, dst);
+            int at = emit(gen, BC_LOAD_CONST_FLOAT, d);
+            gen->bytecode->codes[at].operand.float_value = node->data.num_float.value;
+            return d;
+        }
+        case AST_CHAR: {
+            int d = pick_dst(gen, dst);
+            int at = emit(gen, BC_LOAD_CONST_CHAR, d);
+            gen->bytecode->codes[at].operand.int_value = (unsigned char)node->data.character.value;
+            return d;
+        }
+        case AST_STRING: {
+            int d = pick_dst(gen, dst);
+            int at = emit(gen, BC_LOAD_CONST_STRING, d);
+            gen->bytecode->codes[at].operand.string_value = strdup(node->data.string.value ? node->data.string.value : "");
+            return d;
+        }
+        case AST_NIL: {
+            int d = pick_dst(gen, dst);
+            emit(gen, BC_LOAD_NIL, d);
+            return d;
+        }
+        case AST_IDENTIFIER: {
+            const char* name = node->data.identifier.name;
+            int idx = get_variable_index(gen, name);
+            if (idx >= 0) {
+                if (dst < 0 || dst == idx) return idx;
+                emit_triaddr(gen, BC_MOVE, dst, idx, -1);
+                return dst;
+            }
+            int g = find_global_index(gen, name);
+            if (g >= 0) {
+                int d = pick_dst(gen, dst);
+                int at = emit(gen, BC_LOAD_NAME, d);
+                gen->bytecode->codes[at].operand.var_index = g;
+                return d;
+            }
+            vm_unsupported(gen, node, "an undeclared identifier");
+            return pick_dst(gen, dst);
+        }
+        case AST_BINOP: {
+            int l = gen_expr(gen, node->data.binop.left, -1);
+            int r = gen_expr(gen, node->data.binop.right, -1);
+            int d = pick_dst(gen, dst);
+            emit_triaddr(gen, typed_binop(gen, node), d, l, r);
+            return d;
+        }
+        case AST_UNARYOP: {
+            if (node->data.unaryop.op != OP_MINUS && node->data.unaryop.op != OP_PLUS) {
+                vm_unsupported(gen, node, "pointer operations");
+                return pick_dst(gen, dst);
+            }
+            int src = gen_expr(gen, node->data.unaryop.expr, -1);
+            int d = pick_dst(gen, dst);
+            emit_triaddr(gen, node->data.unaryop.op == OP_MINUS ? BC_NEG : BC_POS, d, src, -1);
+            return d;
+        }
+        case AST_ASSIGN: {
+            int r = gen_assign(gen, node);
+            if (dst >= 0 && r >= 0 && r != dst) {
+                emit_triaddr(gen, BC_MOVE, dst, r, -1);
+                return dst;
+            }
+            return r >= 0 ? r : pick_dst(gen, dst);
+        }
+        case AST_CALL:
+            return gen_call(gen, node, dst);
+        case AST_INDEX: {
+            int target = gen_expr(gen, node->data.index.target, -1);
+            int index = gen_expr(gen, node->data.index.index, -1);
+            int d = pick_dst(gen, dst);
+            int at = emit(gen, BC_INDEX, -1);
+            gen->bytecode->codes[at].operand.index_args.target_index = target;
+            gen->bytecode->codes[at].operand.index_args.index_index = index;
+            gen->bytecode->codes[at].operand.index_args.result_index = d;
+            return d;
+        }
+        case AST_MEMBER_ACCESS: {
+            const char* field = ident_name(node->data.member_access.field);
+            if (field && strcmp(field, "length") == 0) {
+                int obj = gen_expr(gen, node->data.member_access.object, -1);
+                int d = pick_dst(gen, dst);
+                emit_triaddr(gen, BC_LENGTH, d, obj, -1);
+                return d;
+            }
+            vm_unsupported(gen, node, "struct field access");
+            return pick_dst(gen, dst);
+        }
+        case AST_EXPRESSION_LIST: {
+            /* 先建在临时寄存器里，避免 a = [a[0]] 这种先覆盖了 a */
+            int count = node->data.expression_list.expression_count;
+            int tmp = new_tmp(gen);
+            int at = emit(gen, BC_LIST_NEW, tmp);
+            gen->bytecode->codes[at].operand.int_value = count;
+            for (int i = 0; i < count; i++) {
+                int e = gen_expr(gen, node->data.expression_list.expressions[i], -1);
+                emit_triaddr(gen, BC_LIST_PUSH, -1, tmp, e);
+            }
+            if (dst >= 0) {
+                emit_triaddr(gen, BC_MOVE, dst, tmp, -1);
+                return dst;
+            }
+            return tmp;
+        }
+        case AST_INPUT: {
+            int prompt = gen_expr(gen, node->data.input.prompt, -1);
+            int d = pick_dst(gen, dst);
+            emit_triaddr(gen, BC_INPUT, d, prompt, -1);
+            return d;
+        }
+        case AST_TOINT: {
+            int src = gen_expr(gen, node->data.toint.expr, -1);
+            int d = pick_dst(gen, dst);
+            emit_triaddr(gen, BC_TOINT, d, src, -1);
+            return d;
+        }
+        case AST_TOFLOAT: {
+            int src = gen_expr(gen, node->data.tofloat.expr, -1);
+            int d = pick_dst(gen, dst);
+            emit_triaddr(gen, BC_TOFLOAT, d, src, -1);
+            return d;
+        }
+        case AST_FUNCTION:
+            vm_unsupported(gen, node, "a function value");
+            return pick_dst(gen, dst);
+        case AST_STRUCT_LITERAL:
+            vm_unsupported(gen, node, "a struct literal");
+            return pick_dst(gen, dst);
+        default:
+            vm_unsupported(gen, node, "this expression");
+            return pick_dst(gen, dst);
+    }
+}
+
+static void gen_loop_body(ByteCodeGen* gen, ASTNode* body, int* saved_break, int* saved_continue) {
+    *saved_break = gen->loop_break_base;
+    *saved_continue = gen->loop_continue_base;
+    gen->loop_break_base = gen->break_count;
+    gen->loop_continue_base = gen->continue_count;
+    gen_stmt(gen, body);
+}
+
+static void close_loop(ByteCodeGen* gen, int continue_target, int break_target, int saved_break, int saved_continue) {
+    for (int i = gen->loop_continue_base; i < gen->continue_count; i++) {
+        patch_jump(gen, gen->continue_patches[i], continue_target);
+    }
+    for (int i = gen->loop_break_base; i < gen->break_count; i++) {
+        patch_jump(gen, gen->break_patches[i], break_target);
+    }
+    gen->continue_count = gen->loop_continue_base;
+    gen->break_count = gen->loop_break_base;
+    gen->loop_break_base = saved_break;
+    gen->loop_continue_base = saved_continue;
+}
+
+static void gen_for(ByteCodeGen* gen, ASTNode* node) {
+    const char* name = ident_name(node->data.for_stmt.var);
+    int var = get_variable_index(gen, name);
+    if (var < 0) {
+        vm_unsupported(gen, node, "this for loop variable");
+        return;
+    }
+
+    int counter, end, list = -1;
+    if (node->data.for_stmt.end) {
+        counter = var;
+        gen_expr(gen, node->data.for_stmt.start, counter);
+        end = new_tmp(gen);
+        gen_expr(gen, node->data.for_stmt.end, end);
+    } else {
+        list = new_tmp(gen);
+        gen_expr(gen, node->data.for_stmt.start, list);
+        end = new_tmp(gen);
+        emit_triaddr(gen, BC_LENGTH, end, list, -1);
+        counter = new_tmp(gen);
+        int at = emit(gen, BC_LOAD_CONST_INT, counter);
+        gen->bytecode->codes[at].operand.int_value = 0;
+    }
+    int step = new_tmp(gen);
+
+    int prep = emit(gen, BC_FOR_PREPARE, -1);
+    ForArgs* fa = &gen->bytecode->codes[prep].operand.for_args;
+    fa->var_index = counter;
+    fa->end_index = end;
+    fa->step_index = step;
+
+    int body_start = gen->bytecode->count;
+    if (list >= 0) {
+        int at = emit(gen, BC_INDEX, -1);
+        gen->bytecode->codes[at].operand.index_args.target_index = list;
+        gen->bytecode->codes[at].operand.index_args.index_index = counter;
+        gen->bytecode->codes[at].operand.index_args.result_index = var;
+    }
+
+    int saved_break, saved_continue;
+    gen_loop_body(gen, node->data.for_stmt.body, &saved_break, &saved_continue);
+
+    int cont = emit(gen, BC_FOR_LOOP, -1);
+    fa = &gen->bytecode->codes[cont].operand.for_args;
+    fa->var_index = counter;
+    fa->end_index = end;
+    fa->step_index = step;
+    fa->address = body_start;
+
+    int exit = gen->bytecode->count;
+    patch_jump(gen, prep, exit);
+    close_loop(gen, cont, exit, saved_break, saved_continue);
+}
+
+static void gen_function(ByteCodeGen* gen, ASTNode* node) {
+    if (node->data.function.is_extern || !node->data.function.name) return;
+
+    char** saved_vars = gen->variables;
+    int* saved_var_bits = gen->var_bits;
+    int saved_count = gen->var_count;
+    int saved_capacity = gen->var_capacity;
+    int saved_tmp = gen->tmp_counter;
+    int saved_max = gen->max_regs;
+    int saved_in_function = gen->in_function;
+    int saved_ret_bits = gen->ret_bits;
+
+    gen->variables = NULL;
+    gen->var_bits = NULL;
+    gen->var_count = 0;
+    gen->var_capacity = 0;
+    gen->tmp_counter = 0;
+    gen->in_function = 1;
+
+    int def = emit(gen, BC_FUNCTION_DEF, -1);
+    int skip = emit(gen, BC_JUMP, -1);
+
+    ASTNode* params = node->data.function.params;
+    int param_count = (params && params->type == AST_EXPRESSION_LIST) ? params->data.expression_list.expression_count : 0;
+    int* param_regs = param_count > 0 ? malloc(sizeof(int) * param_count) : NULL;
+    int* param_bits = param_count > 0 ? calloc((size_t)param_count, sizeof(int)) : NULL;
+    for (int i = 0; i < param_count; i++) {
+        ASTNode* p = params->data.expression_list.expressions[i];
+        const char* pname = ident_name(p);
+        if (!pname && p && p->type == AST_ASSIGN) {
+            pname = ident_name(p->data.assign.left);
+            param_bits[i] = int_type_bits(p->data.assign.right);
+        }
+        char anon[32];
+        if (!pname) {
+            snprintf(anon, sizeof(anon), "__arg%d", i);
+            pname = anon;
+        }
+        /* 同名参数也占一个槽，保证参数 i 在寄存器 i */
+        if (get_variable_index(gen, pname) >= 0) {
+            snprintf(anon, sizeof(anon), "__arg%d", i);
+            pname = anon;
+        }
+        param_regs[i] = declare_variable(gen, pname);
+        gen->var_bits[param_regs[i]] = param_bits[i];
+    }
+    collect_locals(gen, node->data.function.body);
+    gen->max_regs = gen->var_count;
+
+    FunctionDefArgs* fd = &gen->bytecode->codes[def].operand.func_def_args;
+    fd->name = strdup(node->data.function.name);
+    fd->param_indices = param_regs;
+    fd->param_bits = param_bits;
+    fd->param_count = param_count;
+    gen->ret_bits = int_type_bits(node->data.function.return_type);
+    fd->entry_point = gen->bytecode->count;
+
+    gen_stmt(gen, node->data.function.body);
+    int ret = emit(gen, BC_RETURN, -1);
+    gen->bytecode->codes[ret].operand.int_value = gen->ret_bits;
+
+    fd = &gen->bytecode->codes[def].operand.func_def_args;
+    fd->frame_size = gen->max_regs > 0 ? gen->max_regs : 1;
+    patch_jump(gen, skip, gen->bytecode->count);
+
+    free_name_list(gen->variables, gen->var_count);
+    free(gen->var_bits);
+    gen->variables = saved_vars;
+    gen->var_bits = saved_var_bits;
+    gen->var_count = saved_count;
+    gen->var_capacity = saved_capacity;
+    gen->tmp_counter = saved_tmp;
+    gen->max_regs = saved_max;
+    gen->in_function = saved_in_function;
+    gen->ret_bits = saved_ret_bits;
+}
+
+static void gen_stmt(ByteCodeGen* gen, ASTNode* node) {
+    if (!node) return;
+    int mark = gen->tmp_counter;
+    if (node->location.first_line > 0) gen->cur_line = node->location.first_line;
+    if (!gen->bytecode->source_file && node->source_file) gen->bytecode->source_file = node->source_file;
+
+    switch (node->type) {
+        case AST_PROGRAM:
+            for (int i = 0; i < node->data.program.statement_count; i++) {
+                gen_stmt(gen, node->data.program.statements[i]);
+            }
+            break;
+        case AST_PRINT: {
+            ASTNode* expr = node->data.print.expr;
+            int count = (expr && expr->type == AST_EXPRESSION_LIST) ? expr->data.expression_list.expression_count : 1;
+            int* regs = malloc(sizeof(int) * (count > 0 ? count : 1));
+            if (expr && expr->type == AST_EXPRESSION_LIST) {
+                for (int i = 0; i < count; i++) {
+                    regs[i] = gen_expr(gen, expr->data.expression_list.expressions[i], -1);
+                }
+            } else {
+                regs[0] = gen_expr(gen, expr, -1);
+            }
+            int at = emit(gen, BC_PRINT, -1);
+            gen->bytecode->codes[at].operand.print_args.arg_indices = regs;
+            gen->bytecode->codes[at].operand.print_args.arg_count = count;
+            break;
+        }
+        case AST_ASSIGN:
+        case AST_CONST:
+            if (node->data.assign.is_declaration == 2) break;
+            gen_assign(gen, node);
+            break;
+        case AST_GLOBAL:
+            gen_store_ident(gen, node->data.global_decl.identifier, node->data.global_decl.initializer);
+            break;
+        case AST_IF: {
+            int cond = gen_expr(gen, node->data.if_stmt.condition, -1);
+            int jf = emit(gen, BC_JUMP_IF_FALSE, cond);
+            gen_stmt(gen, node->data.if_stmt.then_body);
+            if (node->data.if_stmt.else_body) {
+                int jend = emit(gen, BC_JUMP, -1);
+                patch_jump(gen, jf, gen->bytecode->count);
+                gen_stmt(gen, node->data.if_stmt.else_body);
+                patch_jump(gen, jend, gen->bytecode->count);
+            } else {
+                patch_jump(gen, jf, gen->bytecode->count);
+            }
+            break;
+        }
+        case AST_MATCH:
+            gen_stmt(gen, lower_match_to_if(node));
+            break;
+        case AST_WHILE: {
+            int top = gen->bytecode->count;
+            int cond = gen_expr(gen, node->data.while_stmt.condition, -1);
+            int jf = emit(gen, BC_JUMP_IF_FALSE, cond);
+            int saved_break, saved_continue;
+            gen_loop_body(gen, node->data.while_stmt.body, &saved_break, &saved_continue);
+            int back = emit(gen, BC_JUMP, -1);
+            patch_jump(gen, back, top);
+            int exit = gen->bytecode->count;
+            patch_jump(gen, jf, exit);
+            close_loop(gen, top, exit, saved_break, saved_continue);
+            break;
+        }
+        case AST_FOR:
+            gen_for(gen, node);
+            break;
+        case AST_BREAK:
+        case AST_CONTINUE: {
+            if (gen->loop_break_base < 0) {
+                vm_unsupported(gen, node, "break/continue outside of a loop");
+                break;
+            }
+            int at = emit(gen, BC_JUMP, -1);
+            if (node->type == AST_BREAK) {
+                push_patch(&gen->break_patches, &gen->break_count, &gen->break_capacity, at);
+            } else {
+                push_patch(&gen->continue_patches, &gen->continue_count, &gen->continue_capacity, at);
+            }
+            break;
+        }
+        case AST_RETURN: {
+            int r = node->data.return_stmt.expr ? gen_expr(gen, node->data.return_stmt.expr, -1) : -1;
+            int at = emit(gen, gen->in_function ? BC_RETURN : BC_HALT, r);
+            /* 返回值的位宽编译期就和声明一致时不用再截断 */
+            if (gen->in_function && static_int_bits(gen, node->data.return_stmt.expr) != gen->ret_bits) {
+                gen->bytecode->codes[at].operand.int_value = gen->ret_bits;
+            }
+            break;
+        }
+        case AST_FUNCTION:
+            gen_function(gen, node);
+            break;
+        case AST_STRUCT_DEF:
+        case AST_IMPORT:
+            break;
+        default:
+            gen_expr(gen, node, -1);
+            break;
+    }
+
+    gen->tmp_counter = mark;
+}
+
+void generate_bytecode(ByteCodeGen* gen, ASTNode* node) {
+    gen_stmt(gen, node);
+}
+
+void generate_bytecode_print(ByteCodeGen* gen, ASTNode* node) {
+    gen_stmt(gen, node);
+}
+
+static int function_has_main(ASTNode* node) {
+    if (!node) return 0;
+    if (node->type == AST_FUNCTION) {
+        return node->data.function.name && strcmp(node->data.function.name, "main") == 0 &&
+               !node->data.function.is_extern;
+    }
+    if (node->type == AST_PROGRAM) {
+        for (int i = 0; i < node->data.program.statement_count; i++) {
+            if (function_has_main(node->data.program.statements[i])) return 1;
+        }
+    }
+    return 0;
+}
+
+void generate_bytecode_program(ByteCodeGen* gen, ASTNode* node) {
+    gen->in_function = 0;
+    gen->program = node;
+    gen->loop_break_base = -1;
+    gen->loop_continue_base = -1;
+    collect_locals(gen, node);
+    gen->max_regs = gen->var_count;
+    gen->globals = gen->variables;
+    gen->global_count = gen->var_count;
+
+    gen_stmt(gen, node);
+
+    int exit_reg = -1;
+    if (function_has_main(node)) {
+        exit_reg = new_tmp(gen);
+        int at = emit(gen, BC_CALL, -1);
+        CallArgs* ca = &gen->bytecode->codes[at].operand.call_args;
+        ca->name = strdup("main");
+        ca->result_index = exit_reg;
+        ca->func_index = -1;
+    }
+    emit(gen, BC_HALT, exit_reg);
+    gen->bytecode->entry_frame_size = gen->max_regs > 0 ? gen->max_regs : 1;
+}
+
+/* 把 CALL 的函数名解析成 FUNCTION_DEF 的位置，找不到返回错误数 */
+int finalize_bytecode(ByteCodeGen* gen) {
+    ByteCodeList* list = gen->bytecode;
+    for (int i = 0; i < list->count; i++) {
+        if (list->codes[i].op != BC_CALL) continue;
+        CallArgs* ca = &list->codes[i].operand.call_args;
+        for (int j = 0; j < list->count; j++) {
+            if (list->codes[j].op == BC_FUNCTION_DEF &&
+                strcmp(list->codes[j].operand.func_def_args.name, ca->name) == 0) {
+                ca->func_index = j;
+                break;
+            }
+        }
+        if (ca->func_index < 0) {
+            char msg[256];
+            snprintf(msg, sizeof(msg), "vm: function '%s' is not defined (extern functions need the native backend)", ca->name);
+            report_semantic_error_with_location(msg, "unknown", 0);
+            gen->error_count++;
+        } else if (list->codes[ca->func_index].operand.func_def_args.param_count != ca->arg_count) {
+            char msg[256];
+            snprintf(msg, sizeof(msg), "vm: function '%s' expects %d argument(s) but got %d", ca->name,
+                     list->codes[ca->func_index].operand.func_def_args.param_count, ca->arg_count);
+            report_semantic_error_with_location(msg, "unknown", 0);
+            gen->error_count++;
+        } else {
+            FunctionDefArgs* fd = &list->codes[ca->func_index].operand.func_def_args;
+            for (int k = 0; k < ca->arg_count; k++) {
+                int bits = fd->param_bits ? fd->param_bits[k] : 0;
+                if (bits && bits != ca->arg_bits[k]) ca->wrap_args = 1;
+            }
+        }
+    }
+    return gen->error_count;
+}
+
+static const char* bc_names[BC_OP_COUNT] = {
+    [BC_LOAD_CONST_INT] = "LOAD_CONST_INT",
+    [BC_LOAD_CONST_FLOAT] = "LOAD_CONST_FLOAT",
+    [BC_LOAD_CONST_STRING] = "LOAD_CONST_STRING",
+    [BC_LOAD_CONST_CHAR] = "LOAD_CONST_CHAR",
+    [BC_LOAD_NAME] = "LOAD_NAME",
+    [BC_STORE_NAME] = "STORE_NAME",
+    [BC_PRINT] = "PRINT",
+    [BC_INPUT] = "INPUT",
+    [BC_TOINT] = "TOINT",
+    [BC_TOFLOAT] = "TOFLOAT",
+    [BC_ADD] = "ADD",
+    [BC_SUB] = "SUB",
+    [BC_MUL] = "MUL",
+    [BC_DIV] = "DIV",
+    [BC_MOD] = "MOD",
+    [BC_POW] = "POW",
+    [BC_CONCAT] = "CONCAT",
+    [BC_REPEAT] = "REPEAT",
+    [BC_NEG] = "NEG",
+    [BC_POS] = "POS",
+    [BC_EQ] = "EQ",
+    [BC_NE] = "NE",
+    [BC_LT] = "LT",
+    [BC_LE] = "LE",
+    [BC_GT] = "GT",
+    [BC_GE] = "GE",
+    [BC_AND] = "AND",
+    [BC_OR] = "OR",
+    [BC_JUMP] = "JUMP",
+    [BC_JUMP_IF_FALSE] = "JUMP_IF_FALSE",
+    [BC_BREAK] = "BREAK",
+    [BC_CONTINUE] = "CONTINUE",
+    [BC_FOR_PREPARE] = "FOR_PREPARE",
+    [BC_FOR_LOOP] = "FOR_LOOP",
+    [BC_FUNCTION_DEF] = "FUNCTION_DEF",
+    [BC_CALL] = "CALL",
+    [BC_RETURN] = "RETURN",
+    [BC_ADDRESS] = "ADDRESS",
+    [BC_DEREF] = "DEREF",
+    [BC_INDEX] = "INDEX",
+    [BC_STRUCT_DEF] = "STRUCT_DEF",
+    [BC_STRUCT_CREATE] = "STRUCT_CREATE",
+    [BC_STRUCT_GET_FIELD] = "STRUCT_GET_FIELD",
+    [BC_STRUCT_SET_FIELD] = "STRUCT_SET_FIELD",
+    [BC_MOVE] = "MOVE",
+    [BC_LOAD_NIL] = "LOAD_NIL",
+    [BC_LIST_NEW] = "LIST_NEW",
+    [BC_LIST_PUSH] = "LIST_PUSH",
+    [BC_INDEX_SET] = "INDEX_SET",
+    [BC_LENGTH] = "LENGTH",
+    [BC_LOAD_CONST_I64] = "LOAD_CONST_I64",
+    [BC_ADD_I32] = "ADD_I32",
+    [BC_ADD_I64] = "ADD_I64",
+    [BC_SUB_I32] = "SUB_I32",
+    [BC_SUB_I64] = "SUB_I64",
+    [BC_MUL_I32] = "MUL_I32",
+    [BC_MUL_I64] = "MUL_I64",
+    [BC_HALT] = "HALT",
+};
+
+void print_bytecode_to_file(ByteCodeList* list, FILE* output) {
+    if (!list || !output) return;
+    fprintf(output, "; frame %d\n", list->entry_frame_size);
+    for (int i = 0; i < list->count; i++) {
+        ByteCode* bc = &list->codes[i];
+        const char* name = (bc->op < BC_OP_COUNT && bc_names[bc->op]) ? bc_names[bc->op] : "?";
+        fprintf(output, "%04d  %-18s", i, name);
+        switch (bc->op) {
+            case BC_LOAD_CONST_INT:
+            case BC_LOAD_CONST_I64:
+            case BC_LOAD_CONST_CHAR:
+            case BC_LIST_NEW:
+                fprintf(output, "r%d, %lld", bc->reg, bc->operand.int_value);
+                break;
+            case BC_LOAD_CONST_FLOAT:
+                fprintf(output, "r%d, %g", bc->reg, bc->operand.float_value);
+                break;
+            case BC_LOAD_CONST_STRING:
+                fprintf(output, "r%d, \"%s\"", bc->reg, bc->operand.string_value);
+                break;
+            case BC_LOAD_NIL:
+            case BC_RETURN:
+            case BC_HALT:
+                fprintf(output, "r%d", bc->reg);
+                break;
+            case BC_LOAD_NAME:
+            case BC_STORE_NAME:
+                fprintf(output, "r%d, g%d", bc->reg, bc->operand.var_index);
+                break;
+            case BC_PRINT:
+                for (int j = 0; j < bc->operand.print_args.arg_count; j++) {
+                    fprintf(output, "%sr%d", j ? ", " : "", bc->operand.print_args.arg_indices[j]);
+                }
+                break;
+            case BC_JUMP:
+                fprintf(output, "@%d", bc->operand.jump_args.address);
+                break;
+            case BC_JUMP_IF_FALSE:
+                fprintf(output, "r%d, @%d", bc->reg, bc->operand.jump_args.address);
+                break;
+            case BC_FOR_PREPARE:
+            case BC_FOR_LOOP:
+                fprintf(output, "r%d, r%d, r%d, @%d", bc->operand.for_args.var_index, bc->operand.for_args.end_index,
+                        bc->operand.for_args.step_index, bc->operand.for_args.address);
+                break;
+            case BC_FUNCTION_DEF:
+                fprintf(output, "%s/%d entry=@%d frame=%d", bc->operand.func_def_args.name,
+                        bc->operand.func_def_args.param_count, bc->operand.func_def_args.entry_point,
+                        bc->operand.func_def_args.frame_size);
+                break;
+            case BC_CALL:
+                fprintf(output, "r%d = %s(", bc->operand.call_args.result_index, bc->operand.call_args.name);
+                for (int j = 0; j < bc->operand.call_args.arg_count; j++) {
+                    fprintf(output, "%sr%d", j ? ", " : "", bc->operand.call_args.arg_indices[j]);
+                }
+                fprintf(output, ")");
+                break;
+            case BC_INDEX:
+                fprintf(output, "r%d = r%d[r%d]", bc->operand.index_args.result_index,
+                        bc->operand.index_args.target_index, bc->operand.index_args.index_index);
+                break;
+            case BC_INDEX_SET:
+                fprintf(output, "r%d[r%d] = r%d", bc->operand.index_args.target_index,
+                        bc->operand.index_args.index_index, bc->operand.index_args.result_index);
+                break;
+            default:
+                fprintf(output, "r%d, r%d, r%d", bc->operand.triaddr.result,
+                        bc->operand.triaddr.operand1, bc->operand.triaddr.operand2);
+                break;
+        }
+        fprintf(output, "\n");
+    }
+}
+
+void print_bytecode(ByteCodeList* list) {
+    print_bytecode_to_file(list, stdout);
+}
@@ -0,0 +1,1040 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include "../../include/vm.h"
+#include "../../include/compiler.h"
+
+/*
+vixc run 用的寄存器虚拟机
+所有帧共用一块连续的寄存器栈，帧 0 是顶层（全局变量就在这里），
+CALL 把参数拷进新帧的前几个寄存器，RETURN 把值写回调用者的目标寄存器。
+GCC/Clang 下用 computed goto 分派，其它编译器退回 switch。
+
+整数和原生代码一样分 i32 / i64：能放进 i32 的字面量是 VM_INT，否则 VM_I64，
+两个 VM_INT 的运算在 32 位上回绕，有一边是 VM_I64 就在 64 位上回绕。
+运算都在无符号上做再截回去，不碰有符号溢出；参数和返回值按声明的位宽截断。
+*/
+
+#if defined(__GNUC__) || defined(__clang__)
+#define VM_COMPUTED_GOTO 1
+#endif
+
+#define VM_MAX_FRAMES 1000000
+#define VM_GC_MIN 1024    // 运行期字符串 + 列表攒到这么多才第一次回收
+
+typedef enum {
+    VM_NIL = 0,
+    VM_INT,
+    VM_I64,
+    VM_FLOAT,
+    VM_CHAR,
+    VM_STR,
+    VM_LIST
+} VMTag;
+
+typedef struct VMList VMList;
+
+typedef struct {
+    VMTag tag;
+    union {
+        long long i;
+        double f;
+        const char* s;
+        VMList* l;
+    } as;
+} VMValue;
+
+struct VMList {
+    VMValue* items;
+    long long len;
+    long long cap;
+    int mark;
+};
+
+typedef struct {
+    int ret_pc;
+    int base;
+    int size;
+    int result;
+} VMFrame;
+
+typedef struct {
+    ByteCodeList* code;
+    VMValue* regs;
+    long long reg_cap;
+    VMFrame* frames;
+    int frame_count;
+    int frame_cap;
+    char** strs;      // 运行期拼出来的字符串，vm_collect 回收不可达的，退出时释放剩下的
+    int str_count;
+    int str_cap;
+    VMList** lists;
+    int list_count;
+    int list_cap;
+    int gc_next;      // strs + lists 到这个数就回收一次
+    const char** live;  // vm_collect 的临时表：寄存器和列表里还能看到的字符串
+    size_t live_count;
+    size_t live_cap;
+} VM;
+
+static int vm_error(VM* vm, int pc, const char* fmt, ...) {
+    char msg[512];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+    int line = (pc >= 0 && pc < vm->code->count) ? vm->code->codes[pc].line : 0;
+    fflush(stdout);
+    report_runtime_error_with_location(msg, vm->code->source_file, line);
+    return -1;
+}
+
+static int vm_ensure_regs(VM* vm, long long need) {
+    if (need <= vm->reg_cap) return 0;
+    long long cap = vm->reg_cap ? vm->reg_cap : 256;
+    while (cap < need) cap *= 2;
+    VMValue* regs = realloc(vm->regs, sizeof(VMValue) * cap);
+    if (!regs) return -1;
+    memset(regs + vm->reg_cap, 0, sizeof(VMValue) * (cap - vm->reg_cap));
+    vm->regs = regs;
+    vm->reg_cap = cap;
+    return 0;
+}
+
+static int vm_push_frame(VM* vm, int ret_pc, int base, int size, int result) {
+    if (vm->frame_count >= vm->frame_cap) {
+        int cap = vm->frame_cap ? vm->frame_cap * 2 : 64;
+        VMFrame* frames = realloc(vm->frames, sizeof(VMFrame) * cap);
+        if (!frames) return -1;
+        vm->frames = frames;
+        vm->frame_cap = cap;
+    }
+    VMFrame* f = &vm->frames[vm->frame_count++];
+    f->ret_pc = ret_pc;
+    f->base = base;
+    f->size = size;
+    f->result = result;
+    return 0;
+}
+
+/* 按位宽回绕：无符号转有符号在 GCC/Clang 上按模 2^n 取值 */
+static long long vm_wrap(unsigned long long u, int bits) {
+    switch (bits) {
+        case 8: return (signed char)(unsigned char)u;
+        case 32: return (int)(unsigned)u;
+        default: return (long long)u;
+    }
+}
+
+static int vm_bits(VMTag t) {
+    return t == VM_I64 ? 64 : 32;
+}
+
+static VMValue vm_make_int(unsigned long long u, int bits) {
+    VMValue r;
+    r.tag = bits == 64 ? VM_I64 : VM_INT;
+    r.as.i = vm_wrap(u, bits);
+    return r;
+}
+
+static void vm_collect(VM* vm);
+
+static char* vm_new_string(VM* vm, size_t len) {
+    if (vm->str_count + vm->list_count >= vm->gc_next) vm_collect(vm);
+    if (vm->str_count >= vm->str_cap) {
+        vm->str_cap = vm->str_cap ? vm->str_cap * 2 : 64;
+        vm->strs = realloc(vm->strs, sizeof(char*) * vm->str_cap);
+    }
+    char* s = malloc(len + 1);
+    s[len] = '\0';
+    vm->strs[vm->str_count++] = s;
+    return s;
+}
+
+static VMList* vm_new_list(VM* vm, long long cap) {
+    if (vm->str_count + vm->list_count >= vm->gc_next) vm_collect(vm);
+    if (vm->list_count >= vm->list_cap) {
+        vm->list_cap = vm->list_cap ? vm->list_cap * 2 : 64;
+        vm->lists = realloc(vm->lists, sizeof(VMList*) * vm->list_cap);
+    }
+    VMList* l = malloc(sizeof(VMList));
+    l->len = 0;
+    l->mark = 0;
+    l->cap = cap > 0 ? cap : 4;
+    l->items = malloc(sizeof(VMValue) * l->cap);
+    vm->lists[vm->list_count++] = l;
+    return l;
+}
+
+static void vm_list_push(VMList* l, VMValue v) {
+    if (l->len >= l->cap) {
+        l->cap *= 2;
+        l->items = realloc(l->items, sizeof(VMValue) * l->cap);
+    }
+    l->items[l->len++] = v;
+}
+
+static void vm_mark_value(VM* vm, VMValue v);
+
+static void vm_mark_list(VM* vm, VMList* l) {
+    if (l->mark) return;
+    l->mark = 1;
+    for (long long i = 0; i < l->len; i++) vm_mark_value(vm, l->items[i]);
+}
+
+static void vm_mark_value(VM* vm, VMValue v) {
+    if (v.tag == VM_LIST) {
+        vm_mark_list(vm, v.as.l);
+    } else if (v.tag == VM_STR && v.as.s) {
+        if (vm->live_count >= vm->live_cap) {
+            vm->live_cap = vm->live_cap ? vm->live_cap * 2 : 256;
+            vm->live = realloc(vm->live, sizeof(const char*) * vm->live_cap);
+        }
+        vm->live[vm->live_count++] = v.as.s;
+    }
+}
+
+static int vm_ptr_cmp(const void* a, const void* b) {
+    const char* x = *(const char* const*)a;
+    const char* y = *(const char* const*)b;
+    return (x > y) - (x < y);
+}
+
+/*
+标记-清除：根是当前所有帧的寄存器 (帧是连续的，到栈顶帧为止)，
+列表递归标记，字符串把指针收进 live 排序后二分查。
+只在分配字符串/列表时触发，这时操作数都还在寄存器里；阈值按存活数翻倍，均摊 O(log n)。
+*/
+static void vm_collect(VM* vm) {
+    vm->live_count = 0;
+    if (vm->frame_count > 0) {
+        VMFrame* top = &vm->frames[vm->frame_count - 1];
+        long long end = (long long)top->base + top->size;
+        for (long long i = 0; i < end; i++) vm_mark_value(vm, vm->regs[i]);
+    }
+    if (vm->live_count > 1) qsort(vm->live, vm->live_count, sizeof(const char*), vm_ptr_cmp);
+
+    int n = 0;
+    for (int i = 0; i < vm->str_count; i++) {
+        const char* s = vm->strs[i];
+        if (vm->live_count && bsearch(&s, vm->live, vm->live_count, sizeof(const char*), vm_ptr_cmp)) {
+            vm->strs[n++] = vm->strs[i];
+        } else {
+            free(vm->strs[i]);
+        }
+    }
+    vm->str_count = n;
+
+    n = 0;
+    for (int i = 0; i < vm->list_count; i++) {
+        VMList* l = vm->lists[i];
+        if (l->mark) {
+            l->mark = 0;
+            vm->lists[n++] = l;
+        } else {
+            free(l->items);
+            free(l);
+        }
+    }
+    vm->list_count = n;
+
+    int alive = vm->str_count + vm->list_count;
+    vm->gc_next = alive * 2 > VM_GC_MIN ? alive * 2 : VM_GC_MIN;
+}
+
+static void vm_free(VM* vm) {
+    for (int i = 0; i < vm->str_count; i++) free(vm->strs[i]);
+    for (int i = 0; i < vm->list_count; i++) {
+        free(vm->lists[i]->items);
+        free(vm->lists[i]);
+    }
+    free(vm->strs);
+    free(vm->lists);
+    free(vm->live);
+    free(vm->regs);
+    free(vm->frames);
+}
+
+static int vm_truthy(VMValue v) {
+    switch (v.tag) {
+        case VM_INT:
+        case VM_I64:
+        case VM_CHAR: return v.as.i != 0;
+        case VM_FLOAT: return v.as.f != 0.0;
+        case VM_STR: return v.as.s != NULL;
+        case VM_LIST: return v.as.l != NULL;
+        default: return 0;
+    }
+}
+
+static int vm_is_intlike(VMValue v) {
+    return v.tag == VM_INT || v.tag == VM_I64 || v.tag == VM_CHAR;
+}
+
+static int vm_is_number(VMValue v) {
+    return vm_is_intlike(v) || v.tag == VM_FLOAT;
+}
+
+static double vm_to_double(VMValue v) {
+    return v.tag == VM_FLOAT ? v.as.f : (double)v.as.i;
+}
+
+static const char* vm_text(VMValue v, char* buf, size_t size) {
+    switch (v.tag) {
+        case VM_INT:
+        case VM_I64: snprintf(buf, size, "%lld", v.as.i); return buf;
+        case VM_FLOAT: snprintf(buf, size, "%f", v.as.f); return buf;
+        case VM_CHAR: snprintf(buf, size, "%c", (char)v.as.i); return buf;
+        case VM_STR: return v.as.s ? v.as.s : "";
+        case VM_LIST: snprintf(buf, size, "[list]"); return buf;
+        default: return "nil";
+    }
+}
+
+static void vm_print_value(FILE* out, VMValue v) {
+    switch (v.tag) {
+        case VM_INT:
+        case VM_I64: fprintf(out, "%lld", v.as.i); break;
+        case VM_FLOAT: fprintf(out, "%f", v.as.f); break;
+        case VM_CHAR: fputc((char)v.as.i, out); break;
+        case VM_STR: fputs(v.as.s ? v.as.s : "", out); break;
+        case VM_LIST:
+            fputc('[', out);
+            for (long long i = 0; i < v.as.l->len; i++) {
+                if (i) fputs(", ", out);
+                vm_print_value(out, v.as.l->items[i]);
+            }
+            fputc(']', out);
+            break;
+        default: fputs("nil", out); break;
+    }
+}
+
+static VMValue vm_concat(VM* vm, VMValue a, VMValue b) {
+    char ba[64], bb[64];
+    const char* sa = vm_text(a, ba, sizeof(ba));
+    const char* sb = vm_text(b, bb, sizeof(bb));
+    size_t la = strlen(sa), lb = strlen(sb);
+    char* s = vm_new_string(vm, la + lb);
+    memcpy(s, sa, la);
+    memcpy(s + la, sb, lb);
+    VMValue r;
+    r.tag = VM_STR;
+    r.as.s = s;
+    return r;
+}
+
+static unsigned long long vm_ipow(unsigned long long base, long long exp) {
+    unsigned long long r = 1;
+    while (exp > 0) {
+        if (exp & 1) r *= base;
+        base *= base;
+        exp >>= 1;
+    }
+    return r;
+}
+
+static const char* vm_op_name(ByteCodeInstruction op) {
+    switch (op) {
+        case BC_ADD: return "+";
+        case BC_SUB: return "-";
+        case BC_MUL: return "*";
+        case BC_DIV: return "/";
+        case BC_MOD: return "%";
+        case BC_POW: return "**";
+        case BC_LT: return "<";
+        case BC_LE: return "<=";
+        case BC_GT: return ">";
+        case BC_GE: return ">=";
+        default: return "?";
+    }
+}
+
+/* 慢路径：非 int/int 的运算，以及需要报错的情况 */
+static int vm_binop(VM* vm, int pc, ByteCodeInstruction op, VMValue a, VMValue b, VMValue* out) {
+    VMValue r;
+    r.tag = VM_INT;
+    r.as.i = 0;
+
+    switch (op) {
+        case BC_AND:
+            r.as.i = vm_truthy(a) && vm_truthy(b);
+            *out = r;
+            return 0;
+        case BC_OR:
+            r.as.i = vm_truthy(a) || vm_truthy(b);
+            *out = r;
+            return 0;
+        case BC_CONCAT:
+            *out = vm_concat(vm, a, b);
+            return 0;
+        case BC_EQ:
+        case BC_NE: {
+            int eq;
+            if (a.tag == VM_STR && b.tag == VM_STR) {
+                eq = strcmp(a.as.s, b.as.s) == 0;
+            } else if (vm_is_number(a) && vm_is_number(b)) {
+                eq = (vm_is_intlike(a) && vm_is_intlike(b)) ? a.as.i == b.as.i : vm_to_double(a) == vm_to_double(b);
+            } else if (a.tag == VM_NIL || b.tag == VM_NIL) {
+                eq = !vm_truthy(a) && !vm_truthy(b);
+            } else if (a.tag == VM_LIST && b.tag == VM_LIST) {
+                eq = a.as.l == b.as.l;
+            } else {
+                eq = 0;
+            }
+            r.as.i = op == BC_EQ ? eq : !eq;
+            *out = r;
+            return 0;
+        }
+        case BC_LT:
+        case BC_LE:
+        case BC_GT:
+        case BC_GE: {
+            int cmp;
+            if (a.tag == VM_STR && b.tag == VM_STR) {
+                cmp = strcmp(a.as.s, b.as.s);
+            } else if (vm_is_number(a) && vm_is_number(b)) {
+                if (vm_is_intlike(a) && vm_is_intlike(b)) {
+                    cmp = (a.as.i > b.as.i) - (a.as.i < b.as.i);
+                } else {
+                    double x = vm_to_double(a), y = vm_to_double(b);
+                    cmp = (x > y) - (x < y);
+                }
+            } else {
+                return vm_error(vm, pc, "cannot compare these values with '%s'", vm_op_name(op));
+            }
+            r.as.i = op == BC_LT ? cmp < 0 : op == BC_LE ? cmp <= 0 : op == BC_GT ? cmp > 0 : cmp >= 0;
+            *out = r;
+            return 0;
+        }
+        default:
+            break;
+    }
+
+    if (op == BC_ADD && (a.tag == VM_STR || b.tag == VM_STR)) {
+        *out = vm_concat(vm, a, b);
+        return 0;
+    }
+    if ((op == BC_MUL || op == BC_REPEAT) && a.tag == VM_STR && vm_is_intlike(b)) {
+        size_t la = strlen(a.as.s);
+        long long n = b.as.i > 0 ? b.as.i : 0;
+        char* s = vm_new_string(vm, la * (size_t)n);
+        for (long long i = 0; i < n; i++) memcpy(s + la * (size_t)i, a.as.s, la);
+        out->tag = VM_STR;
+        out->as.s = s;
+        return 0;
+    }
+    if (!vm_is_number(a) || !vm_is_number(b)) {
+        return vm_error(vm, pc, "unsupported operand types for '%s'", vm_op_name(op));
+    }
+
+    if (vm_is_intlike(a) && vm_is_intlike(b)) {
+        int bits = a.tag == VM_I64 || b.tag == VM_I64 ? 64 : 32;
+        unsigned long long x = (unsigned long long)a.as.i, y = (unsigned long long)b.as.i;
+        switch (op) {
+            case BC_ADD: r = vm_make_int(x + y, bits); break;
+            case BC_SUB: r = vm_make_int(x - y, bits); break;
+            case BC_MUL:
+            case BC_REPEAT: r = vm_make_int(x * y, bits); break;
+            case BC_DIV:
+            case BC_MOD:
+                if (b.as.i == 0) return vm_error(vm, pc, "division by zero");
+                /* MIN / -1 在 C 里是未定义行为：商按取负回绕，余数是 0 */
+                if (b.as.i == -1) {
+                    r = vm_make_int(op == BC_DIV ? 0 - x : 0, bits);
+                } else {
+                    r = vm_make_int((unsigned long long)(op == BC_DIV ? a.as.i / b.as.i : a.as.i % b.as.i), bits);
+                }
+                break;
+            case BC_POW:
+                if (b.as.i < 0) {
+                    r.tag = VM_FLOAT;
+                    r.as.f = pow((double)a.as.i, (double)b.as.i);
+                } else {
+                    r = vm_make_int(vm_ipow(x, b.as.i), bits);
+                }
+                break;
+            default:
+                return vm_error(vm, pc, "unsupported integer operation");
+        }
+        *out = r;
+        return 0;
+    }
+
+    double x = vm_to_double(a), y = vm_to_double(b);
+    r.tag = VM_FLOAT;
+    switch (op) {
+        case BC_ADD: r.as.f = x + y; break;
+        case BC_SUB: r.as.f = x - y; break;
+        case BC_MUL:
+        case BC_REPEAT: r.as.f = x * y; break;
+        case BC_DIV: r.as.f = x / y; break;
+        case BC_MOD: r.as.f = fmod(x, y); break;
+        case BC_POW: r.as.f = pow(x, y); break;
+        default:
+            return vm_error(vm, pc, "unsupported float operation");
+    }
+    *out = r;
+    return 0;
+}
+
+static long long vm_as_int(VMValue v) {
+    switch (v.tag) {
+        case VM_INT:
+        case VM_I64:
+        case VM_CHAR: return v.as.i;
+        case VM_FLOAT: return (long long)v.as.f;
+        case VM_STR: return v.as.s ? strtoll(v.as.s, NULL, 10) : 0;
+        default: return 0;
+    }
+}
+
+static double vm_as_float(VMValue v) {
+    switch (v.tag) {
+        case VM_INT:
+        case VM_I64:
+        case VM_CHAR: return (double)v.as.i;
+        case VM_FLOAT: return v.as.f;
+        case VM_STR: return v.as.s ? strtod(v.as.s, NULL) : 0.0;
+        default: return 0.0;
+    }
+}
+
+static VMValue vm_read_line(VM* vm, VMValue prompt) {
+    VMValue r;
+    if (prompt.tag == VM_STR && prompt.as.s) {
+        fputs(prompt.as.s, stdout);
+    }
+    fflush(stdout);
+    char* line = NULL;
+    size_t cap = 0;
+    ssize_t n = getline(&line, &cap, stdin);
+    if (n < 0) n = 0;
+    while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) n--;
+    char* s = vm_new_string(vm, (size_t)n);
+    if (n > 0) memcpy(s, line, (size_t)n);
+    free(line);
+    r.tag = VM_STR;
+    r.as.s = s;
+    return r;
+}
+
+#ifdef VM_COMPUTED_GOTO
+#define VM_SWITCH(op) goto *dispatch[op];
+#define VM_CASE(op) L_##op
+#define VM_DISPATCH() do { bc = &codes[pc]; goto *dispatch[bc->op]; } while (0)
+#else
+#define VM_SWITCH(op) switch (op)
+#define VM_CASE(op) case op
+#define VM_DISPATCH() continue
+#endif
+
+/* VM_INT 和 VM_I64 都走快路径，结果取较宽的一边 (VM_I64 > VM_INT) */
+#define VM_IS_INT(t) ((unsigned)((t) - VM_INT) <= (unsigned)(VM_I64 - VM_INT))
+
+/* UEXPR 在无符号的 x、y 上算，再按结果宽度截回 */
+#define VM_ARITH(OP, UEXPR)                                                          \
+    VM_CASE(OP): {                                                                   \
+        VMValue a = R[bc->operand.triaddr.operand1];                                 \
+        VMValue b = R[bc->operand.triaddr.operand2];                                 \
+        if (VM_IS_INT(a.tag) && VM_IS_INT(b.tag)) {                                  \
+            unsigned long long x = (unsigned long long)a.as.i;                       \
+            unsigned long long y = (unsigned long long)b.as.i;                       \
+            VMValue* d = &R[bc->operand.triaddr.result];                             \
+            VMTag t = a.tag > b.tag ? a.tag : b.tag;                                 \
+            d->as.i = t == VM_INT ? (long long)(int)(unsigned)(UEXPR) : (long long)(UEXPR); \
+            d->tag = t;                                                              \
+        } else if (vm_binop(&vm, pc, OP, a, b, &R[bc->operand.triaddr.result]) != 0) { \
+            goto fail;                                                               \
+        }                                                                            \
+        pc++;                                                                        \
+        VM_DISPATCH();                                                               \
+    }
+
+/* 定宽的加减乘：位宽在编译期定好了，不再按标记挑结果宽度；标记不对 (比如参数传进来的是 float) 才走慢路径 */
+#define VM_ARITH_I32(OP, GENERIC, UEXPR)                                             \
+    VM_CASE(OP): {                                                                   \
+        VMValue a = R[bc->operand.triaddr.operand1];                                 \
+        VMValue b = R[bc->operand.triaddr.operand2];                                 \
+        if (a.tag == VM_INT && b.tag == VM_INT) {                                    \
+            unsigned x = (unsigned)a.as.i;                                           \
+            unsigned y = (unsigned)b.as.i;                                           \
+            VMValue* d = &R[bc->operand.triaddr.result];                             \
+            d->tag = VM_INT;                                                         \
+            d->as.i = (int)(UEXPR);                                                  \
+        } else if (vm_binop(&vm, pc, GENERIC, a, b, &R[bc->operand.triaddr.result]) != 0) { \
+            goto fail;                                                               \
+        }                                                                            \
+        pc++;                                                                        \
+        VM_DISPATCH();                                                               \
+    }
+
+#define VM_ARITH_I64(OP, GENERIC, UEXPR)                                             \
+    VM_CASE(OP): {                                                                   \
+        VMValue a = R[bc->operand.triaddr.operand1];                                 \
+        VMValue b = R[bc->operand.triaddr.operand2];                                 \
+        if (VM_IS_INT(a.tag) && VM_IS_INT(b.tag)) {                                  \
+            unsigned long long x = (unsigned long long)a.as.i;                       \
+            unsigned long long y = (unsigned long long)b.as.i;                       \
+            VMValue* d = &R[bc->operand.triaddr.result];                             \
+            d->tag = VM_I64;                                                         \
+            d->as.i = (long long)(UEXPR);                                            \
+        } else if (vm_binop(&vm, pc, GENERIC, a, b, &R[bc->operand.triaddr.result]) != 0) { \
+            goto fail;                                                               \
+        }                                                                            \
+        pc++;                                                                        \
+        VM_DISPATCH();                                                               \
+    }
+
+#define VM_COMPARE(OP, EXPR)                                                         \
+    VM_CASE(OP): {                                                                   \
+        VMValue a = R[bc->operand.triaddr.operand1];                                 \
+        VMValue b = R[bc->operand.triaddr.operand2];                                 \
+        if (VM_IS_INT(a.tag) && VM_IS_INT(b.tag)) {                                  \
+            VMValue* d = &R[bc->operand.triaddr.result];                             \
+            d->tag = VM_INT;                                                         \
+            d->as.i = (EXPR);                                                        \
+        } else if (vm_binop(&vm, pc, OP, a, b, &R[bc->operand.triaddr.result]) != 0) { \
+            goto fail;                                                               \
+        }                                                                            \
+        pc++;                                                                        \
+        VM_DISPATCH();                                                               \
+    }
+
+/* 除数是 0 或 -1 (MIN / -1 会溢出) 交给慢路径 */
+#define VM_DIVIDE(OP, EXPR)                                                          \
+    VM_CASE(OP): {                                                                   \
+        VMValue a = R[bc->operand.triaddr.operand1];                                 \
+        VMValue b = R[bc->operand.triaddr.operand2];                                 \
+        if (VM_IS_INT(a.tag) && VM_IS_INT(b.tag) && b.as.i != 0 && b.as.i != -1) {   \
+            VMValue* d = &R[bc->operand.triaddr.result];                             \
+            d->tag = a.tag > b.tag ? a.tag : b.tag;                                  \
+            d->as.i = (EXPR);                                                        \
+        } else if (vm_binop(&vm, pc, OP, a, b, &R[bc->operand.triaddr.result]) != 0) { \
+            goto fail;                                                               \
+        }                                                                            \
+        pc++;                                                                        \
+        VM_DISPATCH();                                                               \
+    }
+
+int vm_run(ByteCodeList* code) {
+    VM vm;
+    memset(&vm, 0, sizeof(vm));
+    vm.code = code;
+
+    int exit_code = 0;
+    int pc = 0;
+    ByteCode* codes = code->codes;
+    ByteCode* bc;
+    VMValue* R;
+
+    if (vm_ensure_regs(&vm, code->entry_frame_size) != 0 ||
+        vm_push_frame(&vm, -1, 0, code->entry_frame_size, -1) != 0) {
+        fprintf(stderr, "Error: vm: out of memory\n");
+        vm_free(&vm);
+        return 1;
+    }
+    R = vm.regs;
+    if (code->count == 0) goto done;
+
+#ifdef VM_COMPUTED_GOTO
+    static void* dispatch[BC_OP_COUNT] = {
+        [BC_LOAD_CONST_INT] = &&L_BC_LOAD_CONST_INT,
+        [BC_LOAD_CONST_FLOAT] = &&L_BC_LOAD_CONST_FLOAT,
+        [BC_LOAD_CONST_STRING] = &&L_BC_LOAD_CONST_STRING,
+        [BC_LOAD_CONST_CHAR] = &&L_BC_LOAD_CONST_CHAR,
+        [BC_LOAD_NAME] = &&L_BC_LOAD_NAME,
+        [BC_STORE_NAME] = &&L_BC_STORE_NAME,
+        [BC_PRINT] = &&L_BC_PRINT,
+        [BC_INPUT] = &&L_BC_INPUT,
+        [BC_TOINT] = &&L_BC_TOINT,
+        [BC_TOFLOAT] = &&L_BC_TOFLOAT,
+        [BC_ADD] = &&L_BC_ADD,
+        [BC_SUB] = &&L_BC_SUB,
+        [BC_MUL] = &&L_BC_MUL,
+        [BC_DIV] = &&L_BC_DIV,
+        [BC_MOD] = &&L_BC_MOD,
+        [BC_POW] = &&L_BC_POW,
+        [BC_CONCAT] = &&L_BC_CONCAT,
+        [BC_REPEAT] = &&L_BC_REPEAT,
+        [BC_NEG] = &&L_BC_NEG,
+        [BC_POS] = &&L_BC_POS,
+        [BC_EQ] = &&L_BC_EQ,
+        [BC_NE] = &&L_BC_NE,
+        [BC_LT] = &&L_BC_LT,
+        [BC_LE] = &&L_BC_LE,
+        [BC_GT] = &&L_BC_GT,
+        [BC_GE] = &&L_BC_GE,
+        [BC_AND] = &&L_BC_AND,
+        [BC_OR] = &&L_BC_OR,
+        [BC_JUMP] = &&L_BC_JUMP,
+        [BC_JUMP_IF_FALSE] = &&L_BC_JUMP_IF_FALSE,
+        [BC_BREAK] = &&L_BC_BREAK,
+        [BC_CONTINUE] = &&L_BC_CONTINUE,
+        [BC_FOR_PREPARE] = &&L_BC_FOR_PREPARE,
+        [BC_FOR_LOOP] = &&L_BC_FOR_LOOP,
+        [BC_FUNCTION_DEF] = &&L_BC_FUNCTION_DEF,
+        [BC_CALL] = &&L_BC_CALL,
+        [BC_RETURN] = &&L_BC_RETURN,
+        [BC_ADDRESS] = &&L_BC_ADDRESS,
+        [BC_DEREF] = &&L_BC_DEREF,
+        [BC_INDEX] = &&L_BC_INDEX,
+        [BC_STRUCT_DEF] = &&L_BC_STRUCT_DEF,
+        [BC_STRUCT_CREATE] = &&L_BC_STRUCT_CREATE,
+        [BC_STRUCT_GET_FIELD] = &&L_BC_STRUCT_GET_FIELD,
+        [BC_STRUCT_SET_FIELD] = &&L_BC_STRUCT_SET_FIELD,
+        [BC_MOVE] = &&L_BC_MOVE,
+        [BC_LOAD_NIL] = &&L_BC_LOAD_NIL,
+        [BC_LIST_NEW] = &&L_BC_LIST_NEW,
+        [BC_LIST_PUSH] = &&L_BC_LIST_PUSH,
+        [BC_INDEX_SET] = &&L_BC_INDEX_SET,
+        [BC_LENGTH] = &&L_BC_LENGTH,
+        [BC_LOAD_CONST_I64] = &&L_BC_LOAD_CONST_I64,
+        [BC_ADD_I32] = &&L_BC_ADD_I32,
+        [BC_ADD_I64] = &&L_BC_ADD_I64,
+        [BC_SUB_I32] = &&L_BC_SUB_I32,
+        [BC_SUB_I64] = &&L_BC_SUB_I64,
+        [BC_MUL_I32] = &&L_BC_MUL_I32,
+        [BC_MUL_I64] = &&L_BC_MUL_I64,
+        [BC_HALT] = &&L_BC_HALT,
+    };
+#endif
+    vm.gc_next = VM_GC_MIN;
+
+    for (;;) {
+        bc = &codes[pc];
+        VM_SWITCH(bc->op) {
+            VM_CASE(BC_LOAD_CONST_INT):
+                R[bc->reg].tag = VM_INT;
+                R[bc->reg].as.i = bc->operand.int_value;
+                pc++;
+                VM_DISPATCH();
+            VM_CASE(BC_LOAD_CONST_I64):
+                R[bc->reg].tag = VM_I64;
+                R[bc->reg].as.i = bc->operand.int_value;
+                pc++;
+                VM_DISPATCH();
+            VM_CASE(BC_LOAD_CONST_FLOAT):
+                R[bc->reg].tag = VM_FLOAT;
+                R[bc->reg].as.f = bc->operand.float_value;
+                pc++;
+                VM_DISPATCH();
+            VM_CASE(BC_LOAD_CONST_STRING):
+                R[bc->reg].tag = VM_STR;
+                R[bc->reg].as.s = bc->operand.string_value;
+                pc++;
+                VM_DISPATCH();
+            VM_CASE(BC_LOAD_CONST_CHAR):
+                R[bc->reg].tag = VM_CHAR;
+                R[bc->reg].as.i = bc->operand.int_value;
+                pc++;
+                VM_DISPATCH();
+            VM_CASE(BC_LOAD_NIL):
+                R[bc->reg].tag = VM_NIL;
+                R[bc->reg].as.i = 0;
+                pc++;
+                VM_DISPATCH();
+            VM_CASE(BC_LOAD_NAME):
+                R[bc->reg] = vm.regs[bc->operand.var_index];
+                pc++;
+                VM_DISPATCH();
+            VM_CASE(BC_STORE_NAME):
+                vm.regs[bc->operand.var_index] = R[bc->reg];
+                pc++;
+                VM_DISPATCH();
+            VM_CASE(BC_MOVE):
+            VM_CASE(BC_POS):
+                R[bc->operand.triaddr.result] = R[bc->operand.triaddr.operand1];
+                pc++;
+                VM_DISPATCH();
+            VM_CASE(BC_NEG): {
+                VMValue v = R[bc->operand.triaddr.operand1];
+                VMValue* d = &R[bc->operand.triaddr.result];
+                if (v.tag == VM_FLOAT) {
+                    d->tag = VM_FLOAT;
+                    d->as.f = -v.as.f;
+                } else if (vm_is_intlike(v)) {
+                    *d = vm_make_int(0 - (unsigned long long)v.as.i, vm_bits(v.tag));
+                } else {
+                    vm_error(&vm, pc, "unary '-' needs a number");
+                    goto fail;
+                }
+                pc++;
+                VM_DISPATCH();
+            }
+
+            VM_ARITH(BC_ADD, x + y)
+            VM_ARITH(BC_SUB, x - y)
+            VM_ARITH(BC_MUL, x * y)
+            VM_ARITH_I32(BC_ADD_I32, BC_ADD, x + y)
+            VM_ARITH_I32(BC_SUB_I32, BC_SUB, x - y)
+            VM_ARITH_I32(BC_MUL_I32, BC_MUL, x * y)
+            VM_ARITH_I64(BC_ADD_I64, BC_ADD, x + y)
+            VM_ARITH_I64(BC_SUB_I64, BC_SUB, x - y)
+            VM_ARITH_I64(BC_MUL_I64, BC_MUL, x * y)
+            VM_DIVIDE(BC_DIV, a.as.i / b.as.i)
+            VM_DIVIDE(BC_MOD, a.as.i % b.as.i)
+            VM_COMPARE(BC_EQ, a.as.i == b.as.i)
+            VM_COMPARE(BC_NE, a.as.i != b.as.i)
+            VM_COMPARE(BC_LT, a.as.i < b.as.i)
+            VM_COMPARE(BC_LE, a.as.i <= b.as.i)
+            VM_COMPARE(BC_GT, a.as.i > b.as.i)
+            VM_COMPARE(BC_GE, a.as.i >= b.as.i)
+            VM_COMPARE(BC_AND, a.as.i && b.as.i)
+            VM_COMPARE(BC_OR, a.as.i || b.as.i)
+
+            VM_CASE(BC_POW):
+            VM_CASE(BC_CONCAT):
+            VM_CASE(BC_REPEAT):
+                if (vm_binop(&vm, pc, bc->op, R[bc->operand.triaddr.operand1], R[bc->operand.triaddr.operand2],
+                             &R[bc->operand.triaddr.result]) != 0) {
+                    goto fail;
+                }
+                pc++;
+                VM_DISPATCH();
+
+            VM_CASE(BC_JUMP):
+                pc = bc->operand.jump_args.address;
+                VM_DISPATCH();
+            VM_CASE(BC_JUMP_IF_FALSE):
+                pc = vm_truthy(R[bc->reg]) ? pc + 1 : bc->operand.jump_args.address;
+                VM_DISPATCH();
+
+            VM_CASE(BC_FOR_PREPARE): {
+                ForArgs* fa = &bc->operand.for_args;
+                VMValue* var = &R[fa->var_index];
+                int bits = var->tag == VM_I64 || R[fa->end_index].tag == VM_I64 ? 64 : 32;
+                long long start = vm_wrap((unsigned long long)vm_as_int(*var), bits);
+                long long end = vm_wrap((unsigned long long)vm_as_int(R[fa->end_index]), bits);
+                *var = vm_make_int((unsigned long long)start, bits);
+                R[fa->end_index] = vm_make_int((unsigned long long)end, bits);
+                R[fa->step_index].tag = VM_INT;
+                R[fa->step_index].as.i = start > end ? -1 : 1;
+                pc = start == end ? fa->address : pc + 1;
+                VM_DISPATCH();
+            }
+            VM_CASE(BC_FOR_LOOP): {
+                ForArgs* fa = &bc->operand.for_args;
+                long long step = R[fa->step_index].as.i;
+                long long end = R[fa->end_index].as.i;
+                int bits = vm_bits(R[fa->end_index].tag);
+                VMValue next = vm_make_int((unsigned long long)vm_as_int(R[fa->var_index]) + (unsigned long long)step, bits);
+                long long i = next.as.i;
+                R[fa->var_index] = next;
+                pc = (step > 0 ? i < end : i > end) ? fa->address : pc + 1;
+                VM_DISPATCH();
+            }
+
+            VM_CASE(BC_FUNCTION_DEF):
+                pc++;
+                VM_DISPATCH();
+            VM_CASE(BC_CALL): {
+                CallArgs* ca = &bc->operand.call_args;
+                FunctionDefArgs* fd = &codes[ca->func_index].operand.func_def_args;
+                VMFrame* cur = &vm.frames[vm.frame_count - 1];
+                int base = cur->base;
+                int nbase = base + cur->size;
+                if (vm.frame_count >= VM_MAX_FRAMES) {
+                    vm_error(&vm, pc, "stack overflow in call to '%s'", ca->name);
+                    goto fail;
+                }
+                if (vm_ensure_regs(&vm, (long long)nbase + fd->frame_size) != 0) {
+                    vm_error(&vm, pc, "out of memory");
+                    goto fail;
+                }
+                R = vm.regs + base;
+                VMValue* callee = vm.regs + nbase;
+                memset(callee, 0, sizeof(VMValue) * fd->frame_size);
+                if (ca->wrap_args) {
+                    for (int i = 0; i < ca->arg_count; i++) {
+                        VMValue v = R[ca->arg_indices[i]];
+                        int bits = fd->param_bits[i];
+                        if (bits && vm_is_intlike(v)) v = vm_make_int((unsigned long long)v.as.i, bits);
+                        callee[fd->param_indices[i]] = v;
+                    }
+                } else {
+                    for (int i = 0; i < ca->arg_count; i++) callee[fd->param_indices[i]] = R[ca->arg_indices[i]];
+                }
+                if (vm_push_frame(&vm, pc + 1, nbase, fd->frame_size, ca->result_index) != 0) {
+                    vm_error(&vm, pc, "out of memory");
+                    goto fail;
+                }
+                R = callee;
+                pc = fd->entry_point;
+                VM_DISPATCH();
+            }
+            VM_CASE(BC_RETURN): {
+                VMValue v;
+                if (bc->reg >= 0) {
+                    v = R[bc->reg];
+                } else {
+                    v.tag = VM_NIL;
+                    v.as.i = 0;
+                }
+                if (bc->operand.int_value && vm_is_intlike(v)) v = vm_make_int((unsigned long long)v.as.i, (int)bc->operand.int_value);
+                VMFrame f = vm.frames[--vm.frame_count];
+                if (vm.frame_count == 0) {
+                    exit_code = vm_is_intlike(v) ? (int)v.as.i : 0;
+                    goto done;
+                }
+                R = vm.regs + vm.frames[vm.frame_count - 1].base;
+                if (f.result >= 0) R[f.result] = v;
+                pc = f.ret_pc;
+                VM_DISPATCH();
+            }
+            VM_CASE(BC_HALT):
+                if (bc->reg >= 0 && vm_is_intlike(R[bc->reg])) {
+                    exit_code = (int)R[bc->reg].as.i;
+                }
+                goto done;
+
+            VM_CASE(BC_PRINT): {
+                PrintArgs* pa = &bc->operand.print_args;
+                for (int i = 0; i < pa->arg_count; i++) {
+                    vm_print_value(stdout, R[pa->arg_indices[i]]);
+                }
+                fputc('\n', stdout);
+                pc++;
+                VM_DISPATCH();
+            }
+            VM_CASE(BC_INPUT):
+                R[bc->operand.triaddr.result] = vm_read_line(&vm, R[bc->operand.triaddr.operand1]);
+                pc++;
+                VM_DISPATCH();
+            VM_CASE(BC_TOINT): {
+                /* 和原生一样 toint 的结果是 i32 */
+                long long v = vm_as_int(R[bc->operand.triaddr.operand1]);
+                R[bc->operand.triaddr.result] = vm_make_int((unsigned long long)v, 32);
+                pc++;
+                VM_DISPATCH();
+            }
+            VM_CASE(BC_TOFLOAT): {
+                double v = vm_as_float(R[bc->operand.triaddr.operand1]);
+                R[bc->operand.triaddr.result].tag = VM_FLOAT;
+                R[bc->operand.triaddr.result].as.f = v;
+                pc++;
+                VM_DISPATCH();
+            }
+
+            VM_CASE(BC_LIST_NEW): {
+                /* 先分配再写寄存器：分配可能触发回收，不能让它看到半写的值 */
+                VMList* l = vm_new_list(&vm, bc->operand.int_value);
+                R[bc->reg].tag = VM_LIST;
+                R[bc->reg].as.l = l;
+                pc++;
+                VM_DISPATCH();
+            }
+            VM_CASE(BC_LIST_PUSH): {
+                VMValue list = R[bc->operand.triaddr.operand1];
+                if (list.tag != VM_LIST) {
+                    vm_error(&vm, pc, "push on a value that is not a list");
+                    goto fail;
+                }
+                vm_list_push(list.as.l, R[bc->operand.triaddr.operand2]);
+                pc++;
+                VM_DISPATCH();
+            }
+            VM_CASE(BC_INDEX): {
+                IndexArgs* ia = &bc->operand.index_args;
+                VMValue t = R[ia->target_index];
+                VMValue ix = R[ia->index_index];
+                if (!vm_is_intlike(ix)) {
+                    vm_error(&vm, pc, "index must be an integer");
+                    goto fail;
+                }
+                if (t.tag == VM_LIST) {
+                    if (ix.as.i < 0 || ix.as.i >= t.as.l->len) {
+                        vm_error(&vm, pc, "index %lld out of bounds for list of length %lld", ix.as.i, t.as.l->len);
+                        goto fail;
+                    }
+                    R[ia->result_index] = t.as.l->items[ix.as.i];
+                } else if (t.tag == VM_STR) {
+                    long long len = (long long)strlen(t.as.s);
+                    if (ix.as.i < 0 || ix.as.i >= len) {
+                        vm_error(&vm, pc, "index %lld out of bounds for string of length %lld", ix.as.i, len);
+                        goto fail;
+                    }
+                    R[ia->result_index].tag = VM_CHAR;
+                    R[ia->result_index].as.i = (unsigned char)t.as.s[ix.as.i];
+                } else {
+                    vm_error(&vm, pc, "value is not indexable");
+                    goto fail;
+                }
+                pc++;
+                VM_DISPATCH();
+            }
+            VM_CASE(BC_INDEX_SET): {
+                IndexArgs* ia = &bc->operand.index_args;
+                VMValue t = R[ia->target_index];
+                VMValue ix = R[ia->index_index];
+                if (t.tag != VM_LIST || !vm_is_intlike(ix)) {
+                    vm_error(&vm, pc, "only list elements can be assigned by index");
+                    goto fail;
+                }
+                if (ix.as.i < 0 || ix.as.i >= t.as.l->len) {
+                    vm_error(&vm, pc, "index %lld out of bounds for list of length %lld", ix.as.i, t.as.l->len);
+                    goto fail;
+                }
+                t.as.l->items[ix.as.i] = R[ia->result_index];
+                pc++;
+                VM_DISPATCH();
+            }
+            VM_CASE(BC_LENGTH): {
+                VMValue v = R[bc->operand.triaddr.operand1];
+                long long len;
+                if (v.tag == VM_LIST) {
+                    len = v.as.l->len;
+                } else if (v.tag == VM_STR) {
+                    len = (long long)strlen(v.as.s);
+                } else {
+                    vm_error(&vm, pc, ".length on a value that is not a list or string");
+                    goto fail;
+                }
+                R[bc->operand.triaddr.result].tag = VM_I64;
+                R[bc->operand.triaddr.result].as.i = len;
+                pc++;
+                VM_DISPATCH();
+            }
+
+            VM_CASE(BC_BREAK):
+            VM_CASE(BC_CONTINUE):
+            VM_CASE(BC_ADDRESS):
+            VM_CASE(BC_DEREF):
+            VM_CASE(BC_STRUCT_DEF):
+            VM_CASE(BC_STRUCT_CREATE):
+            VM_CASE(BC_STRUCT_GET_FIELD):
+            VM_CASE(BC_STRUCT_SET_FIELD):
+#ifndef VM_COMPUTED_GOTO
+            default:
+#endif
+                vm_error(&vm, pc, "unsupported bytecode %d", (int)bc->op);
+                goto fail;
+        }
+    }
+
+fail:
+    exit_code = 1;
+done:
+    fflush(stdout);
+    vm_free(&vm);
+    return exit_code;
+}
+
+int vm_run_ast(ASTNode* root, int dump) {
+    ByteCodeGen* gen = create_bytecode_gen();
+    if (!gen) return 1;
+    generate_bytecode_program(gen, root);
+    if (finalize_bytecode(gen) > 0) {
+        fprintf(stderr, "Error: Found %d error(s) while generating bytecode\n", gen->error_count);
+        free_bytecode_gen(gen);
+        return 1;
+    }
+    if (dump) {
+        print_bytecode_to_file(gen->bytecode, stderr);
+    }
+    int rc = vm_run(gen->bytecode);
+    free_bytecode_gen(gen);
+    return rc;
+}